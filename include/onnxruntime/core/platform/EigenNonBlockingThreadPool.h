@@ -42,6 +42,7 @@
 #endif
 #include "core/common/denormal.h"
 #include "core/common/spin_pause.h"
+#include "core/common/logging/logging.h"
 #include "core/platform/ort_mutex.h"
 #include "core/platform/Barrier.h"
 
@@ -324,6 +325,11 @@ class ExtendedThreadPoolInterface : public Eigen::ThreadPoolInterface {
                              unsigned n, std::ptrdiff_t block_size) = 0;
   virtual void StartProfiling()  = 0;
   virtual std::string StopProfiling() = 0;
+
+  // Return the OS-level thread ids of the worker threads, in worker
+  // index order.  Workers which have not yet started report 0.  Used
+  // by the perf profiler to open hardware counters on each worker.
+  virtual std::vector<unsigned> GetWorkerThreadIds() const = 0;
 };
 
 
@@ -686,6 +692,15 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
     return profiler_.Stop();
   }
 
+  std::vector<unsigned> GetWorkerThreadIds() const override {
+    std::vector<unsigned> ids;
+    ids.reserve(num_threads_);
+    for (const auto& td : worker_data_) {
+      ids.push_back(td.os_thread_id.load(std::memory_order_acquire));
+    }
+    return ids;
+  }
+
   struct Tag {
     constexpr Tag() : v_(0) {
     }
@@ -1337,6 +1352,10 @@ int CurrentThreadId() const final {
     std::unique_ptr<Thread> thread;
     Queue queue;
 
+    // OS thread id of the worker, published once the worker enters
+    // WorkerLoop, and 0 until then.
+    std::atomic<unsigned> os_thread_id{0};
+
     // Each thread has a status, available read-only without locking, and protected
     // by the mutex field below for updates.  The status is used for three
     // purposes:
@@ -1460,6 +1479,7 @@ int CurrentThreadId() const final {
 
     SetDenormalAsZero(set_denormal_as_zero_);
     profiler_.LogThreadId(thread_id);
+    td.os_thread_id.store(onnxruntime::logging::GetThreadId(), std::memory_order_release);
 
     while (!should_exit) {
       Task t = q.PopFront();
@@ -360,12 +360,21 @@ class ThreadPool {
   // working in combination with the thread initiating the loop.
   static int DegreeOfParallelism(const ThreadPool* tp);
 
+  // Returns the number of threads created in the pool, 0 if tp is nullptr. Unlike
+  // DegreeOfParallelism this is not scaled for hybrid CPUs, which suits code that
+  // schedules one long running task per thread.
+  static int NumThreads(const ThreadPool* tp);
+
   ORT_DISALLOW_COPY_AND_ASSIGNMENT(ThreadPool);
 
   // StartProfiling and StopProfiling are not to be consumed as public-facing API
   static void StartProfiling(concurrency::ThreadPool* tp);
   static std::string StopProfiling(concurrency::ThreadPool* tp);
 
+  // Return the OS thread ids of the pool's worker threads, or an empty vector
+  // if tp is nullptr or the pool runs work directly in the caller.
+  static std::vector<unsigned> GetWorkerThreadIds(const concurrency::ThreadPool* tp);
+
  private:
   friend class LoopCounter;
 
@@ -415,6 +424,8 @@ class ThreadPool {
 
   std::string StopProfiling();
 
+  std::vector<unsigned> GetWorkerThreadIds() const;
+
   ThreadOptions thread_options_;
 
   // If a thread pool is created with degree_of_parallelism != 1 then an underlying
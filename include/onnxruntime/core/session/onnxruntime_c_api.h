@@ -237,6 +237,15 @@ typedef enum OrtOpAttrType {
   ORT_OP_ATTR_STRINGS,
 } OrtOpAttrType;
 
+/** \brief State of a request of an ::OrtGenerationEngine
+ */
+typedef enum OrtGenerationRequestState {
+  ORT_GENERATION_REQUEST_QUEUED,     ///< Waiting for a free slot.
+  ORT_GENERATION_REQUEST_RUNNING,    ///< Generates a token at each OrtApi::GenerationEngineStep.
+  ORT_GENERATION_REQUEST_FINISHED,   ///< Generated the end of sequence token or reached its length limit.
+  ORT_GENERATION_REQUEST_CANCELLED,  ///< Cancelled, or a step failed while it was running.
+} OrtGenerationRequestState;
+
 //! @}
 #define ORT_RUNTIME_CLASS(X) \
   struct Ort##X;             \
@@ -269,6 +278,9 @@ ORT_RUNTIME_CLASS(TensorRTProviderOptionsV2);
 ORT_RUNTIME_CLASS(CUDAProviderOptionsV2);
 ORT_RUNTIME_CLASS(Op);
 ORT_RUNTIME_CLASS(OpAttr);
+ORT_RUNTIME_CLASS(GenerationEngine);
+ORT_RUNTIME_CLASS(PreparedRun);
+ORT_RUNTIME_CLASS(RequestBatcher);
 
 #ifdef _WIN32
 typedef _Return_type_success_(return == 0) OrtStatus* OrtStatusPtr;
@@ -293,6 +305,17 @@ typedef void(ORT_API_CALL* OrtLoggingFunction)(
     void* param, OrtLoggingLevel severity, const char* category, const char* logid, const char* code_location,
     const char* message);
 
+/** \brief Callback of OrtApi::RunAsync
+*
+* \param[in] user_data The user_data given to OrtApi::RunAsync
+* \param[in] outputs The outputs given to OrtApi::RunAsync. If the run succeeded they are filled in the same way as
+*   by OrtApi::Run.
+* \param[in] num_outputs Number of elements in the outputs array
+* \param[in] status nullptr if the run succeeded, else the error. Must be freed with OrtApi::ReleaseStatus
+*/
+typedef void(ORT_API_CALL* RunAsyncCallbackFn)(void* user_data, OrtValue** outputs, size_t num_outputs,
+                                               OrtStatusPtr status);
+
 /** \brief Graph optimization level
 *
 * Refer to https://www.onnxruntime.ai/docs/resources/graph-optimizations.html
@@ -2623,6 +2646,10 @@ struct OrtApi {
   *  Only relevant if arena strategy is `kNextPowerOfTwo`. Use -1 to allow ORT to choose the default.
   *  Ultimately, the allocation size is determined by the allocation memory request.
   *  Further allocation sizes are governed by the arena extend strategy.
+  * "max_small_alloc_bytes": Allocations of at most this size are served from per thread caches of
+  *  power of two sized blocks that the arena hands out in bulk, which avoids taking the arena lock for
+  *  most small allocations. Values above 64 KiB are clamped to 64 KiB. 0 disables the caches.
+  *  Use -1 to allow ORT to choose the default, which is 0.
   *
   * \param[in] arena_config_keys Keys to configure the arena
   * \param[in] arena_config_values Values to configure the arena
@@ -3447,6 +3474,245 @@ struct OrtApi {
                   _In_reads_(num_keys) const char* const* provider_options_keys,
                   _In_reads_(num_keys) const char* const* provider_options_values,
                   _In_ size_t num_keys);
+
+  /** \brief Create a generation engine that decodes requests with a GPT-2 decoder model
+  *
+  * The model inputs and outputs follow the convention of the decoder subgraph of the BeamSearch contrib operator:
+  * input_ids, position_ids, attention_mask and past_0, past_1, ... as inputs, logits and present_0, present_1, ...
+  * as outputs. Each request is decoded greedily.
+  *
+  * Requests are decoded in slots rather than in fixed batches. Each call to OrtApi::GenerationEngineStep admits
+  * queued requests into free slots, generates one token for every running request and frees the slots of the
+  * requests that finished, so that short requests do not wait for the longest one of a batch.
+  *
+  * \param[in] env
+  * \param[in] model_path
+  * \param[in] options Session options of the decoder model, may be nullptr.
+  * \param[in] engine_option_keys Keys to configure the engine
+  * \param[in] engine_option_values Values to configure the engine
+  * \param[in] num_keys Number of keys
+  * \param[out] out Newly created ::OrtGenerationEngine. Must be freed with OrtApi::ReleaseGenerationEngine
+  *
+  * Supported keys are
+  * "max_batch_size": Number of slots, that is requests decoded together. Default is 16.
+  * "max_length": Maximum number of prompt and generated tokens of a request. Default is 1024.
+  * "pad_token_id": Input id of the positions that left pad shorter prompts. Default is 0.
+  * "eos_token_id": A request finishes when it generates this token. Default is -1, for none.
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(CreateGenerationEngine, _In_ const OrtEnv* env, _In_ const ORTCHAR_T* model_path,
+                  _In_opt_ const OrtSessionOptions* options,
+                  _In_reads_(num_keys) const char* const* engine_option_keys,
+                  _In_reads_(num_keys) const int64_t* engine_option_values, _In_ size_t num_keys,
+                  _Outptr_ OrtGenerationEngine** out);
+
+  /** \brief Release an ::OrtGenerationEngine
+  *
+  * \since Version 1.12.
+  */
+  ORT_CLASS_RELEASE(GenerationEngine);
+
+  /** \brief Queue a request
+  *
+  * May be called from any thread, also while another thread runs OrtApi::GenerationEngineStep.
+  *
+  * \param[in] engine
+  * \param[in] prompt Input ids of the prompt
+  * \param[in] prompt_length Number of input ids, at least 1 and less than max_length
+  * \param[in] max_new_tokens Maximum number of tokens to generate, at least 1
+  * \param[out] request_id Id of the request
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(GenerationEngineSubmit, _Inout_ OrtGenerationEngine* engine,
+                  _In_reads_(prompt_length) const int32_t* prompt, size_t prompt_length, size_t max_new_tokens,
+                  _Out_ int64_t* request_id);
+
+  /** \brief Cancel a request
+  *
+  * A queued request is cancelled right away. A running request frees its slot at the end of the next step.
+  * Cancelling a request that already finished has no effect.
+  *
+  * \param[in] engine
+  * \param[in] request_id Id returned by OrtApi::GenerationEngineSubmit
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(GenerationEngineCancel, _Inout_ OrtGenerationEngine* engine, int64_t request_id);
+
+  /** \brief Run one decoding step
+  *
+  * Admits queued requests into free slots, generates one token for each running request and retires the
+  * requests that finished. Calls are serialized. If a step fails, the requests it was running are cancelled.
+  *
+  * \param[in] engine
+  * \param[out] num_pending Number of queued and running requests after the step
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(GenerationEngineStep, _Inout_ OrtGenerationEngine* engine, _Out_ size_t* num_pending);
+
+  /** \brief Get the tokens a request has generated so far
+  *
+  * Once a finished or cancelled request has been returned, its id is no longer valid.
+  *
+  * \param[in] engine
+  * \param[in] request_id Id returned by OrtApi::GenerationEngineSubmit
+  * \param[in] allocator Allocator used to allocate the tokens
+  * \param[out] tokens Generated tokens, allocated with `allocator`. nullptr if there are none yet.
+  * \param[out] num_tokens Number of generated tokens
+  * \param[out] state State of the request
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(GenerationEngineGetResult, _Inout_ OrtGenerationEngine* engine, int64_t request_id,
+                  _Inout_ OrtAllocator* allocator, _Outptr_result_maybenull_ int32_t** tokens,
+                  _Out_ size_t* num_tokens, _Out_ OrtGenerationRequestState* state);
+
+  /** \brief Resolve the input and output names of OrtApi::Run once
+  *
+  * The names are resolved to the values of the model, and their device copy info and the expected types of the
+  * inputs are computed. Runs with the returned ::OrtPreparedRun, using OrtApi::RunPrepared, then only check the
+  * types and shapes of the inputs. It may be used by concurrent runs of the session.
+  *
+  * \param[in] session
+  * \param[in] input_names Array of null terminated UTF8 encoded strings of the input names
+  * \param[in] input_len Number of elements in the input_names array
+  * \param[in] output_names Array of null terminated UTF8 encoded strings of the output names
+  * \param[in] output_names_len Number of elements in the output_names array
+  * \param[out] out Newly created ::OrtPreparedRun. Must be freed with OrtApi::ReleasePreparedRun
+  *   before the session is released.
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(PrepareRun, _In_ const OrtSession* session, _In_reads_(input_len) const char* const* input_names,
+                  size_t input_len, _In_reads_(output_names_len) const char* const* output_names,
+                  size_t output_names_len, _Outptr_ OrtPreparedRun** out);
+
+  /** \brief Release an ::OrtPreparedRun
+  *
+  * \since Version 1.12.
+  */
+  ORT_CLASS_RELEASE(PreparedRun);
+
+  /** \brief Run the model with the input and output names resolved by OrtApi::PrepareRun
+  *
+  * \param[in] session The session that prepared `prepared_run`
+  * \param[in] run_options If nullptr, will use a default ::OrtRunOptions
+  * \param[in] prepared_run
+  * \param[in] inputs Array of ::OrtValue%s of the inputs, in the order of the input names of `prepared_run`
+  * \param[in] input_len Number of elements in the inputs array
+  * \param[in,out] outputs Array of ::OrtValue%s, in the order of the output names of `prepared_run`.
+  *   The array is filled in the same way as by OrtApi::Run.
+  * \param[in] output_len Number of elements in the outputs array
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(RunPrepared, _Inout_ OrtSession* session, _In_opt_ const OrtRunOptions* run_options,
+                  _In_ const OrtPreparedRun* prepared_run, _In_reads_(input_len) const OrtValue* const* inputs,
+                  size_t input_len, _Inout_updates_all_(output_len) OrtValue** outputs, size_t output_len);
+
+  /** \brief Queue a run of the model and return without waiting for it
+  *
+  * The run is executed by a thread pool of the session, created by the first call with the inter-op thread pool
+  * options of the session, and `run_async_callback` is invoked on that thread once the run completes.
+  * The callback must not release the session. Releasing the session waits for the queued runs.
+  *
+  * \param[in] session
+  * \param[in] run_options If nullptr, will use a default ::OrtRunOptions. Else it must stay valid until the callback
+  *   is invoked, and OrtApi::RunOptionsSetTerminate cancels the run, queued or running.
+  * \param[in] input_names Array of null terminated UTF8 encoded strings of the input names
+  * \param[in] input Array of ::OrtValue%s of the input values
+  * \param[in] input_len Number of elements in the input_names and inputs arrays
+  * \param[in] output_names Array of null terminated UTF8 encoded strings of the output names
+  * \param[in] output_names_len Number of elements in the output_names and outputs array
+  * \param[in,out] output Array of ::OrtValue%s given to the callback. It must stay valid until the callback is
+  *   invoked, and is filled in the same way as by OrtApi::Run.
+  * \param[in] run_async_callback Invoked once the run completes
+  * \param[in] user_data Given to `run_async_callback`
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(RunAsync, _Inout_ OrtSession* session, _In_opt_ const OrtRunOptions* run_options,
+                  _In_reads_(input_len) const char* const* input_names,
+                  _In_reads_(input_len) const OrtValue* const* input, size_t input_len,
+                  _In_reads_(output_names_len) const char* const* output_names, size_t output_names_len,
+                  _Inout_updates_all_(output_names_len) OrtValue** output,
+                  _In_ RunAsyncCallbackFn run_async_callback, _In_opt_ void* user_data);
+
+  /** \brief Create a request batcher that runs concurrent requests to a model together
+  *
+  * All the inputs and outputs of the model must have a symbolic batch dimension first. The first queued request
+  * waits for more requests, then the queued requests whose inputs have the same types and the same shapes but for
+  * the batch dimension are concatenated along it, run once, and the outputs are sliced back to the requests.
+  * The batch is run on the thread of its first request.
+  *
+  * \param[in] env
+  * \param[in] model_path
+  * \param[in] options Session options of the model, may be nullptr.
+  * \param[in] batcher_option_keys Keys to configure the batcher
+  * \param[in] batcher_option_values Values to configure the batcher
+  * \param[in] num_keys Number of keys
+  * \param[out] out Newly created ::OrtRequestBatcher. Must be freed with OrtApi::ReleaseRequestBatcher
+  *
+  * Supported keys are
+  * "max_batch_size": Maximum number of rows of the requests run together. Default is 16.
+  * "max_delay_us": Maximum time in microseconds the first request of a batch waits for more requests. Default is 1000.
+  * "pad_to_bucket": If not 0, the rows of a batch are padded to the next power of two, at most max_batch_size, so
+  *   that the model runs with a few distinct shapes. Default is 0.
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(CreateRequestBatcher, _In_ const OrtEnv* env, _In_ const ORTCHAR_T* model_path,
+                  _In_opt_ const OrtSessionOptions* options,
+                  _In_reads_(num_keys) const char* const* batcher_option_keys,
+                  _In_reads_(num_keys) const int64_t* batcher_option_values, _In_ size_t num_keys,
+                  _Outptr_ OrtRequestBatcher** out);
+
+  /** \brief Release an ::OrtRequestBatcher
+  *
+  * \since Version 1.12.
+  */
+  ORT_CLASS_RELEASE(RequestBatcher);
+
+  /** \brief Run a request with the other requests of its batch
+  *
+  * May be called from any number of threads. Returns once the batch of the request ran.
+  *
+  * \param[in] batcher
+  * \param[in] inputs Array of ::OrtValue%s of all the model inputs, in the order of the model inputs. They must be
+  *   CPU tensors, but not string tensors, with the same number of rows.
+  * \param[in] input_len Number of elements in the inputs array
+  * \param[out] outputs Array of the model outputs, in the order of the model outputs. Each element is set to a newly
+  *   created ::OrtValue that must be freed with OrtApi::ReleaseValue.
+  * \param[in] output_len Number of elements in the outputs array, the number of model outputs
+  *
+  * \snippet{doc} snippets.dox OrtStatus Return Value
+  *
+  * \since Version 1.12.
+  */
+  ORT_API2_STATUS(RequestBatcherRun, _Inout_ OrtRequestBatcher* batcher,
+                  _In_reads_(input_len) const OrtValue* const* inputs, size_t input_len,
+                  _Out_writes_all_(output_len) OrtValue** outputs, size_t output_len);
 };
 
 /*
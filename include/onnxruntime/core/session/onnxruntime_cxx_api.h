@@ -116,6 +116,9 @@ ORT_DEFINE_RELEASE(ModelMetadata);
 ORT_DEFINE_RELEASE(ThreadingOptions);
 ORT_DEFINE_RELEASE(IoBinding);
 ORT_DEFINE_RELEASE(ArenaCfg);
+ORT_DEFINE_RELEASE(GenerationEngine);
+ORT_DEFINE_RELEASE(PreparedRun);
+ORT_DEFINE_RELEASE(RequestBatcher);
 
 #undef ORT_DEFINE_RELEASE
 
@@ -395,6 +398,15 @@ struct ModelMetadata : Base<OrtModelMetadata> {
   int64_t GetVersion() const;                                                               ///< Wraps OrtApi::ModelMetadataGetVersion
 };
 
+/** \brief Wrapper around ::OrtPreparedRun
+*
+* Created by Session::PrepareRun and used by Session::Run. Must be destroyed before the session that prepared it.
+*/
+struct PreparedRun : Base<OrtPreparedRun> {
+  explicit PreparedRun(std::nullptr_t) {}                                  ///< Create an empty PreparedRun object, must be assigned a valid one to be used
+  explicit PreparedRun(OrtPreparedRun* p) : Base<OrtPreparedRun>{p} {}  ///< Used for interop with the C API
+};
+
 /** \brief Wrapper around ::OrtSession
 *
 */
@@ -432,6 +444,43 @@ struct Session : Base<OrtSession> {
 
   void Run(const RunOptions& run_options, const struct IoBinding&);  ///< Wraps OrtApi::RunWithBinding
 
+  /** \brief Resolve the input and output names once for Run(const RunOptions&, const PreparedRun&, const Value*, size_t, Value*, size_t)
+  *
+  * Wraps OrtApi::PrepareRun
+  */
+  PreparedRun PrepareRun(const char* const* input_names, size_t input_count,
+                         const char* const* output_names, size_t output_count) const;
+
+  /** \brief Run the model with the names resolved by PrepareRun, returning results in an Ort allocated vector.
+  *
+  * Wraps OrtApi::RunPrepared
+  *
+  * \param[in] run_options
+  * \param[in] prepared_run Names resolved by PrepareRun of this session
+  * \param[in] input_values Array of Value objects of length input_count, in the order of the prepared input names
+  * \param[in] input_count Number of inputs
+  * \param[in] output_count Number of outputs, as prepared
+  * \return A std::vector of Value objects in the order of the prepared output names
+  */
+  std::vector<Value> Run(const RunOptions& run_options, const PreparedRun& prepared_run,
+                         const Value* input_values, size_t input_count, size_t output_count);
+
+  /** \brief Run the model with the names resolved by PrepareRun, returning results in user provided outputs
+  * Same as Run(const RunOptions&, const PreparedRun&, const Value*, size_t, size_t)
+  */
+  void Run(const RunOptions& run_options, const PreparedRun& prepared_run, const Value* input_values, size_t input_count,
+           Value* output_values, size_t output_count);
+
+  /** \brief Queue a run of the model, returning results in user provided outputs once callback is invoked
+  *
+  * Wraps OrtApi::RunAsync
+  *
+  * run_options, output_values and their Value objects must stay valid until callback is invoked.
+  */
+  void RunAsync(const RunOptions& run_options, const char* const* input_names, const Value* input_values, size_t input_count,
+                const char* const* output_names, Value* output_values, size_t output_count, RunAsyncCallbackFn callback,
+                void* user_data);
+
   size_t GetInputCount() const;                   ///< Returns the number of model inputs
   size_t GetOutputCount() const;                  ///< Returns the number of model outputs
   size_t GetOverridableInitializerCount() const;  ///< Returns the number of inputs that have defaults that can be overridden
@@ -943,6 +992,51 @@ struct ArenaCfg : Base<OrtArenaCfg> {
   ArenaCfg(size_t max_mem, int arena_extend_strategy, int initial_chunk_size_bytes, int max_dead_bytes_per_chunk);
 };
 
+/*! \struct Ort::GenerationEngine
+  * \brief Greedy generation with a GPT-2 decoder model that admits and retires requests at every step
+  * \details See OrtApi::CreateGenerationEngine
+  */
+struct GenerationEngine : Base<OrtGenerationEngine> {
+  explicit GenerationEngine(std::nullptr_t) {}  ///< Create an empty GenerationEngine object, must be assigned a valid one to be used
+  /**
+  * Wraps OrtApi::CreateGenerationEngine
+  * \param engine_options - pairs of key and value, see OrtApi::CreateGenerationEngine for the supported keys
+  */
+  GenerationEngine(Env& env, const ORTCHAR_T* model_path, const SessionOptions& options,
+                   const std::vector<std::pair<std::string, int64_t>>& engine_options = {});
+
+  int64_t Submit(const int32_t* prompt, size_t prompt_length, size_t max_new_tokens);  ///< Wraps OrtApi::GenerationEngineSubmit
+  void Cancel(int64_t request_id);                                                     ///< Wraps OrtApi::GenerationEngineCancel
+  size_t Step();                                                                       ///< Wraps OrtApi::GenerationEngineStep, returns the number of pending requests
+
+  /** \brief Wraps OrtApi::GenerationEngineGetResult
+  * \param tokens - receives the tokens the request has generated so far
+  * \return the state of the request
+  */
+  OrtGenerationRequestState GetResult(int64_t request_id, std::vector<int32_t>& tokens);
+};
+
+/*! \struct Ort::RequestBatcher
+  * \brief Runs concurrent requests to a model with a batch dimension together
+  * \details See OrtApi::CreateRequestBatcher
+  */
+struct RequestBatcher : Base<OrtRequestBatcher> {
+  explicit RequestBatcher(std::nullptr_t) {}  ///< Create an empty RequestBatcher object, must be assigned a valid one to be used
+  /**
+  * Wraps OrtApi::CreateRequestBatcher
+  * \param batcher_options - pairs of key and value, see OrtApi::CreateRequestBatcher for the supported keys
+  */
+  RequestBatcher(Env& env, const ORTCHAR_T* model_path, const SessionOptions& options,
+                 const std::vector<std::pair<std::string, int64_t>>& batcher_options = {});
+
+  /** \brief Wraps OrtApi::RequestBatcherRun
+  * \param input_values - all the model inputs, in the order of the model inputs
+  * \param output_count - number of model outputs
+  * \return the model outputs, in the order of the model outputs
+  */
+  std::vector<Value> Run(const Value* input_values, size_t input_count, size_t output_count);
+};
+
 //
 // Custom OPs (only needed to implement custom OPs)
 //
@@ -296,6 +296,71 @@ inline ArenaCfg::ArenaCfg(size_t max_mem, int arena_extend_strategy, int initial
   ThrowOnError(GetApi().CreateArenaCfg(max_mem, arena_extend_strategy, initial_chunk_size_bytes, max_dead_bytes_per_chunk, &p_));
 }
 
+inline GenerationEngine::GenerationEngine(Env& env, const ORTCHAR_T* model_path, const SessionOptions& options,
+                                          const std::vector<std::pair<std::string, int64_t>>& engine_options) {
+  std::vector<const char*> keys;
+  std::vector<int64_t> values;
+  for (const auto& option : engine_options) {
+    keys.push_back(option.first.c_str());
+    values.push_back(option.second);
+  }
+  ThrowOnError(GetApi().CreateGenerationEngine(env, model_path, options, keys.data(), values.data(), keys.size(), &p_));
+}
+
+inline int64_t GenerationEngine::Submit(const int32_t* prompt, size_t prompt_length, size_t max_new_tokens) {
+  int64_t request_id;
+  ThrowOnError(GetApi().GenerationEngineSubmit(p_, prompt, prompt_length, max_new_tokens, &request_id));
+  return request_id;
+}
+
+inline void GenerationEngine::Cancel(int64_t request_id) {
+  ThrowOnError(GetApi().GenerationEngineCancel(p_, request_id));
+}
+
+inline size_t GenerationEngine::Step() {
+  size_t num_pending;
+  ThrowOnError(GetApi().GenerationEngineStep(p_, &num_pending));
+  return num_pending;
+}
+
+inline OrtGenerationRequestState GenerationEngine::GetResult(int64_t request_id, std::vector<int32_t>& tokens) {
+  AllocatorWithDefaultOptions allocator;
+  int32_t* data;
+  size_t num_tokens;
+  OrtGenerationRequestState state;
+  ThrowOnError(GetApi().GenerationEngineGetResult(p_, request_id, allocator, &data, &num_tokens, &state));
+  tokens.assign(data, data + num_tokens);
+  if (data != nullptr) {
+    allocator.Free(data);
+  }
+  return state;
+}
+
+inline RequestBatcher::RequestBatcher(Env& env, const ORTCHAR_T* model_path, const SessionOptions& options,
+                                      const std::vector<std::pair<std::string, int64_t>>& batcher_options) {
+  std::vector<const char*> keys;
+  std::vector<int64_t> values;
+  for (const auto& option : batcher_options) {
+    keys.push_back(option.first.c_str());
+    values.push_back(option.second);
+  }
+  ThrowOnError(GetApi().CreateRequestBatcher(env, model_path, options, keys.data(), values.data(), keys.size(), &p_));
+}
+
+inline std::vector<Value> RequestBatcher::Run(const Value* input_values, size_t input_count, size_t output_count) {
+  static_assert(sizeof(Value) == sizeof(OrtValue*), "Value is really just an array of OrtValue* in memory, so we can reinterpret_cast safely");
+  auto ort_input_values = reinterpret_cast<const OrtValue**>(const_cast<Value*>(input_values));
+  std::vector<OrtValue*> ort_output_values(output_count, nullptr);
+  ThrowOnError(GetApi().RequestBatcherRun(p_, ort_input_values, input_count, ort_output_values.data(), output_count));
+
+  std::vector<Value> output_values;
+  output_values.reserve(output_count);
+  for (OrtValue* ort_value : ort_output_values) {
+    output_values.emplace_back(ort_value);
+  }
+  return output_values;
+}
+
 inline Env::Env(OrtLoggingLevel logging_level, _In_ const char* logid) {
   ThrowOnError(GetApi().CreateEnv(logging_level, logid, &p_));
   if (strcmp(logid, "onnxruntime-node") == 0) {
@@ -615,6 +680,40 @@ inline void Session::Run(const RunOptions& run_options, const IoBinding& io_bind
   ThrowOnError(GetApi().RunWithBinding(p_, run_options, io_binding));
 }
 
+inline PreparedRun Session::PrepareRun(const char* const* input_names, size_t input_count,
+                                       const char* const* output_names, size_t output_count) const {
+  OrtPreparedRun* out;
+  ThrowOnError(GetApi().PrepareRun(p_, input_names, input_count, output_names, output_count, &out));
+  return PreparedRun{out};
+}
+
+inline std::vector<Value> Session::Run(const RunOptions& run_options, const PreparedRun& prepared_run,
+                                       const Value* input_values, size_t input_count, size_t output_count) {
+  std::vector<Ort::Value> output_values;
+  for (size_t i = 0; i < output_count; i++)
+    output_values.emplace_back(nullptr);
+  Run(run_options, prepared_run, input_values, input_count, output_values.data(), output_count);
+  return output_values;
+}
+
+inline void Session::Run(const RunOptions& run_options, const PreparedRun& prepared_run, const Value* input_values,
+                         size_t input_count, Value* output_values, size_t output_count) {
+  static_assert(sizeof(Value) == sizeof(OrtValue*), "Value is really just an array of OrtValue* in memory, so we can reinterpret_cast safely");
+  auto ort_input_values = reinterpret_cast<const OrtValue**>(const_cast<Value*>(input_values));
+  auto ort_output_values = reinterpret_cast<OrtValue**>(output_values);
+  ThrowOnError(GetApi().RunPrepared(p_, run_options, prepared_run, ort_input_values, input_count, ort_output_values, output_count));
+}
+
+inline void Session::RunAsync(const RunOptions& run_options, const char* const* input_names, const Value* input_values, size_t input_count,
+                              const char* const* output_names, Value* output_values, size_t output_count, RunAsyncCallbackFn callback,
+                              void* user_data) {
+  static_assert(sizeof(Value) == sizeof(OrtValue*), "Value is really just an array of OrtValue* in memory, so we can reinterpret_cast safely");
+  auto ort_input_values = reinterpret_cast<const OrtValue**>(const_cast<Value*>(input_values));
+  auto ort_output_values = reinterpret_cast<OrtValue**>(output_values);
+  ThrowOnError(GetApi().RunAsync(p_, run_options, input_names, ort_input_values, input_count, output_names, output_count,
+                                 ort_output_values, callback, user_data));
+}
+
 inline size_t Session::GetInputCount() const {
   size_t out;
   ThrowOnError(GetApi().SessionGetInputCount(p_, &out));
@@ -71,6 +71,52 @@ static const char* const kOrtSessionOptionsUseDeviceAllocatorForInitializers = "
 static const char* const kOrtSessionOptionsConfigAllowInterOpSpinning = "session.inter_op.allow_spinning";
 static const char* const kOrtSessionOptionsConfigAllowIntraOpSpinning = "session.intra_op.allow_spinning";
 
+// Create one intra_op thread pool per NUMA node, with its threads pinned to the processors of the node.
+// "0": default, one intra_op thread pool for the session
+// "1": the Runs of the session are assigned to the nodes round-robin, and each Run uses the thread pool of its node
+//      and allocates its activations in CPU memory of that node. The intra_op thread count is split evenly across
+//      the nodes. Only applies to per session thread pools on platforms that report their NUMA topology, with
+//      more than one node and no explicit thread affinity set.
+static const char* const kOrtSessionOptionsConfigIntraOpNumaPools = "session.intra_op.numa_pools";
+
+// Configure how ExecutionMode::ORT_PARALLEL schedules nodes on the inter_op threads
+// "0": default, every ready node is submitted to the inter_op thread pool as a separate task
+// "1": the calling thread and the inter_op threads run nodes from per thread work stealing queues, using the
+//      dependency counts precomputed in the execution plan. A thread continues with the first successor it made
+//      ready instead of queuing it.
+static const char* const kOrtSessionOptionsConfigInterOpWorkStealing = "session.inter_op.work_stealing";
+
+// Path of the profiling output of an earlier run of the same model (see SessionOptions::enable_profiling).
+// With ExecutionMode::ORT_PARALLEL the work stealing scheduler runs the ready node with the longest remaining
+// critical path first. The kernel times in this file are used as node costs; without it the costs are estimated
+// from the FLOPs of statically known shapes.
+static const char* const kOrtSessionOptionsConfigInterOpNodeCostsFile = "session.inter_op.node_costs_file";
+
+// Maximum size in bytes of the per Run activation arenas. "0" (the default) disables them.
+// Activations a memory pattern doesn't cover, e.g. because the input shapes change from Run to Run, are handed out
+// from one buffer per memory location by bumping an offset, and the whole buffer is released when Run ends.
+// Each buffer is sized from the most any earlier Run allocated from it, capped at this value. Allocations that
+// don't fit go to the session allocator as before.
+static const char* const kOrtSessionOptionsConfigRunArenaMaxBytes = "session.run_arena_max_bytes";
+
+// Bucketing of the input shapes memory patterns are cached for when SessionOptions::enable_mem_pattern is set.
+// "0" (the default): a pattern is only used for the exact input shapes it was generated for.
+// A positive value N: the first dim of each input is rounded up to a power of two and the other dims to a multiple
+//   of N, and inputs whose rounded shapes match share a pattern. The pattern of a bucket is generated again
+//   whenever a Run has larger inputs than the ones it was generated for, so it grows to the largest shapes seen.
+static const char* const kOrtSessionOptionsConfigMemPatternBucketGranularity = "session.mem_pattern.bucket_granularity";
+
+// Maximum number of cached memory patterns. The least recently used one is dropped when the limit is reached.
+// "0" (the default) means no limit.
+static const char* const kOrtSessionOptionsConfigMemPatternMaxCached = "session.mem_pattern.max_cached";
+
+// Maximum number of execution frames per graph whose memory pattern buffers are kept once the frame is done, when
+// SessionOptions::enable_mem_pattern is set. The next frame with the same input shapes reuses them instead of
+// looking up the pattern and allocating the buffers again. Each cached frame holds on to its buffers between Runs.
+// "1" suits the subgraphs of control flow nodes such as Loop, Scan and If, whose iterations usually have unchanged
+// shapes. The value applies to all graphs. "0" (the default) disables the cache.
+static const char* const kOrtSessionOptionsConfigMaxCachedFrameBuffers = "session.max_cached_frame_buffers";
+
 // Key for using model bytes directly for ORT format
 // If a session is created using an input byte array contains the ORT format model data,
 // By default we will copy the model bytes at the time of session creation to ensure the model bytes
@@ -123,3 +169,19 @@ static const char* const kOrtSessionOptionsConfigStrictShapeTypeInference = "ses
 // Key for disable PrePacking,
 // If the config value is set to "1" then the prepacking is disabled, otherwise prepacking is enabled (default value)
 static const char* const kOrtSessionOptionsConfigProfilerPerfConfigFileName = "session.profiler.perf_config_file_name";
+
+// Maximum number of perf counters per perf event group, default "4".
+// Groups are time-multiplexed by the kernel when the counters in session.profiler.perf_config_file_name do not
+// fit in the PMU at once, and the profiler scales their values by time_enabled / time_running.
+// Counters are grouped in perf (type, config) order, so the generic hardware events such as cycles and
+// instructions share the first group and are always measured together.
+// The value must be > 0. A value of at least the number of counters puts them all into a single group, which gives
+// exact ratios but cannot be scheduled if it does not fit.
+static const char* const kOrtSessionOptionsConfigProfilerPerfEventsPerGroup = "session.profiler.perf_events_per_group";
+
+// Enables the sampling mode of the profiler when set to a positive number of CPU cycles between samples, e.g. "100000".
+// Each session and intra-op thread gets a perf sampling event, and samples are attributed to the graph node the thread
+// was running. The profile then contains a "perf_sampling" event with per node sample counts and hottest instruction
+// pointers. Unlike the counters of session.profiler.perf_config_file_name nothing is toggled around each node.
+// Linux only, requires enable_profiling.
+static const char* const kOrtSessionOptionsConfigProfilerPerfSamplePeriod = "session.profiler.perf_sample_period";
@@ -63,7 +63,9 @@ Status AttentionBase::CheckInputs(const TensorShape& input_shape,
                                   const TensorShape& bias_shape,
                                   const Tensor*& mask_index,
                                   const Tensor* past,
-                                  const Tensor* extra_add_qk) const {
+                                  const Tensor* extra_add_qk,
+                                  const Tensor* past_seq_len,
+                                  const Tensor* cache_indirection) const {
   // Input shapes:
   //   input       : (batch_size, sequence_length, input_hidden_size)
   //   weights     : (input_hidden_size, 3 * hidden_size)
@@ -75,6 +77,10 @@ Status AttentionBase::CheckInputs(const TensorShape& input_shape,
   //   past        : (2, batch_size, num_heads, past_sequence_length, head_size)
   //   extra_add_qk: (batch_size, num_heads, sequence_length, sequence_length)
   //
+  // When past_present_share_buffer_ is true, dimension 3 of past is max_sequence_length, and
+  //   past_seq_len     : (1) with the number of valid positions in past
+  //   cache_indirection: nullptr or (batch_size, max_sequence_length)
+  //
   // Where hidden_size = num_heads * head_size.
   // When a model is pruned (like some attention heads are removed), hidden_size < input_hidden_size.
 
@@ -175,6 +181,44 @@ Status AttentionBase::CheckInputs(const TensorShape& input_shape,
     past_sequence_length = static_cast<int>(past_dims[3]);
   }
 
+  if (past_present_share_buffer_) {
+    if (past == nullptr || past_seq_len == nullptr) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                             "Inputs 'past' and 'past_sequence_length' are required when past_present_share_buffer is 1");
+    }
+    if (past_seq_len->Shape().Size() != 1) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input 'past_sequence_length' is expected to have 1 element, got ",
+                             past_seq_len->Shape().Size());
+    }
+
+    const int max_sequence_length = past_sequence_length;
+    past_sequence_length = *past_seq_len->Data<int32_t>();
+    if (past_sequence_length < 0 || past_sequence_length + sequence_length > max_sequence_length) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input 'past_sequence_length' shall be in the range [0, ",
+                             max_sequence_length - sequence_length, "], got ", past_sequence_length);
+    }
+
+    if (cache_indirection != nullptr) {
+      const auto& cache_indirection_dims = cache_indirection->Shape().GetDims();
+      if (cache_indirection_dims.size() != 2 || static_cast<int>(cache_indirection_dims[0]) != batch_size ||
+          static_cast<int>(cache_indirection_dims[1]) != max_sequence_length) {
+        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                               "Input 'cache_indirection' shall have shape batch_size x max_sequence_length");
+      }
+
+      const int32_t* cache_indirection_data = cache_indirection->Data<int32_t>();
+      for (int b_i = 0; b_i < batch_size; b_i++) {
+        for (int m_i = 0; m_i < past_sequence_length; m_i++) {
+          const int32_t beam = cache_indirection_data[b_i * max_sequence_length + m_i];
+          if (beam < 0 || beam >= batch_size) {
+            return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input 'cache_indirection' has value ", beam,
+                                   " out of range [0, ", batch_size, ")");
+          }
+        }
+      }
+    }
+  }
+
   if (mask_index != nullptr) {  // mask_index is optional
     const auto& mask_dims = mask_index->Shape().GetDims();
     if (mask_dims.size() == 1) {
@@ -248,6 +292,10 @@ Status AttentionBase::CheckInputs(const TensorShape& input_shape,
     return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "num_heads should be no larger than ", max_threads_per_block);
   }
 
+  if (past_present_share_buffer_) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, NOT_IMPLEMENTED, "past_present_share_buffer is only supported in CPU");
+  }
+
   return CheckInputs(input_shape, weights_shape, bias_shape, mask_index, past, extra_add_qk);
 }
 
@@ -414,6 +462,8 @@ Status Attention<T>::Compute(OpKernelContext* context) const {
   const Tensor* mask_index = context->Input<Tensor>(3);
   const Tensor* past = context->Input<Tensor>(4);
   const Tensor* extra_add_qk = context->Input<Tensor>(5);
+  const Tensor* past_seq_len = context->Input<Tensor>(6);
+  const Tensor* cache_indirection = context->Input<Tensor>(7);
 
   const TensorShape& weights_shape = (weights ? weights->Shape() : weight_shape_);
   ORT_RETURN_IF_ERROR(CheckInputs(input->Shape(),
@@ -421,7 +471,9 @@ Status Attention<T>::Compute(OpKernelContext* context) const {
                                   bias->Shape(),
                                   mask_index,
                                   past,
-                                  extra_add_qk));
+                                  extra_add_qk,
+                                  past_seq_len,
+                                  cache_indirection));
 
   const auto shape = input->Shape().GetDims();
   const int batch_size = static_cast<int>(shape[0]);
@@ -564,7 +616,7 @@ Status Attention<T>::Compute(OpKernelContext* context) const {
   return ApplyAttention(Q, K, V, mask_index, past, output,
                         batch_size, sequence_length,
                         qkv_head_size[0], qkv_head_size[2], v_hidden_size,
-                        extra_add_qk, context);
+                        extra_add_qk, context, past_seq_len, cache_indirection);
 }
 }  // namespace contrib
 }  // namespace onnxruntime
@@ -35,6 +35,8 @@ class AttentionBase {
 
     is_unidirectional_ = info.GetAttrOrDefault<int64_t>("unidirectional", 0) == 1;
 
+    past_present_share_buffer_ = info.GetAttrOrDefault<int64_t>("past_present_share_buffer", 0) == 1;
+
     if (!info.GetAttrs<int64_t>("qkv_hidden_sizes", qkv_hidden_sizes_).IsOK() || qkv_hidden_sizes_.empty()) {
       qkv_hidden_sizes_.resize(0);
     }
@@ -45,10 +47,13 @@ class AttentionBase {
                      const TensorShape& bias_shape,
                      const Tensor*& mask_index,  // For dummy mask with shape (1, 1) or (batch_size, 1), it will be updated to nullptr.
                      const Tensor* past,
-                     const Tensor *extra_add_qk) const;
+                     const Tensor *extra_add_qk,
+                     const Tensor* past_seq_len = nullptr,
+                     const Tensor* cache_indirection = nullptr) const;
 
   int num_heads_;           // number of attention heads
   bool is_unidirectional_;  // whether every token can only attend to previous tokens.
+  bool past_present_share_buffer_;  // whether present is written into the max_sequence_length buffer of past.
   std::vector<int64_t> qkv_hidden_sizes_;   // Q, K, V path hidden layer sizes
 };
 
@@ -9,6 +9,11 @@
 #include "core/common/common.h"
 #include "core/common/safeint.h"
 #include "core/framework/op_kernel.h"
+#include "core/mlas/inc/mlas.h"
+#include "core/platform/env_var_utils.h"
+
+#include <type_traits>
+
 //TODO: fix the warnings
 #if defined(_MSC_VER) && !defined(__clang__)
 #pragma warning(push)
@@ -18,9 +23,18 @@
 namespace onnxruntime {
 namespace contrib {
 
+namespace attention {
+// Environment variable to override the number of attention scores per batch item and head from which the
+// float kernel computes the output block by block instead of materializing the attention probs.
+constexpr const char* kFlashAttentionMinimumScores = "ORT_ATTENTION_FLASH_MINIMUM_SCORES";
+}  // namespace attention
+
 class AttentionCPUBase : public AttentionBase {
  protected:
-  AttentionCPUBase(const OpKernelInfo& info) : AttentionBase(info) {}
+  AttentionCPUBase(const OpKernelInfo& info) : AttentionBase(info) {
+    flash_attention_minimum_scores_ = ParseEnvironmentVariableWithDefault<size_t>(
+        attention::kFlashAttentionMinimumScores, kDefaultFlashAttentionMinimumScores);
+  }
 
   template <typename T>
   Status ApplyAttention(const T* Q,                  // Q data. Its size is BxNxSxH
@@ -35,18 +49,47 @@ class AttentionCPUBase : public AttentionBase {
                         int v_head_size,             // head_size
                         int v_hidden_size,           // hidden_size
                         const Tensor* extra_add_qk,  // extra add in QK. Its size is BxNxSxS
-                        OpKernelContext* context) const {
+                        OpKernelContext* context,
+                        const Tensor* past_seq_len = nullptr,        // valid positions in past when past_present_share_buffer_
+                        const Tensor* cache_indirection = nullptr    // batch item of past that holds each past position
+                        ) const {
     AllocatorPtr allocator;
     ORT_RETURN_IF_ERROR(context->GetTempSpaceAllocator(&allocator));
 
     auto* tp = context->GetOperatorThreadPool();
 
     int past_sequence_length = 0;
-    Tensor* present = GetPresent(context, past, batch_size, v_head_size, sequence_length, past_sequence_length);
+    int max_sequence_length = 0;
+    Tensor* present = nullptr;
+    if (past_present_share_buffer_) {
+      // Present has the shape of past, and only the new positions are written to it.
+      // past and past_seq_len have been validated in CheckInputs.
+      past_sequence_length = *past_seq_len->template Data<int32_t>();
+      max_sequence_length = static_cast<int>(past->Shape()[3]);
+      present = context->Output(1, past->Shape());
+      ORT_RETURN_IF(present == nullptr, "Expect to have present state output when past_present_share_buffer is 1");
+    } else {
+      present = GetPresent(context, past, batch_size, v_head_size, sequence_length, past_sequence_length);
+    }
 
     // Total sequence length including that of past state: S* = S' + S
     const int all_sequence_length = past_sequence_length + sequence_length;
 
+    if constexpr (std::is_same<T, float>::value) {
+      // Without mask, extra add or cache indirection the attention probs are only an intermediate, and for long
+      // sequences MLAS computes the output block by block without materializing them.
+      if (mask_index == nullptr && extra_add_qk == nullptr && cache_indirection == nullptr &&
+          static_cast<size_t>(sequence_length) * all_sequence_length >= flash_attention_minimum_scores_) {
+        ComputeFlashAttention(output->template MutableData<T>(), Q, K, V,
+                              past != nullptr ? past->template Data<T>() : nullptr,
+                              present != nullptr ? present->template MutableData<T>() : nullptr,
+                              batch_size, sequence_length, past_sequence_length, max_sequence_length,
+                              qk_head_size == 0 ? v_head_size : qk_head_size, v_head_size,
+                              is_unidirectional_, tp);
+        return Status::OK();
+      }
+    }
+
     // Compute the attention score. It does 2 things:
     //         I. attention_probs(B, N, S, S*) = 1/sqrt(H) x Q(B, N, S, H) x K'(B, N, S*, H -> B, N, H, S*) +
     //                                           1 x mask_data(B, N, S, S*)
@@ -69,6 +112,7 @@ class AttentionCPUBase : public AttentionBase {
     gsl::span<const int64_t> mask_index_dims = mask_index != nullptr ? mask_index->Shape().GetDims() : gsl::span<const int64_t>{};
     const T* past_data = past != nullptr ? past->template Data<T>() : nullptr;
     T* present_data = present != nullptr ? present->template MutableData<T>() : nullptr;
+    const int32_t* cache_indirection_data = cache_indirection != nullptr ? cache_indirection->template Data<int32_t>() : nullptr;
 
     const T* extra_add_qk_data = nullptr;
     if (extra_add_qk != nullptr) {
@@ -78,7 +122,8 @@ class AttentionCPUBase : public AttentionBase {
     ComputeAttentionProbs<T>(static_cast<T*>(attention_probs), Q, K,
                              mask_index_data, mask_index_dims, static_cast<T*>(mask_data), has_unidirectional,
                              batch_size, sequence_length, past_sequence_length, qk_head_size == 0 ? v_head_size : qk_head_size,
-                             past_data, present_data, tp, extra_add_qk_data);
+                             past_data, present_data, tp, extra_add_qk_data,
+                             max_sequence_length, cache_indirection_data);
 
     // Compute the attentionScore * Value. It does: out_tmp(B, N, S, H) = attention_probs(B, N, S, S*) x V(B, N, S*, H)
     auto out_tmp_data =
@@ -87,12 +132,91 @@ class AttentionCPUBase : public AttentionBase {
 
     ComputeVxAttentionScore(output->template MutableData<T>(), static_cast<T*>(out_tmp_data), static_cast<T*>(attention_probs), V,
                             batch_size, sequence_length, past_sequence_length, v_head_size, v_hidden_size,
-                            past_data, present_data, tp);
+                            past_data, present_data, tp,
+                            max_sequence_length, cache_indirection_data);
 
     return Status::OK();
   }
 
  private:
+  // Default number of attention scores per batch item and head from which ComputeFlashAttention is used.
+  static constexpr size_t kDefaultFlashAttentionMinimumScores = 512 * 512;
+
+  size_t flash_attention_minimum_scores_;
+
+  // Helper function to compute the attention output with MlasFlashAttention. Present state is written first,
+  // then out(B, S, N, H) = Softmax(1/sqrt(H) x Q x K' + causal mask) x V is computed over it.
+  void ComputeFlashAttention(float* output,               // output with size BxSxNxH_v
+                             const float* Q,              // Q data. Its size is BxNxSxH
+                             const float* K,              // K data. Its size is BxNxSxH
+                             const float* V,              // V data. Its size is BxNxSxH_v
+                             const float* past,           // past state
+                             float* present,              // present state
+                             int batch_size,              // batch size
+                             int sequence_length,         // sequence length
+                             int past_sequence_length,    // sequence length of past state
+                             int max_sequence_length,     // positions of past and present when they share a buffer, otherwise 0
+                             int qk_head_size,            // head size of Q and K
+                             int v_head_size,             // head size of V
+                             bool causal,                 // every token only attends to previous tokens
+                             ThreadPool* tp) const {
+    const int all_sequence_length = past_sequence_length + sequence_length;
+    const int chunk_sequence_length = max_sequence_length > 0 ? max_sequence_length : all_sequence_length;
+    const int past_chunk_sequence_length = max_sequence_length > 0 ? max_sequence_length : past_sequence_length;
+    const int loop_len = batch_size * num_heads_;
+
+    MLAS_FLASH_ATTENTION_PARAMS parameters;
+    parameters.BatchCount = static_cast<size_t>(batch_size);
+    parameters.HeadCount = static_cast<size_t>(num_heads_);
+    parameters.SequenceLength = static_cast<size_t>(sequence_length);
+    parameters.KvSequenceLength = static_cast<size_t>(all_sequence_length);
+    parameters.QkHeadSize = static_cast<size_t>(qk_head_size);
+    parameters.VHeadSize = static_cast<size_t>(v_head_size);
+    parameters.Scale = 1.0f / sqrt(static_cast<float>(qk_head_size));
+    parameters.Causal = causal;
+    parameters.Query = Q;
+    parameters.Key = K;
+    parameters.KeyHeadStride = static_cast<size_t>(sequence_length) * qk_head_size;
+    parameters.Value = V;
+    parameters.ValueHeadStride = static_cast<size_t>(sequence_length) * v_head_size;
+    parameters.Output = output;
+
+    if (nullptr != present) {
+      const size_t input_k_chunk_length = static_cast<size_t>(sequence_length) * qk_head_size;
+      const size_t input_v_chunk_length = static_cast<size_t>(sequence_length) * v_head_size;
+      const size_t past_k_chunk_length = static_cast<size_t>(past_sequence_length) * qk_head_size;
+      const size_t past_v_chunk_length = static_cast<size_t>(past_sequence_length) * v_head_size;
+      const size_t present_k_chunk_length = static_cast<size_t>(chunk_sequence_length) * qk_head_size;
+      const size_t present_v_chunk_length = static_cast<size_t>(chunk_sequence_length) * v_head_size;
+
+      // V follows K in past and present state.
+      const float* past_v = nullptr != past ? past + static_cast<size_t>(loop_len) * past_chunk_sequence_length * v_head_size : nullptr;
+      float* present_v = present + static_cast<size_t>(loop_len) * present_v_chunk_length;
+
+      const double cost = static_cast<double>(chunk_sequence_length) * (qk_head_size + v_head_size);
+      ThreadPool::TryParallelFor(tp, loop_len, cost, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        for (std::ptrdiff_t i = begin; i != end; ++i) {
+          if (max_sequence_length > 0) {
+            AppendStateChunk(past, K + input_k_chunk_length * i, present, past_k_chunk_length, input_k_chunk_length,
+                             present_k_chunk_length, i);
+            AppendStateChunk(past_v, V + input_v_chunk_length * i, present_v, past_v_chunk_length, input_v_chunk_length,
+                             present_v_chunk_length, i);
+          } else {
+            ConcatStateChunk(past, K + input_k_chunk_length * i, present, past_k_chunk_length, present_k_chunk_length, i);
+            ConcatStateChunk(past_v, V + input_v_chunk_length * i, present_v, past_v_chunk_length, present_v_chunk_length, i);
+          }
+        }
+      });
+
+      parameters.Key = present;
+      parameters.KeyHeadStride = present_k_chunk_length;
+      parameters.Value = present_v;
+      parameters.ValueHeadStride = present_v_chunk_length;
+    }
+
+    MlasFlashAttention(&parameters, tp);
+  }
+
   // Helper function to compute the attention probs. It does 2 things:
   //  I. attention_probs(B, N, S, S*) = 1/sqrt(H) x Q(B, N, S, H) x K'(B, N, S*, H -> B, N, H, S*) +
   //                                    1 x mask_data(B, N, S, S*)
@@ -112,12 +236,15 @@ class AttentionCPUBase : public AttentionBase {
                              const T* past,                                // past state
                              T* present,                                   // present state
                              ThreadPool* tp,                               // thread pool
-                             const T* extra_add_qk_data                    // extra add matrix with shape BxNxSxS*
+                             const T* extra_add_qk_data,                   // extra add matrix with shape BxNxSxS*
+                             int max_sequence_length,                      // positions of past and present when they share a buffer, otherwise 0
+                             const int32_t* cache_indirection              // nullptr or batch item of past for each past position, BxM
   ) const {
     const int all_sequence_length = past_sequence_length + sequence_length;                  // S* = S' + S
     const size_t past_chunk_length = static_cast<size_t>(past_sequence_length) * head_size;  // S' x H
     const size_t input_chunk_length = static_cast<size_t>(sequence_length) * head_size;      // S x H
     const size_t present_chunk_length = past_chunk_length + input_chunk_length;              // S* x H
+    const size_t max_chunk_length = static_cast<size_t>(max_sequence_length) * head_size;    // M x H
 
     {
       if (mask_data != nullptr) {
@@ -146,19 +273,42 @@ class AttentionCPUBase : public AttentionBase {
           }
 
           const T* k = K + input_chunk_length * i;
-          if (nullptr != present) {
+          if (max_sequence_length > 0) {
+            // Write K after past_K in place: (BxNx)SxH -> (BxNx)MxH, where the first S* positions are used
+            k = AppendStateChunk(past, k, present, past_chunk_length, input_chunk_length, max_chunk_length, i);
+          } else if (nullptr != present) {
             // Concatenate past_K and K : (BxNx)S'xH, (BxNx)SxH -> (BxNx)S*xH
             k = ConcatStateChunk(past, k, present, past_chunk_length, present_chunk_length, i);
           }
 
-          // Compute Q*K' + AttentionMask
-          //                     original                 transposed             each iteration
-          // A: Q                (B x N x) S x H          (B x N x) S x H        S x H
-          // B: K'               (B x N x) S* x H         (B x N x) H x S*       H x S*
-          // C: attention_probs  (B x N x) S x S*         (B x N x) S x S*       S x S*
-          math::Gemm<T, ThreadPool>(CblasNoTrans, CblasTrans, sequence_length, all_sequence_length, head_size, alpha,
-                                    Q + input_chunk_length * i, k, 1.0,
-                                    output, nullptr);
+          if (nullptr != cache_indirection) {
+            // Past positions of this batch item are in the chunks of the batch items cache_indirection points to,
+            // so Q*K' is computed position by position.
+            const int head_index = static_cast<int>(i) % num_heads_;
+            const int32_t* beams = cache_indirection + static_cast<size_t>(batch_index) * max_sequence_length;
+            const T* q = Q + input_chunk_length * i;
+            for (int m_i = 0; m_i < all_sequence_length; m_i++) {
+              const T* k_row = k + static_cast<size_t>(m_i) * head_size;
+              if (m_i < past_sequence_length) {
+                k_row = past + (static_cast<size_t>(beams[m_i]) * num_heads_ + head_index) * max_chunk_length +
+                        static_cast<size_t>(m_i) * head_size;
+              }
+              for (int s_i = 0; s_i < sequence_length; s_i++) {
+                T dot;
+                math::Dot<T, CPUMathUtil>(head_size, q + static_cast<size_t>(s_i) * head_size, k_row, &dot, nullptr);
+                output[s_i * all_sequence_length + m_i] += alpha * dot;
+              }
+            }
+          } else {
+            // Compute Q*K' + AttentionMask
+            //                     original                 transposed             each iteration
+            // A: Q                (B x N x) S x H          (B x N x) S x H        S x H
+            // B: K'               (B x N x) S* x H         (B x N x) H x S*       H x S*
+            // C: attention_probs  (B x N x) S x S*         (B x N x) S x S*       S x S*
+            math::Gemm<T, ThreadPool>(CblasNoTrans, CblasTrans, sequence_length, all_sequence_length, head_size, alpha,
+                                      Q + input_chunk_length * i, k, 1.0,
+                                      output, nullptr);
+          }
 
           // Fix unidirectional mask to be parity with huggingface implementation.
           if (has_unidirectional && mask_data != nullptr) {
@@ -199,18 +349,27 @@ class AttentionCPUBase : public AttentionBase {
                                int hidden_size,           // hidden size
                                const T* past,             // past state
                                T* present,                // present state
-                               ThreadPool* tp) const {
+                               ThreadPool* tp,
+                               int max_sequence_length,            // positions of past and present when they share a buffer, otherwise 0
+                               const int32_t* cache_indirection    // nullptr or batch item of past for each past position, BxM
+                               ) const {
     const int all_sequence_length = past_sequence_length + sequence_length;                  // S* = S' + S
     const size_t past_chunk_length = static_cast<size_t>(past_sequence_length * head_size);  // S' x H
     const size_t input_chunk_length = static_cast<size_t>(sequence_length * head_size);      // S x H
     const size_t present_chunk_length = past_chunk_length + input_chunk_length;              // S* x H
+    const size_t max_chunk_length = static_cast<size_t>(max_sequence_length) * head_size;    // M x H
 
     // Move the pointer of past and present to start of v values.
-    if (nullptr != past) {
-      past += batch_size * num_heads_ * past_sequence_length * head_size;
-    }
-    if (nullptr != present) {
-      present += batch_size * num_heads_ * all_sequence_length * head_size;
+    if (max_sequence_length > 0) {
+      past += batch_size * num_heads_ * max_chunk_length;
+      present += batch_size * num_heads_ * max_chunk_length;
+    } else {
+      if (nullptr != past) {
+        past += batch_size * num_heads_ * past_sequence_length * head_size;
+      }
+      if (nullptr != present) {
+        present += batch_size * num_heads_ * all_sequence_length * head_size;
+      }
     }
 
     const double cost =
@@ -219,15 +378,36 @@ class AttentionCPUBase : public AttentionBase {
     ThreadPool::TryParallelFor(tp, batch_size * num_heads_, cost, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
       for (std::ptrdiff_t i = begin; i != end; ++i) {
         const T* v = V + input_chunk_length * i;
-        if (nullptr != present) {
+        if (max_sequence_length > 0) {
+          // Write V after past_V in place: (BxNx)SxH -> (BxNx)MxH, where the first S* positions are used
+          v = AppendStateChunk(past, v, present, past_chunk_length, input_chunk_length, max_chunk_length, i);
+        } else if (nullptr != present) {
           // concatenate past_V and V: (BxNx)S'xH, (BxNx)SxH -> (BxNx)S*xH
           v = ConcatStateChunk(past, v, present, past_chunk_length, present_chunk_length, i);
         }
 
         T* current_tmp_data = reinterpret_cast<T*>(tmp_buffer) + input_chunk_length * i;
-        math::MatMul<T>(sequence_length, head_size, all_sequence_length,
-                        attention_probs + sequence_length * all_sequence_length * i,
-                        v, current_tmp_data, nullptr);
+        const T* probs = attention_probs + sequence_length * all_sequence_length * i;
+        if (nullptr != cache_indirection) {
+          // Past positions of this batch item are in the chunks of the batch items cache_indirection points to.
+          const int batch_index = static_cast<int>(i / num_heads_);
+          const int head_index = static_cast<int>(i % num_heads_);
+          const int32_t* beams = cache_indirection + static_cast<size_t>(batch_index) * max_sequence_length;
+          memset(current_tmp_data, 0, input_chunk_length * sizeof(T));
+          for (int m_i = 0; m_i < all_sequence_length; m_i++) {
+            const T* v_row = v + static_cast<size_t>(m_i) * head_size;
+            if (m_i < past_sequence_length) {
+              v_row = past + (static_cast<size_t>(beams[m_i]) * num_heads_ + head_index) * max_chunk_length +
+                      static_cast<size_t>(m_i) * head_size;
+            }
+            for (int s_i = 0; s_i < sequence_length; s_i++) {
+              math::Axpy<T, CPUMathUtil>(head_size, probs[s_i * all_sequence_length + m_i], v_row,
+                                         current_tmp_data + static_cast<size_t>(s_i) * head_size, nullptr);
+            }
+          }
+        } else {
+          math::MatMul<T>(sequence_length, head_size, all_sequence_length, probs, v, current_tmp_data, nullptr);
+        }
 
         // transpose: out(B, S, N, H) = transpose out_tmp(B, N, S, H)
         const int batch_index = static_cast<int>(i / num_heads_);
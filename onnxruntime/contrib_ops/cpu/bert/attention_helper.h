@@ -164,5 +164,22 @@ T* ConcatStateChunk(const T* past, const T* chunk, T* present, size_t past_chunk
   return start;
 }
 
+// Write an input state chunk SxH after the first S' positions of a present state chunk that has room for
+// max_sequence_length positions. Past and present have the same shape, and usually share one buffer, so the
+// past positions are only copied when they don't. Returns a pointer to the start of present state chunk.
+template <typename T>
+T* AppendStateChunk(const T* past, const T* chunk, T* present, size_t past_chunk_length, size_t input_chunk_length,
+                    size_t max_chunk_length, std::ptrdiff_t i) {
+  T* start = present + i * max_chunk_length;
+
+  const T* src_past = past + i * max_chunk_length;
+  if (src_past != start) {
+    memcpy(start, src_past, max_chunk_length * sizeof(T));
+  }
+
+  memcpy(start + past_chunk_length, chunk, input_chunk_length * sizeof(T));
+  return start;
+}
+
 }  // namespace contrib
 }  // namespace onnxruntime
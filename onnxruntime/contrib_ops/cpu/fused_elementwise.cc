@@ -0,0 +1,304 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "contrib_ops/cpu/fused_elementwise.h"
+
+#include <algorithm>
+#include <string>
+
+#include "core/common/safeint.h"
+#include "core/mlas/inc/mlas.h"
+#include "core/platform/threadpool.h"
+#include "core/util/math_cpuonly.h"
+
+namespace onnxruntime {
+namespace contrib {
+
+ONNX_OPERATOR_KERNEL_EX(
+    FusedElementwise,
+    kMSDomain,
+    1,
+    kCpuExecutionProvider,
+    KernelDefBuilder()
+        .TypeConstraint("T", DataTypeImpl::GetTensorType<float>()),
+    FusedElementwise);
+
+namespace {
+
+using OpCode = FusedElementwise::OpCode;
+using Instruction = FusedElementwise::Instruction;
+
+// Number of output elements evaluated together. The values of a block, one per instruction,
+// are small enough to stay in the first level cache.
+constexpr int64_t kBlockSize = 256;
+
+// A value of a block: either one element per output element of the block, or a single element
+// that is broadcast to the whole block.
+struct BlockValue {
+  const float* data;
+  bool is_scalar;
+};
+
+using EigenArray = Eigen::Array<float, Eigen::Dynamic, 1>;
+
+template <typename Op>
+void ComputeBinary(const BlockValue& a, const BlockValue& b, float* y, std::ptrdiff_t n, Op op) {
+  EigenVectorArrayMap<float> output(y, n);
+  if (a.is_scalar) {
+    output = op(EigenArray::Constant(n, a.data[0]), ConstEigenVectorArrayMap<float>(b.data, n));
+  } else if (b.is_scalar) {
+    output = op(ConstEigenVectorArrayMap<float>(a.data, n), EigenArray::Constant(n, b.data[0]));
+  } else {
+    output = op(ConstEigenVectorArrayMap<float>(a.data, n), ConstEigenVectorArrayMap<float>(b.data, n));
+  }
+}
+
+// Computes n values of an instruction into y. When both operands are scalars, n is 1.
+void ComputeInstruction(OpCode op, const BlockValue& a, const BlockValue& b, float* y, std::ptrdiff_t n) {
+  ConstEigenVectorArrayMap<float> x(a.data, n);
+  EigenVectorArrayMap<float> output(y, n);
+
+  switch (op) {
+    case OpCode::kAdd:
+      ComputeBinary(a, b, y, n, [](const auto& l, const auto& r) { return l + r; });
+      break;
+    case OpCode::kSub:
+      ComputeBinary(a, b, y, n, [](const auto& l, const auto& r) { return l - r; });
+      break;
+    case OpCode::kMul:
+      ComputeBinary(a, b, y, n, [](const auto& l, const auto& r) { return l * r; });
+      break;
+    case OpCode::kDiv:
+      ComputeBinary(a, b, y, n, [](const auto& l, const auto& r) { return l / r; });
+      break;
+    case OpCode::kMax:
+      ComputeBinary(a, b, y, n, [](const auto& l, const auto& r) { return l.max(r); });
+      break;
+    case OpCode::kMin:
+      ComputeBinary(a, b, y, n, [](const auto& l, const auto& r) { return l.min(r); });
+      break;
+    case OpCode::kAbs:
+      output = x.abs();
+      break;
+    case OpCode::kNeg:
+      output = -x;
+      break;
+    case OpCode::kExp:
+      MlasComputeExp(a.data, y, static_cast<size_t>(n));
+      break;
+    case OpCode::kLog:
+      output = x.log();
+      break;
+    case OpCode::kSqrt:
+      output = x.sqrt();
+      break;
+    case OpCode::kReciprocal:
+      output = x.inverse();
+      break;
+    case OpCode::kRelu:
+      output = x.max(0.0f);
+      break;
+    case OpCode::kSigmoid:
+      MlasComputeLogistic(a.data, y, static_cast<size_t>(n));
+      break;
+    case OpCode::kTanh:
+      MlasComputeTanh(a.data, y, static_cast<size_t>(n));
+      break;
+    case OpCode::kErf:
+      MlasComputeErf(a.data, y, static_cast<size_t>(n));
+      break;
+  }
+}
+
+bool IsUnary(OpCode op) {
+  return op >= OpCode::kAbs;
+}
+
+}  // namespace
+
+FusedElementwise::FusedElementwise(const OpKernelInfo& info) : OpKernel(info) {
+  static const std::pair<const char*, OpCode> op_codes[] = {
+      {"Add", OpCode::kAdd},
+      {"Sub", OpCode::kSub},
+      {"Mul", OpCode::kMul},
+      {"Div", OpCode::kDiv},
+      {"Max", OpCode::kMax},
+      {"Min", OpCode::kMin},
+      {"Abs", OpCode::kAbs},
+      {"Neg", OpCode::kNeg},
+      {"Exp", OpCode::kExp},
+      {"Log", OpCode::kLog},
+      {"Sqrt", OpCode::kSqrt},
+      {"Reciprocal", OpCode::kReciprocal},
+      {"Relu", OpCode::kRelu},
+      {"Sigmoid", OpCode::kSigmoid},
+      {"Tanh", OpCode::kTanh},
+      {"Erf", OpCode::kErf},
+  };
+
+  num_inputs_ = static_cast<int>(info.GetInputCount());
+
+  std::vector<std::string> ops;
+  std::vector<int64_t> operands;
+  ORT_ENFORCE(info.GetAttrs("ops", ops).IsOK(), "Attribute ops is missing.");
+  ORT_ENFORCE(info.GetAttrs("operands", operands).IsOK(), "Attribute operands is missing.");
+  ORT_ENFORCE(!ops.empty() && operands.size() == 2 * ops.size(),
+              "Attribute operands shall have two entries for each of the ", ops.size(), " ops.");
+
+  program_.reserve(ops.size());
+  for (size_t i = 0; i < ops.size(); i++) {
+    const auto* op_code = std::find_if(std::begin(op_codes), std::end(op_codes),
+                                       [&ops, i](const std::pair<const char*, OpCode>& entry) {
+                                         return ops[i] == entry.first;
+                                       });
+    ORT_ENFORCE(op_code != std::end(op_codes), "Unsupported op in FusedElementwise: ", ops[i]);
+
+    Instruction instruction{op_code->second, static_cast<int>(operands[2 * i]), static_cast<int>(operands[2 * i + 1])};
+
+    // An instruction can only use the inputs and the results of the instructions before it.
+    const int num_values = num_inputs_ + static_cast<int>(i);
+    ORT_ENFORCE(instruction.lhs >= 0 && instruction.lhs < num_values,
+                "Invalid operand of op ", i, ": ", instruction.lhs);
+    if (IsUnary(instruction.op)) {
+      ORT_ENFORCE(instruction.rhs == -1, "Op ", i, " (", ops[i], ") takes a single operand.");
+    } else {
+      ORT_ENFORCE(instruction.rhs >= 0 && instruction.rhs < num_values,
+                  "Invalid operand of op ", i, ": ", instruction.rhs);
+    }
+
+    program_.push_back(instruction);
+  }
+}
+
+Status FusedElementwise::Compute(OpKernelContext* context) const {
+  // The output shape is the multidirectional broadcast of all input shapes.
+  size_t rank = 0;
+  for (int i = 0; i < num_inputs_; i++) {
+    rank = std::max(rank, context->Input<Tensor>(i)->Shape().NumDimensions());
+  }
+
+  std::vector<int64_t> output_dims(rank, 1);
+  for (int i = 0; i < num_inputs_; i++) {
+    const TensorShape& shape = context->Input<Tensor>(i)->Shape();
+    const size_t offset = rank - shape.NumDimensions();
+    for (size_t axis = 0; axis < shape.NumDimensions(); axis++) {
+      const int64_t dim = shape[axis];
+      int64_t& output_dim = output_dims[offset + axis];
+      if (output_dim == 1) {
+        output_dim = dim;
+      } else if (dim != 1 && dim != output_dim) {
+        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "FusedElementwise: input ", i, " with shape ", shape,
+                               " cannot be broadcast to the other inputs at axis ", offset + axis);
+      }
+    }
+  }
+
+  Tensor* output = context->Output(0, TensorShape(output_dims));
+  if (output->Shape().Size() == 0) {
+    return Status::OK();
+  }
+
+  // Element strides of each input along the output axes, 0 along the axes it is broadcast over.
+  std::vector<std::vector<int64_t>> strides(num_inputs_, std::vector<int64_t>(rank, 0));
+  std::vector<const float*> input_data(num_inputs_);
+  for (int i = 0; i < num_inputs_; i++) {
+    const Tensor* input = context->Input<Tensor>(i);
+    const TensorShape& shape = input->Shape();
+    const size_t offset = rank - shape.NumDimensions();
+    int64_t stride = 1;
+    for (size_t axis = shape.NumDimensions(); axis-- > 0;) {
+      strides[i][offset + axis] = shape[axis] == 1 ? 0 : stride;
+      stride *= shape[axis];
+    }
+    input_data[i] = input->Data<float>();
+  }
+
+  // Merge adjacent axes that every input visits the same way: contiguously, or by broadcasting. The innermost
+  // axis is then a row that each input either reads contiguously or broadcasts a single element to.
+  std::vector<int64_t> dims;
+  std::vector<std::vector<int64_t>> merged_strides(num_inputs_);
+  for (size_t axis = 0; axis < rank; axis++) {
+    if (output_dims[axis] == 1) {
+      continue;
+    }
+    bool can_merge = !dims.empty();
+    for (int i = 0; i < num_inputs_ && can_merge; i++) {
+      can_merge = merged_strides[i].back() == strides[i][axis] * output_dims[axis];
+    }
+    if (can_merge) {
+      dims.back() *= output_dims[axis];
+      for (int i = 0; i < num_inputs_; i++) {
+        merged_strides[i].back() = strides[i][axis];
+      }
+    } else {
+      dims.push_back(output_dims[axis]);
+      for (int i = 0; i < num_inputs_; i++) {
+        merged_strides[i].push_back(strides[i][axis]);
+      }
+    }
+  }
+  if (dims.empty()) {
+    dims.push_back(1);
+    for (int i = 0; i < num_inputs_; i++) {
+      merged_strides[i].push_back(0);
+    }
+  }
+
+  const size_t outer_rank = dims.size() - 1;
+  const int64_t row_size = dims.back();
+  const int64_t blocks_per_row = (row_size + kBlockSize - 1) / kBlockSize;
+  const int64_t num_rows = output->Shape().Size() / row_size;
+  float* output_data = output->MutableData<float>();
+
+  const auto num_instructions = static_cast<std::ptrdiff_t>(program_.size());
+  const double num_bytes = static_cast<double>(sizeof(float) * kBlockSize);
+  const TensorOpCost cost{num_bytes * num_inputs_, num_bytes, static_cast<double>(kBlockSize * num_instructions)};
+
+  concurrency::ThreadPool::TryParallelFor(
+      context->GetOperatorThreadPool(), num_rows * blocks_per_row, cost,
+      [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        std::vector<float> registers(SafeInt<size_t>(kBlockSize) * num_instructions);
+        std::vector<BlockValue> values(num_inputs_ + num_instructions);
+
+        for (std::ptrdiff_t block = first; block < last; block++) {
+          const int64_t row = block / blocks_per_row;
+          const int64_t column = (block % blocks_per_row) * kBlockSize;
+          const std::ptrdiff_t count = static_cast<std::ptrdiff_t>(std::min(kBlockSize, row_size - column));
+
+          for (int i = 0; i < num_inputs_; i++) {
+            int64_t offset = 0;
+            int64_t remaining = row;
+            for (size_t axis = outer_rank; axis-- > 0;) {
+              offset += (remaining % dims[axis]) * merged_strides[i][axis];
+              remaining /= dims[axis];
+            }
+            const bool is_scalar = merged_strides[i].back() == 0;
+            values[i] = {input_data[i] + offset + (is_scalar ? 0 : column), is_scalar};
+          }
+
+          float* output_block = output_data + row * row_size + column;
+          for (std::ptrdiff_t j = 0; j < num_instructions; j++) {
+            const Instruction& instruction = program_[j];
+            const BlockValue& lhs = values[instruction.lhs];
+            const BlockValue& rhs = IsUnary(instruction.op) ? lhs : values[instruction.rhs];
+            const bool is_scalar = lhs.is_scalar && rhs.is_scalar;
+
+            // The last instruction writes the output block directly, unless its result is a single element.
+            float* result = (j == num_instructions - 1 && !is_scalar) ? output_block
+                                                                       : registers.data() + j * kBlockSize;
+            ComputeInstruction(instruction.op, lhs, rhs, result, is_scalar ? 1 : count);
+            values[num_inputs_ + j] = {result, is_scalar};
+          }
+
+          const BlockValue& result = values.back();
+          if (result.is_scalar) {
+            std::fill_n(output_block, count, result.data[0]);
+          }
+        }
+      });
+
+  return Status::OK();
+}
+
+}  // namespace contrib
+}  // namespace onnxruntime
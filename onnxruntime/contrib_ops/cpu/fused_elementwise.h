@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <vector>
+
+#include "core/common/common.h"
+#include "core/framework/op_kernel.h"
+
+namespace onnxruntime {
+namespace contrib {
+
+// Evaluates a program of elementwise operators over the broadcast shape of the inputs in a single pass.
+// The output is produced block by block, and the intermediate values of a block stay in per-thread
+// registers instead of being written to tensors.
+class FusedElementwise final : public OpKernel {
+ public:
+  explicit FusedElementwise(const OpKernelInfo& info);
+
+  Status Compute(OpKernelContext* context) const override;
+
+  enum class OpCode : uint8_t {
+    // Binary operators
+    kAdd,
+    kSub,
+    kMul,
+    kDiv,
+    kMax,
+    kMin,
+    // Unary operators
+    kAbs,
+    kNeg,
+    kExp,
+    kLog,
+    kSqrt,
+    kReciprocal,
+    kRelu,
+    kSigmoid,
+    kTanh,
+    kErf,
+  };
+
+  struct Instruction {
+    OpCode op;
+    int lhs;  // index of the first operand: an input, or num_inputs + index of an earlier instruction
+    int rhs;  // index of the second operand, -1 for unary operators
+  };
+
+ private:
+  int num_inputs_;
+  std::vector<Instruction> program_;
+};
+
+}  // namespace contrib
+}  // namespace onnxruntime
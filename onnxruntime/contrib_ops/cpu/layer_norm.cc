@@ -5,6 +5,7 @@
 
 #include "core/common/safeint.h"
 #include "core/framework/tensor.h"
+#include "core/mlas/inc/mlas.h"
 #include "core/platform/threadpool.h"
 #include "core/providers/common.h"
 #include "core/util/math_cpuonly.h"
@@ -64,6 +65,10 @@ Status LayerNorm<T, simplified>::Compute(OpKernelContext* p_ctx) const {
     }
   }
 
+  // The MLAS kernel skips the mean and inv_std_dev outputs that are absent, the loop below needs somewhere to
+  // write them.
+  constexpr bool use_mlas = std::is_same<T, float>::value;
+
   AllocatorPtr alloc;
   ORT_RETURN_IF_ERROR(p_ctx->GetTempSpaceAllocator(&alloc));
 
@@ -76,7 +81,7 @@ Status LayerNorm<T, simplified>::Compute(OpKernelContext* p_ctx) const {
     Tensor* mean = p_ctx->Output(output_index++, TensorShape(mean_inv_std_dev_dim));
     if (mean != nullptr) {
       mean_data = mean->template MutableData<T>();
-    } else {
+    } else if (!use_mlas) {
       auto mean_data_buf = alloc->Alloc(SafeInt<size_t>(sizeof(T)) * norm_count);
       mean_data_buf_ptr = BufferUniquePtr(mean_data_buf, BufferDeleter(alloc));
       mean_data = static_cast<T*>(mean_data_buf_ptr.get());
@@ -89,12 +94,30 @@ Status LayerNorm<T, simplified>::Compute(OpKernelContext* p_ctx) const {
   Tensor* inv_std_dev = p_ctx->Output(output_index, TensorShape(mean_inv_std_dev_dim));
   if (inv_std_dev != nullptr) {
     inv_std_dev_data = inv_std_dev->template MutableData<T>();
-  } else {
+  } else if (!use_mlas) {
     auto inv_std_dev_data_buf = alloc->Alloc(SafeInt<size_t>(sizeof(T)) * norm_count);
     inv_std_dev_data_buf_ptr = BufferUniquePtr(inv_std_dev_data_buf, BufferDeleter(alloc));
     inv_std_dev_data = static_cast<T*>(inv_std_dev_data_buf_ptr.get());
   }
 
+  if constexpr (use_mlas) {
+    MLAS_LAYER_NORM_PARAMS params;
+    params.N = static_cast<size_t>(norm_count);
+    params.D = static_cast<size_t>(norm_size);
+    params.Input = X_data;
+    params.Skip = nullptr;
+    params.Bias = nullptr;
+    params.Gamma = scale_data;
+    params.Beta = bias_data;
+    params.Output = Y_data;
+    params.Mean = mean_data;
+    params.InvStdDev = inv_std_dev_data;
+    params.Epsilon = epsilon_;
+    params.Simplified = simplified;
+    MlasComputeLayerNorm(&params, p_ctx->GetOperatorThreadPool());
+    return Status::OK();
+  }
+
   concurrency::ThreadPool::TryBatchParallelFor(
       p_ctx->GetOperatorThreadPool(), static_cast<int32_t>(norm_count),
       [&](ptrdiff_t task_idx) {
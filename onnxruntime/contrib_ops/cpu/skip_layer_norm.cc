@@ -2,6 +2,7 @@
 // Licensed under the MIT License.
 
 #include "core/framework/tensor.h"
+#include "core/mlas/inc/mlas.h"
 #include "core/util/math_cpuonly.h"
 #include "core/providers/common.h"
 #include "core/platform/threadpool.h"
@@ -98,6 +99,24 @@ Status SkipLayerNorm<T>::Compute(OpKernelContext* p_ctx) const {
 
   T* output_data = output->MutableData<T>();
 
+  if constexpr (std::is_same<T, float>::value) {
+    MLAS_LAYER_NORM_PARAMS params;
+    params.N = static_cast<size_t>(task_count);
+    params.D = static_cast<size_t>(hidden_size);
+    params.Input = input_data;
+    params.Skip = skip_data;
+    params.Bias = bias_data;
+    params.Gamma = gamma_data;
+    params.Beta = beta_data;
+    params.Output = output_data;
+    params.Mean = nullptr;
+    params.InvStdDev = nullptr;
+    params.Epsilon = epsilon_;
+    params.Simplified = false;
+    MlasComputeLayerNorm(&params, p_ctx->GetOperatorThreadPool());
+    return Status::OK();
+  }
+
   concurrency::ThreadPool::TryBatchParallelFor(
       p_ctx->GetOperatorThreadPool(), static_cast<int32_t>(task_count),
       [&](ptrdiff_t task_idx) {
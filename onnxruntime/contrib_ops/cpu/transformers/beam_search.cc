@@ -81,11 +81,15 @@ struct BeamSearchState : public IBeamSearchState<T> {
             int vocab_size,
             int sequence_length,
             int max_length,
-            bool output_scores) {
+            bool output_scores,
+            bool is_cuda) {
     size_t batch_beam_size = SafeInt<size_t>(batch_size) * num_beams;
 
     size_t next_token_size = SafeInt<size_t>(batch_beam_size) * vocab_size;
-    this->next_token_logits = AllocateBuffer<T>(allocator, next_token_logits_buffer_, next_token_size);
+    if (is_cuda) {
+      // The CPU operator computes next token scores straight from the logits.
+      this->next_token_logits = AllocateBuffer<T>(allocator, next_token_logits_buffer_, next_token_size);
+    }
     this->next_token_scores = AllocateBuffer<float>(allocator, next_token_scores_buffer_, next_token_size);
 
     this->next_tokens = AllocateBuffer<int32_t>(allocator, next_tokens_buffer_, SafeInt<size_t>(2) * batch_beam_size);
@@ -414,6 +418,9 @@ Status BeamSearchImpl<T>::Initialize() {
 
   ORT_RETURN_IF_ERROR(CheckInputs(context_));
 
+  ORT_RETURN_IF(IsCuda() && gpt_subgraph_.past_present_share_buffer,
+                "'BeamSearch' with a subgraph that shares past and present buffers is not supported in CUDA.");
+
   // This flag will be updated later when the scores output exists.
   parameters_->output_scores = false;
 
@@ -430,7 +437,7 @@ template <typename T>
 Status BeamSearchImpl<T>::CreateInitialFeeds(gsl::span<int32_t>& sequence_lengths, OrtValue& expanded_input_ids, std::vector<OrtValue>& feeds, IAllocatorUniquePtr<char>& buffer) {
   const OrtValue* input_ids_value = context_.GetInputOrtValue(0);
   const Tensor& input_ids = input_ids_value->Get<Tensor>();
-  return gpt_subgraph_.CreateInitialFeeds(input_ids, implicit_inputs_, parameters_->num_beams, parameters_->pad_token_id, sequence_lengths, expanded_input_ids, feeds, create_inputs_func_, add_to_feeds_func_, buffer);
+  return gpt_subgraph_.CreateInitialFeeds(input_ids, implicit_inputs_, parameters_->num_beams, parameters_->pad_token_id, parameters_->max_length, sequence_lengths, expanded_input_ids, feeds, create_inputs_func_, add_to_feeds_func_, buffer);
 }
 
 template <typename T>
@@ -488,7 +495,8 @@ Status BeamSearchImpl<T>::UpdateFeeds(
     gsl::span<const int32_t> beam_next_tokens,
     gsl::span<const int32_t> beam_indices) {
   return update_feeds_func_(temp_space_allocator_, cuda_stream_, last_outputs, next_inputs, current_length, position_ids,
-                            beam_next_tokens, beam_indices, parameters_->num_beams, GetConsoleDumper());
+                            beam_next_tokens, beam_indices, parameters_->num_beams,
+                            gpt_subgraph_.past_present_share_buffer, GetConsoleDumper());
 }
 
 template <typename T>
@@ -512,7 +520,6 @@ Status BeamSearchImpl<T>::Execute(const FeedsFetchesManager& feeds_fetches_manag
   parameters_->output_scores = (output_scores != nullptr);
 
   std::vector<OrtValue> feeds;
-  // TODO: allocate fetches. use ping-pong buffers for past state.
   std::vector<OrtValue> fetches;
 
   // Initialize resources
@@ -547,7 +554,8 @@ Status BeamSearchImpl<T>::Execute(const FeedsFetchesManager& feeds_fetches_manag
                   parameters_->vocab_size,
                   parameters_->sequence_length,
                   parameters_->max_length,
-                  parameters_->output_scores);
+                  parameters_->output_scores,
+                  IsCuda());
 
   cpu_state.sequences.Init(cpu_state.sequences_space,
                            parameters_->BatchBeamSize(),
@@ -587,6 +595,14 @@ Status BeamSearchImpl<T>::Execute(const FeedsFetchesManager& feeds_fetches_manag
     dumper->Print("***CurrentLength", cur_len, true);
 #endif
 
+    if (gpt_subgraph_.past_present_share_buffer) {
+      // present_i is written into the buffer that is fed as past_i. Logits are allocated by the subgraph.
+      fetches.resize(static_cast<size_t>(gpt_subgraph_.num_subgraph_outputs));
+      for (int i = 1; i < gpt_subgraph_.num_subgraph_outputs; ++i) {
+        fetches[i] = feeds[2 + i];
+      }
+    }
+
     status = utils::ExecuteSubgraph(session_state_, feeds_fetches_manager, feeds, fetches, {},
                                     ExecutionMode::ORT_SEQUENTIAL, context_.GetTerminateFlag(), context_.Logger());
 
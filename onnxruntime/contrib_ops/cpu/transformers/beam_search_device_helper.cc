@@ -1,6 +1,8 @@
+#include <algorithm>
 #include "core/providers/cpu/math/top_k.h"
-#include "core/providers/cpu/math/softmax_shared.h"
 #include "core/common/safeint.h"
+#include "core/mlas/inc/mlas.h"
+#include "core/platform/threadpool.h"
 #include "gsl/gsl"
 #include "sequences.h"
 #include "beam_search_scorer.h"
@@ -147,7 +149,6 @@ void InitBeamState(transformers::IBeamSearchState<T>* beam_state,
                    int max_length,
                    void* /*stream*/) {
   memset(beam_state->beam_scores.data(), 0, beam_state->beam_scores.size_bytes());
-  memset(beam_state->next_token_logits.data(), 0, beam_state->next_token_logits.size_bytes());
   memset(beam_state->next_token_scores.data(), 0, beam_state->next_token_scores.size_bytes());
   memset(beam_state->next_tokens.data(), 0, beam_state->next_tokens.size_bytes());
   memset(beam_state->next_indices.data(), 0, beam_state->next_indices.size_bytes());
@@ -176,6 +177,60 @@ void InitBeamState(transformers::IBeamSearchState<T>* beam_state,
   }
 }
 
+namespace {
+
+// A candidate of the top-k selection over next_token_scores of shape (batch_size, num_beams * vocab_size).
+// index is beam_index * vocab_size + token_id, and candidates with equal scores rank by lower index like TopK.
+struct TopKCandidate {
+  float score;
+  int64_t index;
+};
+
+inline bool RanksHigher(const TopKCandidate& a, const TopKCandidate& b) {
+  return a.score > b.score || (a.score == b.score && a.index < b.index);
+}
+
+// Selects the k highest scores of a row into candidates in no particular order. k shall not exceed the row size.
+// The candidates are kept in a heap whose top is the lowest ranked one. The row is scanned in blocks, and a block
+// whose maximum is not above that candidate is skipped: this holds for almost all blocks of a large vocabulary,
+// and the maximum of a block is a reduction that the compiler vectorizes.
+void SelectTopK(gsl::span<const float> scores, int64_t index_offset, size_t k, TopKCandidate* candidates) {
+  constexpr size_t block_size = 16;
+  const float* data = scores.data();
+  const size_t count = static_cast<size_t>(scores.size());
+
+  for (size_t i = 0; i < k; i++) {
+    candidates[i] = {data[i], index_offset + static_cast<int64_t>(i)};
+  }
+  std::make_heap(candidates, candidates + k, RanksHigher);
+  float threshold = candidates[0].score;
+
+  for (size_t i = k; i < count; i += block_size) {
+    const size_t block_count = std::min(block_size, count - i);
+    const float* block = data + i;
+
+    float block_max = std::numeric_limits<float>::lowest();
+    for (size_t j = 0; j < block_count; j++) {
+      block_max = std::max(block_max, block[j]);
+    }
+    if (block_max <= threshold) {
+      continue;
+    }
+
+    // Scores are visited by increasing index, so a score equal to the threshold never ranks higher.
+    for (size_t j = 0; j < block_count; j++) {
+      if (block[j] > threshold) {
+        std::pop_heap(candidates, candidates + k, RanksHigher);
+        candidates[k - 1] = {block[j], index_offset + static_cast<int64_t>(i + j)};
+        std::push_heap(candidates, candidates + k, RanksHigher);
+        threshold = candidates[0].score;
+      }
+    }
+  }
+}
+
+}  // namespace
+
 template <typename T>
 Status ProcessLogits(const OrtValue& logits,                                 // logits output of subgraph
                      transformers::IBeamSearchState<T>* beam_state,          // state
@@ -190,6 +245,7 @@ Status ProcessLogits(const OrtValue& logits,                                 //
                      void* stream,                                           // cuda stream (for CUDA only)
                      const transformers::IConsoleDumper* dumper) {           // tensor dumper
   ORT_UNUSED_PARAMETER(cpu_state);
+  ORT_UNUSED_PARAMETER(stream);
 #ifndef DEBUG_BEAM_SEARCH
   ORT_UNUSED_PARAMETER(dumper);
 #endif
@@ -208,59 +264,51 @@ Status ProcessLogits(const OrtValue& logits,                                 //
   ORT_ENFORCE(logits_shape.NumDimensions() == 3);
   auto input_length = logits_shape[1];
 
-  // Get logits for the last token:
-  //    next_token_logits = logits[:, -1, :], and the result shape is (batch_size * num_beams, vocab_size)
-  // When input_length == 1, use logits directly in SoftmaxCPU below so it only need for input_length > 1.
-  gsl::span<T>& next_token_logits = beam_state->next_token_logits;
-  if (input_length > 1) {
-    const T* current_logits = logits_data + (input_length - 1) * vocab_size;
-    for (int i = 0; i < batch_beam_size; i++) {
-      gsl::span<const T> source(current_logits, vocab_size);
-      gsl::span<T> target = next_token_logits.subspan(SafeInt<gsl::index>(i) * vocab_size, static_cast<gsl::index>(vocab_size));
-      gsl::copy(source, target);
-      current_logits += input_length * vocab_size;
-    }
-  }
+  // Each row of next token scores is produced in a single task, so that it stays in cache while:
+  //   next_token_scores = log_softmax(next_token_logits, dim=-1), where next_token_logits = logits[:, -1, :]
+  //   the logits processors update the scores
+  //   next_token_scores = next_token_scores + beam_scores[:, None].expand_as(next_token_scores)
+  //   its top 2 * num_beams candidates are selected
+  // The top-k selection like the following is then done over the candidates of the beams of each batch:
+  //   next_token_scores = next_token_scores.view(batch_size, num_beams * vocab_size)
+  //   next_token_scores, next_tokens = torch.topk(next_token_scores, 2 * num_beams, dim=1, largest=True, sorted=True)
+  gsl::span<float>& next_token_scores = beam_state->next_token_scores;
+  const size_t top_k = static_cast<size_t>(2 * num_beams);
+  const size_t row_top_k = std::min(top_k, static_cast<size_t>(vocab_size));
+  ORT_RETURN_IF(static_cast<size_t>(num_beams) * row_top_k < top_k,
+                "BeamSearch op: vocab_size ", vocab_size, " is too small for ", num_beams, " beams");
+
+  auto candidates_buffer = IAllocator::MakeUniquePtr<TopKCandidate>(allocator,
+                                                                     SafeInt<size_t>(batch_beam_size) * row_top_k);
+  TopKCandidate* candidates = candidates_buffer.get();
+
+  concurrency::ThreadPool::TryParallelFor(
+      thread_pool, batch_beam_size, static_cast<double>(vocab_size) * 8.0,
+      [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        for (std::ptrdiff_t i = begin; i < end; i++) {
+          const int batch_beam_index = gsl::narrow_cast<int>(i);
+          const T* current_logits = logits_data + ((i + 1) * input_length - 1) * vocab_size;
+          gsl::span<float> beam_token_scores = next_token_scores.subspan(SafeInt<gsl::index>(i) * vocab_size,
+                                                                         static_cast<gsl::index>(vocab_size));
+
+          MlasComputeSoftmax(current_logits, beam_token_scores.data(), 1, static_cast<size_t>(vocab_size), true,
+                             nullptr);
+
+          logits_processors->ProcessRow(sequences, batch_beam_index, beam_token_scores, step);
+
+          const float beam_score = beam_state->beam_scores[batch_beam_index];
+          float* p = beam_token_scores.data();
+          for (int k = 0; k < vocab_size; k++) {
+            p[k] += beam_score;
+          }
+
+          SelectTopK(beam_token_scores, static_cast<int64_t>(i % num_beams) * vocab_size, row_top_k,
+                     candidates + static_cast<size_t>(i) * row_top_k);
+        }
+      });
 
 #ifdef DEBUG_BEAM_SEARCH
   dumper->Print("logits", logits);
-  dumper->Print("next_token_logits", next_token_logits.data(), batch_size, num_beams, vocab_size);
-#endif
-
-  // Get scores for candidates of next token: next_token_scores = log_softmax(next_token_logits, dim=-1)
-  gsl::span<T>& next_token_scores = beam_state->next_token_scores;
-  ORT_RETURN_IF_ERROR(SoftmaxCPU<T>(batch_beam_size,  // rows
-                                    vocab_size,       // elements per row
-                                    input_length > 1 ? next_token_logits.data() : logits_data,
-                                    next_token_scores.data(),
-                                    true,
-                                    thread_pool));
-
-#ifdef DEBUG_BEAM_SEARCH
-  dumper->Print("next_token_scores after softmax", next_token_scores.data(), batch_size, num_beams, vocab_size);
-#endif
-
-  // Apply all score processors that updates scores
-  logits_processors->Process(sequences, next_token_scores, step);
-
-#ifdef DEBUG_BEAM_SEARCH
-  dumper->Print("next_token_scores after logits processor", next_token_scores.data(), batch_size, num_beams, vocab_size);
-#endif
-
-  // Add beam score to next token scores. Corresponding python code is like:
-  //    next_token_scores = next_token_scores + beam_scores[:, None].expand_as(next_token_scores)
-  // TODO: use thread pool to parrellel
-  int offset = 0;
-  int batch_beam_index = 0;
-  for (int i = 0; i < batch_size; i++) {
-    for (int j = 0; j < num_beams; j++, batch_beam_index++) {
-      for (int k = 0; k < vocab_size; k++, offset++) {
-        next_token_scores[offset] += beam_state->beam_scores[batch_beam_index];
-      }
-    }
-  }
-
-#ifdef DEBUG_BEAM_SEARCH
   dumper->Print("next_token_scores after adding beam_scores", next_token_scores.data(), batch_size, num_beams, vocab_size);
 #endif
 
@@ -270,43 +318,24 @@ Status ProcessLogits(const OrtValue& logits,                                 //
     beam_state->remaining_scores = beam_state->remaining_scores.subspan(next_token_scores.size());
   }
 
-  // Apply top-k selection like the following:
-  //   next_token_scores = next_token_scores.view(batch_size, num_beams * vocab_size)
-  //   next_token_scores, next_tokens = torch.topk(next_token_scores, 2 * num_beams, dim=1, largest=True, sorted=True)
-  int64_t next_token_scores_dims[] = {static_cast<int64_t>(batch_size), SafeInt<int64_t>(num_beams) * vocab_size};
-  TensorShape next_token_scores_shape(&next_token_scores_dims[0], 2);
-  auto element_type = DataTypeImpl::GetType<T>();
-  OrtValue next_token_scores_value;
-  Tensor::InitOrtValue(element_type, next_token_scores_shape, next_token_scores.data(), allocator->Info(), next_token_scores_value);
-  const Tensor& input = next_token_scores_value.Get<Tensor>();
-
-  constexpr int axis = 1;
-  const unsigned top_k = static_cast<unsigned>(2 * num_beams);
-  constexpr bool largest = true;
-  constexpr bool sorted = true;  // results returned in sorted order.
-
-  std::unique_ptr<Tensor> topk_scores;
-  std::unique_ptr<Tensor> topk_indices;
-  ORT_RETURN_IF_ERROR(TopK(&input, axis, top_k, largest, sorted, allocator, stream, thread_pool, topk_scores, topk_indices));
-
-#ifdef DEBUG_BEAM_SEARCH
-  dumper->Print("topk_scores", *(topk_scores.get()));
-  dumper->Print("topk_indices", *(topk_indices.get()));
-#endif
-
   // Convert indices in range [0, num_beams * vocab_size) to token ID of range [0, vocab_size) like the following:
   //   next_indices = (next_tokens / vocab_size).long()
   //   next_tokens = next_tokens % vocab_size
-  gsl::span<const int64_t> next_token_indices = topk_indices->DataAsSpan<int64_t>();
-  offset = 0;
+  auto topk_scores_buffer = IAllocator::MakeUniquePtr<float>(allocator, SafeInt<size_t>(batch_size) * top_k);
+  gsl::span<float> topk_scores(topk_scores_buffer.get(), SafeInt<size_t>(batch_size) * top_k);
+  const size_t batch_candidates = static_cast<size_t>(num_beams) * row_top_k;
+  size_t offset = 0;
   for (int i = 0; i < batch_size; i++) {
-    for (unsigned int j = 0; j < top_k; j++, offset++) {
-      beam_state->next_indices[offset] = gsl::narrow_cast<int32_t>(next_token_indices[offset] / vocab_size);
-      beam_state->next_tokens[offset] = gsl::narrow_cast<int32_t>(next_token_indices[offset] % vocab_size);
+    TopKCandidate* first = candidates + i * batch_candidates;
+    std::partial_sort(first, first + top_k, first + batch_candidates, RanksHigher);
+    for (size_t j = 0; j < top_k; j++, offset++) {
+      topk_scores[offset] = first[j].score;
+      beam_state->next_indices[offset] = gsl::narrow_cast<int32_t>(first[j].index / vocab_size);
+      beam_state->next_tokens[offset] = gsl::narrow_cast<int32_t>(first[j].index % vocab_size);
     }
   }
 
-  gsl::span<const T> next_scores = topk_scores->DataAsSpan<T>();
+  gsl::span<const float> next_scores(topk_scores.data(), topk_scores.size());
   gsl::span<const int32_t> next_tokens(beam_state->next_tokens.data(), beam_state->next_tokens.size());
   gsl::span<const int32_t> next_indices(beam_state->next_indices.data(), beam_state->next_indices.size());
 
@@ -368,6 +397,32 @@ void PickPastState(const std::vector<OrtValue>& last_outputs,
   }
 }
 
+// Past state lives in buffers shared with present state. Instead of copying the past state of the selected
+// beams, point the positions of each beam at the rows of the buffers that hold them.
+void PickCacheIndirection(OrtValue& cache_indirection,
+                          gsl::span<const int32_t>& beam_indices,
+                          int past_sequence_length,
+                          AllocatorPtr allocator) {
+  // cache_indirection: (batch_beam_size, max_length), values are rows of the shared buffers.
+  const TensorShape& shape = cache_indirection.Get<Tensor>().Shape();
+  const int64_t max_length = shape[1];
+  const int32_t* old_data = cache_indirection.Get<Tensor>().Data<int32_t>();
+
+  OrtValue picked;
+  Tensor::InitOrtValue(DataTypeImpl::GetType<int32_t>(), shape, allocator, picked);
+  int32_t* data = picked.GetMutable<Tensor>()->MutableData<int32_t>();
+  for (gsl::index j = 0; j < beam_indices.length(); j++) {
+    const int32_t* source = old_data + beam_indices[j] * max_length;
+    int32_t* target = data + j * max_length;
+    std::copy(source, source + past_sequence_length - 1, target);
+    // The last position was just written into the row of the selected beam, and the next one
+    // will be written into the row of this beam.
+    target[past_sequence_length - 1] = beam_indices[j];
+    std::fill(target + past_sequence_length, target + max_length, static_cast<int32_t>(j));
+  }
+  cache_indirection = picked;
+}
+
 template <typename T>
 Status UpdateFeeds(
     AllocatorPtr allocator,
@@ -379,9 +434,10 @@ Status UpdateFeeds(
     gsl::span<const int32_t> beam_next_tokens,
     gsl::span<const int32_t> beam_indices,
     int num_beams,
+    bool past_present_share_buffer,
     const transformers::IConsoleDumper* dumper) {
   // last_outputs: logits, present_0, present_1, ...
-  // next_inputs: input_ids, position_id, attention_mask, past_0, past_1
+  // next_inputs: input_ids, position_id, attention_mask, past_0, past_1, ..., [past_sequence_length, cache_indirection]
 
   // The following updates inputs for subgraph
 
@@ -431,7 +487,25 @@ Status UpdateFeeds(
 #endif
 
   // Update past state
-  if (num_beams == 1) {
+  if (past_present_share_buffer) {
+    const size_t past_sequence_length_index = last_outputs.size() + 2;
+    const int past_sequence_length = current_length - 1;
+    *next_inputs[past_sequence_length_index].GetMutable<Tensor>()->MutableData<int32_t>() = past_sequence_length;
+    if (num_beams > 1) {
+      PickCacheIndirection(next_inputs[past_sequence_length_index + 1], beam_indices, past_sequence_length, allocator);
+    }
+    return Status::OK();
+  }
+
+  bool beams_in_place = true;
+  for (gsl::index j = 0; j < beam_indices.length(); j++) {
+    if (beam_indices[j] != static_cast<int32_t>(j)) {
+      beams_in_place = false;
+      break;
+    }
+  }
+
+  if (num_beams == 1 || beams_in_place) {
     // feed present_* output to past_* inputs one by one
     for (size_t i = 1; i < last_outputs.size(); ++i) {
       next_inputs[i + 2] = last_outputs[i];
@@ -484,6 +558,7 @@ template Status UpdateFeeds<float>(
     gsl::span<const int32_t> beam_next_tokens,
     gsl::span<const int32_t> beam_indices,
     int num_beams,
+    bool past_present_share_buffer,
     const transformers::IConsoleDumper* dumper);
 
 }  // namespace BeamSearchCpuDeviceHelper
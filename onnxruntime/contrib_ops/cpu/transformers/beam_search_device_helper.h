@@ -100,6 +100,7 @@ using UpdateFeedsFunc = std::function<Status(
     gsl::span<const int32_t> beam_next_tokens,
     gsl::span<const int32_t> beam_indices,
     int num_beams,
+    bool past_present_share_buffer,
     const transformers::IConsoleDumper* dumper)>;
 
 }  // namespace BeamSearchDeviceHelper
@@ -174,6 +175,7 @@ Status UpdateFeeds(
     gsl::span<const int32_t> beam_next_tokens,
     gsl::span<const int32_t> beam_indices,
     int num_beams,
+    bool past_present_share_buffer,
     const transformers::IConsoleDumper* dumper);
 
 }  // namespace BeamSearchCpuDeviceHelper
@@ -19,7 +19,7 @@ namespace transformers {
 
 template <typename T>
 struct IBeamSearchState {
-  gsl::span<T> next_token_logits;      // shape (batch_size * num_beams, vocab_size)
+  gsl::span<T> next_token_logits;      // shape (batch_size * num_beams, vocab_size). Used by CUDA only.
   gsl::span<float> next_token_scores;  // shape (batch_size, num_beams * vocab_size)
   gsl::span<int32_t> next_tokens;      // shape (batch_size, 2 * num_beams)
   gsl::span<int32_t> next_indices;     // shape (batch_size, 2 * num_beams)
@@ -51,6 +51,10 @@ class ILogitsProcessorList {
  public:
   virtual ~ILogitsProcessorList() {}
   virtual void Process(const ISequences* sequences, gsl::span<float>& next_token_scores, int step) = 0;
+
+  // Same as Process for one row of shape (vocab_size). Different rows may be processed concurrently.
+  virtual void ProcessRow(const ISequences* sequences, int batch_beam_index, gsl::span<float> beam_token_scores,
+                          int step) = 0;
 };
 
 // Interface for all scorers for beam search or beam sample.
@@ -1,6 +1,7 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <algorithm>
 #include "core/framework/framework_common.h"
 #include "core/framework/session_state.h"
 #include "core/framework/tensorprotoutils.h"
@@ -21,17 +22,24 @@ GptSubgraph::GptSubgraph(
     const onnxruntime::Node& node_in,
     const std::string& attribute_name,
     const GraphViewer& subgraph_in)
-    : node(node_in), attribute(attribute_name), subgraph(subgraph_in), allocator_(nullptr), is_output_float16_(false) {
+    : node(node_in),
+      attribute(attribute_name),
+      subgraph(subgraph_in),
+      past_present_share_buffer(false),
+      allocator_(nullptr),
+      is_output_float16_(false) {
   num_implicit_inputs = static_cast<int>(node.ImplicitInputDefs().size());
 
   auto& subgraph_inputs = subgraph.GetInputs();
   auto& subgraph_outputs = subgraph.GetOutputs();
 
-  // inputs: input_ids, position_ids, attention_mask, past_0, past_1, ...
+  // inputs: input_ids, position_ids, attention_mask, past_0, past_1, ..., [past_sequence_length, cache_indirection]
   // outputs: logits, present_0, present_1, ...
   num_subgraph_inputs = static_cast<int>(subgraph_inputs.size());
   num_subgraph_outputs = static_cast<int>(subgraph_outputs.size());
 
+  past_present_share_buffer = HasPastPresentShareBufferInputs(subgraph_inputs);
+
   // CheckSubgraph will verify inputs and outputs later.
   subgraph_input_names.reserve(num_subgraph_inputs);
   for (int i = 0; i < num_subgraph_inputs; ++i) {
@@ -46,73 +54,14 @@ GptSubgraph::GptSubgraph(
 
 Status GptSubgraph::Validate(const std::vector<const NodeArg*>& subgraph_inputs,
                              const std::vector<const NodeArg*>& subgraph_outputs) {
-  ORT_RETURN_IF(num_subgraph_outputs <= 1,
-                "Invalid GPT-2 subgraph: number of outputs shall be larger than 1 (Need past state in inputs and outputs).");
-
-  ORT_RETURN_IF(num_subgraph_inputs != num_subgraph_outputs + 2,
-                "Invalid GPT-2 subgraph: number of inputs shall be number of outputs plus 2");
-
-  ORT_RETURN_IF(subgraph_inputs[0]->Name() != "input_ids", "subgraph input 0 shall be named as input_ids, got: ",
-                subgraph_inputs[0]->Name());
-  ORT_RETURN_IF(subgraph_inputs[1]->Name() != "position_ids", "subgraph input 1 shall be named as position_ids, got: ",
-                subgraph_inputs[1]->Name());
-  ORT_RETURN_IF(subgraph_inputs[2]->Name() != "attention_mask", "subgraph input 2 shall be named as attention_mask, got: ",
-                subgraph_inputs[2]->Name());
-  ORT_RETURN_IF(subgraph_inputs[3]->Name() != "past_0", "subgraph input 3 shall be named as past_0, got: ",
-                subgraph_inputs[3]->Name());
-
-  // Past state shape is like (2, batch_size, 12, past_seq_len, 64). Here 12 and 64 are constants of num_heads and hidden_size/num_heads.
-  const ONNX_NAMESPACE::TensorShapeProto* past_shape = subgraph_inputs[3]->Shape();
-  ORT_RETURN_IF(past_shape->dim_size() != 5, "subgraph past state is expected to have 5 dimension, got ",
-                past_shape->dim_size());
-
-  ORT_RETURN_IF(!past_shape->dim(0).has_dim_value() || past_shape->dim(0).dim_value() != 2,
-                "subgraph past state dimension 0 shall have length of 2");
-
-  ORT_RETURN_IF(!past_shape->dim(2).has_dim_value() || past_shape->dim(2).dim_value() <= 0,
-                "subgraph past state dimension 2 shall have a positive value for number of heads");
-
-  ORT_RETURN_IF(!past_shape->dim(4).has_dim_value() || past_shape->dim(4).dim_value() <= 0,
-                "subgraph past state dimension 4 shall have a positive value for hidden size per head");
-
-  // check subgraph outputs
-  ORT_RETURN_IF(subgraph_outputs[0]->Name() != "logits", "subgraph output 0 shall be named as logits, got: ",
-                subgraph_outputs[0]->Name());
-
-  ORT_RETURN_IF(subgraph_outputs[1]->Name() != "present_0", "subgraph input 1 shall be named as present_0, got: ",
-                subgraph_outputs[1]->Name());
-
-  // Logits shape is like (batch_size, seq_len, 50257). Here 50257 is the vocabulary size.
-  const ONNX_NAMESPACE::TensorShapeProto* logits_shape = subgraph_outputs[0]->Shape();
-  ORT_RETURN_IF(logits_shape->dim_size() != 3, "subgraph logits output is expected to have 3 dimension, got ",
-                logits_shape->dim_size());
-
-  ORT_RETURN_IF(!logits_shape->dim(2).has_dim_value() || logits_shape->dim(2).dim_value() <= 0,
-                "subgraph past state dimension 2 shall have a positive value for vocabulary size");
-
-  // Save parameters related to the subgraph.
-  num_heads = static_cast<int>(past_shape->dim(2).dim_value());
-  head_size = static_cast<int>(past_shape->dim(4).dim_value());
-  vocab_size = static_cast<int>(logits_shape->dim(2).dim_value());
-  num_layers = static_cast<int>(subgraph_outputs.size()) - 1;
-
-  ORT_RETURN_IF(subgraph_inputs[0]->TypeAsProto()->tensor_type().elem_type() != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_INT32,
-                "subgraph input 0 (input_ids) shall have int32 type");
-  ORT_RETURN_IF(subgraph_inputs[1]->TypeAsProto()->tensor_type().elem_type() != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_INT32,
-                "subgraph input 1 (position_ids) shall have int32 type");
-  ORT_RETURN_IF(subgraph_inputs[2]->TypeAsProto()->tensor_type().elem_type() != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_INT32,
-                "subgraph input 2 (attention_mask) shall have int32 type");
-
-  auto output_type = subgraph_outputs[0]->TypeAsProto()->tensor_type().elem_type();
-  ORT_RETURN_IF(output_type != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_FLOAT && output_type != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_FLOAT16,
-                "subgraph output 0 (logits) shall be float or float16 data type");
-
-  ORT_RETURN_IF(subgraph_inputs[3]->TypeAsProto()->tensor_type().elem_type() != output_type,
-                "subgraph input 3 (past_0) shall shall have same data type of logits output");
-  ORT_RETURN_IF(subgraph_outputs[1]->TypeAsProto()->tensor_type().elem_type() != output_type,
-                "subgraph output 1 (present_0) shall shall have same data type of logits output");
-
-  is_output_float16_ = (output_type == ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_FLOAT16);
+  GptSubgraphInfo info;
+  ORT_RETURN_IF_ERROR(ValidateGptSubgraph(subgraph_inputs, subgraph_outputs, info));
+
+  num_heads = info.num_heads;
+  head_size = info.head_size;
+  vocab_size = info.vocab_size;
+  num_layers = info.num_layers;
+  is_output_float16_ = info.is_output_float16;
 
   return Status::OK();
 }
@@ -187,6 +136,7 @@ Status GptSubgraph::CreateInitialFeeds(
     const std::vector<const OrtValue*>& implicit_inputs,
     int num_beams,
     int pad_token_id,
+    int max_length,
     gsl::span<int32_t>& sequence_lengths,
     OrtValue& expanded_input_ids,
     std::vector<OrtValue>& feeds,
@@ -214,12 +164,15 @@ Status GptSubgraph::CreateInitialFeeds(
   auto default_allocator = provider->GetAllocator(0, OrtMemTypeDefault);
   allocator_ = default_allocator;
 
-  // Initialize empty past state
+  // Initialize empty past state. With a shared buffer, the past state of a layer is the buffer of
+  // max_length positions that present state is written to, and past_sequence_length tells how many are valid.
   auto past_type = IsOutputFloat16() ? DataTypeImpl::GetType<MLFloat16>() : DataTypeImpl::GetType<float>();
-  int64_t past_state_dims[] = {2, batch_size * num_beams, num_heads, 0, head_size};
+  int64_t past_state_dims[] = {2, batch_size * num_beams, num_heads, past_present_share_buffer ? max_length : 0, head_size};
   TensorShape past_shape(&past_state_dims[0], 5);
   OrtValue empty_past;
-  Tensor::InitOrtValue(past_type, past_shape, default_allocator, empty_past);
+  if (!past_present_share_buffer) {
+    Tensor::InitOrtValue(past_type, past_shape, default_allocator, empty_past);
+  }
 
   // The ordering is the same as used in Setup
   feeds.reserve(static_cast<size_t>(num_subgraph_inputs) + static_cast<size_t>(num_implicit_inputs));
@@ -231,8 +184,35 @@ Status GptSubgraph::CreateInitialFeeds(
   ORT_RETURN_IF_ERROR(add_to_feeds_func(provider, expanded_input_ids, expanded_position_ids, expanded_attention_mask, feeds, buffer));
 
   // The remaing inputs are past state.
-  for (int i = 3; i < num_subgraph_inputs; ++i) {
-    feeds.push_back(empty_past);
+  for (int i = 3; i < 3 + num_layers; ++i) {
+    if (past_present_share_buffer) {
+      OrtValue past;
+      Tensor::InitOrtValue(past_type, past_shape, default_allocator, past);
+      feeds.push_back(past);
+    } else {
+      feeds.push_back(empty_past);
+    }
+  }
+
+  if (past_present_share_buffer) {
+    auto int32_type = DataTypeImpl::GetType<int32_t>();
+    int64_t past_sequence_length_dims[] = {1};
+    OrtValue past_sequence_length;
+    Tensor::InitOrtValue(int32_type, TensorShape(&past_sequence_length_dims[0], 1), default_allocator,
+                         past_sequence_length);
+    *past_sequence_length.GetMutable<Tensor>()->MutableData<int32_t>() = 0;
+    feeds.push_back(past_sequence_length);
+
+    // cache_indirection[i][j] is the beam whose row of the buffer holds position j of beam i. Every beam
+    // writes its positions of the first run into its own row.
+    int64_t cache_indirection_dims[] = {batch_size * num_beams, max_length};
+    OrtValue cache_indirection;
+    Tensor::InitOrtValue(int32_type, TensorShape(&cache_indirection_dims[0], 2), default_allocator, cache_indirection);
+    int32_t* cache_indirection_data = cache_indirection.GetMutable<Tensor>()->MutableData<int32_t>();
+    for (int64_t i = 0; i < batch_size * num_beams; ++i) {
+      std::fill_n(cache_indirection_data + i * max_length, max_length, static_cast<int32_t>(i));
+    }
+    feeds.push_back(cache_indirection);
   }
 
   // pass in implicit inputs
@@ -5,6 +5,7 @@
 #include "gsl/gsl"
 #include "core/framework/allocator.h"
 #include "core/framework/feeds_fetches_manager.h"
+#include "core/framework/gpt_subgraph_info.h"
 #include "contrib_ops/cpu/transformers/beam_search_device_helper.h"
 
 namespace onnxruntime {
@@ -40,6 +41,12 @@ struct GptSubgraph {
   int vocab_size;
   int num_layers;
 
+  // The subgraph has the inputs past_sequence_length and cache_indirection after the past state.
+  // Past and present state of a layer then share one buffer of max_length positions that the subgraph
+  // appends the new positions to, and the beams index the positions of that buffer through
+  // cache_indirection instead of having their past state copied.
+  bool past_present_share_buffer;
+
   // Setup exectuion
   Status Setup(const SessionState& session_state,
                const SessionState& subgraph_session_state);
@@ -50,6 +57,7 @@ struct GptSubgraph {
       const std::vector<const OrtValue*>& implicit_inputs,
       int num_beams,
       int pad_token_id,
+      int max_length,
       gsl::span<int32_t>& sequence_lengths,
       OrtValue& expanded_input_ids,
       std::vector<OrtValue>& feeds,
@@ -7,25 +7,11 @@ namespace onnxruntime {
 namespace contrib {
 namespace transformers {
 
-template <typename T>
-gsl::span<T> NextTokenScores<T>::GetScores(int batch_beam_index) {
-  assert(batch_beam_index >= 0 && batch_beam_index < batch_beam_size);
-  return scores.subspan(static_cast<gsl::index>(batch_beam_index) * vocab_size, vocab_size);
-}
-
-template <typename T>
-void NextTokenScores<T>::SetScore(int token_id, T score) {
-  assert(token_id >= 0 && token_id < vocab_size);
-  for (int i = 0; i < batch_beam_size; i++) {
-    scores[static_cast<gsl::index>(i) * vocab_size + token_id] = score;
-  }
-}
-
 #ifdef DEBUG_BEAM_SEARCH
 template <typename T>
-void DumpScores(const char* name, const NextTokenScores<T>& next_token_scores) {
+void DumpScores(const char* name, gsl::span<const T> beam_token_scores) {
   std::cout << name << std::endl;
-  ORT_UNUSED_PARAMETER(next_token_scores);
+  ORT_UNUSED_PARAMETER(beam_token_scores);
 }
 #endif
 
@@ -36,13 +22,15 @@ MinLengthLogitsProcessor<T>::MinLengthLogitsProcessor(int min_length, int eos_to
 
 template <typename T>
 void MinLengthLogitsProcessor<T>::Process(const ISequences* sequences,
-                                          NextTokenScores<T>& next_token_scores) {
+                                          int /*batch_beam_index*/,
+                                          gsl::span<T> beam_token_scores) {
   if (sequences->GetSequenceLength() < min_length_) {
-    next_token_scores.SetScore(eos_token_id_, std::numeric_limits<T>::lowest());
+    assert(eos_token_id_ >= 0 && eos_token_id_ < static_cast<int>(beam_token_scores.size()));
+    beam_token_scores[eos_token_id_] = std::numeric_limits<T>::lowest();
   }
 
 #ifdef DEBUG_BEAM_SEARCH
-  DumpScores("MinLengthLogitsProcessor", next_token_scores);
+  DumpScores<T>("MinLengthLogitsProcessor", beam_token_scores);
 #endif
 }
 
@@ -52,29 +40,26 @@ RepetitionPenaltyLogitsProcessor<T>::RepetitionPenaltyLogitsProcessor(float pena
 
 template <typename T>
 void RepetitionPenaltyLogitsProcessor<T>::Process(const ISequences* sequences,
-                                                  NextTokenScores<T>& next_token_scores) {
-  const int batch_beam_size = next_token_scores.batch_beam_size;
-  for (int i = 0; i < batch_beam_size; i++) {
-    gsl::span<T> beam_token_scores = next_token_scores.GetScores(i);
-    gsl::span<const int32_t> sequence = sequences->GetSequence(i);
-
-    // Find unique word IDs in sequence.
-    std::unordered_set<int32_t> unique_word_ids;
-    for (const auto& word_id : sequence) {
-      unique_word_ids.insert(word_id);
-    }
+                                                  int batch_beam_index,
+                                                  gsl::span<T> beam_token_scores) {
+  gsl::span<const int32_t> sequence = sequences->GetSequence(batch_beam_index);
+
+  // Find unique word IDs in sequence.
+  std::unordered_set<int32_t> unique_word_ids;
+  for (const auto& word_id : sequence) {
+    unique_word_ids.insert(word_id);
+  }
 
-    for (const int32_t word_id : unique_word_ids) {
-      T score = beam_token_scores[word_id];
+  for (const int32_t word_id : unique_word_ids) {
+    T score = beam_token_scores[word_id];
 
-      // If score < 0, then repetition penalty > 1.0 has to multiplied to reduce the previous token probability,
-      // This assumes that scores are either positive (like ctrl) or negative (like GPT-2), but not a mixture.
-      beam_token_scores[word_id] = (score < 0 ? score * penalty_ : score / penalty_);
-    }
+    // If score < 0, then repetition penalty > 1.0 has to multiplied to reduce the previous token probability,
+    // This assumes that scores are either positive (like ctrl) or negative (like GPT-2), but not a mixture.
+    beam_token_scores[word_id] = (score < 0 ? score * penalty_ : score / penalty_);
   }
 
 #ifdef DEBUG_BEAM_SEARCH
-  DumpScores("RepetitionPenaltyLogitsProcessor", next_token_scores);
+  DumpScores<T>("RepetitionPenaltyLogitsProcessor", beam_token_scores);
 #endif
 }
 
@@ -84,37 +69,33 @@ NoRepeatNGramLogitsProcessor<T>::NoRepeatNGramLogitsProcessor(int ngram_size) :
 
 template <typename T>
 void NoRepeatNGramLogitsProcessor<T>::Process(const ISequences* sequences,
-                                              NextTokenScores<T>& next_token_scores) {
+                                              int batch_beam_index,
+                                              gsl::span<T> beam_token_scores) {
   if (ngram_size_ == 0 || ngram_size_ > sequences->GetSequenceLength()) {
     return;
   }
 
   const gsl::index prefix_length = static_cast<gsl::index>(ngram_size_) - 1;
-  int batch_beam_size = next_token_scores.batch_beam_size;
-
-  for (int i = 0; i < batch_beam_size; i++) {
-    gsl::span<T> beam_token_scores = next_token_scores.GetScores(i);
-    gsl::span<const int32_t> sequence = sequences->GetSequence(i);
-
-    gsl::span<const int32_t> prefix = sequence.subspan(sequence.length() - prefix_length);
-    ORT_ENFORCE(prefix.length() == prefix_length);
-
-    std::unordered_set<int32_t> blocked_word_ids;
-    for (int j = 0; j <= static_cast<int>(sequence.length()) - ngram_size_; j++) {
-      // Here we use naive algorithm for matching. The complexity is O(batch_beam_size * ngram_size * sequence_length)
-      // TODO: build N-Gram index (hash table with prefix of length NGram - 1 as key, and list of last word of NGram as value) for fast matching.
-      if (ngram_size_ == 1 || prefix == sequence.subspan(j, prefix_length)) {
-        blocked_word_ids.insert(sequence[static_cast<gsl::index>(j) + prefix_length]);
-      }
-    }
+  gsl::span<const int32_t> sequence = sequences->GetSequence(batch_beam_index);
+
+  gsl::span<const int32_t> prefix = sequence.subspan(sequence.length() - prefix_length);
+  ORT_ENFORCE(prefix.length() == prefix_length);
 
-    for (const int32_t word_id : blocked_word_ids) {
-      beam_token_scores[word_id] = std::numeric_limits<T>::lowest();
+  std::unordered_set<int32_t> blocked_word_ids;
+  for (int j = 0; j <= static_cast<int>(sequence.length()) - ngram_size_; j++) {
+    // Here we use naive algorithm for matching. The complexity is O(ngram_size * sequence_length) per beam.
+    // TODO: build N-Gram index (hash table with prefix of length NGram - 1 as key, and list of last word of NGram as value) for fast matching.
+    if (ngram_size_ == 1 || prefix == sequence.subspan(j, prefix_length)) {
+      blocked_word_ids.insert(sequence[static_cast<gsl::index>(j) + prefix_length]);
     }
   }
 
+  for (const int32_t word_id : blocked_word_ids) {
+    beam_token_scores[word_id] = std::numeric_limits<T>::lowest();
+  }
+
 #ifdef DEBUG_BEAM_SEARCH
-  DumpScores("NoRepeatNGramLogitsProcessor", next_token_scores);
+  DumpScores<T>("NoRepeatNGramLogitsProcessor", beam_token_scores);
 #endif
 }
 
@@ -124,56 +105,52 @@ VocabMaskLogitsProcessor<T>::VocabMaskLogitsProcessor(const gsl::span<const int3
 
 template <typename T>
 void VocabMaskLogitsProcessor<T>::Process(const ISequences* /*sequences*/,
-                                          NextTokenScores<T>& next_token_scores) {
+                                          int /*batch_beam_index*/,
+                                          gsl::span<T> beam_token_scores) {
   assert(!vocab_mask_.empty());
+  assert(vocab_mask_.size() == beam_token_scores.size());
 
   // Process vocabulary mask and set tokens with mask value 0 to -inf.
-  T* p = next_token_scores.scores.data();
-  // next_token_scores shape (batch_size * num_beams, vocab_size)
   // vocab_mask shape (vocab_size).
-  for (int i = 0; i < next_token_scores.batch_beam_size; i++) {
-    for (int j = 0; j < next_token_scores.vocab_size; j++, p++) {
-      if (vocab_mask_[j] == 0) {
-        *p = std::numeric_limits<T>::lowest();
-      }
+  const size_t vocab_size = static_cast<size_t>(beam_token_scores.size());
+  const int32_t* mask = vocab_mask_.data();
+  T* p = beam_token_scores.data();
+  for (size_t j = 0; j < vocab_size; j++) {
+    if (mask[j] == 0) {
+      p[j] = std::numeric_limits<T>::lowest();
     }
   }
 
 #ifdef DEBUG_BEAM_SEARCH
-  DumpScores("VocabMaskLogitsProcessor", next_token_scores);
+  DumpScores<T>("VocabMaskLogitsProcessor", beam_token_scores);
 #endif
 }
 
 template <typename T>
-PrefixVocabMaskLogitsProcessor<T>::PrefixVocabMaskLogitsProcessor(const gsl::span<const int32_t>& prefix_vocab_mask, int batch_size)
-    : prefix_vocab_mask_(prefix_vocab_mask), batch_size_(batch_size) {
+PrefixVocabMaskLogitsProcessor<T>::PrefixVocabMaskLogitsProcessor(const gsl::span<const int32_t>& prefix_vocab_mask, int num_beams)
+    : prefix_vocab_mask_(prefix_vocab_mask), num_beams_(num_beams) {
 }
 
 template <typename T>
 void PrefixVocabMaskLogitsProcessor<T>::Process(const ISequences* /*sequences*/,
-                                                NextTokenScores<T>& next_token_scores) {
+                                                int batch_beam_index,
+                                                gsl::span<T> beam_token_scores) {
   assert(!prefix_vocab_mask_.empty());
 
-  // next_token_scores shape (batch_size * num_beams, vocab_size)
-  int num_beams = next_token_scores.batch_beam_size / batch_size_;
-  assert(num_beams * batch_size_ == next_token_scores.batch_beam_size);
-
   // Process prefix vocabulary mask and set tokens with mask value 0 to -inf.
-  // prefix_vocab_mask shape (batch_szie, vocab_size).
-  T* p = next_token_scores.scores.data();
-  for (int i = 0; i < batch_size_; i++) {
-    size_t prefix_vocab_mask_offset = SafeInt<size_t>(i) * next_token_scores.vocab_size;
-    for (int j = 0; j < num_beams; j++) {
-      for (int k = 0; k < next_token_scores.vocab_size; k++, p++) {
-        if (prefix_vocab_mask_[prefix_vocab_mask_offset + static_cast<size_t>(k)] == 0) {
-          *p = std::numeric_limits<T>::lowest();
-        }
-      }
+  // prefix_vocab_mask shape (batch_szie, vocab_size), and the row belongs to batch batch_beam_index / num_beams.
+  const int batch_index = batch_beam_index / num_beams_;
+  const size_t vocab_size = static_cast<size_t>(beam_token_scores.size());
+  const int32_t* mask = prefix_vocab_mask_.data() + SafeInt<size_t>(batch_index) * vocab_size;
+  T* p = beam_token_scores.data();
+  for (size_t k = 0; k < vocab_size; k++) {
+    if (mask[k] == 0) {
+      p[k] = std::numeric_limits<T>::lowest();
     }
   }
 
 #ifdef DEBUG_BEAM_SEARCH
-  DumpScores("PrefixVocabMaskLogitsProcessor", next_token_scores);
+  DumpScores<T>("PrefixVocabMaskLogitsProcessor", beam_token_scores);
 #endif
 }
 
@@ -196,7 +173,7 @@ void LogitsProcessorList::Init(const BeamSearchParameters& parameters) {
   }
 
   if (!parameters.prefix_vocab_mask.empty()) {
-    prefix_vocab_mask_processor_ = std::make_unique<PrefixVocabMaskLogitsProcessor<float>>(parameters.prefix_vocab_mask, parameters.batch_size);
+    prefix_vocab_mask_processor_ = std::make_unique<PrefixVocabMaskLogitsProcessor<float>>(parameters.prefix_vocab_mask, parameters.num_beams);
     processor_list_.push_back(prefix_vocab_mask_processor_.get());
   }
 
@@ -212,13 +189,21 @@ void LogitsProcessorList::Init(const BeamSearchParameters& parameters) {
 void LogitsProcessorList::Process(const ISequences* sequences,
                                   gsl::span<float>& next_token_scores,
                                   int step) {
-  NextTokenScores<float> input_scores = {next_token_scores, batch_beam_size_, vocab_size_};
+  for (int i = 0; i < batch_beam_size_; i++) {
+    ProcessRow(sequences, i, next_token_scores.subspan(static_cast<gsl::index>(i) * vocab_size_, vocab_size_), step);
+  }
+}
+
+void LogitsProcessorList::ProcessRow(const ISequences* sequences,
+                                     int batch_beam_index,
+                                     gsl::span<float> beam_token_scores,
+                                     int step) {
   for (size_t i = 0; i < processor_list_.size(); i++) {
     // Prefix vocab mask is applied to first iteration only.
     if (step > 1 && processor_list_[i] == prefix_vocab_mask_processor_.get()) {
       continue;
     }
-    processor_list_[i]->Process(sequences, input_scores);
+    processor_list_[i]->Process(sequences, batch_beam_index, beam_token_scores);
   }
 }
 
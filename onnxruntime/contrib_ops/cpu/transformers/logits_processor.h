@@ -9,25 +9,16 @@ namespace onnxruntime {
 namespace contrib {
 namespace transformers {
 
-template <typename T>
-struct NextTokenScores {
-  gsl::span<T>& scores;
-  int batch_beam_size;
-  int vocab_size;
-
-  gsl::span<T> GetScores(int batch_beam_index);
-
-  void SetScore(int token_id, T score);
-};
-
 // Interface for all scorers for beam search or beam sample.
+// Each call updates the scores of one row of shape (vocab_size), so that rows can be processed concurrently.
 template <typename T>
 class ILogitsProcessor {
  public:
   virtual ~ILogitsProcessor() {}
 
   virtual void Process(const ISequences* sequences,
-                       NextTokenScores<T>& next_token_scores) = 0;
+                       int batch_beam_index,
+                       gsl::span<T> beam_token_scores) = 0;
 };
 
 template <typename T>
@@ -36,7 +27,8 @@ class MinLengthLogitsProcessor : public ILogitsProcessor<T> {
   MinLengthLogitsProcessor(int min_length, int eos_token_id);
 
   void Process(const ISequences* sequences,
-               NextTokenScores<T>& next_token_scores) override;
+               int batch_beam_index,
+               gsl::span<T> beam_token_scores) override;
 
  private:
   int min_length_;
@@ -49,7 +41,8 @@ class RepetitionPenaltyLogitsProcessor : public ILogitsProcessor<T> {
   RepetitionPenaltyLogitsProcessor(float penalty);
 
   void Process(const ISequences* sequences,
-               NextTokenScores<T>& next_token_scores) override;
+               int batch_beam_index,
+               gsl::span<T> beam_token_scores) override;
 
  private:
   float penalty_;
@@ -61,7 +54,8 @@ class NoRepeatNGramLogitsProcessor : public ILogitsProcessor<T> {
   NoRepeatNGramLogitsProcessor(int ngram_size);
 
   void Process(const ISequences* sequences,
-               NextTokenScores<T>& next_token_scores) override;
+               int batch_beam_index,
+               gsl::span<T> beam_token_scores) override;
 
  private:
   int ngram_size_;
@@ -73,7 +67,8 @@ class VocabMaskLogitsProcessor : public ILogitsProcessor<T> {
   VocabMaskLogitsProcessor(const gsl::span<const int32_t>& vocab_mask);
 
   void Process(const ISequences* sequences,
-               NextTokenScores<T>& next_token_scores) override;
+               int batch_beam_index,
+               gsl::span<T> beam_token_scores) override;
 
  private:
   gsl::span<const int32_t> vocab_mask_;
@@ -82,21 +77,24 @@ class VocabMaskLogitsProcessor : public ILogitsProcessor<T> {
 template <typename T>
 class PrefixVocabMaskLogitsProcessor : public ILogitsProcessor<T> {
  public:
-  PrefixVocabMaskLogitsProcessor(const gsl::span<const int32_t>& vocab_mask, int batch_size);
+  PrefixVocabMaskLogitsProcessor(const gsl::span<const int32_t>& vocab_mask, int num_beams);
 
   void Process(const ISequences* sequences,
-               NextTokenScores<T>& next_token_scores) override;
+               int batch_beam_index,
+               gsl::span<T> beam_token_scores) override;
 
  private:
   gsl::span<const int32_t> prefix_vocab_mask_;
-  const int batch_size_;
+  const int num_beams_;
 };
 
 class LogitsProcessorList : public ILogitsProcessorList {
  public:
   LogitsProcessorList() = default;
   void Init(const BeamSearchParameters& parameters);
-  void Process(const ISequences* sequences, gsl::span<float>& next_token_scores, int step);
+  void Process(const ISequences* sequences, gsl::span<float>& next_token_scores, int step) override;
+  void ProcessRow(const ISequences* sequences, int batch_beam_index, gsl::span<float> beam_token_scores,
+                  int step) override;
 
  private:
   int batch_beam_size_;
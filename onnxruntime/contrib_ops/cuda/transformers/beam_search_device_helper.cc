@@ -412,7 +412,10 @@ Status UpdateFeeds(
     gsl::span<const int32_t> beam_next_tokens,
     gsl::span<const int32_t> beam_indices,
     int num_beams,
+    bool past_present_share_buffer,
     const transformers::IConsoleDumper* dumper) {
+  ORT_RETURN_IF(past_present_share_buffer, "Sharing past and present buffers is not supported in CUDA.");
+
   // Update input_ids with next tokens.
   int batch_beam_size = static_cast<int>(beam_next_tokens.length());
   int64_t dims[] = {batch_beam_size, 1};
@@ -506,6 +509,7 @@ template Status UpdateFeeds<float>(
     gsl::span<const int32_t> beam_next_tokens,
     gsl::span<const int32_t> beam_indices,
     int num_beams,
+    bool past_present_share_buffer,
     const transformers::IConsoleDumper* dumper);
 
 // Float16
@@ -542,6 +546,7 @@ template Status UpdateFeeds<MLFloat16>(
     gsl::span<const int32_t> beam_next_tokens,
     gsl::span<const int32_t> beam_indices,
     int num_beams,
+    bool past_present_share_buffer,
     const transformers::IConsoleDumper* dumper);
 
 }  // namespace BeamSearchCudaDeviceHelper
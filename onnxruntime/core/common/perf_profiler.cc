@@ -10,6 +10,36 @@
 //   PerfProfiler(&counter_name_map, search_perf_event_names, perf_event_attribute_default);
 // }
 
+// Recognizes the generic perf events the derived metrics need. Raw PMU events stay PERF_ROLE_OTHER.
+static perf_counter_role_t GetCounterRole(uint type, unsigned long long config) {
+  if (type == PERF_TYPE_HARDWARE) {
+    switch (config) {
+      case PERF_COUNT_HW_CPU_CYCLES:
+        return PERF_ROLE_CYCLES;
+      case PERF_COUNT_HW_INSTRUCTIONS:
+        return PERF_ROLE_INSTRUCTIONS;
+      case PERF_COUNT_HW_CACHE_MISSES:
+        return PERF_ROLE_LLC_MISSES;
+      default:
+        return PERF_ROLE_OTHER;
+    }
+  }
+  if (type == PERF_TYPE_HW_CACHE) {
+    // config is cache id | op << 8 | result << 16
+    unsigned long long cache_id = config & 0xff;
+    unsigned long long result = (config >> 16) & 0xff;
+    if (result == PERF_COUNT_HW_CACHE_RESULT_MISS) {
+      if (cache_id == PERF_COUNT_HW_CACHE_L1D) {
+        return PERF_ROLE_L1D_MISSES;
+      }
+      if (cache_id == PERF_COUNT_HW_CACHE_LL) {
+        return PERF_ROLE_LLC_MISSES;
+      }
+    }
+  }
+  return PERF_ROLE_OTHER;
+}
+
 PerfProfiler::PerfProfiler(std::map<perf_type_config_t, std::string> *perf_counter_name_map, std::map<std::string, std::string> *search_perf_event_rename, perf_event_attr *perf_event_attribute_default) {
   perf_event_attr pea_default;
   std::map<perf_type_config_t, std::string> counter_name_map;
@@ -24,10 +54,11 @@ PerfProfiler::PerfProfiler(std::map<perf_type_config_t, std::string> *perf_count
     pea_default.disabled = 1;
     pea_default.exclude_kernel = 1;
     pea_default.exclude_hv = 1;
-    pea_default.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
   } else {
     pea_default = *perf_event_attribute_default;
   }
+  // ReadGroup parses this layout, and the time fields are needed to scale multiplexed groups
+  pea_default.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
 
   if (perf_counter_name_map != NULL) {
     counter_name_map = *perf_counter_name_map;
@@ -117,6 +148,7 @@ PerfProfiler::PerfProfiler(std::map<perf_type_config_t, std::string> *perf_count
     perf_counter_info_t pci;
     pci.pea = pea;
     pci.counter_name = kv.second;
+    pci.role = GetCounterRole(pea.type, pea.config);
     // printf("counter name map: %s type: %d config: %llu\n", pci.counter_name.c_str(), pea.type, pea.config);
     perf_counter_info.emplace_back(pci);
   }
@@ -125,83 +157,237 @@ PerfProfiler::PerfProfiler(std::map<perf_type_config_t, std::string> *perf_count
     printf("error: no perf counters found!\n");
     exit(1);
   }
+
+  // the derived metrics take each role from the first counter that has it
+  for (size_t i = 0; i < perf_counter_info.size(); i++) {
+    for (size_t j = 0; j < i; j++) {
+      if (perf_counter_info[i].role != PERF_ROLE_OTHER && perf_counter_info[i].role == perf_counter_info[j].role) {
+        printf("perf: %s counts the same as %s, the derived metrics use %s\n",
+               perf_counter_info[i].counter_name.c_str(), perf_counter_info[j].counter_name.c_str(),
+               perf_counter_info[j].counter_name.c_str());
+        break;
+      }
+    }
+  }
+}
+
+
+void PerfProfiler::Initialize(const std::vector<unsigned>& worker_thread_ids) {
+  // a subgraph Run inside a Run that is counting, keep the groups of the outer Run
+  if (run_depth.value.load() > 0) {
+    return;
+  }
+
+  std::vector<int> thread_ids;
+  thread_ids.push_back(static_cast<int>(syscall(SYS_gettid)));
+  for (unsigned tid : worker_thread_ids) {
+    // workers that have not started yet report 0, they keep an unopened group until a later Initialize
+    thread_ids.push_back(static_cast<int>(tid));
+  }
+
+  if (perf_thread_groups.size() == thread_ids.size()) {
+    bool same_threads = true;
+    for (size_t i = 0; i < thread_ids.size(); i++) {
+      if (perf_thread_groups[i].tid != thread_ids[i]) {
+        same_threads = false;
+        break;
+      }
+    }
+    if (same_threads) {
+      return;
+    }
+  }
+
+  Close();
+  for (int tid : thread_ids) {
+    perf_thread_groups.emplace_back(OpenGroup(tid));
+  }
 }
 
+perf_thread_group_t PerfProfiler::OpenGroup(int tid) {
+  perf_thread_group_t group;
+  group.tid = tid;
+  group.perf_syscall_data.assign(perf_counter_info.size(), {-1, 0});
+
+  if (tid == 0) {
+    return group;
+  }
 
-void PerfProfiler::Initialize() {
   uint64_t id;
   int fd;
-
-  int pid = 0;
   int cpu = -1;
 
   // printf("pci size: %d\n", perf_counter_info.size());
   for (uint i = 0; i < perf_counter_info.size(); i++) {
-
-    if (i == 0) {
-      fd = syscall(__NR_perf_event_open, &perf_counter_info[i].pea, pid, cpu, -1, 0);
-      perf_counter_info[i].perf_syscall_data.fd = fd;
-      ioctl(perf_counter_info[i].perf_syscall_data.fd, PERF_EVENT_IOC_ID, &id);
-      perf_counter_info[i].perf_syscall_data.id = id;
-    } else {
-      // fd of group leader
-      fd = syscall(__NR_perf_event_open, &perf_counter_info[i].pea, pid, cpu, perf_counter_info[0].perf_syscall_data.fd /*!!!*/, 0);
-      perf_counter_info[i].perf_syscall_data.fd = fd;
-      ioctl(perf_counter_info[i].perf_syscall_data.fd, PERF_EVENT_IOC_ID, &id);
-      perf_counter_info[i].perf_syscall_data.id = id;
+    // the first counter of each event group is its leader, the others join the leader's group
+    int group_fd = -1;
+    if (!IsGroupLeader(i)) {
+      size_t leader = max_events_per_group == 0 ? 0 : (i / max_events_per_group) * max_events_per_group;
+      group_fd = group.perf_syscall_data[leader].fd;
     }
+    fd = syscall(__NR_perf_event_open, &perf_counter_info[i].pea, tid, cpu, group_fd, 0);
+    group.perf_syscall_data[i].fd = fd;
 
-    if (perf_counter_info[i].perf_syscall_data.fd == -1) {
+    if (fd == -1) {
       char buffer[ 256 ];
       char * errorMsg = strerror_r( errno, buffer, 256 ); // GNU-specific version, Linux default
-      printf("Error on %s - %s\n", perf_counter_info[i].counter_name.c_str(), errorMsg); //return value has to be used since buffer might not be modified
+      printf("Error on %s (tid %d) - %s\n", perf_counter_info[i].counter_name.c_str(), tid, errorMsg); //return value has to be used since buffer might not be modified
       printf("perf error hint: %s\n", perfErrorHint.c_str());
       exit(1);
     }
 
-    // printf("name: %s fd: %d id: %d\n", perf_counter_info[i].counter_name.c_str(), perf_counter_info[i].perf_syscall_data.fd, perf_counter_info[i].perf_syscall_data.id);
+    ioctl(fd, PERF_EVENT_IOC_ID, &id);
+    group.perf_syscall_data[i].id = id;
 
+    // printf("name: %s tid: %d fd: %d id: %d\n", perf_counter_info[i].counter_name.c_str(), tid, fd, id);
   }
+
+  return group;
+}
+
+void PerfProfiler::Close() {
+  for (const auto& group : perf_thread_groups) {
+    // close siblings before the leader
+    for (size_t i = group.perf_syscall_data.size(); i > 0; i--) {
+      if (group.perf_syscall_data[i - 1].fd != -1) {
+        close(group.perf_syscall_data[i - 1].fd);
+      }
+    }
+  }
+  perf_thread_groups.clear();
 }
 
 void PerfProfiler::Reset() {
-  ioctl(perf_counter_info[0].perf_syscall_data.fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  for (const auto& group : perf_thread_groups) {
+    for (size_t i = 0; i < group.perf_syscall_data.size(); i++) {
+      if (IsGroupLeader(i) && group.perf_syscall_data[i].fd != -1) {
+        ioctl(group.perf_syscall_data[i].fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      }
+    }
+  }
 }
 
 void PerfProfiler::Enable() {
-  ioctl(perf_counter_info[0].perf_syscall_data.fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  for (const auto& group : perf_thread_groups) {
+    for (size_t i = 0; i < group.perf_syscall_data.size(); i++) {
+      if (IsGroupLeader(i) && group.perf_syscall_data[i].fd != -1) {
+        ioctl(group.perf_syscall_data[i].fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+      }
+    }
+  }
 }
 
 void PerfProfiler::Disable() {
-  ioctl(perf_counter_info[0].perf_syscall_data.fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  for (const auto& group : perf_thread_groups) {
+    for (size_t i = 0; i < group.perf_syscall_data.size(); i++) {
+      if (IsGroupLeader(i) && group.perf_syscall_data[i].fd != -1) {
+        ioctl(group.perf_syscall_data[i].fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+      }
+    }
+  }
 }
 
-std::map<std::string, uint64_t> PerfProfiler::Read() {
+void PerfProfiler::StartRun() {
+  if (run_depth.value.fetch_add(1) == 0) {
+    Enable();
+  }
+}
 
-  int return_val = read(perf_counter_info[0].perf_syscall_data.fd, buf, sizeof(buf));
-  if (return_val == -1) {
-      char buffer[ 256 ];
-      char * errorMsg = strerror_r( errno, buffer, 256 ); // GNU-specific version, Linux default
-      std::string errorMsg_str = "perf error: " + std::string(errorMsg) + "\n" + perfErrorHint + "\n";
-      std::map<std::string, uint64_t> result;
-      result[errorMsg_str] = -1;
-      return result;
+void PerfProfiler::StopRun() {
+  int depth = run_depth.value.load();
+  while (depth > 0 && !run_depth.value.compare_exchange_weak(depth, depth - 1)) {
+  }
+  if (depth == 1) {
+    Disable();
+  }
+}
+
+bool PerfProfiler::ReadGroup(const perf_thread_group_t& group, uint64_t* values) {
+  size_t num_counters = perf_counter_info.size();
+  memset(values, 0, num_counters * kValuesPerCounter * sizeof(uint64_t));
+
+  bool ok = true;
+  for (size_t leader = 0; leader < num_counters; leader++) {
+    if (!IsGroupLeader(leader) || group.perf_syscall_data[leader].fd == -1) {
+      continue;
     }
-  perf_read_format_t* rf = (struct perf_read_format_t*) buf;
 
-  std::map<int, int> id_to_pci;
+    if (read(group.perf_syscall_data[leader].fd, buf, sizeof(buf)) == -1) {
+      ok = false;
+      continue;
+    }
+    perf_read_format_t* rf = (struct perf_read_format_t*) buf;
+
+    for (uint i = 0; i < rf->nr; i++) {
+      // values come back in the order the counters joined the group, so the id check almost always hits first try
+      size_t counter = leader + i < num_counters ? leader + i : leader;
+      for (size_t tries = 0; tries < num_counters; tries++) {
+        if (group.perf_syscall_data[counter].id == rf->values[i].id) {
+          values[counter * kValuesPerCounter + 0] = rf->values[i].value;
+          values[counter * kValuesPerCounter + 1] = rf->time_enabled;
+          values[counter * kValuesPerCounter + 2] = rf->time_running;
+          break;
+        }
+        counter = (counter + 1) % num_counters;
+      }
+    }
+  }
 
-  for (uint i = 0; i < perf_counter_info.size(); i++) {
-    id_to_pci[perf_counter_info[i].perf_syscall_data.id] = i;
+  return ok;
+}
+
+bool PerfProfiler::ReadValues(uint64_t* values) {
+  size_t thread_stride = perf_counter_info.size() * kValuesPerCounter;
+  bool ok = true;
+  for (size_t i = 0; i < perf_thread_groups.size(); i++) {
+    ok = ReadGroup(perf_thread_groups[i], values + i * thread_stride) && ok;
+  }
+  return ok;
+}
+
+double PerfProfiler::ScaleValue(uint64_t value, uint64_t time_enabled, uint64_t time_running) {
+  if (time_running == 0) {
+    return 0.0;
+  }
+  if (time_running >= time_enabled) {
+    return static_cast<double>(value);
+  }
+  return static_cast<double>(value) * static_cast<double>(time_enabled) / static_cast<double>(time_running);
+}
+
+std::vector<std::map<std::string, uint64_t>> PerfProfiler::ReadPerThread() {
+  std::vector<uint64_t> values(NumValues());
+  ReadValues(values.data());
+
+  size_t num_counters = perf_counter_info.size();
+  std::vector<std::map<std::string, uint64_t>> results(perf_thread_groups.size());
+  for (size_t i = 0; i < perf_thread_groups.size(); i++) {
+    for (size_t c = 0; c < num_counters; c++) {
+      const uint64_t* v = &values[(i * num_counters + c) * kValuesPerCounter];
+      results[i][perf_counter_info[c].counter_name] = static_cast<uint64_t>(ScaleValue(v[0], v[1], v[2]));
+    }
   }
 
+  return results;
+}
+
+std::map<std::string, uint64_t> PerfProfiler::Read() {
+  size_t num_counters = perf_counter_info.size();
+  std::vector<uint64_t> values(num_counters * kValuesPerCounter);
   std::map<std::string, uint64_t> result;
 
-  for (uint i = 0; i < rf->nr; i++) {
-    // printf("id: %d, val: %d\n", rf->values[i].id, rf->values[i].value);
-    if (id_to_pci.find(rf->values[i].id) != id_to_pci.end()) {
-      // printf("id: %d, val: %d, name: %s\n", rf->values[i].id, rf->values[i].value, perf_counter_info[id_to_pci[rf->values[i].id]].counter_name.c_str());
-      result[perf_counter_info[id_to_pci[rf->values[i].id]].counter_name] = rf->values[i].value;
+  for (const auto& group : perf_thread_groups) {
+    if (!ReadGroup(group, values.data())) {
+      char buffer[ 256 ];
+      char * errorMsg = strerror_r( errno, buffer, 256 ); // GNU-specific version, Linux default
+      std::string errorMsg_str = "perf error: " + std::string(errorMsg) + "\n" + perfErrorHint + "\n";
+      result.clear();
+      result[errorMsg_str] = -1;
+      return result;
+    }
+    for (size_t c = 0; c < num_counters; c++) {
+      const uint64_t* v = &values[c * kValuesPerCounter];
+      result[perf_counter_info[c].counter_name] += static_cast<uint64_t>(ScaleValue(v[0], v[1], v[2]));
     }
   }
 
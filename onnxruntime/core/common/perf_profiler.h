@@ -18,6 +18,7 @@
 #include <asm/unistd.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <atomic>
 
 #include <perfmon/pfmlib.h>
 #include <perfmon/pfmlib_perf_event.h>
@@ -25,8 +26,11 @@
 #define PERF_PROFILER_H
 
 // define format perf records to
+// read_format is PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
 struct perf_read_format_t {
   uint64_t nr;
+  uint64_t time_enabled;
+  uint64_t time_running;
   struct {
     uint64_t value;
     uint64_t id;
@@ -48,11 +52,28 @@ struct perf_syscall_data_t {
   uint64_t id;
 };
 
+// what a counter measures, for the derived metrics (IPC, MPKI, bandwidth) in the profiler output
+enum perf_counter_role_t {
+  PERF_ROLE_OTHER = 0,
+  PERF_ROLE_CYCLES,
+  PERF_ROLE_INSTRUCTIONS,
+  PERF_ROLE_L1D_MISSES,
+  PERF_ROLE_LLC_MISSES,
+};
+
 struct perf_counter_info_t {
   perf_event_attr pea;
-  perf_syscall_data_t perf_syscall_data;
   int counter_idx;
   std::string counter_name;
+  perf_counter_role_t role;
+};
+
+// the counters opened on a single OS thread
+struct perf_thread_group_t {
+  int tid;  // 0 for a worker that had not started yet, its fds are -1
+  // indexed like perf_counter_info. The counters are split into perf event groups of
+  // max_events_per_group, the first counter of each is its group leader.
+  std::vector<perf_syscall_data_t> perf_syscall_data;
 };
 
 class PerfProfiler {
@@ -63,9 +84,36 @@ class PerfProfiler {
 
     std::vector<perf_counter_info_t> perf_counter_info;
 
+    // group 0 counts the thread that called Initialize, the rest count thread pool workers
+    std::vector<perf_thread_group_t> perf_thread_groups;
+
     char buf[4096];
 
-    void Initialize();
+    // Number of Runs counting right now. Concurrent Runs and the control flow subgraph Runs nested in them
+    // share the groups, which are enabled by the first StartRun and disabled by the last StopRun.
+    // A copy of the profiler starts outside of any Run.
+    struct RunDepth {
+      std::atomic<int> value{0};
+      RunDepth() = default;
+      RunDepth(const RunDepth&) {}
+      RunDepth& operator=(const RunDepth&) { return *this; }
+    };
+    RunDepth run_depth;
+
+    // Counters per perf event group. The kernel time-multiplexes groups when there are more counters than
+    // the PMU has registers, and values are scaled by time_enabled / time_running. Counters in one group
+    // are always scheduled together, so ratios inside a group (e.g. IPC) stay exact. 0 puts all counters
+    // in one group, which fails to schedule at all if it does not fit the PMU.
+    size_t max_events_per_group = 4;
+
+    // values ReadValues stores per counter: raw count, time enabled and time running (ns)
+    static constexpr size_t kValuesPerCounter = 3;
+
+    // Opens a counter group on the calling thread and one on each of worker_thread_ids.
+    // Does nothing if the groups are already open for exactly these threads, so it is cheap to call per Run.
+    void Initialize(const std::vector<unsigned>& worker_thread_ids = {});
+
+    void Close();
 
     void Reset();
 
@@ -73,9 +121,42 @@ class PerfProfiler {
 
     void Disable();
 
+    // Enable counting for a whole Run, so per node values come from reading before and after the node
+    // instead of resetting and toggling the groups. Runs of control flow subgraphs nest inside their
+    // parent Run, only the outermost StopRun disables the groups.
+    void StartRun();
+
+    void StopRun();
+
+    // number of values ReadValues writes: kValuesPerCounter per counter per thread group
+    size_t NumValues() const { return perf_thread_groups.size() * perf_counter_info.size() * kValuesPerCounter; }
+
+    // Allocation-free read of all thread groups. The raw count, time enabled and time running of a counter
+    // are at values[(group * perf_counter_info.size() + counter) * kValuesPerCounter + 0, 1, 2].
+    // Unopened groups come back as zeros. Returns false if a group fails to read, the values are then no
+    // valid sample and must not be used for deltas.
+    bool ReadValues(uint64_t* values);
+
+    // Scales a count for multiplexing, value * time_enabled / time_running. All three may be deltas
+    // between two ReadValues. Returns 0 if the counter never ran.
+    static double ScaleValue(uint64_t value, uint64_t time_enabled, uint64_t time_running);
+
+    bool IsGroupLeader(size_t counter) const {
+      return max_events_per_group == 0 ? counter == 0 : counter % max_events_per_group == 0;
+    }
+
+    // scaled counter values summed over all thread groups
     std::map<std::string, uint64_t> Read();
 
+    // scaled counter values of each thread group, in perf_thread_groups order
+    std::vector<std::map<std::string, uint64_t>> ReadPerThread();
+
     std::string perfErrorHint = "This could be an error in perf. Try running `perf stat` to make sure that, for example, "
         "/proc/sys/kernel/perf_event_paranoid has been set correctly to 3 or lower";
 
+  private:
+    perf_thread_group_t OpenGroup(int tid);
+
+    bool ReadGroup(const perf_thread_group_t& group, uint64_t* values);
+
 };
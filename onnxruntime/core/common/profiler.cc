@@ -3,6 +3,12 @@
 
 #include "profiler.h"
 
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <unordered_set>
+
 namespace onnxruntime {
 namespace profiling {
 using namespace std::chrono;
@@ -85,6 +91,10 @@ PerfProfiler* Profiler::GetPerfProfiler() {
   return &myperf_;
 }
 
+void Profiler::SetSamplingProfiler(std::unique_ptr<SamplingProfiler> sampling_profiler) {
+  sampling_profiler_ = std::move(sampling_profiler);
+}
+
 bool Profiler::IsPerfEnabled() {
   return is_perf_enabled;
 }
@@ -124,24 +134,33 @@ void Profiler::EndTimeAndRecordEvent(EventCategory category,
                                      const std::string& event_name,
                                      const TimePoint& start_time,
                                      const std::initializer_list<std::pair<std::string, std::string>>& event_args,
-                                     std::list<std::pair<std::string, std::string>> addtl_event_args,
+                                     const uint64_t* perf_values,
                                      bool /*sync_gpu*/) {
   long long dur = TimeDiffMicroSeconds(start_time);
   long long ts = TimeDiffMicroSeconds(profiling_start_time_, start_time);
 
-  // merge lists
-  std::list<std::pair<std::string, std::string>> event_args_list = event_args;
-
-  event_args_list.merge(addtl_event_args);
-
   EventRecord event(category, logging::GetProcessId(),
-                    logging::GetThreadId(), event_name, ts, dur, {event_args_list.begin(), event_args_list.end()});
+                    logging::GetThreadId(), event_name, ts, dur, {event_args.begin(), event_args.end()});
   if (profile_with_logger_) {
+    // the custom logger needs a complete event right away
+    if (perf_values != nullptr) {
+      std::vector<double> totals;
+      AddPerfRecordArgs(event, perf_values, totals);
+    }
     custom_logger_->SendProfileEvent(event);
   } else {
     //TODO: sync_gpu if needed.
     std::lock_guard<OrtMutex> lock(mutex_);
     if (events_.size() < max_num_events_) {
+      if (perf_values != nullptr && perf_record_stride_ != 0) {
+        if (num_perf_records_ == kMaxPerfRecords) {
+          FlushPerfRecords();
+        }
+        std::copy(perf_values, perf_values + perf_record_stride_,
+                  perf_record_values_.begin() + num_perf_records_ * perf_record_stride_);
+        perf_record_event_index_[num_perf_records_] = events_.size();
+        ++num_perf_records_;
+      }
       events_.emplace_back(event);
     } else {
       if (session_logger_ && !max_events_reached) {
@@ -157,6 +176,147 @@ void Profiler::EndTimeAndRecordEvent(EventCategory category,
   }
 }
 
+void Profiler::PreparePerfRecords() {
+  std::lock_guard<OrtMutex> lock(mutex_);
+  size_t stride = myperf_.NumValues();
+  if (stride == perf_record_stride_) {
+    return;
+  }
+
+  // records already written use the old layout, format them before resizing
+  FlushPerfRecords();
+  perf_record_stride_ = stride;
+  perf_record_values_.assign(kMaxPerfRecords * stride, 0);
+  perf_record_event_index_.assign(kMaxPerfRecords, 0);
+}
+
+static std::string FormatPerfMetric(double value) {
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(3) << value;
+  return ss.str();
+}
+
+// Adds the metrics derived from scaled counter totals: instructions per cycle, L1D and LLC misses per
+// thousand instructions, and the DRAM bandwidth estimated as one 64 byte line per LLC miss over dur_us.
+// A metric is left out when the config file does not list the counters it needs. When several counters
+// measure the same thing, like cache-misses and an LLC miss event, only the first one configured is used.
+static void AddDerivedPerfMetrics(const std::vector<perf_counter_info_t>& counters,
+                                  const std::vector<double>& totals,
+                                  long long dur_us,
+                                  std::unordered_map<std::string, std::string>& args) {
+  constexpr double kCacheLineBytes = 64.0;
+  double role_totals[PERF_ROLE_LLC_MISSES + 1] = {};
+  bool has_role[PERF_ROLE_LLC_MISSES + 1] = {};
+  for (size_t c = 0; c < counters.size(); c++) {
+    perf_counter_role_t role = counters[c].role;
+    if (role == PERF_ROLE_OTHER || has_role[role]) {
+      continue;
+    }
+    role_totals[role] = totals[c];
+    has_role[role] = true;
+  }
+
+  double cycles = role_totals[PERF_ROLE_CYCLES];
+  double instructions = role_totals[PERF_ROLE_INSTRUCTIONS];
+  if (has_role[PERF_ROLE_CYCLES] && has_role[PERF_ROLE_INSTRUCTIONS] && cycles > 0) {
+    args["ipc"] = FormatPerfMetric(instructions / cycles);
+  }
+  if (has_role[PERF_ROLE_INSTRUCTIONS] && instructions > 0) {
+    if (has_role[PERF_ROLE_L1D_MISSES]) {
+      args["l1d_mpki"] = FormatPerfMetric(role_totals[PERF_ROLE_L1D_MISSES] * 1000.0 / instructions);
+    }
+    if (has_role[PERF_ROLE_LLC_MISSES]) {
+      args["llc_mpki"] = FormatPerfMetric(role_totals[PERF_ROLE_LLC_MISSES] * 1000.0 / instructions);
+    }
+  }
+  if (has_role[PERF_ROLE_LLC_MISSES]) {
+    double dram_bytes = role_totals[PERF_ROLE_LLC_MISSES] * kCacheLineBytes;
+    args["dram_bytes_est"] = FormatPerfMetric(dram_bytes);
+    if (dur_us > 0) {
+      // bytes per microsecond / 1000 is GB/s
+      args["dram_gbps_est"] = FormatPerfMetric(dram_bytes / static_cast<double>(dur_us) / 1000.0);
+    }
+  }
+}
+
+void Profiler::AddPerfRecordArgs(EventRecord& event, const uint64_t* perf_values, std::vector<double>& totals) const {
+  const auto& counters = myperf_.perf_counter_info;
+  size_t num_counters = counters.size();
+  size_t thread_stride = num_counters * PerfProfiler::kValuesPerCounter;
+  size_t num_threads = thread_stride == 0 ? 0 : perf_record_stride_ / thread_stride;
+  totals.assign(num_counters, 0.0);
+  if (num_threads == 0) {
+    return;
+  }
+
+  // scale for multiplexing, scaled[t * num_counters + c]
+  std::vector<double> scaled(num_threads * num_counters);
+  double min_running_ratio = 1.0;
+  for (size_t i = 0; i < scaled.size(); i++) {
+    const uint64_t* v = perf_values + i * PerfProfiler::kValuesPerCounter;
+    scaled[i] = PerfProfiler::ScaleValue(v[0], v[1], v[2]);
+    if (v[1] > 0) {
+      min_running_ratio = std::min(min_running_ratio, static_cast<double>(v[2]) / static_cast<double>(v[1]));
+    }
+  }
+
+  // per thread values, worker -1 is the thread that ran the node
+  std::ostringstream per_thread;
+  per_thread << "[";
+  for (size_t t = 0; t < num_threads; t++) {
+    per_thread << (t > 0 ? "," : "") << "{\"worker\":" << static_cast<int>(t) - 1;
+    for (size_t c = 0; c < num_counters; c++) {
+      per_thread << ",\"" << counters[c].counter_name << "\":"
+                 << static_cast<uint64_t>(scaled[t * num_counters + c]);
+    }
+    per_thread << "}";
+  }
+  per_thread << "]";
+
+  std::ostringstream imbalance;
+  imbalance << "{";
+  for (size_t c = 0; c < num_counters; c++) {
+    double max_value = 0.0;
+    double min_value = std::numeric_limits<double>::max();
+    for (size_t t = 0; t < num_threads; t++) {
+      double value = scaled[t * num_counters + c];
+      totals[c] += value;
+      max_value = std::max(max_value, value);
+      min_value = std::min(min_value, value);
+    }
+    event.args[counters[c].counter_name] = std::to_string(static_cast<uint64_t>(totals[c]));
+    imbalance << (c > 0 ? "," : "") << "\"" << counters[c].counter_name << "\":{\"max\":"
+              << static_cast<uint64_t>(max_value) << ",\"min\":" << static_cast<uint64_t>(min_value) << "}";
+  }
+  imbalance << "}";
+
+  event.args["perf_threads"] = per_thread.str();
+  event.args["perf_thread_imbalance"] = imbalance.str();
+  // below 1 the counters were multiplexed and the values above are estimates
+  event.args["perf_running_ratio"] = FormatPerfMetric(min_running_ratio);
+  AddDerivedPerfMetrics(counters, totals, event.dur, event.args);
+}
+
+void Profiler::FlushPerfRecords() {
+  std::vector<double> totals;
+  for (size_t n = 0; n < num_perf_records_; n++) {
+    EventRecord& event = events_[perf_record_event_index_[n]];
+    AddPerfRecordArgs(event, perf_record_values_.data() + n * perf_record_stride_, totals);
+
+    auto op_name = event.args.find("op_name");
+    if (op_name != event.args.end()) {
+      PerfOpSummary& summary = perf_op_summaries_[op_name->second];
+      summary.totals.resize(totals.size(), 0.0);
+      for (size_t c = 0; c < totals.size(); c++) {
+        summary.totals[c] += totals[c];
+      }
+      summary.node_count++;
+      summary.dur += event.dur;
+    }
+  }
+  num_perf_records_ = 0;
+}
+
 std::string Profiler::EndProfiling() {
   if (!enabled_) {
     return std::string();
@@ -171,6 +331,45 @@ std::string Profiler::EndProfiling() {
   }
 
   std::lock_guard<OrtMutex> lock(mutex_);
+  FlushPerfRecords();
+  for (const auto& kv : perf_op_summaries_) {
+    const PerfOpSummary& summary = kv.second;
+    EventRecord event(SESSION_EVENT, logging::GetProcessId(), logging::GetThreadId(),
+                      kv.first + "_perf_summary", 0, summary.dur,
+                      {{"op_name", kv.first}, {"node_count", std::to_string(summary.node_count)}});
+    for (size_t c = 0; c < summary.totals.size(); c++) {
+      event.args[myperf_.perf_counter_info[c].counter_name] = std::to_string(static_cast<uint64_t>(summary.totals[c]));
+    }
+    AddDerivedPerfMetrics(myperf_.perf_counter_info, summary.totals, summary.dur, event.args);
+    events_.emplace_back(std::move(event));
+  }
+  perf_op_summaries_.clear();
+
+  if (sampling_profiler_) {
+    sampling_profiler_->Stop();
+    // samples are keyed by node index, name them from the kernel events
+    std::ostringstream node_names;
+    node_names << "{";
+    std::unordered_set<std::string> named_nodes;
+    const std::string kernel_suffix = "_kernel_time";
+    for (const auto& rec : events_) {
+      auto graph_index = rec.args.find("graph_index");
+      if (rec.cat != NODE_EVENT || graph_index == rec.args.end() || rec.name.size() < kernel_suffix.size() ||
+          rec.name.compare(rec.name.size() - kernel_suffix.size(), kernel_suffix.size(), kernel_suffix) != 0 ||
+          !named_nodes.insert(graph_index->second).second) {
+        continue;
+      }
+      node_names << (named_nodes.size() > 1 ? ", " : "") << "\"" << graph_index->second << "\": \""
+                 << rec.name.substr(0, rec.name.size() - kernel_suffix.size()) << "\"";
+    }
+    node_names << "}";
+
+    EventRecord event(SESSION_EVENT, logging::GetProcessId(), logging::GetThreadId(), "perf_sampling", 0,
+                      TimeDiffMicroSeconds(profiling_start_time_),
+                      {{"report", sampling_profiler_->GetNodeReport(kMaxSampledIpsPerNode)},
+                       {"node_names", node_names.str()}});
+    events_.emplace_back(std::move(event));
+  }
   profile_stream_ << "[\n";
 
   for (const auto& ep_profiler : ep_profilers_) {
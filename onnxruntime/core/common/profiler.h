@@ -8,7 +8,7 @@
 #include <initializer_list>
 #include <iostream>
 #include <tuple>
-#include <list>
+#include <vector>
 
 #include "core/common/profiler_common.h"
 #include "core/common/logging/logging.h"
@@ -17,6 +17,7 @@
 // #ifndef PERF_PROFILER_H
 #include "perf_profiler.h"
 // #endif
+#include "core/common/sampling_profiler.h"
 
 namespace onnxruntime {
 
@@ -88,13 +89,24 @@ class Profiler {
                              const std::initializer_list<std::pair<std::string, std::string>>& event_args = {},
                              bool sync_gpu = false);
 
-   void EndTimeAndRecordEvent(EventCategory category,
+  /*
+  Same as above, and attaches the perf counter values of the event, laid out as PerfProfiler::ReadValues does.
+  The values are copied into a preallocated ring of fixed-size records and only formatted when the ring is
+  full or in EndProfiling, so nothing is allocated per event. perf_values may be null.
+  */
+  void EndTimeAndRecordEvent(EventCategory category,
                              const std::string& event_name,
                              const TimePoint& start_time,
                              const std::initializer_list<std::pair<std::string, std::string>>& event_args,
-                             std::list<std::pair<std::string, std::string>> addtl_event_args,
+                             const uint64_t* perf_values,
                              bool sync_gpu = false);
 
+  /*
+  Sizes the perf counter record ring for the current PerfProfiler thread groups.
+  Call once per Run after PerfProfiler::Initialize; it only reallocates when the record size changes.
+  */
+  void PreparePerfRecords();
+
   /*
   Write profile data to the given stream in chrome format defined below.
   https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/preview#
@@ -138,6 +150,17 @@ class Profiler {
 
   PerfProfiler* GetPerfProfiler();
 
+  /*
+  Enables the sampling mode: perf samples attributed to graph nodes, written as one "perf_sampling"
+  session event by EndProfiling.
+  */
+  void SetSamplingProfiler(std::unique_ptr<SamplingProfiler> sampling_profiler);
+
+  // nullptr unless the sampling mode is enabled
+  SamplingProfiler* GetSamplingProfiler() {
+    return sampling_profiler_.get();
+  }
+
  private:
   ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(Profiler);
 
@@ -181,6 +204,34 @@ class Profiler {
 
   PerfProfiler myperf_ = PerfProfiler(&counter_name_map, &event_list, NULL);
 
+  // Formats one perf record into event args: the per counter totals scaled for multiplexing, the per
+  // thread values, the max/min over threads and the derived metrics. Returns the scaled totals in totals.
+  void AddPerfRecordArgs(EventRecord& event, const uint64_t* perf_values, std::vector<double>& totals) const;
+
+  // Moves every perf record still in the ring into the args of its event, adds them to the per op
+  // type summaries and empties the ring.
+  void FlushPerfRecords();
+
+  // scaled counter totals of all nodes of one op type, written as one event per op type by EndProfiling
+  struct PerfOpSummary {
+    size_t node_count{0};
+    long long dur{0};
+    std::vector<double> totals;
+  };
+  std::map<std::string, PerfOpSummary> perf_op_summaries_;
+
+  std::unique_ptr<SamplingProfiler> sampling_profiler_;
+
+  // Number of records the perf ring holds. A full ring is flushed before the next record is written,
+  // so only every kMaxPerfRecords-th node event pays for formatting.
+  static constexpr size_t kMaxPerfRecords = 16 * 1024;
+  // Hottest instruction pointers reported per node in sampling mode.
+  static constexpr size_t kMaxSampledIpsPerNode = 20;
+  size_t perf_record_stride_{0};
+  std::vector<uint64_t> perf_record_values_;     // kMaxPerfRecords records of perf_record_stride_ values
+  std::vector<size_t> perf_record_event_index_;  // index into events_ of each record
+  size_t num_perf_records_{0};                   // records written since the last flush
+
 #ifdef ENABLE_STATIC_PROFILER_INSTANCE
   static Profiler* instance_;
 #endif
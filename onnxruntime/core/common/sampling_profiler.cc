@@ -0,0 +1,359 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/common/sampling_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#include <dlfcn.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "core/common/logging/logging.h"
+
+namespace onnxruntime {
+namespace profiling {
+
+std::atomic<SamplingProfiler*> SamplingProfiler::active_profiler_{nullptr};
+
+namespace {
+
+thread_local int current_node_index = -1;
+
+uint64_t MonotonicNowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+uint32_t CachedThreadId() {
+  static thread_local uint32_t tid = logging::GetThreadId();
+  return tid;
+}
+
+// Copies len bytes starting at offset out of the data area of a sample ring, which may wrap around.
+void CopyFromRing(const char* data, size_t data_size, uint64_t offset, void* dst, size_t len) {
+  size_t start = static_cast<size_t>(offset & (data_size - 1));
+  size_t first = std::min(len, data_size - start);
+  memcpy(dst, data + start, first);
+  if (first < len) {
+    memcpy(static_cast<char*>(dst) + first, data, len - first);
+  }
+}
+
+// body of a PERF_RECORD_SAMPLE with sample_type PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_TIME
+struct SampleBody {
+  uint64_t ip;
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t time;
+};
+
+// body of a PERF_RECORD_LOST
+struct LostBody {
+  uint64_t id;
+  uint64_t lost;
+};
+
+}  // namespace
+
+SamplingProfiler::SamplingProfiler(uint64_t sample_period)
+    : sample_period_(sample_period),
+      transitions_(std::make_unique<NodeTransition[]>(kMaxTransitions)) {
+}
+
+SamplingProfiler::~SamplingProfiler() {
+  Stop();
+}
+
+void SamplingProfiler::SetCurrentNode(int node_index) {
+  if (current_node_index == node_index) {
+    return;
+  }
+  current_node_index = node_index;
+  SamplingProfiler* profiler = active_profiler_.load(std::memory_order_acquire);
+  if (profiler != nullptr) {
+    profiler->LogTransition(node_index);
+  }
+}
+
+int SamplingProfiler::GetCurrentNode() {
+  return current_node_index;
+}
+
+void SamplingProfiler::LogTransition(int node_index) {
+  uint64_t idx = num_transitions_.fetch_add(1, std::memory_order_relaxed);
+  NodeTransition& entry = transitions_[idx % kMaxTransitions];
+  entry.time_ns = MonotonicNowNs();
+  entry.tid = CachedThreadId();
+  entry.node_index = node_index;
+  entry.seq.store(idx + 1, std::memory_order_release);
+}
+
+void SamplingProfiler::Start(const std::vector<unsigned>& worker_thread_ids) {
+  std::vector<unsigned> thread_ids;
+  thread_ids.push_back(CachedThreadId());
+  for (unsigned tid : worker_thread_ids) {
+    // workers that have not started yet report 0, they get a ring on a later Run
+    if (tid != 0) {
+      thread_ids.push_back(tid);
+    }
+  }
+
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  std::lock_guard<OrtMutex> start_stop_lock(start_stop_mutex_);
+  {
+    // the reader thread only starts below, with the lock held, so it never sees a half added ring
+    std::lock_guard<OrtMutex> lock(rings_mutex_);
+    for (unsigned tid : thread_ids) {
+      if (std::any_of(rings_.begin(), rings_.end(), [tid](const ThreadRing& r) { return r.tid == tid; })) {
+        continue;
+      }
+
+      perf_event_attr pea;
+      memset(&pea, 0, sizeof(perf_event_attr));
+      pea.type = PERF_TYPE_HARDWARE;
+      pea.size = sizeof(perf_event_attr);
+      pea.config = PERF_COUNT_HW_CPU_CYCLES;
+      pea.sample_period = sample_period_;
+      pea.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_TIME;
+      pea.exclude_kernel = 1;
+      pea.exclude_hv = 1;
+      pea.use_clockid = 1;
+      pea.clockid = CLOCK_MONOTONIC;
+
+      int fd = static_cast<int>(syscall(__NR_perf_event_open, &pea, static_cast<pid_t>(tid), -1, -1, 0));
+      if (fd == -1) {
+        // sampling is best effort, the thread is just left out
+        char buffer[256];
+        char* error_msg = strerror_r(errno, buffer, 256);
+        printf("perf sampling: cannot open event on tid %u - %s\n", tid, error_msg);
+        continue;
+      }
+
+      size_t size = (kRingDataPages + 1) * page_size;
+      void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (base == MAP_FAILED) {
+        char buffer[256];
+        char* error_msg = strerror_r(errno, buffer, 256);
+        printf("perf sampling: cannot map ring of tid %u - %s\n", tid, error_msg);
+        close(fd);
+        continue;
+      }
+
+      rings_.push_back({tid, fd, base, size});
+    }
+
+    if (!running_) {
+      SamplingProfiler* expected = nullptr;
+      if (!active_profiler_.compare_exchange_strong(expected, this)) {
+        printf("perf sampling: another session is sampling, node attribution is disabled for this one\n");
+      }
+      stop_reader_ = false;
+      reader_ = std::thread([this]() { ReaderLoop(); });
+      running_ = true;
+    }
+  }
+}
+
+void SamplingProfiler::Stop() {
+  std::lock_guard<OrtMutex> start_stop_lock(start_stop_mutex_);
+  if (!running_) {
+    return;
+  }
+
+  stop_reader_ = true;
+  reader_.join();
+  running_ = false;
+
+  SamplingProfiler* expected = this;
+  active_profiler_.compare_exchange_strong(expected, nullptr);
+
+  std::lock_guard<OrtMutex> lock(rings_mutex_);
+  for (auto& ring : rings_) {
+    ioctl(ring.fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+  Drain();
+  for (auto& ring : rings_) {
+    munmap(ring.base, ring.size);
+    close(ring.fd);
+  }
+  rings_.clear();
+}
+
+void SamplingProfiler::ReaderLoop() {
+  while (!stop_reader_) {
+    {
+      std::lock_guard<OrtMutex> lock(rings_mutex_);
+      Drain();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(kDrainIntervalMs));
+  }
+}
+
+void SamplingProfiler::Drain() {
+  // samples first: every node change the thread made before a drained sample is then already logged
+  for (auto& ring : rings_) {
+    DrainRing(ring);
+  }
+  ConsumeTransitions();
+  AttributePendingSamples();
+}
+
+void SamplingProfiler::DrainRing(ThreadRing& ring) {
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  auto* page = static_cast<perf_event_mmap_page*>(ring.base);
+  const char* data = static_cast<const char*>(ring.base) + page_size;
+  const size_t data_size = ring.size - page_size;
+
+  uint64_t head = __atomic_load_n(&page->data_head, __ATOMIC_ACQUIRE);
+  uint64_t tail = page->data_tail;
+
+  while (tail < head) {
+    perf_event_header header;
+    CopyFromRing(data, data_size, tail, &header, sizeof(header));
+    if (header.size == 0) {
+      break;
+    }
+
+    if (header.type == PERF_RECORD_SAMPLE) {
+      SampleBody body;
+      CopyFromRing(data, data_size, tail + sizeof(header), &body, sizeof(body));
+      pending_samples_.push_back({body.time, body.ip, body.tid});
+    } else if (header.type == PERF_RECORD_LOST) {
+      LostBody body;
+      CopyFromRing(data, data_size, tail + sizeof(header), &body, sizeof(body));
+      lost_samples_ += body.lost;
+    }
+    tail += header.size;
+  }
+
+  __atomic_store_n(&page->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+void SamplingProfiler::ConsumeTransitions() {
+  uint64_t published = num_transitions_.load(std::memory_order_acquire);
+  if (published - consumed_transitions_ > kMaxTransitions) {
+    // the writers lapped us, the oldest entries are gone
+    dropped_transitions_ += published - consumed_transitions_ - kMaxTransitions;
+    consumed_transitions_ = published - kMaxTransitions;
+  }
+
+  while (consumed_transitions_ < published) {
+    const NodeTransition& entry = transitions_[consumed_transitions_ % kMaxTransitions];
+    uint64_t seq = entry.seq.load(std::memory_order_acquire);
+    if (seq != consumed_transitions_ + 1) {
+      // still being written, or already overwritten by a later round; pick it up next drain
+      if (seq > consumed_transitions_ + 1) {
+        ++dropped_transitions_;
+        ++consumed_transitions_;
+        continue;
+      }
+      break;
+    }
+    timelines_[entry.tid].emplace_back(entry.time_ns, entry.node_index);
+    ++consumed_transitions_;
+  }
+}
+
+void SamplingProfiler::AttributePendingSamples() {
+  for (auto& kv : timelines_) {
+    // entries are logged in order per thread except across the seq race above, keep them sorted
+    std::sort(kv.second.begin(), kv.second.end());
+  }
+
+  std::unordered_map<uint32_t, uint64_t> last_sample_time;
+  for (const auto& sample : pending_samples_) {
+    int32_t node_index = -1;
+    auto timeline = timelines_.find(sample.tid);
+    if (timeline != timelines_.end()) {
+      const auto& changes = timeline->second;
+      auto next = std::upper_bound(changes.begin(), changes.end(), std::make_pair(sample.time_ns, INT32_MAX));
+      if (next != changes.begin()) {
+        node_index = std::prev(next)->second;
+      }
+    }
+
+    if (node_index < 0) {
+      ++unattributed_samples_;
+    } else {
+      NodeSamples& node = node_samples_[node_index];
+      ++node.num_samples;
+      ++node.ip_counts[sample.ip];
+    }
+
+    uint64_t& last = last_sample_time[sample.tid];
+    last = std::max(last, sample.time_ns);
+  }
+  pending_samples_.clear();
+
+  // later samples of a thread are newer than the ones just attributed, so each timeline only needs
+  // the change in effect at its last sample and the ones after it
+  for (auto& kv : timelines_) {
+    auto last = last_sample_time.find(kv.first);
+    if (last == last_sample_time.end()) {
+      continue;
+    }
+    auto& changes = kv.second;
+    auto next = std::upper_bound(changes.begin(), changes.end(), std::make_pair(last->second, INT32_MAX));
+    if (next != changes.begin()) {
+      changes.erase(changes.begin(), std::prev(next));
+    }
+  }
+}
+
+std::string SamplingProfiler::GetNodeReport(size_t max_ips_per_node) const {
+  std::ostringstream ss;
+  ss << "{\"sample_period\": " << sample_period_
+     << ", \"unattributed_samples\": " << unattributed_samples_
+     << ", \"lost_samples\": " << lost_samples_
+     << ", \"dropped_node_changes\": " << dropped_transitions_
+     << ", \"nodes\": {";
+
+  std::vector<std::pair<int32_t, const NodeSamples*>> nodes;
+  for (const auto& kv : node_samples_) {
+    nodes.emplace_back(kv.first, &kv.second);
+  }
+  std::sort(nodes.begin(), nodes.end());
+
+  bool is_first_node = true;
+  for (const auto& node : nodes) {
+    std::vector<std::pair<uint64_t, uint64_t>> ips(node.second->ip_counts.begin(), node.second->ip_counts.end());
+    std::sort(ips.begin(), ips.end(),
+              [](const std::pair<uint64_t, uint64_t>& a, const std::pair<uint64_t, uint64_t>& b) {
+                return a.second > b.second;
+              });
+    if (ips.size() > max_ips_per_node) {
+      ips.resize(max_ips_per_node);
+    }
+
+    ss << (is_first_node ? "" : ", ") << "\"" << node.first << "\": {\"samples\": " << node.second->num_samples
+       << ", \"ips\": [";
+    for (size_t i = 0; i < ips.size(); i++) {
+      Dl_info info;
+      const char* symbol = "?";
+      const char* module = "?";
+      if (dladdr(reinterpret_cast<void*>(ips[i].first), &info) != 0) {
+        if (info.dli_sname != nullptr) symbol = info.dli_sname;
+        if (info.dli_fname != nullptr) module = info.dli_fname;
+      }
+      ss << (i == 0 ? "" : ", ") << "{\"ip\": \"0x" << std::hex << ips[i].first << std::dec
+         << "\", \"samples\": " << ips[i].second
+         << ", \"symbol\": \"" << symbol << "\", \"module\": \"" << module << "\"}";
+    }
+    ss << "]}";
+    is_first_node = false;
+  }
+  ss << "}}";
+  return ss.str();
+}
+
+}  // namespace profiling
+}  // namespace onnxruntime
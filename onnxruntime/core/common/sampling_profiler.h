@@ -0,0 +1,128 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "core/common/common.h"
+#include "core/platform/ort_mutex.h"
+
+namespace onnxruntime {
+namespace profiling {
+
+/**
+ * Sampling mode of the perf profiler. Instead of enabling, disabling and reading counters around every node,
+ * one cycles sampling event per thread runs for the whole profiling session. The kernel writes the samples
+ * (instruction pointer, thread, time) into an mmap ring per thread that a background thread drains.
+ *
+ * Threads publish the graph node they are running with SetCurrentNode: the sequential executor around each
+ * kernel, and the intra-op workers while they help with a parallel loop of that kernel. Each change is logged
+ * with a CLOCK_MONOTONIC timestamp, the clock the samples are taken with, so the background thread can match
+ * samples to nodes by thread and time. The result is a per node instruction pointer histogram.
+ *
+ * Only one SamplingProfiler logs node changes at a time. Node indices are those of the graph being run, so
+ * nodes of control flow subgraphs share indices with the main graph.
+ */
+class SamplingProfiler {
+ public:
+  explicit SamplingProfiler(uint64_t sample_period);
+  ~SamplingProfiler();
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(SamplingProfiler);
+
+  // Opens a sampling event on the calling thread and on each of worker_thread_ids that has none yet, and starts
+  // the background thread on first use. Cheap to call once per Run.
+  void Start(const std::vector<unsigned>& worker_thread_ids);
+
+  // Drains the rings one last time, joins the background thread and closes the events.
+  void Stop();
+
+  // JSON object keyed by node index with the sample count and the max_ips_per_node hottest instruction
+  // pointers of each node, plus counts of the samples that could not be attributed or were lost.
+  // Call after Stop.
+  std::string GetNodeReport(size_t max_ips_per_node) const;
+
+  uint64_t SamplePeriod() const { return sample_period_; }
+
+  // Publishes the node the calling thread runs, -1 for none. Unless a SamplingProfiler is running
+  // this only updates a thread_local.
+  static void SetCurrentNode(int node_index);
+
+  static int GetCurrentNode();
+
+  static bool IsActive() { return active_profiler_.load(std::memory_order_relaxed) != nullptr; }
+
+ private:
+  struct NodeTransition {
+    std::atomic<uint64_t> seq{0};  // index + 1 once the entry is written
+    uint64_t time_ns{0};
+    uint32_t tid{0};
+    int32_t node_index{-1};
+  };
+
+  struct ThreadRing {
+    unsigned tid;
+    int fd;
+    void* base;
+    size_t size;
+  };
+
+  struct NodeSamples {
+    uint64_t num_samples{0};
+    std::unordered_map<uint64_t, uint64_t> ip_counts;
+  };
+
+  void LogTransition(int node_index);
+  void ReaderLoop();
+  // Moves the samples of all rings into pending_samples_, then attributes them. Background thread only.
+  void Drain();
+  void DrainRing(ThreadRing& ring);
+  void ConsumeTransitions();
+  void AttributePendingSamples();
+
+  static std::atomic<SamplingProfiler*> active_profiler_;
+
+  // Node changes are logged into a ring that the background thread consumes. Writers that lap the
+  // background thread overwrite entries, which is counted in dropped_transitions_.
+  static constexpr size_t kMaxTransitions = 64 * 1024;
+  // Data pages of each sample ring, a power of two.
+  static constexpr size_t kRingDataPages = 64;
+  static constexpr int kDrainIntervalMs = 5;
+
+  const uint64_t sample_period_;
+  std::unique_ptr<NodeTransition[]> transitions_;
+  std::atomic<uint64_t> num_transitions_{0};
+  uint64_t consumed_transitions_{0};
+  uint64_t dropped_transitions_{0};
+
+  // Serializes Start and Stop, which a session calls from different threads when EndProfiling runs during a
+  // Run. Stop joins the reader thread, which takes rings_mutex_, so it cannot hold rings_mutex_ for that.
+  OrtMutex start_stop_mutex_;
+  bool running_{false};
+
+  OrtMutex rings_mutex_;
+  std::vector<ThreadRing> rings_;
+  std::thread reader_;
+  std::atomic<bool> stop_reader_{false};
+
+  struct PendingSample {
+    uint64_t time_ns;
+    uint64_t ip;
+    uint32_t tid;
+  };
+  std::vector<PendingSample> pending_samples_;
+  // per thread (time, node) changes not older than the thread's last attributed sample
+  std::unordered_map<uint32_t, std::vector<std::pair<uint64_t, int32_t>>> timelines_;
+  std::unordered_map<int32_t, NodeSamples> node_samples_;
+  uint64_t unattributed_samples_{0};
+  uint64_t lost_samples_{0};
+};
+
+}  // namespace profiling
+}  // namespace onnxruntime
@@ -18,6 +18,7 @@ limitations under the License.
 #include "core/platform/threadpool.h"
 #include "core/common/common.h"
 #include "core/common/cpuid_info.h"
+#include "core/common/sampling_profiler.h"
 #include "core/common/eigen_common_wrapper.h"
 #include "core/platform/EigenNonBlockingThreadPool.h"
 #include "core/platform/ort_mutex.h"
@@ -481,6 +482,14 @@ std::string ThreadPool::StopProfiling() {
   }
 }
 
+std::vector<unsigned> ThreadPool::GetWorkerThreadIds() const {
+  if (underlying_threadpool_) {
+    return underlying_threadpool_->GetWorkerThreadIds();
+  } else {
+    return {};
+  }
+}
+
 thread_local ThreadPool::ParallelSection* ThreadPool::ParallelSection::current_parallel_section{nullptr};
 
 ThreadPool::ParallelSection::ParallelSection(ThreadPool* tp) {
@@ -503,6 +512,16 @@ ThreadPool::ParallelSection::~ParallelSection() {
 }
 
 void ThreadPool::RunInParallel(std::function<void(unsigned idx)> fn, unsigned n, std::ptrdiff_t block_size) {
+  if (profiling::SamplingProfiler::IsActive()) {
+    // Workers helping with the loop publish the caller's node, so their samples are attributed to it
+    int node_index = profiling::SamplingProfiler::GetCurrentNode();
+    fn = [node_index, inner_fn = std::move(fn)](unsigned idx) {
+      int prev_node_index = profiling::SamplingProfiler::GetCurrentNode();
+      profiling::SamplingProfiler::SetCurrentNode(node_index);
+      inner_fn(idx);
+      profiling::SamplingProfiler::SetCurrentNode(prev_node_index);
+    };
+  }
   if (underlying_threadpool_) {
     if (ThreadPool::ParallelSection::current_parallel_section) {
       underlying_threadpool_->RunInParallelSection(*(ThreadPool::ParallelSection::current_parallel_section->ps_.get()),
@@ -650,6 +669,18 @@ std::string ThreadPool::StopProfiling(concurrency::ThreadPool* tp) {
   }
 }
 
+std::vector<unsigned> ThreadPool::GetWorkerThreadIds(const concurrency::ThreadPool* tp) {
+  if (tp) {
+    return tp->GetWorkerThreadIds();
+  } else {
+    return {};
+  }
+}
+
+int ThreadPool::NumThreads(const concurrency::ThreadPool* tp) {
+  return tp ? tp->NumThreads() : 0;
+}
+
 // Return the number of threads created by the pool.
 int ThreadPool::NumThreads() const {
   if (underlying_threadpool_) {
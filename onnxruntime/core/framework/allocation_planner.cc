@@ -1205,6 +1205,58 @@ class PlannerImpl {
     return Status::OK();
   }
 
+  // Count the distinct producers of every node and flatten the distinct consumers of every node into
+  // plan_.node_dependencies, so the parallel executor doesn't need to walk the graph or take locks at runtime.
+  void ComputeNodeDependencies() {
+    auto& dependencies = plan_.node_dependencies;
+    const size_t max_node_index = graph_viewer_.MaxNodeIndex();
+
+    std::vector<bool> in_plan(max_node_index, false);
+    for (const auto& step : plan_.execution_plan) {
+      in_plan[step.node_index] = true;
+    }
+
+    dependencies.dependency_counts.assign(max_node_index, 0);
+    dependencies.successor_offsets.assign(max_node_index + 1, 0);
+    dependencies.successors.clear();
+    dependencies.root_nodes.clear();
+
+    std::vector<std::vector<NodeIndex>> successors(max_node_index);
+    for (const auto& step : plan_.execution_plan) {
+      const auto* pnode = graph_viewer_.GetNode(step.node_index);
+      auto& node_successors = successors[step.node_index];
+      for (auto it = pnode->OutputEdgesBegin(), end = pnode->OutputEdgesEnd(); it != end; ++it) {
+        const NodeIndex consumer = it->GetNode().Index();
+        if (consumer < max_node_index && in_plan[consumer]) {
+          node_successors.push_back(consumer);
+        }
+      }
+
+      // a node consuming several outputs of the producer has one edge per output
+      std::sort(node_successors.begin(), node_successors.end());
+      node_successors.erase(std::unique(node_successors.begin(), node_successors.end()), node_successors.end());
+      for (NodeIndex consumer : node_successors) {
+        ++dependencies.dependency_counts[consumer];
+      }
+    }
+
+    for (size_t node_index = 0; node_index < max_node_index; ++node_index) {
+      dependencies.successor_offsets[node_index + 1] =
+          dependencies.successor_offsets[node_index] + successors[node_index].size();
+    }
+
+    dependencies.successors.reserve(dependencies.successor_offsets[max_node_index]);
+    for (const auto& node_successors : successors) {
+      dependencies.successors.insert(dependencies.successors.end(), node_successors.begin(), node_successors.end());
+    }
+
+    for (const auto& step : plan_.execution_plan) {
+      if (dependencies.dependency_counts[step.node_index] == 0) {
+        dependencies.root_nodes.push_back(step.node_index);
+      }
+    }
+  }
+
   // Convert information in a freelist (about which ml-value becomes free when) into
   // a deallocation plan in the format required in an ExecutionPlan
   void GenerateDeallocationPlan() {
@@ -1308,6 +1360,10 @@ Status PlannerImpl::CreatePlan() {
   // Determine nodes that need fence check. This needs to be done after ComputeUseCounts and ComputeReusePlan.
   ORT_RETURN_IF_ERROR(ComputeFenceCheck());
 
+  if (context_.IsParallelExecutionEnabled()) {
+    ComputeNodeDependencies();
+  }
+
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
   //Adjust the allocate and lifetime intervals for all ml-values, based on their allocation kind.
   AdjustInplaceLifeIntervals();
@@ -1350,4 +1406,136 @@ Status SequentialPlanner::CreatePlan(
   return planner.CreatePlan();
 }
 
+// Product of the statically known dims of a tensor, unknown dims count as 1.
+static double KnownElementCount(const NodeArg* arg) {
+  if (arg == nullptr || !arg->Exists()) {
+    return 0.0;
+  }
+
+  double count = 1.0;
+  const auto* shape = arg->Shape();
+  if (shape != nullptr) {
+    for (const auto& dim : shape->dim()) {
+      if (dim.has_dim_value() && dim.dim_value() > 0) {
+        count *= static_cast<double>(dim.dim_value());
+      }
+    }
+  }
+
+  return count;
+}
+
+// Dim of a tensor, counted from the end for negative axis. 1 if it is not statically known.
+static double KnownDim(const NodeArg* arg, int axis) {
+  const auto* shape = arg != nullptr && arg->Exists() ? arg->Shape() : nullptr;
+  if (shape == nullptr) {
+    return 1.0;
+  }
+
+  const int rank = shape->dim_size();
+  if (axis < 0) {
+    axis += rank;
+  }
+
+  if (axis < 0 || axis >= rank) {
+    return 1.0;
+  }
+
+  const auto& dim = shape->dim(axis);
+  return dim.has_dim_value() && dim.dim_value() > 0 ? static_cast<double>(dim.dim_value()) : 1.0;
+}
+
+// Rough cost of a node in FLOPs. Matrix multiplications and convolutions count their multiply-adds,
+// other nodes the elements they read and write.
+static double EstimateNodeCost(const Node& node) {
+  const auto& inputs = node.InputDefs();
+  const auto& outputs = node.OutputDefs();
+
+  double output_elements = 0.0;
+  for (const auto* output : outputs) {
+    output_elements += KnownElementCount(output);
+  }
+
+  const auto& op_type = node.OpType();
+  if ((op_type == "MatMul" || op_type == "FusedMatMul" || op_type == "MatMulInteger") && !inputs.empty()) {
+    return 2.0 * output_elements * KnownDim(inputs[0], -1);
+  }
+
+  if ((op_type == "Gemm" || op_type == "FusedGemm") && !inputs.empty()) {
+    const auto& attributes = node.GetAttributes();
+    const auto trans_a = attributes.find("transA");
+    const bool is_trans_a = trans_a != attributes.end() && trans_a->second.i() != 0;
+    return 2.0 * output_elements * KnownDim(inputs[0], is_trans_a ? 0 : 1);
+  }
+
+  if ((op_type == "Conv" || op_type == "FusedConv" || op_type == "ConvInteger") && inputs.size() > 1) {
+    // each output element takes the weights of one output channel
+    return 2.0 * output_elements * KnownElementCount(inputs[1]) / KnownDim(inputs[1], 0);
+  }
+
+  double input_elements = 0.0;
+  for (const auto* input : inputs) {
+    input_elements += KnownElementCount(input);
+  }
+
+  return input_elements + output_elements;
+}
+
+void SequentialPlanner::ComputeCriticalPathCosts(const onnxruntime::GraphViewer& graph,
+                                                 const std::unordered_map<std::string, double>& measured_node_costs,
+                                                 SequentialExecutionPlan& plan) {
+  auto& dependencies = plan.node_dependencies;
+  if (dependencies.successor_offsets.empty()) {
+    return;
+  }
+
+  // measured and estimated costs are in different units, so nodes that are missing from the measurements
+  // (e.g. renamed by a different optimization level) get the average measured cost
+  double default_measured_cost = 0.0;
+  if (!measured_node_costs.empty()) {
+    for (const auto& entry : measured_node_costs) {
+      default_measured_cost += entry.second;
+    }
+
+    default_measured_cost /= static_cast<double>(measured_node_costs.size());
+  }
+
+  auto& critical_path_costs = dependencies.critical_path_costs;
+  critical_path_costs.assign(dependencies.dependency_counts.size(), 0.0);
+
+  // the reverse of the execution order visits all successors of a node before the node
+  for (auto it = plan.execution_plan.crbegin(); it != plan.execution_plan.crend(); ++it) {
+    const NodeIndex node_index = it->node_index;
+    const auto& node = *graph.GetNode(node_index);
+
+    double cost;
+    if (measured_node_costs.empty()) {
+      cost = EstimateNodeCost(node);
+    } else {
+      const auto entry = measured_node_costs.find(node.Name());
+      cost = entry != measured_node_costs.end() ? entry->second : default_measured_cost;
+    }
+
+    double longest_successor_path = 0.0;
+    for (size_t i = dependencies.successor_offsets[node_index], end = dependencies.successor_offsets[node_index + 1];
+         i < end; ++i) {
+      longest_successor_path = std::max(longest_successor_path, critical_path_costs[dependencies.successors[i]]);
+    }
+
+    critical_path_costs[node_index] = cost + longest_successor_path;
+  }
+
+  auto longer_path_first = [&critical_path_costs](NodeIndex lhs, NodeIndex rhs) {
+    return critical_path_costs[lhs] > critical_path_costs[rhs];
+  };
+
+  for (size_t node_index = 0, num_nodes = dependencies.dependency_counts.size(); node_index < num_nodes; ++node_index) {
+    std::stable_sort(dependencies.successors.begin() + dependencies.successor_offsets[node_index],
+                     dependencies.successors.begin() + dependencies.successor_offsets[node_index + 1],
+                     longer_path_first);
+  }
+
+  std::stable_sort(dependencies.root_nodes.begin(), dependencies.root_nodes.end(), longer_path_first);
+}
+
 }  // namespace onnxruntime
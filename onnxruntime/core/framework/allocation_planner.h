@@ -84,6 +84,14 @@ class SequentialPlanner {
       const OrtValueNameIdxMap& ort_value_name_idx_map,
       const ISequentialPlannerContext& context,
       std::unique_ptr<SequentialExecutionPlan>& plan);
+
+  // Fills plan.node_dependencies.critical_path_costs and orders the root nodes and the successors of each node
+  // by it, so the parallel executor picks the node on the longest remaining path first.
+  // Node costs are looked up by node name in measured_node_costs, e.g. kernel times of an earlier profiling run.
+  // If it is empty they are estimated from the FLOPs of the statically known shapes.
+  static void ComputeCriticalPathCosts(const onnxruntime::GraphViewer& graph,
+                                       const std::unordered_map<std::string, double>& measured_node_costs,
+                                       SequentialExecutionPlan& plan);
 };
 
 }  // namespace onnxruntime
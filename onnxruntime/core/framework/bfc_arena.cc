@@ -3,15 +3,258 @@
 
 #include "core/framework/allocator.h"
 #include "core/framework/bfc_arena.h"
+#include <algorithm>
+#include <atomic>
 #include <type_traits>
+#include <unordered_map>
 
 namespace onnxruntime {
+
+// Allocations of at most max_bytes are rounded up to a power of two size class, starting at kMinAllocationSize.
+// The objects of a class are carved from slabs that come from a few large slab regions allocated from the arena,
+// so Free can recognize a cached pointer and find its class without taking a lock.
+//
+// Each thread keeps a free list per class and exchanges objects with the per class depot in batches. The depot
+// mutex is taken about once per kBatchSize allocations, the arena mutex only when a new slab region is needed.
+// Objects never go back to the BFC bins, the slab regions stay allocated for the lifetime of the arena.
+// The cache only keeps pointers and never touches the memory it hands out, so it works for device memory as well.
+class BFCArena::SmallAllocCache : public std::enable_shared_from_this<BFCArena::SmallAllocCache> {
+ public:
+  SmallAllocCache(BFCArena& arena, size_t max_bytes)
+      : arena_(arena),
+        id_(next_id_.fetch_add(1, std::memory_order_relaxed)),
+        num_classes_(ClassForSize(max_bytes) + 1),
+        slab_bytes_(std::max<size_t>(kMinSlabBytes, ClassSize(num_classes_ - 1) * kMinObjectsPerSlab)),
+        depots_(std::make_unique<Depot[]>(num_classes_)) {
+  }
+
+  // Returns nullptr if no slab region can be added, the caller then allocates from the arena directly.
+  void* Alloc(size_t size) {
+    const size_t size_class = ClassForSize(size);
+    auto& free_list = GetThreadCache().free_lists[size_class];
+    if (free_list.empty()) {
+      Refill(size_class, free_list);
+      if (free_list.empty()) {
+        return nullptr;
+      }
+    }
+
+    void* p = free_list.back();
+    free_list.pop_back();
+    return p;
+  }
+
+  // Returns false if p was not allocated by the cache.
+  bool Free(void* p) {
+    const size_t size_class = ClassOf(p);
+    if (size_class == kNotCached) {
+      return false;
+    }
+
+    auto& free_list = GetThreadCache().free_lists[size_class];
+    free_list.push_back(p);
+    if (free_list.size() > kMaxThreadCachedPerClass) {
+      Release(size_class, free_list, kBatchSize);
+    }
+
+    return true;
+  }
+
+  // Returns 0 if p was not allocated by the cache.
+  size_t ObjectSize(const void* p) const {
+    const size_t size_class = ClassOf(p);
+    return size_class == kNotCached ? 0 : ClassSize(size_class);
+  }
+
+ private:
+  struct ThreadCache {
+    ThreadCache() = default;
+    ~ThreadCache() {
+      // the thread is exiting, give its objects back unless the arena is gone
+      if (auto cache = owner.lock()) {
+        for (size_t size_class = 0; size_class < free_lists.size(); ++size_class) {
+          cache->Release(size_class, free_lists[size_class], 0);
+        }
+      }
+    }
+
+    ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(ThreadCache);
+
+    std::weak_ptr<SmallAllocCache> owner;
+    std::vector<std::vector<void*>> free_lists;
+  };
+
+  struct Depot {
+    OrtMutex mutex;
+    std::vector<void*> free_objects;
+    // unused part of the slab the class carves new objects from
+    char* slab_next = nullptr;
+    char* slab_end = nullptr;
+  };
+
+  struct SlabRegion {
+    char* begin = nullptr;
+    char* end = nullptr;
+    // size class of each slab in the region
+    std::unique_ptr<uint8_t[]> slab_classes;
+  };
+
+  static constexpr size_t kNotCached = static_cast<size_t>(-1);
+  static constexpr size_t kBatchSize = 32;
+  static constexpr size_t kMaxThreadCachedPerClass = 2 * kBatchSize;
+  static constexpr size_t kMinSlabBytes = 64 * 1024;
+  static constexpr size_t kMinObjectsPerSlab = 16;
+  // the first region holds kFirstRegionSlabs slabs, every further one twice as many as the one before
+  static constexpr size_t kFirstRegionSlabs = 16;
+  static constexpr size_t kMaxSlabRegions = 16;
+
+  static size_t ClassForSize(size_t size) {
+    size_t size_class = 0;
+    while (ClassSize(size_class) < size) {
+      ++size_class;
+    }
+    return size_class;
+  }
+
+  static size_t ClassSize(size_t size_class) { return kMinAllocationSize << size_class; }
+
+  size_t ClassOf(const void* p) const {
+    const char* ptr = static_cast<const char*>(p);
+    const size_t num_regions = num_regions_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < num_regions; ++i) {
+      const auto& region = regions_[i];
+      if (ptr >= region.begin && ptr < region.end) {
+        // the slab class is written before any object of the slab is handed out
+        return region.slab_classes[static_cast<size_t>(ptr - region.begin) / slab_bytes_];
+      }
+    }
+
+    return kNotCached;
+  }
+
+  ThreadCache& GetThreadCache() {
+    // one entry per cache the thread has used. Entries of destroyed caches are dropped when one is added.
+    thread_local std::unordered_map<uint64_t, ThreadCache> thread_caches;
+    thread_local uint64_t last_id = 0;
+    thread_local ThreadCache* last_cache = nullptr;
+    if (last_id == id_) {
+      return *last_cache;
+    }
+
+    auto entry = thread_caches.find(id_);
+    if (entry == thread_caches.end()) {
+      for (auto it = thread_caches.begin(); it != thread_caches.end();) {
+        it = it->second.owner.expired() ? thread_caches.erase(it) : std::next(it);
+      }
+
+      entry = thread_caches.try_emplace(id_).first;
+      entry->second.owner = weak_from_this();
+      entry->second.free_lists.resize(num_classes_);
+      for (auto& free_list : entry->second.free_lists) {
+        free_list.reserve(kMaxThreadCachedPerClass + 1);
+      }
+    }
+
+    last_id = id_;
+    last_cache = &entry->second;
+    return *last_cache;
+  }
+
+  // Moves up to kBatchSize objects into free_list, from the depot first and then from the current slab.
+  void Refill(size_t size_class, std::vector<void*>& free_list) {
+    Depot& depot = depots_[size_class];
+    std::lock_guard<OrtMutex> lock(depot.mutex);
+
+    const size_t from_depot = std::min(kBatchSize, depot.free_objects.size());
+    free_list.insert(free_list.end(), depot.free_objects.end() - from_depot, depot.free_objects.end());
+    depot.free_objects.resize(depot.free_objects.size() - from_depot);
+
+    const size_t object_size = ClassSize(size_class);
+    while (free_list.size() < kBatchSize) {
+      if (depot.slab_next == depot.slab_end && !NewSlab(depot, size_class)) {
+        break;
+      }
+
+      free_list.push_back(depot.slab_next);
+      depot.slab_next += object_size;
+    }
+  }
+
+  // Moves all but the last `keep` objects of free_list to the depot.
+  void Release(size_t size_class, std::vector<void*>& free_list, size_t keep) {
+    if (free_list.size() <= keep) {
+      return;
+    }
+
+    Depot& depot = depots_[size_class];
+    std::lock_guard<OrtMutex> lock(depot.mutex);
+    const auto first_kept = free_list.end() - keep;
+    depot.free_objects.insert(depot.free_objects.end(), free_list.begin(), first_kept);
+    free_list.erase(free_list.begin(), first_kept);
+  }
+
+  // Points the depot at a new slab, adding a slab region if the last one is used up. Called with depot.mutex held.
+  bool NewSlab(Depot& depot, size_t size_class) {
+    std::lock_guard<OrtMutex> lock(regions_mutex_);
+    size_t num_regions = num_regions_.load(std::memory_order_relaxed);
+    if (num_regions == 0 || region_next_ == regions_[num_regions - 1].end) {
+      if (num_regions == kMaxSlabRegions) {
+        return false;
+      }
+
+      const size_t num_slabs = kFirstRegionSlabs << num_regions;
+      void* region_ptr = nullptr;
+      ORT_TRY {
+        region_ptr = arena_.AllocateRawInternal(num_slabs * slab_bytes_, false);
+      }
+      ORT_CATCH(const std::exception&) {
+        // the arena is out of memory. Let the caller allocate from it directly so the failure is reported there.
+        return false;
+      }
+
+      auto& region = regions_[num_regions];
+      region.begin = static_cast<char*>(region_ptr);
+      region.end = region.begin + num_slabs * slab_bytes_;
+      region.slab_classes = std::make_unique<uint8_t[]>(num_slabs);
+      region_next_ = region.begin;
+      num_regions_.store(++num_regions, std::memory_order_release);
+    }
+
+    auto& region = regions_[num_regions - 1];
+    region.slab_classes[static_cast<size_t>(region_next_ - region.begin) / slab_bytes_] =
+        static_cast<uint8_t>(size_class);
+    depot.slab_next = region_next_;
+    depot.slab_end = region_next_ + slab_bytes_;
+    region_next_ += slab_bytes_;
+    return true;
+  }
+
+  static std::atomic<uint64_t> next_id_;
+
+  BFCArena& arena_;
+  // identifies the cache in the thread local caches, unlike its address it is never reused
+  const uint64_t id_;
+  const size_t num_classes_;
+  const size_t slab_bytes_;
+  std::unique_ptr<Depot[]> depots_;
+
+  // regions_ is append only. An entry is complete before num_regions_ includes it.
+  SlabRegion regions_[kMaxSlabRegions];
+  std::atomic<size_t> num_regions_{0};
+  OrtMutex regions_mutex_;
+  // next unused slab of the last region, protected by regions_mutex_
+  char* region_next_ = nullptr;
+};
+
+std::atomic<uint64_t> BFCArena::SmallAllocCache::next_id_{1};
+
 BFCArena::BFCArena(std::unique_ptr<IAllocator> resource_allocator,
                    size_t total_memory,
                    ArenaExtendStrategy arena_extend_strategy,
                    int initial_chunk_size_bytes,
                    int max_dead_bytes_per_chunk,
-                   int initial_growth_chunk_size_bytes)
+                   int initial_growth_chunk_size_bytes,
+                   int max_small_alloc_bytes)
     : IAllocator(OrtMemoryInfo(resource_allocator->Info().name,
                                OrtAllocatorType::OrtArenaAllocator,
                                resource_allocator->Info().device,
@@ -22,13 +265,19 @@ BFCArena::BFCArena(std::unique_ptr<IAllocator> resource_allocator,
       next_allocation_id_(1),
       initial_chunk_size_bytes_(initial_chunk_size_bytes),
       max_dead_bytes_per_chunk_(max_dead_bytes_per_chunk),
-      initial_growth_chunk_size_bytes_(initial_growth_chunk_size_bytes) {
+      initial_growth_chunk_size_bytes_(initial_growth_chunk_size_bytes),
+      max_small_alloc_bytes_(static_cast<size_t>(std::clamp(max_small_alloc_bytes, 0, MAX_SMALL_ALLOC_BYTES_LIMIT))) {
   LOGS_DEFAULT(INFO) << "Creating BFCArena for " << device_allocator_->Info().name
                      << " with following configs: initial_chunk_size_bytes: " << initial_chunk_size_bytes_
                      << " max_dead_bytes_per_chunk: " << max_dead_bytes_per_chunk_
                      << " initial_growth_chunk_size_bytes: " << initial_growth_chunk_size_bytes_
                      << " memory limit: " << total_memory
-                     << " arena_extend_strategy: " << static_cast<int32_t>(arena_extend_strategy);
+                     << " arena_extend_strategy: " << static_cast<int32_t>(arena_extend_strategy)
+                     << " max_small_alloc_bytes: " << max_small_alloc_bytes_;
+
+  if (max_small_alloc_bytes_ > 0) {
+    small_alloc_cache_ = std::make_shared<SmallAllocCache>(*this, max_small_alloc_bytes_);
+  }
 
   // static_cast<std::underlying_type_t<ArenaExtendStrategy>>(arena_extend_strategy); doesn't work on this compiler
 
@@ -74,6 +323,9 @@ BFCArena::BFCArena(std::unique_ptr<IAllocator> resource_allocator,
 }
 
 BFCArena::~BFCArena() {
+  // detach the thread caches before the memory goes away
+  small_alloc_cache_.reset();
+
   for (const auto& region : region_manager_.regions()) {
     device_allocator_->Free(region.ptr());
   }
@@ -255,6 +507,13 @@ size_t BFCArena::RoundedBytes(size_t bytes) {
 }
 
 void* BFCArena::Alloc(size_t size) {
+  if (size != 0 && size <= max_small_alloc_bytes_) {
+    void* p = small_alloc_cache_->Alloc(size);
+    if (p != nullptr) {
+      return p;
+    }
+  }
+
   return AllocateRawInternal(size, false);
 }
 
@@ -279,6 +538,14 @@ void* BFCArena::Reserve(size_t size) {
 }
 
 size_t BFCArena::RequestedSize(const void* ptr) {
+  // the small allocation cache doesn't track requested sizes
+  if (small_alloc_cache_) {
+    const size_t object_size = small_alloc_cache_->ObjectSize(ptr);
+    if (object_size != 0) {
+      return object_size;
+    }
+  }
+
   std::lock_guard<OrtMutex> lock(lock_);
   BFCArena::ChunkHandle h = region_manager_.get_handle(ptr);
   ORT_ENFORCE(h != kInvalidChunkHandle);
@@ -287,6 +554,13 @@ size_t BFCArena::RequestedSize(const void* ptr) {
 }
 
 size_t BFCArena::AllocatedSize(const void* ptr) {
+  if (small_alloc_cache_) {
+    const size_t object_size = small_alloc_cache_->ObjectSize(ptr);
+    if (object_size != 0) {
+      return object_size;
+    }
+  }
+
   std::lock_guard<OrtMutex> lock(lock_);
   BFCArena::ChunkHandle h = region_manager_.get_handle(ptr);
   ORT_ENFORCE(h != kInvalidChunkHandle);
@@ -432,6 +706,11 @@ void BFCArena::Free(void* p) {
   if (p == nullptr) {
     return;
   }
+
+  if (small_alloc_cache_ && small_alloc_cache_->Free(p)) {
+    return;
+  }
+
   std::lock_guard<OrtMutex> lock(lock_);
   auto it = reserved_chunks_.find(p);
   if (it != reserved_chunks_.end()) {
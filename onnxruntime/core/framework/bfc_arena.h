@@ -57,13 +57,18 @@ class BFCArena : public IAllocator {
   static const int DEFAULT_MAX_DEAD_BYTES_PER_CHUNK = 128 * 1024 * 1024;
   static const int DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES = 2 * 1024 * 1024;
   static const size_t DEFAULT_MAX_MEM = std::numeric_limits<size_t>::max();
+  // 0 disables the small allocation cache
+  static const int DEFAULT_MAX_SMALL_ALLOC_BYTES = 0;
+  // largest size the small allocation cache serves, bigger values are clamped to it
+  static const int MAX_SMALL_ALLOC_BYTES_LIMIT = 64 * 1024;
 
   BFCArena(std::unique_ptr<IAllocator> resource_allocator,
            size_t total_memory,
            ArenaExtendStrategy arena_extend_strategy = DEFAULT_ARENA_EXTEND_STRATEGY,
            int initial_chunk_size_bytes = DEFAULT_INITIAL_CHUNK_SIZE_BYTES,
            int max_dead_bytes_per_chunk = DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
-           int initial_growth_chunk_size_bytes = DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES);
+           int initial_growth_chunk_size_bytes = DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES,
+           int max_small_alloc_bytes = DEFAULT_MAX_SMALL_ALLOC_BYTES);
 
   ~BFCArena() override;
 
@@ -97,6 +102,10 @@ class BFCArena : public IAllocator {
   size_t AllocatedSize(const void* ptr);
 
  private:
+  // Per thread size class caches in front of the arena for allocations of at most max_small_alloc_bytes_.
+  // Defined in bfc_arena.cc.
+  class SmallAllocCache;
+
   void* AllocateRawInternal(size_t num_bytes, bool dump_log_on_failure);
   void DeallocateRawInternal(void* ptr);
 
@@ -474,6 +483,11 @@ class BFCArena : public IAllocator {
   // is to be considered for shrinkage or not.
   bool consider_first_allocation_region_for_shrinkage_;
 
+  // 0 if the small allocation cache is disabled.
+  // The per thread caches of the threads that used the arena hold weak references to small_alloc_cache_.
+  const size_t max_small_alloc_bytes_;
+  std::shared_ptr<SmallAllocCache> small_alloc_cache_;
+
   ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(BFCArena);
 };
 #ifdef __GNUC__
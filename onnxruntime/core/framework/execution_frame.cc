@@ -14,6 +14,7 @@
 #include "core/framework/sparse_utils.h"
 #include "core/framework/node_index_info.h"
 #include "core/framework/op_kernel.h"
+#include "core/framework/run_placement.h"
 #include "core/framework/session_state.h"
 #include "core/framework/TensorSeq.h"
 #include "core/framework/utils.h"
@@ -381,7 +382,7 @@ ExecutionFrame::ExecutionFrame(const std::vector<int>& feed_mlvalue_idxs, const
     }
 
     //if there are some traditional ml value type in inputs disable the memory pattern optimization.
-    if (all_tensors) {
+    if (all_tensors && !TakeCachedFrameBuffers(feeds)) {
       mem_patterns_ = session_state.GetMemoryPatternGroup(feeds, feed_mlvalue_idxs, inferred_shapes_);
       // if no existing patterns, generate one in this executionframe
       if (!mem_patterns_) {
@@ -448,9 +449,70 @@ ExecutionFrame::ExecutionFrame(const std::vector<int>& feed_mlvalue_idxs, const
       }
     }
   }
+
+  if (session_state.GetRunArenaMaxBytes() > 0) {
+    for (const auto& location_size : session_state.GetRunArenaSizes()) {
+      auto run_arena = std::make_unique<RunArena>(location_size.first);
+      if (location_size.second > 0) {
+        // as with the memory pattern buffers, run without the arena if the block can't be allocated
+        AllocatorPtr alloc = GetAllocator(location_size.first);
+        void* buffer = nullptr;
+        ORT_TRY {
+          buffer = alloc->Alloc(location_size.second);
+        }
+        ORT_CATCH(const OnnxRuntimeException& ex) {
+          ORT_HANDLE_EXCEPTION([&]() {
+            LOGS(session_state_.Logger(), INFO) << "Allocation of run arena for " << location_size.first.ToString()
+                                                << " failed. Error:" << ex.what();
+          });
+        }
+
+        if (buffer != nullptr) {
+          run_arena->buffer = BufferUniquePtr(buffer, alloc);
+          run_arena->capacity = location_size.second;
+        }
+      }
+
+      run_arenas_.push_back(std::move(run_arena));
+    }
+  }
 }
 
-ExecutionFrame::~ExecutionFrame() = default;
+ExecutionFrame::~ExecutionFrame() {
+  // size the arenas of the next runs
+  for (const auto& run_arena : run_arenas_) {
+    session_state_.UpdateRunArenaSize(run_arena->location, run_arena->requested.load(std::memory_order_relaxed));
+  }
+
+  // The tensors placed in the buffers are not used anymore, so the next frame with these input shapes can take them.
+  // If no buffer could be allocated the next frame tries again instead.
+  if (cache_frame_buffers_ && mem_patterns_ != nullptr && !buffers_.empty()) {
+    SessionState::CachedFrameBuffers frame_buffers;
+    frame_buffers.input_dims = std::move(frame_buffers_input_dims_);
+    frame_buffers.mem_patterns = std::move(mem_patterns_);
+    frame_buffers.inferred_shapes = std::move(inferred_shapes_);
+    frame_buffers.buffers = std::move(buffers_);
+    session_state_.CacheFrameBuffers(std::move(frame_buffers));
+  }
+}
+
+bool ExecutionFrame::TakeCachedFrameBuffers(const std::vector<OrtValue>& feeds) {
+  if (session_state_.GetMaxCachedFrameBuffers() == 0) {
+    return false;
+  }
+
+  cache_frame_buffers_ = true;
+  SessionState::CachedFrameBuffers frame_buffers;
+  const bool cached = session_state_.TakeCachedFrameBuffers(feeds, frame_buffers);
+  frame_buffers_input_dims_ = std::move(frame_buffers.input_dims);
+  if (cached) {
+    mem_patterns_ = std::move(frame_buffers.mem_patterns);
+    inferred_shapes_ = std::move(frame_buffers.inferred_shapes);
+    buffers_ = std::move(frame_buffers.buffers);
+  }
+
+  return cached;
+}
 
 Status ExecutionFrame::CopyTensor(const Tensor& src, Tensor& dest) const {
   return session_state_.GetDataTransferMgr().CopyTensor(src, dest);
@@ -513,8 +575,9 @@ Status ExecutionFrame::AllocateMLValueTensorSelfOwnBufferHelper(OrtValue& ort_va
       if (block) {
         auto it = buffers_.find(location);
         if (it != buffers_.end()) {
-          // if the block is not correct, log message then fall back to default behavior
-          if (block->size_ == size) {
+          // if the block is too small, log message then fall back to default behavior.
+          // the block is larger if the pattern was generated for larger inputs of the same shape bucket.
+          if (block->size_ >= size) {
             void* buffer = it->second.get();
             auto status = AllocateTensorWithPreAllocateBufferHelper(
                 ort_value, static_cast<void*>(static_cast<char*>(buffer) + block->offset_), element_type, location,
@@ -523,8 +586,6 @@ Status ExecutionFrame::AllocateMLValueTensorSelfOwnBufferHelper(OrtValue& ort_va
           } else {
             // the block size may vary especially if the model has NonZero ops, or different sequence lengths are
             // fed in, so use VERBOSE as the log level as it's expected.
-            // TODO: Should we re-use the block if the size is large enough? Would probably need to allow it
-            // to be freed if the size difference was too large so our memory usage doesn't stick at a high water mark
             LOGS(session_state_.Logger(), VERBOSE) << "For ort_value with index: " << ort_value_index
                                                    << ", block in memory pattern size is: " << block->size_
                                                    << " but the actually size is: " << size
@@ -537,8 +598,21 @@ Status ExecutionFrame::AllocateMLValueTensorSelfOwnBufferHelper(OrtValue& ort_va
   }
 
   //no memory pattern, or the pattern is not correct.
-  if (!alloc) alloc = GetAllocator(location);
-  Tensor::InitOrtValue(element_type, shape, std::move(alloc), ort_value);
+  // unless the value outlives the frame, try the run arena before the allocator.
+  // string tensors are excluded as they need their destructors to run.
+  void* run_arena_buffer = nullptr;
+  if (!run_arenas_.empty() && per_alloc_plan.alloc_kind != AllocKind::kAllocateOutput &&
+      per_alloc_plan.alloc_kind != AllocKind::kAllocatedExternally && !utils::IsDataTypeString(element_type)) {
+    run_arena_buffer = AllocateFromRunArena(location, size);
+  }
+
+  if (run_arena_buffer != nullptr) {
+    ORT_RETURN_IF_ERROR(AllocateTensorWithPreAllocateBufferHelper(ort_value, run_arena_buffer, element_type,
+                                                                  location, shape));
+  } else {
+    if (!alloc) alloc = GetAllocator(location);
+    Tensor::InitOrtValue(element_type, shape, std::move(alloc), ort_value);
+  }
 
   // trace the memory allocation.
   // don't trace the memory allocation on string tensors, as it need
@@ -561,6 +635,25 @@ Status ExecutionFrame::AllocateMLValueTensorSelfOwnBufferHelper(OrtValue& ort_va
   return Status::OK();
 }
 
+void* ExecutionFrame::AllocateFromRunArena(const OrtMemoryInfo& location, size_t size) {
+  for (const auto& run_arena : run_arenas_) {
+    if (run_arena->location == location) {
+      // size is a multiple of kAllocAlignment so every offset stays aligned
+      run_arena->requested.fetch_add(size, std::memory_order_relaxed);
+      if (run_arena->buffer) {
+        const size_t offset = run_arena->offset.fetch_add(size, std::memory_order_relaxed);
+        if (size <= run_arena->capacity && offset <= run_arena->capacity - size) {
+          return static_cast<char*>(run_arena->buffer.get()) + offset;
+        }
+      }
+
+      return nullptr;
+    }
+  }
+
+  return nullptr;
+}
+
 Status ExecutionFrame::AllocateMLValueTensorPreAllocateBuffer(OrtValue& ort_value, int ort_value_index_reuse,
                                                               MLDataType element_type, const OrtMemoryInfo& location,
                                                               const TensorShape& shape, bool create_fence) {
@@ -773,6 +866,12 @@ Status ExecutionFrame::AllocateAsPerAllocationPlan(OrtValue& ort_value, int ort_
 }
 
 AllocatorPtr ExecutionFrame::GetAllocatorImpl(const OrtMemoryInfo& info) const {
+  // the allocator of the NUMA node the Run is placed on, if any
+  AllocatorPtr placement_allocator = RunPlacement::GetAllocator(session_state_.GetThreadPool(), info);
+  if (placement_allocator) {
+    return placement_allocator;
+  }
+
   return session_state_.GetAllocator(info);
 }
 
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <unordered_map>
@@ -201,6 +203,13 @@ class ExecutionFrame final : public IExecutionFrame {
   Status AllocateTensorWithPreAllocateBufferHelper(OrtValue& ort_value, void* pBuffer, MLDataType element_type,
                                                    const OrtMemoryInfo& location, const TensorShape& shape);
 
+  // Returns nullptr if there is no run arena for location or it has less than size bytes left.
+  void* AllocateFromRunArena(const OrtMemoryInfo& location, size_t size);
+
+  // Takes the memory pattern and buffers a finished frame with the same input shapes cached in the session state.
+  // Returns false if there are none, and then the buffers this frame allocates for its pattern are cached.
+  bool TakeCachedFrameBuffers(const std::vector<OrtValue>& feeds);
+
   void TraceAllocate(int ort_value_idx, size_t size);
   void TraceFree(int ort_value_idx);
 
@@ -214,7 +223,7 @@ class ExecutionFrame final : public IExecutionFrame {
   // If we already have cached memory pattern on these input shapes
   // Use this mem pattern that create a big chunk for all the internal
   // kernel's input/output tensors.
-  const MemoryPatternGroup* mem_patterns_;
+  std::shared_ptr<const MemoryPatternGroup> mem_patterns_;
 
   // If no cached memory pattern, and we enable the memory pattern optimization
   // use this planner_ to trace the memory allocation in current executor.
@@ -223,6 +232,28 @@ class ExecutionFrame final : public IExecutionFrame {
   // Big chunks on different locations that will be used by mem_pattern.
   std::map<OrtMemoryInfo, BufferUniquePtr> buffers_;
 
+  // Whether mem_patterns_ and buffers_ go back to the session state cache when the frame is destroyed, and the
+  // input dims they are cached for.
+  bool cache_frame_buffers_ = false;
+  std::vector<int64_t> frame_buffers_input_dims_;
+
+  // Buffer the activations on one location that mem_patterns_ doesn't cover are bumped off.
+  // Nothing is freed before the frame goes away.
+  struct RunArena {
+    explicit RunArena(const OrtMemoryInfo& location) : location(location) {}
+
+    const OrtMemoryInfo location;
+    BufferUniquePtr buffer;
+    size_t capacity = 0;
+    std::atomic<size_t> offset{0};
+    // bytes asked for, including those that didn't fit
+    std::atomic<size_t> requested{0};
+  };
+
+  // Empty unless the session enables run arenas. Not added to after construction, so the parallel executor can
+  // allocate from it concurrently.
+  std::vector<std::unique_ptr<RunArena>> run_arenas_;
+
   // Given the input shapes of the executed graph, ExecutionFrame tries inferring
   // all symbolic shapes. inferred_shapes_[i] is the shape of OrtValue indexed
   // by i, if the key i exists.
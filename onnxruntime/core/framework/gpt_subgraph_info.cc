@@ -0,0 +1,107 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/gpt_subgraph_info.h"
+
+#include "core/graph/graph.h"
+
+namespace onnxruntime {
+
+bool HasPastPresentShareBufferInputs(const std::vector<const NodeArg*>& subgraph_inputs) {
+  const size_t num_inputs = subgraph_inputs.size();
+  return num_inputs >= 2 &&
+         subgraph_inputs[num_inputs - 2]->Name() == "past_sequence_length" &&
+         subgraph_inputs[num_inputs - 1]->Name() == "cache_indirection";
+}
+
+Status ValidateGptSubgraph(const std::vector<const NodeArg*>& subgraph_inputs,
+                           const std::vector<const NodeArg*>& subgraph_outputs,
+                           GptSubgraphInfo& info) {
+  const int num_subgraph_inputs = static_cast<int>(subgraph_inputs.size());
+  const int num_subgraph_outputs = static_cast<int>(subgraph_outputs.size());
+  const bool past_present_share_buffer = HasPastPresentShareBufferInputs(subgraph_inputs);
+
+  ORT_RETURN_IF(num_subgraph_outputs <= 1,
+                "Invalid GPT-2 subgraph: number of outputs shall be larger than 1 (Need past state in inputs and outputs).");
+
+  if (past_present_share_buffer) {
+    ORT_RETURN_IF(num_subgraph_inputs != num_subgraph_outputs + 4,
+                  "Invalid GPT-2 subgraph: number of inputs shall be number of outputs plus 4 "
+                  "when it has past_sequence_length and cache_indirection inputs");
+    for (int i = num_subgraph_inputs - 2; i < num_subgraph_inputs; ++i) {
+      ORT_RETURN_IF(subgraph_inputs[i]->TypeAsProto()->tensor_type().elem_type() !=
+                        ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_INT32,
+                    "subgraph input ", subgraph_inputs[i]->Name(), " shall have int32 type");
+    }
+  } else {
+    ORT_RETURN_IF(num_subgraph_inputs != num_subgraph_outputs + 2,
+                  "Invalid GPT-2 subgraph: number of inputs shall be number of outputs plus 2");
+  }
+
+  ORT_RETURN_IF(subgraph_inputs[0]->Name() != "input_ids", "subgraph input 0 shall be named as input_ids, got: ",
+                subgraph_inputs[0]->Name());
+  ORT_RETURN_IF(subgraph_inputs[1]->Name() != "position_ids", "subgraph input 1 shall be named as position_ids, got: ",
+                subgraph_inputs[1]->Name());
+  ORT_RETURN_IF(subgraph_inputs[2]->Name() != "attention_mask", "subgraph input 2 shall be named as attention_mask, got: ",
+                subgraph_inputs[2]->Name());
+  ORT_RETURN_IF(subgraph_inputs[3]->Name() != "past_0", "subgraph input 3 shall be named as past_0, got: ",
+                subgraph_inputs[3]->Name());
+
+  // Past state shape is like (2, batch_size, 12, past_seq_len, 64). Here 12 and 64 are constants of num_heads and hidden_size/num_heads.
+  const ONNX_NAMESPACE::TensorShapeProto* past_shape = subgraph_inputs[3]->Shape();
+  ORT_RETURN_IF(past_shape->dim_size() != 5, "subgraph past state is expected to have 5 dimension, got ",
+                past_shape->dim_size());
+
+  ORT_RETURN_IF(!past_shape->dim(0).has_dim_value() || past_shape->dim(0).dim_value() != 2,
+                "subgraph past state dimension 0 shall have length of 2");
+
+  ORT_RETURN_IF(!past_shape->dim(2).has_dim_value() || past_shape->dim(2).dim_value() <= 0,
+                "subgraph past state dimension 2 shall have a positive value for number of heads");
+
+  ORT_RETURN_IF(!past_shape->dim(4).has_dim_value() || past_shape->dim(4).dim_value() <= 0,
+                "subgraph past state dimension 4 shall have a positive value for hidden size per head");
+
+  // check subgraph outputs
+  ORT_RETURN_IF(subgraph_outputs[0]->Name() != "logits", "subgraph output 0 shall be named as logits, got: ",
+                subgraph_outputs[0]->Name());
+
+  ORT_RETURN_IF(subgraph_outputs[1]->Name() != "present_0", "subgraph input 1 shall be named as present_0, got: ",
+                subgraph_outputs[1]->Name());
+
+  // Logits shape is like (batch_size, seq_len, 50257). Here 50257 is the vocabulary size.
+  const ONNX_NAMESPACE::TensorShapeProto* logits_shape = subgraph_outputs[0]->Shape();
+  ORT_RETURN_IF(logits_shape->dim_size() != 3, "subgraph logits output is expected to have 3 dimension, got ",
+                logits_shape->dim_size());
+
+  ORT_RETURN_IF(!logits_shape->dim(2).has_dim_value() || logits_shape->dim(2).dim_value() <= 0,
+                "subgraph past state dimension 2 shall have a positive value for vocabulary size");
+
+  // Save parameters related to the subgraph.
+  info.num_heads = static_cast<int>(past_shape->dim(2).dim_value());
+  info.head_size = static_cast<int>(past_shape->dim(4).dim_value());
+  info.vocab_size = static_cast<int>(logits_shape->dim(2).dim_value());
+  info.num_layers = static_cast<int>(subgraph_outputs.size()) - 1;
+  info.past_present_share_buffer = past_present_share_buffer;
+
+  ORT_RETURN_IF(subgraph_inputs[0]->TypeAsProto()->tensor_type().elem_type() != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_INT32,
+                "subgraph input 0 (input_ids) shall have int32 type");
+  ORT_RETURN_IF(subgraph_inputs[1]->TypeAsProto()->tensor_type().elem_type() != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_INT32,
+                "subgraph input 1 (position_ids) shall have int32 type");
+  ORT_RETURN_IF(subgraph_inputs[2]->TypeAsProto()->tensor_type().elem_type() != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_INT32,
+                "subgraph input 2 (attention_mask) shall have int32 type");
+
+  auto output_type = subgraph_outputs[0]->TypeAsProto()->tensor_type().elem_type();
+  ORT_RETURN_IF(output_type != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_FLOAT && output_type != ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_FLOAT16,
+                "subgraph output 0 (logits) shall be float or float16 data type");
+
+  ORT_RETURN_IF(subgraph_inputs[3]->TypeAsProto()->tensor_type().elem_type() != output_type,
+                "subgraph input 3 (past_0) shall shall have same data type of logits output");
+  ORT_RETURN_IF(subgraph_outputs[1]->TypeAsProto()->tensor_type().elem_type() != output_type,
+                "subgraph output 1 (present_0) shall shall have same data type of logits output");
+
+  info.is_output_float16 = (output_type == ONNX_NAMESPACE::TensorProto_DataType::TensorProto_DataType_FLOAT16);
+
+  return Status::OK();
+}
+
+}  // namespace onnxruntime
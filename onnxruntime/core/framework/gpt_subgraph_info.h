@@ -0,0 +1,33 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <vector>
+
+#include "core/common/common.h"
+#include "core/graph/basic_types.h"
+
+namespace onnxruntime {
+class NodeArg;
+
+// Parameters of a GPT-2 decoder graph deduced from its inputs and outputs.
+struct GptSubgraphInfo {
+  int num_heads;
+  int head_size;
+  int vocab_size;
+  int num_layers;
+  bool past_present_share_buffer;
+  bool is_output_float16;
+};
+
+// Whether the decoder graph has the inputs past_sequence_length and cache_indirection after the past state.
+bool HasPastPresentShareBufferInputs(const std::vector<const NodeArg*>& subgraph_inputs);
+
+// Checks that the inputs and outputs of a GPT-2 decoder graph follow the convention of the BeamSearch subgraph,
+// and deduces its parameters. Used for the subgraph of BeamSearch and for standalone decoder models.
+Status ValidateGptSubgraph(const std::vector<const NodeArg*>& subgraph_inputs,
+                           const std::vector<const NodeArg*>& subgraph_outputs,
+                           GptSubgraphInfo& info);
+
+}  // namespace onnxruntime
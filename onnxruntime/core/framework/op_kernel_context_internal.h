@@ -5,6 +5,7 @@
 
 #include <functional>
 #include "core/framework/op_kernel.h"
+#include "core/framework/run_placement.h"
 #include "core/framework/session_state.h"
 #include "core/session/onnxruntime_c_api.h"
 
@@ -22,7 +23,7 @@ class OpKernelContextInternal : public OpKernelContext {
                                    const OpKernel& kernel,
                                    const logging::Logger& logger,
                                    const bool& terminate_flag)
-      : OpKernelContext(&frame, &kernel, session_state.GetThreadPool(), logger),
+      : OpKernelContext(&frame, &kernel, RunPlacement::GetThreadPool(session_state.GetThreadPool()), logger),
         session_state_(session_state),
         terminate_flag_(terminate_flag) {
     const auto& implicit_inputs = kernel.Node().ImplicitInputDefs();
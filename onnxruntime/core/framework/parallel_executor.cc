@@ -3,23 +3,177 @@
 
 #include "core/framework/parallel_executor.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <thread>
 #include <vector>
 #include "core/common/common.h"
 #include "core/common/logging/logging.h"
+#include "core/common/spin_pause.h"
 #include "core/framework/allocation_planner.h"
 #include "core/framework/execution_frame.h"
 #include "core/framework/session_state.h"
 #include "core/framework/op_kernel_context_internal.h"
+#include "core/framework/run_placement.h"
 #include "core/framework/utils.h"
 #include "core/platform/threadpool.h"
 
 namespace onnxruntime {
 
+namespace {
+
+// Fixed capacity work stealing deque (Chase and Lev) of node indices. The owning worker pushes and pops at the
+// bottom, the other workers steal from the top. Every node becomes ready once per run, so a capacity of the
+// number of nodes in the plan is never exceeded and the buffer doesn't need to grow.
+class NodeDeque {
+ public:
+  explicit NodeDeque(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    buffer_ = std::make_unique<std::atomic<NodeIndex>[]>(size);
+  }
+
+  // Owner only.
+  void Push(NodeIndex node_index) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    buffer_[static_cast<size_t>(bottom) & mask_].store(node_index, std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  // Owner only. Takes the most recently pushed node.
+  bool Pop(NodeIndex& node_index) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return false;
+    }
+
+    node_index = buffer_[static_cast<size_t>(bottom) & mask_].load(std::memory_order_relaxed);
+    if (top < bottom) {
+      return true;
+    }
+
+    // last node, a thief may be taking it as well
+    const bool taken = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return taken;
+  }
+
+  // Any thread. Takes the oldest node. May fail spuriously when racing with another thread.
+  bool Steal(NodeIndex& node_index) {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return false;
+    }
+
+    node_index = buffer_[static_cast<size_t>(top) & mask_].load(std::memory_order_relaxed);
+    return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+  }
+
+  bool Empty() const {
+    return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::unique_ptr<std::atomic<NodeIndex>[]> buffer_;
+  size_t mask_;
+  // top_ is written by thieves and bottom_ by the owner, keep them on separate cache lines
+  alignas(64) std::atomic<int64_t> top_{0};
+  alignas(64) std::atomic<int64_t> bottom_{0};
+};
+
+// Number of empty passes over the queues before an idle worker blocks.
+constexpr int kIdleSpinCount = 1024;
+
+Status CreateNodeExceptionStatus(NodeIndex node_index, const SessionState& session_state, const std::exception* ex) {
+  const auto* node = session_state.GetGraphViewer().GetNode(node_index);
+
+  return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Exception running nodes starting at ", node->OpType(),
+                         " node '", node->Name(), "'. ",
+                         ex ? ex->what() : "Unknown exception was caught by catch-all handler.");
+}
+
+}  // namespace
+
+struct ParallelExecutor::WorkStealingRun {
+  WorkStealingRun(ParallelExecutor& executor_in, const SessionState& session_state_in,
+                  const logging::Logger& logger_in, size_t num_workers)
+      : executor(executor_in),
+        session_state(session_state_in),
+        logger(logger_in),
+        dependencies(session_state_in.GetExecutionPlan()->node_dependencies) {
+    const size_t num_node_slots = dependencies.dependency_counts.size();
+    pending_dependencies = std::make_unique<std::atomic<int>[]>(num_node_slots);
+    for (size_t i = 0; i < num_node_slots; ++i) {
+      pending_dependencies[i].store(dependencies.dependency_counts[i], std::memory_order_relaxed);
+    }
+
+    const size_t num_nodes = session_state_in.GetExecutionPlan()->execution_plan.size();
+    deques.reserve(num_workers);
+    for (size_t i = 0; i < num_workers; ++i) {
+      deques.push_back(std::make_unique<NodeDeque>(num_nodes));
+    }
+  }
+
+  bool AnyQueued() const {
+    return std::any_of(deques.cbegin(), deques.cend(), [](const std::unique_ptr<NodeDeque>& d) { return !d->Empty(); });
+  }
+
+  // Called after queuing a node or finishing the run. The fence pairs with the one in WorkStealingLoop so that
+  // either the idle worker sees the change or this sees the idle worker.
+  void WakeIdleWorkers(bool all) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (num_idle.load(std::memory_order_relaxed) > 0) {
+      { std::lock_guard<OrtMutex> lock(idle_mutex); }
+      if (all) {
+        idle_cv.notify_all();
+      } else {
+        idle_cv.notify_one();
+      }
+    }
+  }
+
+  // Only valid while a node of the run is queued or running.
+  ParallelExecutor& executor;
+  const SessionState& session_state;
+  const logging::Logger& logger;
+  const SequentialExecutionPlan::NodeDependencies& dependencies;
+
+  // producers not finished yet, per node index. Starts as a copy of dependencies.dependency_counts.
+  std::unique_ptr<std::atomic<int>[]> pending_dependencies;
+  // one queue per worker, the calling thread is worker 0
+  std::vector<std::unique_ptr<NodeDeque>> deques;
+  // nodes queued or running. The run is over once this drops to 0.
+  std::atomic<int64_t> outstanding{0};
+  // set on the first error. Queued nodes are then dropped instead of run.
+  std::atomic<bool> failed{false};
+
+  std::atomic<int> num_idle{0};
+  OrtMutex idle_mutex;
+  OrtCondVar idle_cv;
+};
+
 ParallelExecutor::ParallelExecutor(const SessionState& session_state, const bool& terminate_flag)
-    : out_standings_(0), terminate_flag_(terminate_flag), executor_pool_(session_state.GetInterOpThreadPool()) {
+    : out_standings_(0),
+      use_work_stealing_(session_state.GetUseWorkStealingExecutor()),
+      run_placement_(RunPlacement::Current()),
+      terminate_flag_(terminate_flag),
+      executor_pool_(session_state.GetInterOpThreadPool()) {
+  if (use_work_stealing_) {
+    return;
+  }
+
   const auto& graph_viewer = session_state.GetGraphViewer();
   node_refs_.resize(graph_viewer.MaxNodeIndex());
   for (auto& node : graph_viewer.Nodes()) {
@@ -40,20 +194,24 @@ Status ParallelExecutor::Execute(const SessionState& session_state, const std::v
 
   root_frame_ = std::make_unique<ExecutionFrame>(feed_mlvalue_idxs, feeds, fetch_mlvalue_idxs, fetches,
                                                          fetch_allocators, session_state);
-  //std::cout << "start nodes:" << std::endl;
-  for (auto node_index : session_state.GetGraphViewer().GetRootNodes()) {
-    auto p_op_kernel = session_state.GetKernel(node_index);
-    if (!p_op_kernel)
-      continue;
-
-    //std::cout << "\t" << p_op_kernel->Node().Name() << std::endl;
-    EnqueueNode(node_index, session_state, logger);
-  }
+  if (use_work_stealing_) {
+    RunWorkStealing(session_state, logger);
+  } else {
+    //std::cout << "start nodes:" << std::endl;
+    for (auto node_index : session_state.GetGraphViewer().GetRootNodes()) {
+      auto p_op_kernel = session_state.GetKernel(node_index);
+      if (!p_op_kernel)
+        continue;
+
+      //std::cout << "\t" << p_op_kernel->Node().Name() << std::endl;
+      EnqueueNode(node_index, session_state, logger);
+    }
 
-  // Wait for finish.
-  {
-    std::unique_lock<OrtMutex> lock(complete_mutex_);
-    while (out_standings_ > 0) complete_cv_.wait(lock);
+    // Wait for finish.
+    {
+      std::unique_lock<OrtMutex> lock(complete_mutex_);
+      while (out_standings_ > 0) complete_cv_.wait(lock);
+    }
   }
 
   Status status = Status::OK();
@@ -104,156 +262,167 @@ Status ParallelExecutor::Execute(const SessionState& session_state, const std::v
   return Status::OK();
 }
 
-Status ParallelExecutor::RunNodeAsync(size_t p_node_index,
-                                      const SessionState& session_state,
-                                      const logging::Logger& logger) {
-  LOGS(logger, INFO) << "Begin execution";
-
+Status ParallelExecutor::RunNode(NodeIndex node_index,
+                                 const SessionState& session_state,
+                                 const logging::Logger& logger) {
   Status status = Status::OK();
 
-  size_t node_index = p_node_index;
-  bool keep_running = true;
   const auto& graph_viewer = session_state.GetGraphViewer();
   TimePoint sync_time_begin;
   TimePoint kernel_begin_time;
   const bool f_profiler_enabled = session_state.Profiler().IsEnabled();
   const SequentialExecutionPlan& exec_plan = *session_state.GetExecutionPlan();
 
-  // Avoid context switching if possible.
-  while (keep_running) {
-    // TODO: Convert RunNodeAsync return Status.
-    // to also handle exception propagation
-    if (terminate_flag_) {
-      LOGS(logger, WARNING) << "Exiting due to terminate flag being set to true.";
-      ORT_THROW("Exiting due to terminate flag being set to true.");
-    }
+  if (terminate_flag_) {
+    LOGS(logger, WARNING) << "Exiting due to terminate flag being set to true.";
+    ORT_THROW("Exiting due to terminate flag being set to true.");
+  }
 
-    const auto* p_op_kernel = session_state.GetKernel(node_index);
-    const auto& node = *graph_viewer.GetNode(node_index);
+  const auto* p_op_kernel = session_state.GetKernel(node_index);
+  const auto& node = *graph_viewer.GetNode(node_index);
 
-    // if a kernel has been added in the session state, it better be NON-null.
-    if (p_op_kernel == nullptr) {
-      ORT_THROW("Got nullptr from GetKernel for node: ", node.Name());
-    }
+  // if a kernel has been added in the session state, it better be NON-null.
+  if (p_op_kernel == nullptr) {
+    ORT_THROW("Got nullptr from GetKernel for node: ", node.Name());
+  }
 
-    OpKernelContextInternal op_kernel_context(session_state, *root_frame_, *p_op_kernel, logger, terminate_flag_);
+  OpKernelContextInternal op_kernel_context(session_state, *root_frame_, *p_op_kernel, logger, terminate_flag_);
 
-    if (f_profiler_enabled) {
-      sync_time_begin = session_state.Profiler().Start();
-    }
-    // sync before compute
-    int queue_id = p_op_kernel->KernelDef().ExecQueueId();
-    if (exec_plan.NodeHasFence(node_index)) {
-      for (int input_index = 0; input_index < op_kernel_context.InputCount(); ++input_index) {
-        Fence_t fence = op_kernel_context.InputFence(input_index);
-        if (fence) {
-          auto execution_provider_type = node.GetExecutionProviderType();
-          if (OrtMemTypeCPUInput == p_op_kernel->KernelDef().InputMemoryType(input_index)) {
-            execution_provider_type = kCpuExecutionProvider;
-          }
-          fence->BeforeUsingAsInput(execution_provider_type, queue_id);
+  if (f_profiler_enabled) {
+    sync_time_begin = session_state.Profiler().Start();
+  }
+  // sync before compute
+  int queue_id = p_op_kernel->KernelDef().ExecQueueId();
+  if (exec_plan.NodeHasFence(node_index)) {
+    for (int input_index = 0; input_index < op_kernel_context.InputCount(); ++input_index) {
+      Fence_t fence = op_kernel_context.InputFence(input_index);
+      if (fence) {
+        auto execution_provider_type = node.GetExecutionProviderType();
+        if (OrtMemTypeCPUInput == p_op_kernel->KernelDef().InputMemoryType(input_index)) {
+          execution_provider_type = kCpuExecutionProvider;
         }
+        fence->BeforeUsingAsInput(execution_provider_type, queue_id);
       }
+    }
 
-      for (int input_index = 0; input_index < op_kernel_context.ImplicitInputCount(); ++input_index) {
-        Fence_t fence = op_kernel_context.ImplicitInputFence(input_index);
-        if (fence) {
-          auto execution_provider_type = node.GetExecutionProviderType();
-          if (OrtMemTypeCPUInput == p_op_kernel->KernelDef().InputMemoryType(input_index)) {
-            execution_provider_type = kCpuExecutionProvider;
-          }
-          fence->BeforeUsingAsInput(execution_provider_type, queue_id);
+    for (int input_index = 0; input_index < op_kernel_context.ImplicitInputCount(); ++input_index) {
+      Fence_t fence = op_kernel_context.ImplicitInputFence(input_index);
+      if (fence) {
+        auto execution_provider_type = node.GetExecutionProviderType();
+        if (OrtMemTypeCPUInput == p_op_kernel->KernelDef().InputMemoryType(input_index)) {
+          execution_provider_type = kCpuExecutionProvider;
         }
+        fence->BeforeUsingAsInput(execution_provider_type, queue_id);
       }
+    }
 
-      for (int output_index = 0; output_index < op_kernel_context.OutputCount(); ++output_index) {
-        Fence_t fence = op_kernel_context.OutputFence(output_index);
-        if (fence) {
-          fence->BeforeUsingAsOutput(node.GetExecutionProviderType(), queue_id);
-        }
+    for (int output_index = 0; output_index < op_kernel_context.OutputCount(); ++output_index) {
+      Fence_t fence = op_kernel_context.OutputFence(output_index);
+      if (fence) {
+        fence->BeforeUsingAsOutput(node.GetExecutionProviderType(), queue_id);
       }
     }
+  }
 
-    if (f_profiler_enabled) {
-      session_state.Profiler().EndTimeAndRecordEvent(profiling::NODE_EVENT,
-                                                     node.Name() + "_fence_before",
-                                                     sync_time_begin,
-                                                     {{"op_name", p_op_kernel->KernelDef().OpName()}});
-      concurrency::ThreadPool::StartProfiling(session_state.GetThreadPool());
-      kernel_begin_time = session_state.Profiler().Start();
-    }
+  if (f_profiler_enabled) {
+    session_state.Profiler().EndTimeAndRecordEvent(profiling::NODE_EVENT,
+                                                   node.Name() + "_fence_before",
+                                                   sync_time_begin,
+                                                   {{"op_name", p_op_kernel->KernelDef().OpName()}});
+    concurrency::ThreadPool::StartProfiling(session_state.GetThreadPool());
+    kernel_begin_time = session_state.Profiler().Start();
+  }
 
-    // call compute on the kernel
-    VLOGS(logger, 1) << "Computing kernel: " << node.Name();
+  // call compute on the kernel
+  VLOGS(logger, 1) << "Computing kernel: " << node.Name();
 
-    // Execute the kernel.
-    ORT_TRY {
+  // Execute the kernel.
+  ORT_TRY {
 #ifdef ENABLE_TRAINING
-      if (p_op_kernel->KernelDef().AllocateInputsContiguously()) {
-        ORT_RETURN_IF_ERROR(utils::VerifyInputTensorsAllocatedContiguously(&op_kernel_context));
-      }
+    if (p_op_kernel->KernelDef().AllocateInputsContiguously()) {
+      ORT_RETURN_IF_ERROR(utils::VerifyInputTensorsAllocatedContiguously(&op_kernel_context));
+    }
 #endif
 
-      status = p_op_kernel->Compute(&op_kernel_context);
-    }
-    ORT_CATCH(const std::exception& ex) {
-      ORT_HANDLE_EXCEPTION([&]() {
-        status = ORT_MAKE_STATUS(ONNXRUNTIME, RUNTIME_EXCEPTION, ex.what());
-      });
-    }
+    status = p_op_kernel->Compute(&op_kernel_context);
+  }
+  ORT_CATCH(const std::exception& ex) {
+    ORT_HANDLE_EXCEPTION([&]() {
+      status = ORT_MAKE_STATUS(ONNXRUNTIME, RUNTIME_EXCEPTION, ex.what());
+    });
+  }
 
-    if (!status.IsOK()) {
-      std::ostringstream ss;
-      ss << "Non-zero status code returned while running " << node.OpType() << " node. Name:'" << node.Name()
-         << "' Status Message: " << status.ErrorMessage();
-      const auto msg_string = ss.str();
-      LOGS(logger, ERROR) << msg_string;
-      status = Status(status.Category(), status.Code(), msg_string);
-      break;
-    }
+  if (!status.IsOK()) {
+    std::ostringstream ss;
+    ss << "Non-zero status code returned while running " << node.OpType() << " node. Name:'" << node.Name()
+       << "' Status Message: " << status.ErrorMessage();
+    const auto msg_string = ss.str();
+    LOGS(logger, ERROR) << msg_string;
+    return Status(status.Category(), status.Code(), msg_string);
+  }
 
-    if (f_profiler_enabled) {
-      session_state.Profiler().EndTimeAndRecordEvent(profiling::NODE_EVENT,
-                                                     node.Name() + "_kernel_time",
-                                                     kernel_begin_time,
-                                                     {{"op_name", p_op_kernel->KernelDef().OpName()},
-                                                      {"provider", p_op_kernel->KernelDef().Provider()},
-                                                      {"thread_scheduling_stats", concurrency::ThreadPool::StopProfiling(session_state.GetThreadPool())}});
+  if (f_profiler_enabled) {
+    session_state.Profiler().EndTimeAndRecordEvent(profiling::NODE_EVENT,
+                                                   node.Name() + "_kernel_time",
+                                                   kernel_begin_time,
+                                                   {{"op_name", p_op_kernel->KernelDef().OpName()},
+                                                    {"provider", p_op_kernel->KernelDef().Provider()},
+                                                    {"thread_scheduling_stats", concurrency::ThreadPool::StopProfiling(session_state.GetThreadPool())}});
 
-      sync_time_begin = session_state.Profiler().Start();
-    }
-    // sync after compute for outputs
-    if (exec_plan.NodeHasFence(node_index)) {
-      for (int input_index = 0; input_index < op_kernel_context.InputCount(); ++input_index) {
-        Fence_t fence = op_kernel_context.InputFence(input_index);
-        if (fence) {
-          fence->AfterUsedAsInput(queue_id);
-        }
+    sync_time_begin = session_state.Profiler().Start();
+  }
+  // sync after compute for outputs
+  if (exec_plan.NodeHasFence(node_index)) {
+    for (int input_index = 0; input_index < op_kernel_context.InputCount(); ++input_index) {
+      Fence_t fence = op_kernel_context.InputFence(input_index);
+      if (fence) {
+        fence->AfterUsedAsInput(queue_id);
       }
+    }
 
-      for (int input_index = 0; input_index < op_kernel_context.ImplicitInputCount(); ++input_index) {
-        Fence_t fence = op_kernel_context.ImplicitInputFence(input_index);
-        if (fence) {
-          fence->AfterUsedAsInput(queue_id);
-        }
+    for (int input_index = 0; input_index < op_kernel_context.ImplicitInputCount(); ++input_index) {
+      Fence_t fence = op_kernel_context.ImplicitInputFence(input_index);
+      if (fence) {
+        fence->AfterUsedAsInput(queue_id);
       }
+    }
 
-      for (int output_index = 0; output_index < op_kernel_context.OutputCount(); ++output_index) {
-        Fence_t fence = op_kernel_context.OutputFence(output_index);
-        if (fence) {
-          fence->AfterUsedAsOutput(queue_id);
-        }
+    for (int output_index = 0; output_index < op_kernel_context.OutputCount(); ++output_index) {
+      Fence_t fence = op_kernel_context.OutputFence(output_index);
+      if (fence) {
+        fence->AfterUsedAsOutput(queue_id);
       }
     }
-    if (f_profiler_enabled) {
-      session_state.Profiler().EndTimeAndRecordEvent(profiling::NODE_EVENT,
-                                                     node.Name() + "_fence_after",
-                                                     sync_time_begin,
-                                                     {{"op_name", p_op_kernel->KernelDef().OpName()}});
-    }
+  }
+  if (f_profiler_enabled) {
+    session_state.Profiler().EndTimeAndRecordEvent(profiling::NODE_EVENT,
+                                                   node.Name() + "_fence_after",
+                                                   sync_time_begin,
+                                                   {{"op_name", p_op_kernel->KernelDef().OpName()}});
+  }
+
+  return status;
+}
+
+Status ParallelExecutor::RunNodeAsync(size_t p_node_index,
+                                      const SessionState& session_state,
+                                      const logging::Logger& logger) {
+  LOGS(logger, INFO) << "Begin execution";
+
+  Status status = Status::OK();
+
+  size_t node_index = p_node_index;
+  bool keep_running = true;
+  const auto& graph_viewer = session_state.GetGraphViewer();
 
-    //std::cout << "Run async node finish: " << p_node_index << std::endl;
+  // Avoid context switching if possible.
+  while (keep_running) {
+    status = RunNode(node_index, session_state, logger);
+    if (!status.IsOK()) {
+      break;
+    }
 
+    const auto& node = *graph_viewer.GetNode(node_index);
     keep_running = false;
 
     // Checking which output nodes ready for running.
@@ -294,29 +463,151 @@ void ParallelExecutor::EnqueueNode(size_t p_node_index, const SessionState& sess
   }
 
   onnxruntime::concurrency::ThreadPool::Schedule(executor_pool_, [this, p_node_index, &session_state, &logger]() {
-    auto create_exception_message = [p_node_index, &session_state](const std::exception* ex) {
-      const auto* node = session_state.GetGraphViewer().GetNode(p_node_index);
-
-      return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Exception running nodes starting at ", node->OpType(),
-                             " node '", node->Name(), "'. ",
-                             ex ? ex->what() : "Unknown exception was caught by catch-all handler.");
-    };
-
+    RunPlacement::Scope placement_scope(run_placement_);
     Status status;
     ORT_TRY {
       status = ParallelExecutor::RunNodeAsync(p_node_index, std::cref(session_state), std::cref(logger));
     }
     ORT_CATCH(const std::exception& ex) {
       ORT_HANDLE_EXCEPTION([&]() {
-        status = create_exception_message(&ex);
+        status = CreateNodeExceptionStatus(p_node_index, session_state, &ex);
       });
     }
     ORT_CATCH(...) {
       // catch node processing failure exceptions here to prevent app crash.
-      status = create_exception_message(nullptr);
+      status = CreateNodeExceptionStatus(p_node_index, session_state, nullptr);
     }
 
     FinishNodeRun(status);
   });
 }
+
+void ParallelExecutor::RunWorkStealing(const SessionState& session_state, const logging::Logger& logger) {
+  const auto& exec_plan = *session_state.GetExecutionPlan();
+  const auto& root_nodes = exec_plan.node_dependencies.root_nodes;
+  if (root_nodes.empty()) {
+    return;
+  }
+
+  // one helper per inter-op thread, but no more helpers than nodes besides the one the calling thread starts with
+  const size_t num_helpers = std::min<size_t>(concurrency::ThreadPool::NumThreads(executor_pool_),
+                                              exec_plan.execution_plan.size() - 1);
+  const size_t num_workers = num_helpers + 1;
+  auto run = std::make_shared<WorkStealingRun>(*this, session_state, logger, num_workers);
+
+  // root_nodes are ordered by critical path. Deal them out to the workers, which are not running yet, so that
+  // each one starts with the most critical of its roots. Workers pop the most recently pushed node.
+  run->outstanding.store(static_cast<int64_t>(root_nodes.size()), std::memory_order_relaxed);
+  for (size_t i = root_nodes.size(); i-- > 0;) {
+    run->deques[i % num_workers]->Push(root_nodes[i]);
+  }
+
+  for (size_t worker = 1; worker < num_workers; ++worker) {
+    concurrency::ThreadPool::Schedule(executor_pool_, [run, worker, placement = run_placement_]() {
+      RunPlacement::Scope placement_scope(placement);
+      WorkStealingLoop(run, worker);
+    });
+  }
+
+  WorkStealingLoop(run, 0);
+}
+
+void ParallelExecutor::WorkStealingLoop(const std::shared_ptr<WorkStealingRun>& run_ptr, size_t worker) {
+  WorkStealingRun& run = *run_ptr;
+  const size_t num_workers = run.deques.size();
+  NodeDeque& own_queue = *run.deques[worker];
+  int idle_count = 0;
+
+  while (run.outstanding.load(std::memory_order_acquire) > 0) {
+    NodeIndex node_index;
+    bool found = own_queue.Pop(node_index);
+    for (size_t i = 1; !found && i < num_workers; ++i) {
+      found = run.deques[(worker + i) % num_workers]->Steal(node_index);
+    }
+
+    if (found) {
+      idle_count = 0;
+      RunNodeChain(run, worker, node_index);
+      continue;
+    }
+
+    if (++idle_count < kIdleSpinCount) {
+      concurrency::SpinPause();
+      continue;
+    }
+
+    // nothing to do for a while, e.g. while a long running node is the only one ready
+    std::unique_lock<OrtMutex> lock(run.idle_mutex);
+    run.num_idle.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!run.AnyQueued() && run.outstanding.load(std::memory_order_relaxed) > 0) {
+      run.idle_cv.wait(lock);
+    }
+    run.num_idle.fetch_sub(1, std::memory_order_relaxed);
+    idle_count = 0;
+  }
+}
+
+void ParallelExecutor::RunNodeChain(WorkStealingRun& run, size_t worker, NodeIndex node_index) {
+  const auto& dependencies = run.dependencies;
+  NodeDeque& own_queue = *run.deques[worker];
+
+  while (true) {
+    if (!run.failed.load(std::memory_order_relaxed)) {
+      Status status;
+      ORT_TRY {
+        status = run.executor.RunNode(node_index, run.session_state, run.logger);
+      }
+      ORT_CATCH(const std::exception& ex) {
+        ORT_HANDLE_EXCEPTION([&]() {
+          status = CreateNodeExceptionStatus(node_index, run.session_state, &ex);
+        });
+      }
+      ORT_CATCH(...) {
+        // catch node processing failure exceptions here to prevent app crash.
+        status = CreateNodeExceptionStatus(node_index, run.session_state, nullptr);
+      }
+
+      if (!status.IsOK()) {
+        run.executor.RecordError(status);
+        run.failed.store(true, std::memory_order_relaxed);
+      }
+    }
+
+    // the last producer to finish makes a node ready. acq_rel publishes the outputs of all producers to it.
+    // Successors are ordered by critical path. Visiting them in reverse keeps the most critical ready one for
+    // this thread and queues the others from the least critical up, so the next Pop takes the most critical.
+    bool has_next = false;
+    NodeIndex next_node_index = 0;
+    if (!run.failed.load(std::memory_order_relaxed)) {
+      for (size_t i = dependencies.successor_offsets[node_index + 1], begin = dependencies.successor_offsets[node_index];
+           i-- > begin;) {
+        const NodeIndex successor = dependencies.successors[i];
+        if (run.pending_dependencies[successor].fetch_sub(1, std::memory_order_acq_rel) != 1) {
+          continue;
+        }
+
+        if (has_next) {
+          run.outstanding.fetch_add(1, std::memory_order_relaxed);
+          own_queue.Push(next_node_index);
+          run.WakeIdleWorkers(false);
+        }
+
+        next_node_index = successor;
+        has_next = true;
+      }
+    }
+
+    if (!has_next) {
+      break;
+    }
+
+    // continue with the successor on this thread, it stays counted in outstanding
+    node_index = next_node_index;
+  }
+
+  if (run.outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    run.WakeIdleWorkers(true);
+  }
+}
 }  // namespace onnxruntime
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include "core/common/common.h"
 #include "core/common/status.h"
@@ -17,6 +18,7 @@
 namespace onnxruntime {
 
 class ExecutionFrame;
+struct RunPlacement;
 
 class ParallelExecutor : public IExecutor {
  public:
@@ -31,6 +33,29 @@ class ParallelExecutor : public IExecutor {
  private:
   ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(ParallelExecutor);
 
+  // State of one work stealing Execute, shared with the inter-op threads helping with it.
+  struct WorkStealingRun;
+
+  // Runs a single node, including the fences around it. Throws if the terminate flag is set.
+  Status RunNode(NodeIndex node_index, const SessionState& session_state, const logging::Logger& logger);
+
+  // Runs the graph with the calling thread and up to one task per inter-op thread taking ready nodes from
+  // each other's queues. Errors are collected in errors_.
+  void RunWorkStealing(const SessionState& session_state, const logging::Logger& logger);
+
+  // Takes nodes from the worker's own queue or steals them from the others until the run is over.
+  // Helpers may start after Execute has returned, so this must not touch the executor unless it got a node.
+  static void WorkStealingLoop(const std::shared_ptr<WorkStealingRun>& run, size_t worker);
+
+  // Runs node_index and then, as long as it made any ready, its successor with the longest critical path.
+  // The other ready successors go to the worker's queue.
+  static void RunNodeChain(WorkStealingRun& run, size_t worker, NodeIndex node_index);
+
+  void RecordError(const Status& status) {
+    std::lock_guard<OrtMutex> lock(complete_mutex_);
+    errors_.push_back(status);
+  }
+
   Status RunNodeAsync(size_t p_node_index, const SessionState& session_state, const logging::Logger& logger);
 
   void EnqueueNode(size_t p_node_index, const SessionState& session_state, const logging::Logger& logger);
@@ -59,6 +84,12 @@ class ParallelExecutor : public IExecutor {
   OrtCondVar complete_cv_;
   std::vector<Status> errors_;
 
+  // schedule with work stealing on the node dependencies of the execution plan instead of node_refs_
+  const bool use_work_stealing_;
+
+  // placement of the Run on the thread that created the executor, applied to the inter-op threads helping with it
+  const RunPlacement* const run_placement_;
+
   const bool& terminate_flag_;
   // TODO: Temporary threadpool for the executor.  This is a costly way to handle the problem.
   onnxruntime::concurrency::ThreadPool* const executor_pool_{};
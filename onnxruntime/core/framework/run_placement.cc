@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/run_placement.h"
+
+#include "core/platform/env.h"
+
+namespace onnxruntime {
+
+namespace {
+thread_local const RunPlacement* current_run_placement = nullptr;
+}  // namespace
+
+const RunPlacement* RunPlacement::Current() {
+  return current_run_placement;
+}
+
+concurrency::ThreadPool* RunPlacement::GetThreadPool(concurrency::ThreadPool* session_thread_pool) {
+  const RunPlacement* placement = current_run_placement;
+  if (placement != nullptr && placement->thread_pool != nullptr && session_thread_pool != nullptr &&
+      placement->session_thread_pool == session_thread_pool) {
+    return placement->thread_pool;
+  }
+
+  return session_thread_pool;
+}
+
+AllocatorPtr RunPlacement::GetAllocator(const concurrency::ThreadPool* session_thread_pool,
+                                        const OrtMemoryInfo& info) {
+  const RunPlacement* placement = current_run_placement;
+  if (placement != nullptr && placement->cpu_allocator && session_thread_pool != nullptr &&
+      placement->session_thread_pool == session_thread_pool && placement->cpu_allocator->Info() == info) {
+    return placement->cpu_allocator;
+  }
+
+  return nullptr;
+}
+
+RunPlacement::Scope::Scope(const RunPlacement* placement) : previous_(current_run_placement) {
+  current_run_placement = placement;
+}
+
+RunPlacement::Scope::~Scope() {
+  current_run_placement = previous_;
+}
+
+void* NumaNodeCPUAllocator::Alloc(size_t size) {
+  void* p = CPUAllocator::Alloc(size);
+  if (p != nullptr) {
+    // best effort, the memory is usable wherever it ends up
+    Env::Default().BindMemoryToNumaNode(p, size, numa_node_);
+  }
+  return p;
+}
+
+}  // namespace onnxruntime
@@ -0,0 +1,63 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "core/common/common.h"
+#include "core/framework/allocator.h"
+#include "core/platform/threadpool.h"
+
+namespace onnxruntime {
+
+/**
+ * The intra-op thread pool and CPU allocator a Run uses in place of the ones of its session, e.g. those of the
+ * NUMA node the Run is assigned to.
+ *
+ * InferenceSession makes the placement current on the thread calling Run, and the parallel executor on the
+ * inter-op threads working on that Run. Kernels pick it up through OpKernelContextInternal and ExecutionFrame.
+ * The subgraph sessions share the thread pool of the main one, so the placement applies to them as well.
+ */
+struct RunPlacement {
+  // intra-op thread pool of the session the placement is for
+  const concurrency::ThreadPool* session_thread_pool = nullptr;
+  concurrency::ThreadPool* thread_pool = nullptr;
+  // replaces the allocator of the session with the same OrtMemoryInfo, nullptr to keep it
+  AllocatorPtr cpu_allocator;
+
+  // The placement the calling thread runs with, or nullptr.
+  static const RunPlacement* Current();
+
+  // Returns the thread pool the calling thread should use in place of session_thread_pool.
+  static concurrency::ThreadPool* GetThreadPool(concurrency::ThreadPool* session_thread_pool);
+
+  // Returns the allocator the calling thread should use for info in a session with session_thread_pool,
+  // or nullptr if the session's allocator should be used.
+  static AllocatorPtr GetAllocator(const concurrency::ThreadPool* session_thread_pool, const OrtMemoryInfo& info);
+
+  // Makes a placement current on the calling thread for the lifetime of the scope. nullptr clears it.
+  class Scope {
+   public:
+    explicit Scope(const RunPlacement* placement);
+    ~Scope();
+    ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(Scope);
+
+   private:
+    const RunPlacement* const previous_;
+  };
+};
+
+/**
+ * CPU allocator that asks the OS to place its memory on one NUMA node. The placement takes effect when the pages
+ * are first touched, which makes it a good fit for an arena that is extended by the Runs on that node.
+ */
+class NumaNodeCPUAllocator : public CPUAllocator {
+ public:
+  explicit NumaNodeCPUAllocator(int numa_node) : numa_node_(numa_node) {}
+
+  void* Alloc(size_t size) override;
+
+ private:
+  const int numa_node_;
+};
+
+}  // namespace onnxruntime
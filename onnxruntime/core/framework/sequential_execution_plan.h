@@ -118,6 +118,27 @@ struct SequentialExecutionPlan : public ExecutionPlanBase {
   // to_be_freed: vector elements represent indices of ml-values to be freed (as described above)
   std::vector<OrtValueIndex> to_be_freed;
 
+  // NodeDependencies: the node graph in a form the work stealing parallel executor can use without locking.
+  // Vectors are indexed by node index. Only populated when planning for parallel execution.
+  struct NodeDependencies {
+    // number of distinct nodes in the plan that produce an input of the node
+    std::vector<int> dependency_counts;
+
+    // the distinct consumers of node n are successors[successor_offsets[n] .. successor_offsets[n + 1]),
+    // longest critical path first
+    std::vector<size_t> successor_offsets;
+    std::vector<onnxruntime::NodeIndex> successors;
+
+    // nodes with no dependencies, longest critical path first
+    std::vector<onnxruntime::NodeIndex> root_nodes;
+
+    // cost of the node plus the most expensive path from it to a graph output.
+    // See SequentialPlanner::ComputeCriticalPathCosts.
+    std::vector<double> critical_path_costs;
+  };
+
+  NodeDependencies node_dependencies;
+
   const OrtMemoryInfo& GetLocation(size_t ort_value_index) const override {
     return allocation_plan[ort_value_index].location;
   }
@@ -145,6 +145,16 @@ static Status ReleaseNodeMLValues(ExecutionFrame& frame,
                                   const SequentialExecutionPlan::NodeExecutionPlan& node_exec_plan,
                                   const logging::Logger& logger);
 
+// Stops the perf counting started for a Run on every way out of Execute, including error returns.
+struct PerfRunGuard {
+  PerfProfiler* perf = nullptr;
+  ~PerfRunGuard() {
+    if (perf != nullptr) {
+      perf->StopRun();
+    }
+  }
+};
+
 Status SequentialExecutor::Execute(const SessionState& session_state, const std::vector<int>& feed_mlvalue_idxs,
                                    const std::vector<OrtValue>& feeds, const std::vector<int>& fetch_mlvalue_idxs,
                                    std::vector<OrtValue>& fetches,
@@ -161,14 +171,33 @@ Status SequentialExecutor::Execute(const SessionState& session_state, const std:
   std::string output_type_shape{};
   bool is_perf_profiler_enabled = session_state.Profiler().IsPerfEnabled();
   PerfProfiler* myperf = session_state.Profiler().GetPerfProfiler();
+  // counter values at kernel start and, after the kernel, the per node deltas. Sized once per Run.
+  std::vector<uint64_t> perf_begin_values;
+  std::vector<uint64_t> perf_node_values;
+  // false when a read around the node failed, the node event then gets no counter values
+  bool perf_node_values_valid = false;
+  PerfRunGuard perf_run_guard;
+  profiling::SamplingProfiler* sampling_profiler =
+      is_profiler_enabled ? session_state.Profiler().GetSamplingProfiler() : nullptr;
 
   // printf("DEBUG: IN SEQ EXECUTOR. profiler en: %d, perf en: %d\n", is_profiler_enabled, is_perf_profiler_enabled);
 
   if (is_profiler_enabled) {
     tp = session_state.Profiler().Start();
 
-    if (is_perf_profiler_enabled)
-      myperf->Initialize();
+    // count on the intra-op workers too, kernels using TryParallelFor do most of their work there
+    if (is_perf_profiler_enabled) {
+      myperf->Initialize(concurrency::ThreadPool::GetWorkerThreadIds(session_state.GetThreadPool()));
+      session_state.Profiler().PreparePerfRecords();
+      perf_begin_values.resize(myperf->NumValues());
+      perf_node_values.resize(myperf->NumValues());
+      myperf->StartRun();
+      perf_run_guard.perf = myperf;
+    }
+
+    if (sampling_profiler != nullptr) {
+      sampling_profiler->Start(concurrency::ThreadPool::GetWorkerThreadIds(session_state.GetThreadPool()));
+    }
   }
 
   ExecutionFrame frame{feed_mlvalue_idxs, feeds, fetch_mlvalue_idxs, fetches, fetch_allocators, session_state};
@@ -330,19 +359,24 @@ Status SequentialExecutor::Execute(const SessionState& session_state, const std:
 
       kernel_begin_time = session_state.Profiler().Start();
 
-      if (is_perf_profiler_enabled) {
-        myperf->Reset();
-        myperf->Enable();
-      }
-
-
       // Calculate total input sizes for this operation.
       CalculateTotalInputSizes(&op_kernel_context, p_op_kernel,
                                input_activation_sizes, input_parameter_sizes,
                                node_name_for_profiling, input_type_shape);
+
+      // read last so the profiling bookkeeping above is not counted against the node
+      if (is_perf_profiler_enabled) {
+        perf_node_values_valid = myperf->ReadValues(perf_begin_values.data());
+      }
     }
 
     Status compute_status;
+    // the node a control flow parent is running, restored when this node is done
+    int sampled_parent_node_index = -1;
+    if (sampling_profiler != nullptr) {
+      sampled_parent_node_index = profiling::SamplingProfiler::GetCurrentNode();
+      profiling::SamplingProfiler::SetCurrentNode(static_cast<int>(node_index));
+    }
     {
 #ifdef CONCURRENCY_VISUALIZER
       diagnostic::span span(series, "%s.%d", node.OpType().c_str(), node.Index());
@@ -367,6 +401,10 @@ Status SequentialExecutor::Execute(const SessionState& session_state, const std:
         });
       }
 
+      if (sampling_profiler != nullptr) {
+        profiling::SamplingProfiler::SetCurrentNode(sampled_parent_node_index);
+      }
+
 #ifdef ENABLE_NVTX_PROFILE
       node_compute_range.End();
 #endif
@@ -387,6 +425,15 @@ Status SequentialExecutor::Execute(const SessionState& session_state, const std:
     }
 
     if (is_profiler_enabled) {
+      if (is_perf_profiler_enabled) {
+        perf_node_values_valid = myperf->ReadValues(perf_node_values.data()) && perf_node_values_valid;
+        if (perf_node_values_valid) {
+          for (size_t i = 0; i < perf_node_values.size(); i++) {
+            perf_node_values[i] -= perf_begin_values[i];
+          }
+        }
+      }
+
       // Calculate total output sizes for this operation.
       CalculateTotalOutputSizes(&op_kernel_context, total_output_sizes, node_name_for_profiling, output_type_shape);
 
@@ -403,23 +450,6 @@ Status SequentialExecutor::Execute(const SessionState& session_state, const std:
                 << "\n";
 #endif
 
-      std::map<std::string, uint64_t> perf_results;
-      if (is_perf_profiler_enabled) {
-        myperf->Disable();
-        perf_results = myperf->Read();
-      }
-
-
-      // Log additional operation args / info.
-      std::list<std::pair<std::string, std::string>> args;
-
-      for (const auto& kv : perf_results) {
-        std::pair<std::string, std::string> new_pair;
-        new_pair.first = kv.first;
-        new_pair.second = std::to_string(kv.second);
-        args.emplace_back(new_pair);
-      }
-
 
       session_state.Profiler().EndTimeAndRecordEvent(profiling::NODE_EVENT,
                                                      node_name_for_profiling + "_kernel_time",
@@ -437,7 +467,7 @@ Status SequentialExecutor::Execute(const SessionState& session_state, const std:
                                                          {"output_type_shape", output_type_shape},
                                                          {"thread_scheduling_stats", concurrency::ThreadPool::StopProfiling(session_state.GetThreadPool())},
                                                      },
-                                                     (std::list<std::pair<std::string, std::string>>)args,
+                                                     is_perf_profiler_enabled && perf_node_values_valid ? perf_node_values.data() : nullptr,
                                                      false);
       sync_time_begin = session_state.Profiler().Start();
     }
@@ -3,10 +3,12 @@
 
 #include "core/framework/session_state.h"
 
+#include <algorithm>
 #include <sstream>
 
 #include "core/platform/ort_mutex.h"
 #include "core/common/logging/logging.h"
+#include "core/common/parse_string.h"
 #include "core/common/safeint.h"
 #include "core/flatbuffers/schema/ort.fbs.h"
 #include "core/framework/allocator.h"
@@ -425,12 +427,53 @@ Status SessionState::PrepackConstantInitializedTensors(std::unordered_map<std::s
   }
 }
 
-static int64_t CalculateMemoryPatternsKey(const gsl::span<const OrtValue>& tensor_inputs) {
-  int64_t key = 0;
+// Collects the dims of all inputs into input_dims and returns the key of the bucket they fall in.
+// bucket_granularity 0 makes each shape a bucket of its own.
+static int64_t CalculateMemoryPatternsKey(const gsl::span<const OrtValue>& tensor_inputs, int64_t bucket_granularity,
+                                          std::vector<int64_t>& input_dims) {
+  uint64_t key = 0;
+  auto add_to_key = [&key](int64_t value) {
+    key = key * 1000003 + static_cast<uint64_t>(value);
+  };
+
+  input_dims.clear();
   for (const auto& input : tensor_inputs) {
-    for (auto dim : input.Get<Tensor>().Shape().GetDims()) key ^= dim;
+    const auto dims = input.Get<Tensor>().Shape().GetDims();
+    add_to_key(static_cast<int64_t>(dims.size()));
+    for (size_t i = 0; i < dims.size(); ++i) {
+      input_dims.push_back(dims[i]);
+      int64_t bucket_dim = dims[i];
+      if (bucket_granularity > 0 && bucket_dim > 0) {
+        if (i == 0) {
+          // usually the batch size
+          bucket_dim = 1;
+          while (bucket_dim < dims[i]) {
+            bucket_dim *= 2;
+          }
+        } else {
+          bucket_dim = (bucket_dim + bucket_granularity - 1) / bucket_granularity * bucket_granularity;
+        }
+      }
+      add_to_key(bucket_dim);
+    }
+  }
+
+  return static_cast<int64_t>(key);
+}
+
+// Whether a pattern generated for inputs with planned_dims has blocks that are large enough for inputs with dims.
+static bool MemoryPatternCoversInputDims(const std::vector<int64_t>& planned_dims, const std::vector<int64_t>& dims) {
+  if (planned_dims.size() != dims.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < dims.size(); ++i) {
+    if (dims[i] > planned_dims[i]) {
+      return false;
+    }
   }
-  return key;
+
+  return true;
 }
 
 #ifdef ENABLE_TRAINING
@@ -652,22 +695,23 @@ Status SessionState::GeneratePatternGroupCache(const gsl::span<const OrtValue>&
 }
 #endif
 
-const MemoryPatternGroup* SessionState::GetMemoryPatternGroup(const gsl::span<const OrtValue>& tensor_inputs,
-                                                              const std::vector<int>& feed_mlvalue_idxs,
-                                                              std::unordered_map<int, TensorShape>& inferred_shapes) const {
-  int64_t key = CalculateMemoryPatternsKey(tensor_inputs);
+std::shared_ptr<const MemoryPatternGroup> SessionState::GetMemoryPatternGroup(
+    const gsl::span<const OrtValue>& tensor_inputs,
+    const std::vector<int>& feed_mlvalue_idxs,
+    std::unordered_map<int, TensorShape>& inferred_shapes) const {
+  std::vector<int64_t> input_dims;
+  int64_t key = CalculateMemoryPatternsKey(tensor_inputs, mem_pattern_bucket_granularity_, input_dims);
 
   std::lock_guard<OrtMutex> lock(mem_patterns_lock_);
   auto it = mem_patterns_.find(key);
-  if (it == mem_patterns_.end()) {
+  if (it == mem_patterns_.end() || !MemoryPatternCoversInputDims(it->second.input_dims, input_dims)) {
+    ++mem_pattern_cache_stats_.misses;
 #ifdef ENABLE_TRAINING
     auto mem_patterns = std::make_unique<MemoryPatternGroup>();
     if (GeneratePatternGroupCache(tensor_inputs, feed_mlvalue_idxs, mem_patterns.get(), inferred_shapes).IsOK()) {
-      key = CalculateMemoryPatternsKey(tensor_inputs);
-      auto ptr = mem_patterns.get();
-      mem_patterns_[key] = std::move(mem_patterns);
-      shape_patterns_[key] = inferred_shapes;
-      return ptr;
+      auto& entry = InsertMemoryPatternGroup(key, std::move(input_dims), std::move(mem_patterns));
+      entry.inferred_shapes = inferred_shapes;
+      return entry.mem_patterns;
     }
     return nullptr;
 #else
@@ -676,8 +720,45 @@ const MemoryPatternGroup* SessionState::GetMemoryPatternGroup(const gsl::span<co
 #endif
   }
 
-  inferred_shapes = shape_patterns_[key];
-  return it->second.get();
+  ++mem_pattern_cache_stats_.hits;
+  auto& entry = it->second;
+  mem_patterns_lru_.splice(mem_patterns_lru_.begin(), mem_patterns_lru_, entry.lru_position);
+  // the inferred shapes are only valid for the exact shapes the pattern was generated for
+  if (entry.input_dims == input_dims) {
+    inferred_shapes = entry.inferred_shapes;
+  }
+  return entry.mem_patterns;
+}
+
+SessionState::MemoryPatternCacheEntry& SessionState::InsertMemoryPatternGroup(
+    int64_t key, std::vector<int64_t> input_dims, std::unique_ptr<MemoryPatternGroup> mem_patterns) const {
+  auto it = mem_patterns_.find(key);
+  if (it != mem_patterns_.end()) {
+    ++mem_pattern_cache_stats_.replacements;
+    mem_patterns_lru_.splice(mem_patterns_lru_.begin(), mem_patterns_lru_, it->second.lru_position);
+  } else {
+    if (max_cached_mem_patterns_ > 0 && mem_patterns_.size() >= max_cached_mem_patterns_) {
+      // frames that still use the evicted pattern hold a reference to it
+      ++mem_pattern_cache_stats_.evictions;
+      mem_patterns_.erase(mem_patterns_lru_.back());
+      mem_patterns_lru_.pop_back();
+    }
+
+    mem_patterns_lru_.push_front(key);
+    it = mem_patterns_.emplace(key, MemoryPatternCacheEntry{}).first;
+    it->second.lru_position = mem_patterns_lru_.begin();
+  }
+
+  auto& entry = it->second;
+  entry.mem_patterns = std::move(mem_patterns);
+  entry.inferred_shapes.clear();
+  entry.input_dims = std::move(input_dims);
+  return entry;
+}
+
+SessionState::MemoryPatternCacheStats SessionState::GetMemoryPatternCacheStats() const {
+  std::lock_guard<OrtMutex> lock(mem_patterns_lock_);
+  return mem_pattern_cache_stats_;
 }
 
 void SessionState::ResolveMemoryPatternFlag() {
@@ -706,17 +787,75 @@ void SessionState::ResolveMemoryPatternFlag() {
 
 Status SessionState::UpdateMemoryPatternGroupCache(const gsl::span<const OrtValue>& tensor_inputs,
                                                    std::unique_ptr<MemoryPatternGroup> mem_patterns) const {
-  int64_t key = CalculateMemoryPatternsKey(tensor_inputs);
+  std::vector<int64_t> input_dims;
+  int64_t key = CalculateMemoryPatternsKey(tensor_inputs, mem_pattern_bucket_granularity_, input_dims);
 
   std::lock_guard<OrtMutex> lock(mem_patterns_lock_);
   auto it = mem_patterns_.find(key);
-  if (it == mem_patterns_.end()) {
-    mem_patterns_[key] = std::move(mem_patterns);
+  // keep the existing pattern if it covers these shapes, e.g. if another Run added it in the meantime
+  if (it == mem_patterns_.end() || !MemoryPatternCoversInputDims(it->second.input_dims, input_dims)) {
+    InsertMemoryPatternGroup(key, std::move(input_dims), std::move(mem_patterns));
   }
 
   return Status::OK();
 }
 
+std::vector<std::pair<OrtMemoryInfo, size_t>> SessionState::GetRunArenaSizes() const {
+  std::lock_guard<OrtMutex> lock(run_arena_sizes_lock_);
+  return {run_arena_sizes_.begin(), run_arena_sizes_.end()};
+}
+
+void SessionState::UpdateRunArenaSize(const OrtMemoryInfo& location, size_t bytes) const {
+  std::lock_guard<OrtMutex> lock(run_arena_sizes_lock_);
+  auto it = run_arena_sizes_.find(location);
+  if (it != run_arena_sizes_.end()) {
+    it->second = std::max(it->second, std::min(bytes, run_arena_max_bytes_));
+  }
+}
+
+bool SessionState::TakeCachedFrameBuffers(const gsl::span<const OrtValue>& tensor_inputs,
+                                          CachedFrameBuffers& frame_buffers) const {
+  frame_buffers.input_dims.clear();
+  for (const auto& input : tensor_inputs) {
+    const auto dims = input.Get<Tensor>().Shape().GetDims();
+    // the rank too, so that inputs of other ranks with the same dims in total don't match
+    frame_buffers.input_dims.push_back(static_cast<int64_t>(dims.size()));
+    frame_buffers.input_dims.insert(frame_buffers.input_dims.end(), dims.begin(), dims.end());
+  }
+
+  std::lock_guard<OrtMutex> lock(cached_frame_buffers_lock_);
+  auto it = std::find_if(cached_frame_buffers_.begin(), cached_frame_buffers_.end(),
+                         [&frame_buffers](const CachedFrameBuffers& entry) {
+                           return entry.input_dims == frame_buffers.input_dims;
+                         });
+  if (it == cached_frame_buffers_.end()) {
+    return false;
+  }
+
+  frame_buffers = std::move(*it);
+  cached_frame_buffers_.erase(it);
+  return true;
+}
+
+void SessionState::CacheFrameBuffers(CachedFrameBuffers frame_buffers) const {
+  if (max_cached_frame_buffers_ == 0) {
+    return;
+  }
+
+  std::lock_guard<OrtMutex> lock(cached_frame_buffers_lock_);
+  // another frame with the same input shapes may have finished first, keep its buffers
+  for (const auto& entry : cached_frame_buffers_) {
+    if (entry.input_dims == frame_buffers.input_dims) {
+      return;
+    }
+  }
+
+  if (cached_frame_buffers_.size() >= max_cached_frame_buffers_) {
+    cached_frame_buffers_.erase(cached_frame_buffers_.begin());
+  }
+  cached_frame_buffers_.push_back(std::move(frame_buffers));
+}
+
 bool SessionState::GetEnableMemoryPattern() const { return enable_mem_pattern_; }
 
 bool SessionState::GetEnableMemoryReuse() const { return enable_mem_reuse_; }
@@ -1388,6 +1527,44 @@ Status SessionState::FinalizeSessionStateImpl(const std::basic_string<PATH_CHAR_
                                                     subgraphs_kernel_create_info_maps,
                                                     outer_scope_node_arg_to_location_map,
                                                     ort_value_name_idx_map_, context, p_seq_exec_plan_));
+  // the node dependencies the work stealing executor needs are only planned for parallel execution
+  use_work_stealing_executor_ =
+      session_options.execution_mode == ExecutionMode::ORT_PARALLEL &&
+      session_options.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigInterOpWorkStealing, "0") == "1";
+  if (use_work_stealing_executor_) {
+    SequentialPlanner::ComputeCriticalPathCosts(*graph_viewer_, measured_node_costs_, *p_seq_exec_plan_);
+  }
+
+  const std::string bucket_granularity =
+      session_options.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigMemPatternBucketGranularity, "0");
+  ORT_RETURN_IF_NOT(TryParseStringWithClassicLocale(bucket_granularity, mem_pattern_bucket_granularity_) &&
+                        mem_pattern_bucket_granularity_ >= 0,
+                    "Invalid value for ", kOrtSessionOptionsConfigMemPatternBucketGranularity, ": ",
+                    bucket_granularity);
+  const std::string max_cached_mem_patterns =
+      session_options.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigMemPatternMaxCached, "0");
+  ORT_RETURN_IF_NOT(TryParseStringWithClassicLocale(max_cached_mem_patterns, max_cached_mem_patterns_),
+                    "Invalid value for ", kOrtSessionOptionsConfigMemPatternMaxCached, ": ", max_cached_mem_patterns);
+
+  const std::string run_arena_max_bytes =
+      session_options.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigRunArenaMaxBytes, "0");
+  ORT_RETURN_IF_NOT(TryParseStringWithClassicLocale(run_arena_max_bytes, run_arena_max_bytes_),
+                    "Invalid value for ", kOrtSessionOptionsConfigRunArenaMaxBytes, ": ", run_arena_max_bytes);
+  // cached buffers stay allocated between Runs, so caching is opt-in
+  const std::string max_cached_frame_buffers =
+      session_options.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigMaxCachedFrameBuffers, "0");
+  ORT_RETURN_IF_NOT(TryParseStringWithClassicLocale(max_cached_frame_buffers, max_cached_frame_buffers_),
+                    "Invalid value for ", kOrtSessionOptionsConfigMaxCachedFrameBuffers, ": ",
+                    max_cached_frame_buffers);
+
+  if (run_arena_max_bytes_ > 0) {
+    // the arenas start empty, the first Run only measures how much they need
+    for (const auto& alloc_plan : p_seq_exec_plan_->allocation_plan) {
+      if (alloc_plan.alloc_kind == AllocKind::kAllocate) {
+        run_arena_sizes_.emplace(alloc_plan.location, 0);
+      }
+    }
+  }
   // Record the allocation plan
 
   // Uncomment the below to dump the allocation plan to std::cout
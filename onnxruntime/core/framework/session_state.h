@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <list>
 #include <memory>
 #include <map>
 #include <unordered_map>
@@ -206,22 +207,84 @@ class SessionState {
   /**
   Get cached memory pattern based on input shapes
   Must be called only when all values contain tensors
+  The pattern may have been generated for larger input shapes of the same bucket, so its blocks can be larger
+  than the tensors that are placed in them.
   */
-  const MemoryPatternGroup* GetMemoryPatternGroup(
+  std::shared_ptr<const MemoryPatternGroup> GetMemoryPatternGroup(
       const gsl::span<const OrtValue>& tensor_inputs,
       const std::vector<int>& feed_mlvalue_idxs,
       std::unordered_map<int, TensorShape>& inferred_shapes) const;
 
   /**
   Set generated memory pattern with a given input shapes.
+  Replaces the pattern of the bucket the input shapes fall in if it was generated for shapes that don't cover them.
   Const as it's an internal cache update only.
   All inputs must represent Tensors
   */
   Status UpdateMemoryPatternGroupCache(const gsl::span<const OrtValue>& tensor_inputs,
                                        std::unique_ptr<MemoryPatternGroup> mem_patterns) const;
 
+  struct MemoryPatternCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    // patterns replaced by one generated for larger shapes of the same bucket
+    size_t replacements = 0;
+    size_t evictions = 0;
+  };
+
+  MemoryPatternCacheStats GetMemoryPatternCacheStats() const;
+
   bool GetUseDeterministicCompute() const { return use_deterministic_compute_; }
 
+  // Whether the parallel executor should schedule nodes with work stealing. Set by FinalizeSessionState.
+  bool GetUseWorkStealingExecutor() const { return use_work_stealing_executor_; }
+
+  // Node costs by node name, e.g. kernel times from an earlier profiling run. FinalizeSessionState uses them to
+  // compute the critical paths for parallel execution instead of estimating the costs.
+  void SetMeasuredNodeCosts(std::unordered_map<std::string, double> node_costs) {
+    measured_node_costs_ = std::move(node_costs);
+  }
+
+  // Maximum size of the per Run activation arenas of ExecutionFrame, 0 if they are disabled.
+  size_t GetRunArenaMaxBytes() const { return run_arena_max_bytes_; }
+
+  // The memory locations activations are allocated on, each with the size its run arena should have.
+  std::vector<std::pair<OrtMemoryInfo, size_t>> GetRunArenaSizes() const;
+
+  // Records that a Run allocated `bytes` of activations from the run arena of `location`, or would have if the
+  // arena had been large enough. The next runs size the arena from the largest amount seen.
+  // Const as it's an internal cache update only.
+  void UpdateRunArenaSize(const OrtMemoryInfo& location, size_t bytes) const;
+
+  /**
+  Memory pattern and pattern buffers of an ExecutionFrame that finished, kept for the next frame with the same
+  input shapes so that it neither looks up the pattern nor allocates the buffers again. Control flow nodes execute
+  their subgraphs once per iteration, mostly with the input shapes of the previous iteration.
+  */
+  struct CachedFrameBuffers {
+    // dims of all inputs, in order
+    std::vector<int64_t> input_dims;
+    std::shared_ptr<const MemoryPatternGroup> mem_patterns;
+    std::unordered_map<int, TensorShape> inferred_shapes;
+    std::map<OrtMemoryInfo, BufferUniquePtr> buffers;
+  };
+
+  // Maximum number of CachedFrameBuffers kept, 0 if frames don't cache their buffers.
+  size_t GetMaxCachedFrameBuffers() const { return max_cached_frame_buffers_; }
+
+  /**
+  Moves the entry cached for exactly the input shapes of tensor_inputs into frame_buffers and returns true.
+  Otherwise only sets frame_buffers.input_dims and returns false.
+  The entry is removed from the cache, so the buffers are only used by one frame at a time.
+  All inputs must represent Tensors
+  */
+  bool TakeCachedFrameBuffers(const gsl::span<const OrtValue>& tensor_inputs,
+                              CachedFrameBuffers& frame_buffers) const;
+
+  // Caches the buffers of a frame, dropping the oldest entry if the cache is full.
+  // Const as it's an internal cache update only.
+  void CacheFrameBuffers(CachedFrameBuffers frame_buffers) const;
+
   /**
   Get enable memory pattern flag
   */
@@ -469,12 +532,40 @@ class SessionState {
   // switch for enable memory pattern optimization or not.
   bool enable_mem_pattern_;
 
+  struct MemoryPatternCacheEntry {
+    std::shared_ptr<const MemoryPatternGroup> mem_patterns;
+    std::unordered_map<int, TensorShape> inferred_shapes;
+    // dims of all inputs, in order, the pattern was generated for
+    std::vector<int64_t> input_dims;
+    std::list<int64_t>::iterator lru_position;
+  };
+
+  // Adds or replaces the pattern of a bucket, evicting the least recently used one if the cache is full.
+  // Called with mem_patterns_lock_ held.
+  MemoryPatternCacheEntry& InsertMemoryPatternGroup(int64_t key, std::vector<int64_t> input_dims,
+                                                    std::unique_ptr<MemoryPatternGroup> mem_patterns) const;
+
   // lock for the mem_patterns_
   mutable OrtMutex mem_patterns_lock_;
 
-  // cache for the generated mem_patterns. key is calculated based on input shapes.
-  mutable std::map<int64_t, std::unique_ptr<MemoryPatternGroup>> mem_patterns_;
-  mutable std::map<int64_t, std::unordered_map<int, TensorShape>> shape_patterns_;
+  // cache for the generated mem_patterns. key is calculated based on the bucketed input shapes.
+  mutable std::map<int64_t, MemoryPatternCacheEntry> mem_patterns_;
+  // keys of mem_patterns_, most recently used first
+  mutable std::list<int64_t> mem_patterns_lru_;
+  mutable MemoryPatternCacheStats mem_pattern_cache_stats_;
+  // see kOrtSessionOptionsConfigMemPatternBucketGranularity and kOrtSessionOptionsConfigMemPatternMaxCached
+  int64_t mem_pattern_bucket_granularity_ = 0;
+  size_t max_cached_mem_patterns_ = 0;
+
+  size_t run_arena_max_bytes_ = 0;
+  mutable OrtMutex run_arena_sizes_lock_;
+  mutable std::map<OrtMemoryInfo, size_t> run_arena_sizes_;
+
+  // see kOrtSessionOptionsConfigMaxCachedFrameBuffers
+  size_t max_cached_frame_buffers_ = 0;
+  mutable OrtMutex cached_frame_buffers_lock_;
+  // oldest first
+  mutable std::vector<CachedFrameBuffers> cached_frame_buffers_;
 
   NameNodeInfoMapType input_names_to_nodeinfo_mapping_;
   NameNodeInfoMapType output_names_to_nodeinfo_mapping_;
@@ -489,6 +580,8 @@ class SessionState {
 
   bool use_deterministic_compute_;
   bool enable_mem_reuse_;
+  bool use_work_stealing_executor_ = false;
+  std::unordered_map<std::string, double> measured_node_costs_;
   std::unique_ptr<NodeIndexInfo> node_index_info_;
   std::multimap<int, std::unique_ptr<FeedsFetchesManager>> cached_feeds_fetches_managers_;
 
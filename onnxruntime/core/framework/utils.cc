@@ -639,6 +639,37 @@ common::Status ExecuteGraph(const SessionState& session_state,
   return status;
 }
 
+common::Status ExecutePreparedGraph(const SessionState& session_state,
+                                    const FeedsFetchesManager& feeds_fetches_manager,
+                                    const std::vector<OrtValue>& feeds, std::vector<OrtValue>& fetches,
+                                    ExecutionMode execution_mode, const bool& terminate_flag,
+                                    const logging::Logger& logger, bool only_execute_path_to_fetches,
+                                    const std::vector<OrtDevice>* fetches_device_info) {
+  // no copies are needed whatever the feeds and fetches are, so the prepared manager can be used as is
+  if (feeds_fetches_manager.GetDeviceCopyChecks().status == DeviceCopyCheck::NoCopy) {
+    return ExecuteGraphImpl(session_state, feeds_fetches_manager, feeds, fetches, {},
+                            execution_mode, terminate_flag, logger, only_execute_path_to_fetches);
+  }
+
+  // finalize a copy of the static copy info with the locations of the feeds and fetches of this call
+  FeedsFetchesManager run_feeds_fetches_manager{FeedsFetchesInfo(feeds_fetches_manager.GetFeedsFetchesInfo())};
+  run_feeds_fetches_manager.GetMutableFeedsDeviceCopyInfo() = feeds_fetches_manager.GetFeedsDeviceCopyInfo();
+  auto& fetch_copy_info = run_feeds_fetches_manager.GetMutableFetchesDeviceCopyInfo();
+  fetch_copy_info = feeds_fetches_manager.GetFetchesDeviceCopyInfo();
+
+  if (fetches_device_info) {
+    // populate the target device info. ignored if pre-allocated fetches are provided
+    for (size_t i = 0, end = fetch_copy_info.size(); i < end; ++i) {
+      fetch_copy_info[i].target_device = (*fetches_device_info)[i];
+    }
+  }
+
+  FinalizeFeedFetchCopyInfo(run_feeds_fetches_manager, feeds, fetches);
+
+  return ExecuteGraphImpl(session_state, run_feeds_fetches_manager, feeds, fetches, {},
+                          execution_mode, terminate_flag, logger, only_execute_path_to_fetches);
+}
+
 #ifdef ENABLE_TRAINING
 common::Status ExecutePartialGraph(const SessionState& session_state, FeedsFetchesManager& feeds_fetches_manager,
                                    const std::vector<OrtValue>& feeds, std::vector<OrtValue>& fetches,
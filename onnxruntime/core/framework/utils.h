@@ -91,6 +91,16 @@ common::Status ExecuteGraph(const SessionState& session_state, FeedsFetchesManag
                             ExecutionMode execution_mode, const bool& terminate_flag, const logging::Logger& logger,
                             bool only_execute_path_to_fetches = false);
 
+// Execute the main graph with a feeds_fetches_manager that was set up once by InitializeFeedFetchCopyInfo and may be
+// shared by concurrent calls. It is not modified: if copies may be needed, a copy of it is finalized based on the
+// provided feeds and fetches, and on the optional target devices of the fetches.
+common::Status ExecutePreparedGraph(const SessionState& session_state,
+                                    const FeedsFetchesManager& feeds_fetches_manager,
+                                    const std::vector<OrtValue>& feeds, std::vector<OrtValue>& fetches,
+                                    ExecutionMode execution_mode, const bool& terminate_flag,
+                                    const logging::Logger& logger, bool only_execute_path_to_fetches = false,
+                                    const std::vector<OrtDevice>* fetches_device_info = nullptr);
+
 #ifdef ENABLE_TRAINING
 common::Status ExecutePartialGraph(const SessionState& session_state, FeedsFetchesManager& feeds_fetches_manager,
                                    const std::vector<OrtValue>& feeds, std::vector<OrtValue>& fetches,
@@ -1208,6 +1208,46 @@ activation.)DOC")
                                   ONNX_NAMESPACE::convPoolShapeInference(ctx, true, false, 0, 1);
                                 }));
 
+constexpr const char* FusedElementwise_ver1_doc = R"DOC(
+Evaluates a program of elementwise operators in a single pass over the output, without materializing
+the intermediate tensors. Instruction i applies ops[i] to the values operands[2*i] and operands[2*i+1],
+where values 0 to N-1 are the N inputs and value N+j is the result of instruction j < i. The second
+operand of a unary operator is -1. The output is the result of the last instruction, and its shape is
+the multidirectional (Numpy-style) broadcast of the shapes of all inputs.
+
+Supported binary operators: Add, Sub, Mul, Div, Max, Min.
+Supported unary operators: Abs, Neg, Exp, Log, Sqrt, Reciprocal, Relu, Sigmoid, Tanh, Erf.
+)DOC";
+
+ONNX_MS_OPERATOR_SET_SCHEMA(FusedElementwise, 1,
+                            OpSchema()
+                                .SetDoc(FusedElementwise_ver1_doc)
+                                .Attr("ops",
+                                      "Operator type of each instruction.",
+                                      AttributeProto::STRINGS)
+                                .Attr("operands",
+                                      "Two value indices per instruction: the operands of the instruction.",
+                                      AttributeProto::INTS)
+                                .Input(0, "inputs", "Inputs of the program.", "T", OpSchema::Variadic)
+                                .Output(0, "output", "Result of the last instruction.", "T")
+                                .TypeConstraint(
+                                    "T",
+                                    {"tensor(float)"},
+                                    "Constrain input and output types to float tensors.")
+                                .TypeAndShapeInferenceFunction([](ONNX_NAMESPACE::InferenceContext& ctx) {
+                                  propagateElemTypeFromInputToOutput(ctx, 0, 0);
+
+                                  std::vector<const TensorShapeProto*> shapes;
+                                  for (size_t i = 0; i < ctx.getNumInputs(); ++i) {
+                                    if (!hasInputShape(ctx, i)) {
+                                      return;
+                                    }
+                                    shapes.push_back(&getInputShape(ctx, i));
+                                  }
+                                  multidirectionalBroadcastShapeInference(
+                                      shapes, *ctx.getOutputType(0)->mutable_tensor_type()->mutable_shape());
+                                }));
+
 ONNX_MS_OPERATOR_SET_SCHEMA(FusedGemm, 1,
                             OpSchema()
                                 .SetDoc(R"DOC(
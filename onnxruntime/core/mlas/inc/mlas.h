@@ -931,6 +931,92 @@ MlasComputeSoftmax(
     MLAS_THREADPOOL* ThreadPool
     );
 
+//
+// Layer normalization routines.
+//
+
+/**
+ * @brief Parameters of MlasComputeLayerNorm.
+ *
+ *  For each row n, computes x = Input[n] + Skip[n] + Bias and
+ *  Output[n] = (x - mean(x)) / sqrt(var(x) + Epsilon) * Gamma + Beta.
+ */
+struct MLAS_LAYER_NORM_PARAMS {
+    size_t N;                   /**< number of rows */
+    size_t D;                   /**< number of elements of a row */
+    const float* Input;         /**< input with shape (N, D) */
+    const float* Skip;          /**< optional residual input with shape (N, D), else nullptr */
+    const float* Bias;          /**< optional bias with shape (D), else nullptr */
+    const float* Gamma;         /**< scale with shape (D) */
+    const float* Beta;          /**< optional shift with shape (D), else nullptr */
+    float* Output;              /**< output with shape (N, D), may alias the input */
+    float* Mean;                /**< optional mean of each row with shape (N), else nullptr */
+    float* InvStdDev;           /**< optional inverse standard deviation of each row with shape (N), else nullptr */
+    float Epsilon;              /**< value added to the variance */
+    bool Simplified;            /**< normalize by the root mean square without subtracting the mean */
+};
+
+/**
+ * @brief Layer normalization of the rows of a matrix, with the residual and
+ *        bias addition fused into the same pass over the row.
+ *        Work is distributed over blocks of rows.
+ *
+ * @param Parameters    Supplies the layer normalization parameters.
+ * @param ThreadPool    Supplies the thread pool object to use, else nullptr if
+ *                      the base library threading support should be used.
+ */
+void
+MLASCALL
+MlasComputeLayerNorm(
+    const MLAS_LAYER_NORM_PARAMS* Parameters,
+    MLAS_THREADPOOL* ThreadPool
+    );
+
+//
+// Fused attention routines.
+//
+
+/**
+ * @brief Parameters of MlasFlashAttention.
+ *
+ *  For each batch item b and head n, computes softmax(Scale * Q x K') x V,
+ *  where Q is SequenceLength x QkHeadSize, K is KvSequenceLength x QkHeadSize
+ *  and V is KvSequenceLength x VHeadSize.
+ */
+struct MLAS_FLASH_ATTENTION_PARAMS {
+    size_t BatchCount;          /**< number of batch items */
+    size_t HeadCount;           /**< number of heads */
+    size_t SequenceLength;      /**< number of query rows */
+    size_t KvSequenceLength;    /**< number of key and value rows */
+    size_t QkHeadSize;          /**< columns of the query and key rows */
+    size_t VHeadSize;           /**< columns of the value rows */
+    float Scale;                /**< scale applied to Q x K' before the softmax */
+    bool Causal;                /**< query row s attends to keys [0, KvSequenceLength - SequenceLength + s] only, which
+                                     requires KvSequenceLength >= SequenceLength */
+    const float* Query;         /**< query with shape (BatchCount, HeadCount, SequenceLength, QkHeadSize) */
+    const float* Key;           /**< key rows of head (b * HeadCount + n) start at Key + (b * HeadCount + n) * KeyHeadStride */
+    size_t KeyHeadStride;       /**< elements between the key rows of consecutive heads, >= KvSequenceLength * QkHeadSize */
+    const float* Value;         /**< value rows, addressed like the key rows */
+    size_t ValueHeadStride;     /**< elements between the value rows of consecutive heads, >= KvSequenceLength * VHeadSize */
+    float* Output;              /**< output with shape (BatchCount, SequenceLength, HeadCount, VHeadSize) */
+};
+
+/**
+ * @brief Scaled dot product attention computed block by block with an online
+ *        softmax, without storing the SequenceLength x KvSequenceLength scores.
+ *        Work is distributed over batch items, heads and blocks of query rows.
+ *
+ * @param Parameters    Supplies the attention parameters.
+ * @param ThreadPool    Supplies the thread pool object to use, else nullptr if
+ *                      the base library threading support should be used.
+ */
+void
+MLASCALL
+MlasFlashAttention(
+    const MLAS_FLASH_ATTENTION_PARAMS* Parameters,
+    MLAS_THREADPOOL* ThreadPool
+    );
+
 void
 MLASCALL
 MlasComputeTanh(
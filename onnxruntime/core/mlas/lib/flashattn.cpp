@@ -0,0 +1,317 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    flashattn.cpp
+
+Abstract:
+
+    This module implements a fused scaled dot product attention that computes
+    softmax(Scale * Q x K') x V without materializing the attention scores.
+
+    Each work item is a block of query rows of one batch item and head. The
+    keys and values are visited block by block, and the softmax is computed
+    online: the maximum and the sum of the exponentials seen so far are kept
+    per query row, and the accumulated output is rescaled whenever the maximum
+    grows. Only one block of scores and one block of output rows per thread are
+    live at any time, so the memory traffic does not grow with the square of
+    the sequence length.
+
+--*/
+
+#include "mlasi.h"
+
+//
+// Define the number of query rows and key columns processed per block, and
+// the number of value columns accumulated at once. Value heads wider than
+// that are processed in several passes over the keys.
+//
+
+#define MLAS_FLASH_ATTENTION_BLOCK_Q            64
+#define MLAS_FLASH_ATTENTION_BLOCK_KV           128
+#define MLAS_FLASH_ATTENTION_STRIDE_V           128
+
+struct MLAS_FLASH_ATTENTION_WORK_BLOCK {
+    ptrdiff_t ThreadCount;
+    size_t BlockCountQ;
+    const MLAS_FLASH_ATTENTION_PARAMS* Parameters;
+};
+
+void
+MlasFlashAttentionBlock(
+    const MLAS_FLASH_ATTENTION_PARAMS* Parameters,
+    size_t BatchHeadIndex,
+    size_t q,
+    size_t CountQ
+    )
+/*++
+
+Routine Description:
+
+    This routine computes the attention output for a block of query rows of
+    one batch item and head.
+
+Arguments:
+
+    Parameters - Supplies the attention parameters.
+
+    BatchHeadIndex - Supplies the index of the batch item and head, that is
+        batch index * HeadCount + head index.
+
+    q - Supplies the index of the first query row.
+
+    CountQ - Supplies the number of query rows, at most
+        MLAS_FLASH_ATTENTION_BLOCK_Q.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    MLAS_DECLSPEC_ALIGN(float Scores[MLAS_FLASH_ATTENTION_BLOCK_Q * MLAS_FLASH_ATTENTION_BLOCK_KV], 64);
+    MLAS_DECLSPEC_ALIGN(float Accumulator[MLAS_FLASH_ATTENTION_BLOCK_Q * MLAS_FLASH_ATTENTION_STRIDE_V], 64);
+    float RowMaximum[MLAS_FLASH_ATTENTION_BLOCK_Q];
+    float RowSum[MLAS_FLASH_ATTENTION_BLOCK_Q];
+
+    const size_t SequenceLength = Parameters->SequenceLength;
+    const size_t KvSequenceLength = Parameters->KvSequenceLength;
+    const size_t QkHeadSize = Parameters->QkHeadSize;
+    const size_t VHeadSize = Parameters->VHeadSize;
+
+    const size_t BatchIndex = BatchHeadIndex / Parameters->HeadCount;
+    const size_t HeadIndex = BatchHeadIndex % Parameters->HeadCount;
+
+    const float* Query = Parameters->Query + (BatchHeadIndex * SequenceLength + q) * QkHeadSize;
+    const float* Key = Parameters->Key + BatchHeadIndex * Parameters->KeyHeadStride;
+    const float* Value = Parameters->Value + BatchHeadIndex * Parameters->ValueHeadStride;
+
+    //
+    // With a causal mask, query row q may attend to the keys up to and
+    // including KvSequenceLength - SequenceLength + q.
+    //
+
+    const size_t CausalOffset = KvSequenceLength - SequenceLength;
+    const size_t CountKvTotal = Parameters->Causal ? CausalOffset + q + CountQ : KvSequenceLength;
+
+    for (size_t v = 0; v < VHeadSize; v += MLAS_FLASH_ATTENTION_STRIDE_V) {
+
+        const size_t CountV = std::min(VHeadSize - v, size_t(MLAS_FLASH_ATTENTION_STRIDE_V));
+
+        std::fill_n(RowMaximum, CountQ, std::numeric_limits<float>::lowest());
+        std::fill_n(RowSum, CountQ, 0.0f);
+
+        for (size_t kv = 0; kv < CountKvTotal; kv += MLAS_FLASH_ATTENTION_BLOCK_KV) {
+
+            const size_t CountKv = std::min(CountKvTotal - kv, size_t(MLAS_FLASH_ATTENTION_BLOCK_KV));
+
+            //
+            // Compute the scores of this block: Scale * Q x K'.
+            //
+
+            MlasGemm(CblasNoTrans, CblasTrans, CountQ, CountKv, QkHeadSize, Parameters->Scale,
+                Query, QkHeadSize, Key + kv * QkHeadSize, QkHeadSize, 0.0f, Scores, CountKv, nullptr);
+
+            //
+            // Replace the scores by their exponentials relative to the running
+            // maximum of each row, and rescale what has been accumulated so far
+            // when that maximum grows.
+            //
+
+            for (size_t r = 0; r < CountQ; r++) {
+
+                float* Row = Scores + r * CountKv;
+
+                size_t CountValid = CountKv;
+
+                if (Parameters->Causal) {
+                    const size_t Limit = CausalOffset + q + r + 1;
+                    CountValid = (Limit > kv) ? std::min(Limit - kv, CountKv) : 0;
+                }
+
+                if (CountValid > 0) {
+
+#if defined(MLAS_TARGET_AMD64)
+                    float Maximum = GetMlasPlatform().ReduceMaximumF32Kernel(Row, CountValid);
+#else
+                    float Maximum = MlasReduceMaximumF32Kernel(Row, CountValid);
+#endif
+                    Maximum = std::max(Maximum, RowMaximum[r]);
+                    float NegativeMaximum = -Maximum;
+
+#if defined(MLAS_TARGET_AMD64)
+                    float Accumulation = GetMlasPlatform().ComputeSumExpF32Kernel(Row, Row, CountValid, &NegativeMaximum);
+#else
+                    float Accumulation = MlasComputeSumExpF32Kernel(Row, Row, CountValid, &NegativeMaximum);
+#endif
+
+                    if (kv == 0) {
+                        RowSum[r] = Accumulation;
+                    } else if (Maximum > RowMaximum[r]) {
+                        float Correction[] = { std::exp(RowMaximum[r] - Maximum) };
+#if defined(MLAS_TARGET_AMD64)
+                        GetMlasPlatform().ComputeSoftmaxOutputF32Kernel(Accumulator + r * CountV, CountV, Correction);
+#else
+                        MlasComputeSoftmaxOutputF32Kernel(Accumulator + r * CountV, CountV, Correction);
+#endif
+                        RowSum[r] = RowSum[r] * Correction[0] + Accumulation;
+                    } else {
+                        RowSum[r] += Accumulation;
+                    }
+
+                    RowMaximum[r] = Maximum;
+                }
+
+                std::fill(Row + CountValid, Row + CountKv, 0.0f);
+            }
+
+            //
+            // Accumulate the weighted values of this block.
+            //
+
+            MlasGemm(CblasNoTrans, CblasNoTrans, CountQ, CountV, CountKv, 1.0f,
+                Scores, CountKv, Value + kv * VHeadSize + v, VHeadSize, (kv == 0) ? 0.0f : 1.0f,
+                Accumulator, CountV, nullptr);
+        }
+
+        //
+        // Normalize the accumulated rows into the output, which is stored as
+        // (BatchCount, SequenceLength, HeadCount, VHeadSize).
+        //
+
+        for (size_t r = 0; r < CountQ; r++) {
+
+            float* Output = Parameters->Output +
+                ((BatchIndex * SequenceLength + q + r) * Parameters->HeadCount + HeadIndex) * VHeadSize + v;
+            const float Scale = 1.0f / RowSum[r];
+            const float* Row = Accumulator + r * CountV;
+
+            for (size_t i = 0; i < CountV; i++) {
+                Output[i] = Row[i] * Scale;
+            }
+        }
+    }
+}
+
+void
+MlasFlashAttentionThreaded(
+    void* Context,
+    ptrdiff_t Index
+    )
+/*++
+
+Routine Description:
+
+    This routine is invoked from a worker thread to execute a segment of a
+    fused attention operation.
+
+Arguments:
+
+    Context - Supplies the pointer to the context for the threaded operation.
+
+    Index - Supplies the current index of the threaded operation.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    const auto* WorkBlock = (MLAS_FLASH_ATTENTION_WORK_BLOCK*)Context;
+    const MLAS_FLASH_ATTENTION_PARAMS* Parameters = WorkBlock->Parameters;
+
+    //
+    // Partition the operation along the batch, head and query block dimensions.
+    //
+
+    const size_t BlockCountQ = WorkBlock->BlockCountQ;
+    const size_t TotalWork = Parameters->BatchCount * Parameters->HeadCount * BlockCountQ;
+
+    size_t WorkIndex;
+    size_t WorkRemaining;
+
+    MlasPartitionWork(Index, WorkBlock->ThreadCount, TotalWork, &WorkIndex, &WorkRemaining);
+
+    while (WorkRemaining > 0) {
+
+        const size_t BatchHeadIndex = WorkIndex / BlockCountQ;
+        const size_t q = (WorkIndex % BlockCountQ) * MLAS_FLASH_ATTENTION_BLOCK_Q;
+        const size_t CountQ = std::min(Parameters->SequenceLength - q, size_t(MLAS_FLASH_ATTENTION_BLOCK_Q));
+
+        MlasFlashAttentionBlock(Parameters, BatchHeadIndex, q, CountQ);
+
+        WorkIndex++;
+        WorkRemaining--;
+    }
+}
+
+void
+MLASCALL
+MlasFlashAttention(
+    const MLAS_FLASH_ATTENTION_PARAMS* Parameters,
+    MLAS_THREADPOOL* ThreadPool
+    )
+/*++
+
+Routine Description:
+
+    This routine computes the scaled dot product attention
+    softmax(Scale * Q x K') x V for each batch item and head without storing
+    the attention scores.
+
+Arguments:
+
+    Parameters - Supplies the attention parameters.
+
+    ThreadPool - Supplies the thread pool object to use, else nullptr if the
+        base library threading support should be used.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    if (Parameters->SequenceLength == 0) {
+        return;
+    }
+
+    MLAS_FLASH_ATTENTION_WORK_BLOCK WorkBlock;
+
+    WorkBlock.Parameters = Parameters;
+    WorkBlock.BlockCountQ = MlasDivRoundup(Parameters->SequenceLength, MLAS_FLASH_ATTENTION_BLOCK_Q);
+
+    //
+    // Compute the number of target threads given the complexity of the
+    // operation. Limit the number of threads to the number of query blocks and
+    // try to keep each thread processing a minimum amount of work.
+    //
+
+    const size_t TotalWork = Parameters->BatchCount * Parameters->HeadCount * WorkBlock.BlockCountQ;
+
+    ptrdiff_t ThreadCount = MlasGetMaximumThreadCount(ThreadPool);
+
+    if (size_t(ThreadCount) > TotalWork) {
+        ThreadCount = ptrdiff_t(TotalWork);
+    }
+
+    constexpr double MinimumComplexityPerThread = 65536.0;
+
+    const double Complexity = double(Parameters->BatchCount * Parameters->HeadCount) *
+        double(Parameters->SequenceLength) * double(Parameters->KvSequenceLength) *
+        double(Parameters->QkHeadSize + Parameters->VHeadSize);
+
+    const double BlockCount = Complexity / MinimumComplexityPerThread + 1.0;
+
+    if (double(ThreadCount) > BlockCount) {
+        ThreadCount = ptrdiff_t(BlockCount);
+    }
+
+    WorkBlock.ThreadCount = ThreadCount;
+
+    MlasExecuteThreaded(MlasFlashAttentionThreaded, &WorkBlock, ThreadCount, ThreadPool);
+}
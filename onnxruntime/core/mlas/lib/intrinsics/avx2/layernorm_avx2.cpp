@@ -0,0 +1,181 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    layernorm_avx2.cpp
+
+Abstract:
+
+    This module implements the layer normalization kernel of a single row with
+    AVX2 and FMA3 instructions.
+
+--*/
+
+#include "mlasi.h"
+
+MLAS_FORCEINLINE
+float
+MlasReduceAddFloat32x8(
+    __m256 Vector
+    )
+{
+    __m128 Vector128 = _mm_add_ps(_mm256_castps256_ps128(Vector), _mm256_extractf128_ps(Vector, 1));
+    Vector128 = _mm_add_ps(Vector128, _mm_movehl_ps(Vector128, Vector128));
+    Vector128 = _mm_add_ss(Vector128, _mm_movehdup_ps(Vector128));
+    return _mm_cvtss_f32(Vector128);
+}
+
+void
+MLASCALL
+MlasLayerNormF32KernelAvx2(
+    const float* Input,
+    const float* Skip,
+    const float* Bias,
+    const float* Gamma,
+    const float* Beta,
+    float* Output,
+    size_t D,
+    float Epsilon,
+    bool Simplified,
+    float* Mean,
+    float* InvStdDev
+    )
+{
+    const bool StoreSum = (Skip != nullptr || Bias != nullptr);
+
+    //
+    // Compute the sum and the sum of squares of the row.
+    //
+
+    __m256 SumVector0 = _mm256_setzero_ps();
+    __m256 SumVector1 = _mm256_setzero_ps();
+    __m256 SquareSumVector0 = _mm256_setzero_ps();
+    __m256 SquareSumVector1 = _mm256_setzero_ps();
+
+    size_t d = 0;
+
+    for (; d + 16 <= D; d += 16) {
+
+        __m256 Vector0 = _mm256_loadu_ps(Input + d);
+        __m256 Vector1 = _mm256_loadu_ps(Input + d + 8);
+
+        if (Skip != nullptr) {
+            Vector0 = _mm256_add_ps(Vector0, _mm256_loadu_ps(Skip + d));
+            Vector1 = _mm256_add_ps(Vector1, _mm256_loadu_ps(Skip + d + 8));
+        }
+
+        if (Bias != nullptr) {
+            Vector0 = _mm256_add_ps(Vector0, _mm256_loadu_ps(Bias + d));
+            Vector1 = _mm256_add_ps(Vector1, _mm256_loadu_ps(Bias + d + 8));
+        }
+
+        if (StoreSum) {
+            _mm256_storeu_ps(Output + d, Vector0);
+            _mm256_storeu_ps(Output + d + 8, Vector1);
+        }
+
+        SumVector0 = _mm256_add_ps(SumVector0, Vector0);
+        SumVector1 = _mm256_add_ps(SumVector1, Vector1);
+        SquareSumVector0 = _mm256_fmadd_ps(Vector0, Vector0, SquareSumVector0);
+        SquareSumVector1 = _mm256_fmadd_ps(Vector1, Vector1, SquareSumVector1);
+    }
+
+    for (; d + 8 <= D; d += 8) {
+
+        __m256 Vector = _mm256_loadu_ps(Input + d);
+
+        if (Skip != nullptr) {
+            Vector = _mm256_add_ps(Vector, _mm256_loadu_ps(Skip + d));
+        }
+
+        if (Bias != nullptr) {
+            Vector = _mm256_add_ps(Vector, _mm256_loadu_ps(Bias + d));
+        }
+
+        if (StoreSum) {
+            _mm256_storeu_ps(Output + d, Vector);
+        }
+
+        SumVector0 = _mm256_add_ps(SumVector0, Vector);
+        SquareSumVector0 = _mm256_fmadd_ps(Vector, Vector, SquareSumVector0);
+    }
+
+    float Sum = MlasReduceAddFloat32x8(_mm256_add_ps(SumVector0, SumVector1));
+    float SquareSum = MlasReduceAddFloat32x8(_mm256_add_ps(SquareSumVector0, SquareSumVector1));
+
+    for (; d < D; d++) {
+
+        float Value = Input[d];
+
+        if (Skip != nullptr) {
+            Value += Skip[d];
+        }
+
+        if (Bias != nullptr) {
+            Value += Bias[d];
+        }
+
+        if (StoreSum) {
+            Output[d] = Value;
+        }
+
+        Sum += Value;
+        SquareSum += Value * Value;
+    }
+
+    //
+    // Compute the statistics of the row.
+    //
+
+    float RowMean = Simplified ? 0.0f : Sum / float(D);
+    float Variance = SquareSum / float(D) - RowMean * RowMean;
+    float RowInvStdDev = 1.0f / std::sqrt(std::max(Variance, 0.0f) + Epsilon);
+
+    if (Mean != nullptr) {
+        *Mean = RowMean;
+    }
+
+    if (InvStdDev != nullptr) {
+        *InvStdDev = RowInvStdDev;
+    }
+
+    //
+    // Normalize the row.
+    //
+
+    const float* Source = StoreSum ? Output : Input;
+
+    __m256 MeanVector = _mm256_set1_ps(RowMean);
+    __m256 InvStdDevVector = _mm256_set1_ps(RowInvStdDev);
+
+    d = 0;
+
+    for (; d + 8 <= D; d += 8) {
+
+        __m256 Vector = _mm256_sub_ps(_mm256_loadu_ps(Source + d), MeanVector);
+        __m256 Scale = _mm256_mul_ps(_mm256_loadu_ps(Gamma + d), InvStdDevVector);
+
+        if (Beta != nullptr) {
+            Vector = _mm256_fmadd_ps(Vector, Scale, _mm256_loadu_ps(Beta + d));
+        } else {
+            Vector = _mm256_mul_ps(Vector, Scale);
+        }
+
+        _mm256_storeu_ps(Output + d, Vector);
+    }
+
+    for (; d < D; d++) {
+
+        float Value = (Source[d] - RowMean) * (Gamma[d] * RowInvStdDev);
+
+        if (Beta != nullptr) {
+            Value += Beta[d];
+        }
+
+        Output[d] = Value;
+    }
+}
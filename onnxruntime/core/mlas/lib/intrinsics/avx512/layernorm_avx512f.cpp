@@ -0,0 +1,141 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    layernorm_avx512f.cpp
+
+Abstract:
+
+    This module implements the layer normalization kernel of a single row with
+    AVX512F instructions. The remainder of the row is processed with masked
+    loads and stores.
+
+--*/
+
+#include "mlasi.h"
+
+void
+MLASCALL
+MlasLayerNormF32KernelAvx512F(
+    const float* Input,
+    const float* Skip,
+    const float* Bias,
+    const float* Gamma,
+    const float* Beta,
+    float* Output,
+    size_t D,
+    float Epsilon,
+    bool Simplified,
+    float* Mean,
+    float* InvStdDev
+    )
+{
+    const bool StoreSum = (Skip != nullptr || Bias != nullptr);
+
+    //
+    // Compute the sum and the sum of squares of the row.
+    //
+
+    __m512 SumVector0 = _mm512_setzero_ps();
+    __m512 SumVector1 = _mm512_setzero_ps();
+    __m512 SquareSumVector0 = _mm512_setzero_ps();
+    __m512 SquareSumVector1 = _mm512_setzero_ps();
+
+    size_t d = 0;
+
+    for (; d + 32 <= D; d += 32) {
+
+        __m512 Vector0 = _mm512_loadu_ps(Input + d);
+        __m512 Vector1 = _mm512_loadu_ps(Input + d + 16);
+
+        if (Skip != nullptr) {
+            Vector0 = _mm512_add_ps(Vector0, _mm512_loadu_ps(Skip + d));
+            Vector1 = _mm512_add_ps(Vector1, _mm512_loadu_ps(Skip + d + 16));
+        }
+
+        if (Bias != nullptr) {
+            Vector0 = _mm512_add_ps(Vector0, _mm512_loadu_ps(Bias + d));
+            Vector1 = _mm512_add_ps(Vector1, _mm512_loadu_ps(Bias + d + 16));
+        }
+
+        if (StoreSum) {
+            _mm512_storeu_ps(Output + d, Vector0);
+            _mm512_storeu_ps(Output + d + 16, Vector1);
+        }
+
+        SumVector0 = _mm512_add_ps(SumVector0, Vector0);
+        SumVector1 = _mm512_add_ps(SumVector1, Vector1);
+        SquareSumVector0 = _mm512_fmadd_ps(Vector0, Vector0, SquareSumVector0);
+        SquareSumVector1 = _mm512_fmadd_ps(Vector1, Vector1, SquareSumVector1);
+    }
+
+    for (; d < D; d += 16) {
+
+        __mmask16 Mask = (D - d >= 16) ? __mmask16(0xFFFF) : __mmask16((1u << (D - d)) - 1);
+
+        __m512 Vector = _mm512_maskz_loadu_ps(Mask, Input + d);
+
+        if (Skip != nullptr) {
+            Vector = _mm512_add_ps(Vector, _mm512_maskz_loadu_ps(Mask, Skip + d));
+        }
+
+        if (Bias != nullptr) {
+            Vector = _mm512_add_ps(Vector, _mm512_maskz_loadu_ps(Mask, Bias + d));
+        }
+
+        if (StoreSum) {
+            _mm512_mask_storeu_ps(Output + d, Mask, Vector);
+        }
+
+        SumVector0 = _mm512_add_ps(SumVector0, Vector);
+        SquareSumVector0 = _mm512_fmadd_ps(Vector, Vector, SquareSumVector0);
+    }
+
+    float Sum = _mm512_reduce_add_ps(_mm512_add_ps(SumVector0, SumVector1));
+    float SquareSum = _mm512_reduce_add_ps(_mm512_add_ps(SquareSumVector0, SquareSumVector1));
+
+    //
+    // Compute the statistics of the row.
+    //
+
+    float RowMean = Simplified ? 0.0f : Sum / float(D);
+    float Variance = SquareSum / float(D) - RowMean * RowMean;
+    float RowInvStdDev = 1.0f / std::sqrt(std::max(Variance, 0.0f) + Epsilon);
+
+    if (Mean != nullptr) {
+        *Mean = RowMean;
+    }
+
+    if (InvStdDev != nullptr) {
+        *InvStdDev = RowInvStdDev;
+    }
+
+    //
+    // Normalize the row.
+    //
+
+    const float* Source = StoreSum ? Output : Input;
+
+    __m512 MeanVector = _mm512_set1_ps(RowMean);
+    __m512 InvStdDevVector = _mm512_set1_ps(RowInvStdDev);
+
+    for (d = 0; d < D; d += 16) {
+
+        __mmask16 Mask = (D - d >= 16) ? __mmask16(0xFFFF) : __mmask16((1u << (D - d)) - 1);
+
+        __m512 Vector = _mm512_sub_ps(_mm512_maskz_loadu_ps(Mask, Source + d), MeanVector);
+        __m512 Scale = _mm512_mul_ps(_mm512_maskz_loadu_ps(Mask, Gamma + d), InvStdDevVector);
+
+        if (Beta != nullptr) {
+            Vector = _mm512_fmadd_ps(Vector, Scale, _mm512_maskz_loadu_ps(Mask, Beta + d));
+        } else {
+            Vector = _mm512_mul_ps(Vector, Scale);
+        }
+
+        _mm512_mask_storeu_ps(Output + d, Mask, Vector);
+    }
+}
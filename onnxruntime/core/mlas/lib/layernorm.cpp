@@ -0,0 +1,332 @@
+/*++
+
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+Licensed under the MIT License.
+
+Module Name:
+
+    layernorm.cpp
+
+Abstract:
+
+    This module implements routines to compute the layer normalization of the
+    rows of a matrix, optionally after adding a residual (skip) row and a bias
+    row to the input.
+
+    Each row is visited twice: the first pass computes the sum and the sum of
+    squares of the row (storing the residual sum to the output buffer), and
+    the second pass normalizes the row and applies the scale and the shift.
+
+--*/
+
+#include "mlasi.h"
+
+struct MLAS_LAYER_NORM_WORK_BLOCK {
+    ptrdiff_t ThreadCountN;
+    const MLAS_LAYER_NORM_PARAMS* Parameters;
+};
+
+void
+MLASCALL
+MlasLayerNormF32Kernel(
+    const float* Input,
+    const float* Skip,
+    const float* Bias,
+    const float* Gamma,
+    const float* Beta,
+    float* Output,
+    size_t D,
+    float Epsilon,
+    bool Simplified,
+    float* Mean,
+    float* InvStdDev
+    )
+/*++
+
+Routine Description:
+
+    This routine implements the generic kernel to compute the layer
+    normalization of a single row.
+
+Arguments:
+
+    Input - Supplies the input row.
+
+    Skip - Supplies the optional residual row added to the input.
+
+    Bias - Supplies the optional bias row added to the input.
+
+    Gamma - Supplies the scale row.
+
+    Beta - Supplies the optional shift row.
+
+    Output - Supplies the output row. The output row may alias the input row.
+
+    D - Supplies the number of elements of the rows.
+
+    Epsilon - Supplies the value added to the variance to avoid dividing by
+        zero.
+
+    Simplified - Supplies true to normalize by the root mean square of the row
+        without subtracting the mean, else false.
+
+    Mean - Supplies the optional location to store the mean of the row.
+
+    InvStdDev - Supplies the optional location to store the inverse standard
+        deviation of the row.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    const bool StoreSum = (Skip != nullptr || Bias != nullptr);
+
+    //
+    // Compute the sum and the sum of squares of the row.
+    //
+
+    MLAS_FLOAT32X4 SumVector0 = MlasZeroFloat32x4();
+    MLAS_FLOAT32X4 SumVector1 = MlasZeroFloat32x4();
+    MLAS_FLOAT32X4 SquareSumVector0 = MlasZeroFloat32x4();
+    MLAS_FLOAT32X4 SquareSumVector1 = MlasZeroFloat32x4();
+
+    size_t d = 0;
+
+    for (; d + 8 <= D; d += 8) {
+
+        MLAS_FLOAT32X4 Vector0 = MlasLoadFloat32x4(Input + d);
+        MLAS_FLOAT32X4 Vector1 = MlasLoadFloat32x4(Input + d + 4);
+
+        if (Skip != nullptr) {
+            Vector0 = MlasAddFloat32x4(Vector0, MlasLoadFloat32x4(Skip + d));
+            Vector1 = MlasAddFloat32x4(Vector1, MlasLoadFloat32x4(Skip + d + 4));
+        }
+
+        if (Bias != nullptr) {
+            Vector0 = MlasAddFloat32x4(Vector0, MlasLoadFloat32x4(Bias + d));
+            Vector1 = MlasAddFloat32x4(Vector1, MlasLoadFloat32x4(Bias + d + 4));
+        }
+
+        if (StoreSum) {
+            MlasStoreFloat32x4(Output + d, Vector0);
+            MlasStoreFloat32x4(Output + d + 4, Vector1);
+        }
+
+        SumVector0 = MlasAddFloat32x4(SumVector0, Vector0);
+        SumVector1 = MlasAddFloat32x4(SumVector1, Vector1);
+        SquareSumVector0 = MlasMultiplyAddFloat32x4(Vector0, Vector0, SquareSumVector0);
+        SquareSumVector1 = MlasMultiplyAddFloat32x4(Vector1, Vector1, SquareSumVector1);
+    }
+
+    float Sum = MlasReduceAddFloat32x4(MlasAddFloat32x4(SumVector0, SumVector1));
+    float SquareSum = MlasReduceAddFloat32x4(MlasAddFloat32x4(SquareSumVector0, SquareSumVector1));
+
+    for (; d < D; d++) {
+
+        float Value = Input[d];
+
+        if (Skip != nullptr) {
+            Value += Skip[d];
+        }
+
+        if (Bias != nullptr) {
+            Value += Bias[d];
+        }
+
+        if (StoreSum) {
+            Output[d] = Value;
+        }
+
+        Sum += Value;
+        SquareSum += Value * Value;
+    }
+
+    //
+    // Compute the statistics of the row. The variance is clamped at zero as
+    // rounding errors may make it slightly negative for a constant row.
+    //
+
+    float RowMean = Simplified ? 0.0f : Sum / float(D);
+    float Variance = SquareSum / float(D) - RowMean * RowMean;
+    float RowInvStdDev = 1.0f / std::sqrt(std::max(Variance, 0.0f) + Epsilon);
+
+    if (Mean != nullptr) {
+        *Mean = RowMean;
+    }
+
+    if (InvStdDev != nullptr) {
+        *InvStdDev = RowInvStdDev;
+    }
+
+    //
+    // Normalize the row.
+    //
+
+    const float* Source = StoreSum ? Output : Input;
+
+    MLAS_FLOAT32X4 MeanVector = MlasBroadcastFloat32x4(RowMean);
+    MLAS_FLOAT32X4 InvStdDevVector = MlasBroadcastFloat32x4(RowInvStdDev);
+
+    d = 0;
+
+    for (; d + 4 <= D; d += 4) {
+
+        MLAS_FLOAT32X4 Vector = MlasSubtractFloat32x4(MlasLoadFloat32x4(Source + d), MeanVector);
+        MLAS_FLOAT32X4 Scale = MlasMultiplyFloat32x4(MlasLoadFloat32x4(Gamma + d), InvStdDevVector);
+
+        if (Beta != nullptr) {
+            Vector = MlasMultiplyAddFloat32x4(Vector, Scale, MlasLoadFloat32x4(Beta + d));
+        } else {
+            Vector = MlasMultiplyFloat32x4(Vector, Scale);
+        }
+
+        MlasStoreFloat32x4(Output + d, Vector);
+    }
+
+    for (; d < D; d++) {
+
+        float Value = (Source[d] - RowMean) * (Gamma[d] * RowInvStdDev);
+
+        if (Beta != nullptr) {
+            Value += Beta[d];
+        }
+
+        Output[d] = Value;
+    }
+}
+
+void
+MlasComputeLayerNormThreaded(
+    void* Context,
+    ptrdiff_t Index
+    )
+/*++
+
+Routine Description:
+
+    This routine is invoked from a worker thread to execute a segment of a
+    layer normalization operation.
+
+Arguments:
+
+    Context - Supplies the pointer to the context for the threaded operation.
+
+    ThreadId - Supplies the current index of the threaded operation.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    const auto* WorkBlock = (MLAS_LAYER_NORM_WORK_BLOCK*)Context;
+    const MLAS_LAYER_NORM_PARAMS* Parameters = WorkBlock->Parameters;
+
+    //
+    // Partition the operation along the N dimension.
+    //
+
+    size_t n;
+    size_t CountN;
+
+    MlasPartitionWork(Index, WorkBlock->ThreadCountN, Parameters->N, &n, &CountN);
+
+    const size_t D = Parameters->D;
+
+    const float* Input = Parameters->Input + n * D;
+    const float* Skip = (Parameters->Skip != nullptr) ? Parameters->Skip + n * D : nullptr;
+    float* Output = Parameters->Output + n * D;
+    float* Mean = (Parameters->Mean != nullptr) ? Parameters->Mean + n : nullptr;
+    float* InvStdDev = (Parameters->InvStdDev != nullptr) ? Parameters->InvStdDev + n : nullptr;
+
+    while (CountN > 0) {
+
+#if defined(MLAS_TARGET_AMD64)
+        GetMlasPlatform().LayerNormF32Kernel(
+#else
+        MlasLayerNormF32Kernel(
+#endif
+            Input, Skip, Parameters->Bias, Parameters->Gamma, Parameters->Beta,
+            Output, D, Parameters->Epsilon, Parameters->Simplified, Mean, InvStdDev);
+
+        Input += D;
+        Output += D;
+
+        if (Skip != nullptr) {
+            Skip += D;
+        }
+
+        if (Mean != nullptr) {
+            Mean++;
+        }
+
+        if (InvStdDev != nullptr) {
+            InvStdDev++;
+        }
+
+        CountN--;
+    }
+}
+
+void
+MLASCALL
+MlasComputeLayerNorm(
+    const MLAS_LAYER_NORM_PARAMS* Parameters,
+    MLAS_THREADPOOL* ThreadPool
+    )
+/*++
+
+Routine Description:
+
+    This routine computes the layer normalization of the rows of a matrix.
+
+    N.B. This implementation supports in place updates of the output buffer.
+
+Arguments:
+
+    Parameters - Supplies the layer normalization parameters.
+
+    ThreadPool - Supplies the thread pool object to use, else nullptr if the
+        base library threading support should be used.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    MLAS_LAYER_NORM_WORK_BLOCK WorkBlock;
+
+    WorkBlock.Parameters = Parameters;
+
+    //
+    // Compute the number of target threads given the complexity of the layer
+    // normalization operation. Limit the number of threads to the number of
+    // rows and try to keep each thread processing a minimum number of
+    // elements before using another thread.
+    //
+
+    const size_t N = Parameters->N;
+    const size_t D = Parameters->D;
+
+    ptrdiff_t ThreadCountN = MlasGetMaximumThreadCount(ThreadPool);
+
+    if (size_t(ThreadCountN) > N) {
+        ThreadCountN = ptrdiff_t(N);
+    }
+
+    constexpr size_t MinimumElementsPerThread = 16384;
+
+    size_t BlockCount = ((N * D) / MinimumElementsPerThread) + 1;
+
+    if (size_t(ThreadCountN) > BlockCount) {
+        ThreadCountN = ptrdiff_t(BlockCount);
+    }
+
+    WorkBlock.ThreadCountN = ThreadCountN;
+
+    MlasExecuteThreaded(MlasComputeLayerNormThreaded, &WorkBlock, ThreadCountN, ThreadPool);
+}
@@ -485,6 +485,22 @@ void
     size_t N
     );
 
+typedef
+void
+(MLASCALL MLAS_LAYER_NORM_FLOAT_KERNEL)(
+    const float* Input,
+    const float* Skip,
+    const float* Bias,
+    const float* Gamma,
+    const float* Beta,
+    float* Output,
+    size_t D,
+    float Epsilon,
+    bool Simplified,
+    float* Mean,
+    float* InvStdDev
+    );
+
 typedef
 void
 (MLASCALL MLAS_QLINEAR_BINARY_OP_S8_KERNEL)(
@@ -676,6 +692,12 @@ extern "C" {
     MLAS_REDUCE_MINIMUM_MAXIMUM_FLOAT_KERNEL MlasReduceMinimumMaximumF32KernelAvx;
 #endif
 
+    MLAS_LAYER_NORM_FLOAT_KERNEL MlasLayerNormF32Kernel;
+#if defined(MLAS_TARGET_AMD64)
+    MLAS_LAYER_NORM_FLOAT_KERNEL MlasLayerNormF32KernelAvx2;
+    MLAS_LAYER_NORM_FLOAT_KERNEL MlasLayerNormF32KernelAvx512F;
+#endif
+
 }
 
 //
@@ -878,6 +900,7 @@ struct MLAS_PLATFORM {
     MLAS_COMPUTE_LOGSOFTMAX_OUTPUT_FLOAT_KERNEL* ComputeLogSoftmaxOutputF32Kernel;
     MLAS_REDUCE_MAXIMUM_FLOAT_KERNEL* ReduceMaximumF32Kernel;
     MLAS_REDUCE_MINIMUM_MAXIMUM_FLOAT_KERNEL* ReduceMinimumMaximumF32Kernel;
+    MLAS_LAYER_NORM_FLOAT_KERNEL* LayerNormF32Kernel;
     MLAS_QUANTIZE_LINEAR_S8_KERNEL* QuantizeLinearS8Kernel;
     MLAS_QUANTIZE_LINEAR_U8_KERNEL* QuantizeLinearU8Kernel;
     uint32_t NchwcBlockSize;
@@ -0,0 +1,190 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/optimizer/elementwise_fusion.h"
+
+#include <algorithm>
+
+#include "core/graph/graph_utils.h"
+#include "core/optimizer/utils.h"
+
+using namespace ONNX_NAMESPACE;
+using namespace ::onnxruntime::common;
+namespace onnxruntime {
+
+namespace {
+
+// Upper bound of the operators fused into one node. FusedElementwise keeps a block of values per operator,
+// and they shall stay in the first level cache.
+constexpr size_t kMaxFusedNodes = 32;
+
+bool IsFloatTensor(const NodeArg& arg) {
+  const auto* type = arg.TypeAsProto();
+  return type != nullptr && type->has_tensor_type() &&
+         type->tensor_type().elem_type() == TensorProto_DataType_FLOAT;
+}
+
+// Returns true if the node is an operator that FusedElementwise evaluates, on float tensors.
+bool IsFusible(const Node& node, const InlinedHashSet<std::string_view>& compatible_providers) {
+  const bool is_binary = graph_utils::IsSupportedOptypeVersionAndDomain(node, "Add", {7, 13, 14}) ||
+                         graph_utils::IsSupportedOptypeVersionAndDomain(node, "Sub", {7, 13, 14}) ||
+                         graph_utils::IsSupportedOptypeVersionAndDomain(node, "Mul", {7, 13, 14}) ||
+                         graph_utils::IsSupportedOptypeVersionAndDomain(node, "Div", {7, 13, 14}) ||
+                         graph_utils::IsSupportedOptypeVersionAndDomain(node, "Max", {8, 12, 13}) ||
+                         graph_utils::IsSupportedOptypeVersionAndDomain(node, "Min", {8, 12, 13});
+  const bool is_unary = graph_utils::IsSupportedOptypeVersionAndDomain(node, "Abs", {6, 13}) ||
+                        graph_utils::IsSupportedOptypeVersionAndDomain(node, "Neg", {6, 13}) ||
+                        graph_utils::IsSupportedOptypeVersionAndDomain(node, "Exp", {6, 13}) ||
+                        graph_utils::IsSupportedOptypeVersionAndDomain(node, "Log", {6, 13}) ||
+                        graph_utils::IsSupportedOptypeVersionAndDomain(node, "Sqrt", {6, 13}) ||
+                        graph_utils::IsSupportedOptypeVersionAndDomain(node, "Reciprocal", {6, 13}) ||
+                        graph_utils::IsSupportedOptypeVersionAndDomain(node, "Relu", {6, 13, 14}) ||
+                        graph_utils::IsSupportedOptypeVersionAndDomain(node, "Sigmoid", {6, 13}) ||
+                        graph_utils::IsSupportedOptypeVersionAndDomain(node, "Tanh", {6, 13}) ||
+                        graph_utils::IsSupportedOptypeVersionAndDomain(node, "Erf", {9, 13});
+
+  if (!(is_binary || is_unary) ||
+      !graph_utils::IsSupportedProvider(node, compatible_providers) ||
+      node.InputDefs().size() != (is_binary ? 2u : 1u) ||
+      node.OutputDefs().size() != 1) {
+    return false;
+  }
+
+  for (const NodeArg* input : node.InputDefs()) {
+    if (!input->Exists() || !IsFloatTensor(*input)) {
+      return false;
+    }
+  }
+
+  return IsFloatTensor(*node.OutputDefs()[0]);
+}
+
+}  // namespace
+
+Status ElementwiseFusion::ApplyImpl(Graph& graph, bool& modified, int graph_level,
+                                    const logging::Logger& logger) const {
+  GraphViewer graph_viewer(graph);
+  const auto& node_topology_list = graph_viewer.GetNodesInTopologicalOrder();
+
+  InlinedHashMap<NodeIndex, size_t> topological_order;
+  for (size_t i = 0; i < node_topology_list.size(); i++) {
+    topological_order[node_topology_list[i]] = i;
+  }
+
+  // Visit the nodes from the last one so that a group is rooted at the last operator of a chain.
+  for (auto it = node_topology_list.rbegin(); it != node_topology_list.rend(); ++it) {
+    auto* node_ptr = graph.GetNode(*it);
+    if (nullptr == node_ptr)
+      continue;  // node was removed
+
+    auto& root = *node_ptr;
+
+    ORT_RETURN_IF_ERROR(Recurse(root, modified, graph_level, logger));
+
+    if (!IsFusible(root, GetCompatibleExecutionProviders())) {
+      continue;
+    }
+
+    // Grow the group towards the producers. A producer joins once all of its consumers are in the group, so the
+    // intermediate values are not used outside of the group. A producer is checked again from each consumer.
+    InlinedVector<Node*> group{&root};
+    InlinedHashSet<NodeIndex> group_indices{root.Index()};
+    for (size_t i = 0; i < group.size() && group.size() < kMaxFusedNodes; i++) {
+      for (auto edge = group[i]->InputEdgesBegin(); edge != group[i]->InputEdgesEnd(); ++edge) {
+        const Node& producer = edge->GetNode();
+        if (group_indices.count(producer.Index()) > 0 ||
+            !IsFusible(producer, GetCompatibleExecutionProviders()) ||
+            producer.GetExecutionProviderType() != root.GetExecutionProviderType() ||
+            graph.NodeProducesGraphOutput(producer)) {
+          continue;
+        }
+
+        const bool consumed_by_group = std::all_of(producer.OutputEdgesBegin(), producer.OutputEdgesEnd(),
+                                                   [&group_indices](const Node::EdgeEnd& output_edge) {
+                                                     return group_indices.count(output_edge.GetNode().Index()) > 0;
+                                                   });
+        if (consumed_by_group && group.size() < kMaxFusedNodes) {
+          group.push_back(graph.GetNode(producer.Index()));
+          group_indices.insert(producer.Index());
+        }
+      }
+    }
+
+    if (group.size() < 2) {
+      continue;
+    }
+
+    // Instructions follow the topological order, which ends with the root.
+    std::sort(group.begin(), group.end(), [&topological_order](const Node* a, const Node* b) {
+      return topological_order[a->Index()] < topological_order[b->Index()];
+    });
+
+    // Values 0 to N-1 are the inputs of the group, and value N+i is the result of its i-th operator.
+    InlinedVector<NodeArg*> inputs;
+    InlinedHashMap<const NodeArg*, int64_t> value_indices;
+    for (Node* node : group) {
+      for (NodeArg* input : node->MutableInputDefs()) {
+        const Node* producer = graph.GetProducerNode(input->Name());
+        const bool is_intermediate = producer != nullptr && group_indices.count(producer->Index()) > 0;
+        if (!is_intermediate && value_indices.find(input) == value_indices.end()) {
+          value_indices[input] = static_cast<int64_t>(inputs.size());
+          inputs.push_back(input);
+        }
+      }
+    }
+
+    std::vector<std::string> ops;
+    std::vector<int64_t> operands;
+    for (size_t i = 0; i < group.size(); i++) {
+      const Node& node = *group[i];
+      const auto& input_defs = node.InputDefs();
+      ops.push_back(node.OpType());
+      operands.push_back(value_indices.at(input_defs[0]));
+      operands.push_back(input_defs.size() > 1 ? value_indices.at(input_defs[1]) : -1);
+      value_indices[node.OutputDefs()[0]] = static_cast<int64_t>(inputs.size() + i);
+    }
+
+    Node& fused_node = graph.AddNode(graph.GenerateNodeName("FusedElementwise"),
+                                     "FusedElementwise",
+                                     "fused elementwise operators",
+                                     inputs,
+                                     {},
+                                     nullptr,
+                                     kMSDomain);
+    fused_node.AddAttribute("ops", ops);
+    fused_node.AddAttribute("operands", operands);
+
+    // Assign provider to this new node. Provider should be same as the provider for old node.
+    fused_node.SetExecutionProviderType(root.GetExecutionProviderType());
+
+    // Connect the producers of the group inputs to the slots of the deduplicated inputs. FinalizeNodeFusion would
+    // move the input edges of the first node to the slots they had there, which differ once an input repeats,
+    // e.g. Mul(x, x), so those edges are removed before it runs.
+    for (size_t i = 0; i < group.size(); i++) {
+      const Node& node = *group[i];
+      for (auto edge = node.InputEdgesBegin(); edge != node.InputEdgesEnd(); ++edge) {
+        if (group_indices.count(edge->GetNode().Index()) == 0) {
+          const NodeArg* input = node.InputDefs()[edge->GetDstArgIndex()];
+          graph.AddEdge(edge->GetNode().Index(), fused_node.Index(), edge->GetSrcArgIndex(),
+                        static_cast<int>(value_indices.at(input)));
+        }
+      }
+    }
+
+    graph_utils::GraphEdge::RemoveGraphEdges(graph, graph_utils::GraphEdge::GetNodeInputEdges(*group[0]));
+
+    InlinedVector<std::reference_wrapper<Node>> nodes_to_fuse;
+    for (Node* node : group) {
+      nodes_to_fuse.push_back(*node);
+    }
+
+    // move output definitions and edges from the root (last in list) to fused_node, and remove the group.
+    graph_utils::FinalizeNodeFusion(graph, nodes_to_fuse, fused_node);
+
+    modified = true;
+  }
+
+  return Status::OK();
+}
+
+}  // namespace onnxruntime
@@ -0,0 +1,25 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "core/optimizer/graph_transformer.h"
+
+namespace onnxruntime {
+
+/**
+@Class ElementwiseFusion
+Fuse connected unary and binary elementwise operators on float tensors, like Add->Mul->Tanh->Mul, into one
+FusedElementwise node that evaluates them in a single pass without materializing the intermediate tensors.
+Only the output of the last operator of a fused group may be used outside of the group.
+*/
+class ElementwiseFusion : public GraphTransformer {
+ public:
+  ElementwiseFusion(const InlinedHashSet<std::string_view>& compatible_execution_providers = {}) noexcept
+      : GraphTransformer("ElementwiseFusion", compatible_execution_providers) {
+  }
+
+  Status ApplyImpl(Graph& graph, bool& modified, int graph_level, const logging::Logger& logger) const override;
+};
+
+}  // namespace onnxruntime
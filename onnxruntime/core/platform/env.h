@@ -122,6 +122,19 @@ class Env {
   // This function doesn't support systems with more than 64 logical processors
   virtual std::vector<size_t> GetThreadAffinityMasks() const = 0;
 
+  // Returns the logical processors of each NUMA node that this process may run on, in node order. Nodes without
+  // any such processor are left out. Empty if the platform doesn't report its NUMA topology.
+  virtual std::vector<std::vector<size_t>> GetNumaNodeProcessors() const {
+    return {};
+  }
+
+  // Asks the OS to place the pages in [addr, addr + size) on NUMA node `node` (the index into
+  // GetNumaNodeProcessors) once they are touched. Only pages entirely inside the range are affected.
+  // Returns false if this isn't supported, which callers can ignore as placement is a hint only.
+  virtual bool BindMemoryToNumaNode(void* /*addr*/, size_t /*size*/, int /*node*/) const {
+    return false;
+  }
+
   /// \brief Returns the number of micro-seconds since the Unix epoch.
   virtual uint64_t NowMicros() const {
     return env_time_->NowMicros();
@@ -27,6 +27,8 @@ limitations under the License.
 #include <dlfcn.h>
 #include <ftw.h>
 #include <string.h>
+#include <algorithm>
+#include <fstream>
 #include <thread>
 #include <utility>  // for std::forward
 #include <vector>
@@ -37,10 +39,96 @@ limitations under the License.
 #include "core/platform/scoped_resource.h"
 #include "core/platform/EigenNonBlockingThreadPool.h"
 
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
 namespace onnxruntime {
 
 namespace {
 
+#if defined(__linux__)
+// Parses a sysfs list like "0-3,8,10-11". Returns false if the file can't be read.
+bool ReadSysfsList(const std::string& path, std::vector<size_t>& values) {
+  std::ifstream file(path);
+  std::string list;
+  if (!file || !std::getline(file, list)) {
+    return false;
+  }
+
+  values.clear();
+  size_t pos = 0;
+  while (pos < list.size()) {
+    const size_t end = std::min(list.find(',', pos), list.size());
+    const std::string range = list.substr(pos, end - pos);
+    const size_t dash = range.find('-');
+    ORT_TRY {
+      const size_t first = std::stoul(range.substr(0, dash));
+      const size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+      for (size_t value = first; value <= last; ++value) {
+        values.push_back(value);
+      }
+    }
+    ORT_CATCH(const std::exception&) {
+      return false;
+    }
+    pos = end + 1;
+  }
+
+  return true;
+}
+
+struct NumaTopology {
+  // the OS ids of the nodes, in the order of node_processors
+  std::vector<size_t> nodes;
+  // the processors of each node that this process may run on
+  std::vector<std::vector<size_t>> node_processors;
+};
+
+// Reads the online NUMA nodes, keeping the processors in the affinity mask of the process and skipping the nodes
+// left without any. Empty if the topology can't be read.
+NumaTopology ReadNumaTopology() {
+  NumaTopology topology;
+  std::vector<size_t> online_nodes;
+  if (!ReadSysfsList("/sys/devices/system/node/online", online_nodes)) {
+    return topology;
+  }
+
+  cpu_set_t affinity;
+  CPU_ZERO(&affinity);
+  const bool has_affinity = sched_getaffinity(0, sizeof(affinity), &affinity) == 0;
+
+  for (size_t node : online_nodes) {
+    std::vector<size_t> processors;
+    if (!ReadSysfsList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", processors)) {
+      return {};
+    }
+
+    if (has_affinity) {
+      processors.erase(std::remove_if(processors.begin(), processors.end(),
+                                      [&affinity](size_t cpu) {
+                                        return cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &affinity);
+                                      }),
+                       processors.end());
+    }
+
+    if (!processors.empty()) {
+      topology.nodes.push_back(node);
+      topology.node_processors.push_back(std::move(processors));
+    }
+  }
+
+  return topology;
+}
+
+// The topology is read once. BindMemoryToNumaNode runs for every allocation of a node local allocator.
+const NumaTopology& GetNumaTopology() {
+  static const NumaTopology topology = ReadNumaTopology();
+  return topology;
+}
+#endif
+
 constexpr int OneMillion = 1000000;
 
 class UnmapFileParam {
@@ -246,6 +334,31 @@ class PosixEnv : public Env {
     return ret;
   }
 
+#if defined(__linux__)
+  std::vector<std::vector<size_t>> GetNumaNodeProcessors() const override {
+    return GetNumaTopology().node_processors;
+  }
+
+  bool BindMemoryToNumaNode(void* addr, size_t size, int node) const override {
+    const auto& nodes = GetNumaTopology().nodes;
+    if (node < 0 || static_cast<size_t>(node) >= nodes.size() || nodes[node] >= sizeof(unsigned long) * 8) {
+      return false;
+    }
+
+    const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t begin = (reinterpret_cast<uintptr_t>(addr) + page_size - 1) & ~(page_size - 1);
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(addr) + size) & ~(page_size - 1);
+    if (begin >= end) {
+      return false;
+    }
+
+    // MPOL_PREFERRED: allocate on the node while it has free memory, fall back to the others after that
+    constexpr int kMpolPreferred = 1;
+    const unsigned long node_mask = 1UL << nodes[node];
+    return syscall(SYS_mbind, begin, end - begin, kMpolPreferred, &node_mask, sizeof(node_mask) * 8, 0) == 0;
+  }
+#endif
+
   void SleepForMicroseconds(int64_t micros) const override {
     while (micros > 0) {
       timespec sleep_time;
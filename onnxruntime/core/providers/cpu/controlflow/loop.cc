@@ -12,6 +12,10 @@
 #include "core/providers/cpu/controlflow/loop.h"
 #include "core/providers/cpu/controlflow/utils.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
 #include "core/framework/allocator.h"
 #include "core/framework/framework_common.h"
 #include "core/framework/op_kernel_context_internal.h"
@@ -131,6 +135,28 @@ ONNX_CPU_OPERATOR_KERNEL(Loop,
                              .TypeConstraint("V", DataTypeImpl::AllTensorAndSequenceTensorAndOptionalTypes()),
                          Loop);
 
+// true if the dims are the same values or the same symbols
+static bool HaveSameDims(const TensorShapeProto& shape, const TensorShapeProto& other_shape) {
+  if (shape.dim_size() != other_shape.dim_size()) {
+    return false;
+  }
+
+  for (int i = 0; i < shape.dim_size(); ++i) {
+    const auto& dim = shape.dim(i);
+    const auto& other_dim = other_shape.dim(i);
+    if (dim.has_dim_value()) {
+      if (!other_dim.has_dim_value() || dim.dim_value() != other_dim.dim_value()) {
+        return false;
+      }
+    } else if (!dim.has_dim_param() || dim.dim_param().empty() ||
+               !other_dim.has_dim_param() || dim.dim_param() != other_dim.dim_param()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 Loop::Info::Info(const onnxruntime::Node& node, const GraphViewer& subgraph_in)
     : subgraph(subgraph_in) {
   num_loop_carried_vars = static_cast<int>(node.InputDefs().size()) - 2;  // skip 'M' and 'cond'
@@ -173,6 +199,43 @@ Loop::Info::Info(const onnxruntime::Node& node, const GraphViewer& subgraph_in)
     auto& output = subgraph_outputs[i];
     subgraph_output_names.push_back(output->Name());
   }
+
+  // An output the Loop provides a buffer for must be written by a node in the subgraph, and fetched once.
+  // A subgraph input, outer scope value or initializer that is returned as an output is not written.
+  auto is_written_by_node = [this](const std::string& output_name) {
+    return subgraph.GetProducerNode(output_name) != nullptr &&
+           std::count(subgraph_output_names.cbegin(), subgraph_output_names.cend(), output_name) == 1;
+  };
+
+  // A subgraph output may share the buffer of a subgraph input if it is the input, or an Identity of it
+  // (see the Loop specific handling in the allocation planner). Such an input cannot be double buffered as
+  // the output would be overwritten two iterations later.
+  auto may_be_shared_by_output = [this, &subgraph_outputs](const NodeArg& input) {
+    return std::any_of(subgraph_outputs.cbegin(), subgraph_outputs.cend(), [this, &input](const NodeArg* output) {
+      if (output->Name() == input.Name()) {
+        return true;
+      }
+
+      const Node* producer = subgraph.GetProducerNode(output->Name());
+      return producer != nullptr && producer->OpType() == "Identity" &&
+             producer->InputDefs()[0]->Name() == input.Name();
+    });
+  };
+
+  loop_carried_vars_double_buffered.reserve(num_loop_carried_vars);
+  for (int i = 0; i < num_loop_carried_vars; ++i) {
+    const auto& input = *subgraph_inputs[static_cast<size_t>(i) + 2];    // skip iter_num and cond
+    const auto& output = *subgraph_outputs[static_cast<size_t>(i) + 1];  // skip cond
+    loop_carried_vars_double_buffered.push_back(input.Shape() != nullptr && output.Shape() != nullptr &&
+                                                HaveSameDims(*input.Shape(), *output.Shape()) &&
+                                                is_written_by_node(output.Name()) &&
+                                                !may_be_shared_by_output(input));
+  }
+
+  scan_outputs_in_place.reserve(static_cast<size_t>(num_outputs) - num_loop_carried_vars);
+  for (int i = num_loop_carried_vars; i < num_outputs; ++i) {
+    scan_outputs_in_place.push_back(is_written_by_node(subgraph_output_names[static_cast<size_t>(i) + 1]));
+  }
 }
 
 class LoopImpl {
@@ -194,6 +257,16 @@ class LoopImpl {
   void CreateInitialFeeds(std::vector<OrtValue>& feeds);
   void SaveOutputsAndUpdateFeeds(const std::vector<OrtValue>& last_outputs, std::vector<OrtValue>& next_inputs);
 
+  // provide the buffers the subgraph writes the double buffered loop carried variables and the in place scan
+  // outputs to in the next iteration
+  void CreateFetches(const std::vector<OrtValue>& feeds, std::vector<OrtValue>& fetches);
+
+  // save a scan output of the iteration that just ran, unless the subgraph wrote it in place
+  void SaveScanOutput(int scan_output_index, const OrtValue& output, int64_t iter_num);
+
+  // create the single Loop output from the buffer of a scan output that was written in place
+  Status CopyScanOutputBuffer(int scan_output_index, int output_index, int64_t num_iterations);
+
   // create the single Loop output from a collection of per-iteration outputs
   Status ConcatenateLoopOutput(std::vector<OrtValue>& per_iteration_output, int output_index);
 
@@ -213,6 +286,23 @@ class LoopImpl {
   // the order from the subgraph matches the order from the loop output
   std::vector<std::vector<OrtValue>> loop_output_tensors_;
 
+  // the two buffers of each double buffered loop carried variable. the fetch of an iteration is the feed of the next.
+  std::vector<std::array<OrtValue, 2>> loop_carried_buffers_;
+
+  // whether a loop carried variable is double buffered in the next iteration. it starts as Info decided from the
+  // declared shapes and is cleared once an iteration produces a shape that differs from the shape it was fed.
+  std::vector<bool> double_buffer_loop_carried_vars_;
+
+  // buffer for scan outputs written in place with room for 'capacity' iterations. it is created from the output of
+  // the first iteration and grows geometrically if the trip count is not known.
+  struct ScanOutputBuffer {
+    OrtValue buffer;
+    int64_t capacity = 0;
+    size_t bytes_per_iteration = 0;
+  };
+
+  std::vector<ScanOutputBuffer> scan_output_buffers_;
+
   const Loop::ConcatOutput& concat_output_func_;
   void* stream_;
 };
@@ -422,6 +512,9 @@ Status LoopImpl::Initialize() {
   condition_mlvalue_ = MakeScalarMLValue<bool>(cpu_allocator, condition_, condition_rank != 0);
 
   loop_output_tensors_.resize(static_cast<size_t>(info_.num_outputs) - info_.num_loop_carried_vars);
+  loop_carried_buffers_.resize(info_.num_loop_carried_vars);
+  double_buffer_loop_carried_vars_ = info_.loop_carried_vars_double_buffered;
+  scan_output_buffers_.resize(static_cast<size_t>(info_.num_outputs) - info_.num_loop_carried_vars);
 
   return status;
 }
@@ -449,16 +542,140 @@ void LoopImpl::SaveOutputsAndUpdateFeeds(const std::vector<OrtValue>& last_outpu
   // last_output: cond, loop vars..., loop output...
   // next_input: iter_num, cond, loop_vars. iter_num is re-used
 
+  // the declared dims of a double buffered variable may be symbolic, so check the shapes that were actually
+  // produced. a variable whose shape changed can't be written to a buffer with the shape of its feed.
+  for (int i = 0; i < info_.num_loop_carried_vars; ++i) {
+    const OrtValue& feed = next_inputs[static_cast<ptrdiff_t>(i) + 2];     // skip iter_num and cond
+    const OrtValue& output = last_outputs[static_cast<ptrdiff_t>(i) + 1];  // skip cond
+    if (double_buffer_loop_carried_vars_[i] &&
+        (!feed.IsTensor() || !output.IsTensor() || feed.Get<Tensor>().Shape() != output.Get<Tensor>().Shape())) {
+      double_buffer_loop_carried_vars_[i] = false;
+    }
+  }
+
   // simple copy for cond and loop carried vars. start at 1 to skip iter_num in input
   for (ptrdiff_t i = 1; i < info_.num_subgraph_inputs; ++i) {
     next_inputs[i] = last_outputs[i - 1];
   }
 
-  // save loop outputs as we have to concatenate at the end
-  for (ptrdiff_t j = info_.num_loop_carried_vars; j < info_.num_outputs; ++j) {
-    ORT_ENFORCE(last_outputs[j + 1].IsTensor(), "All scan outputs MUST be tensors");
-    loop_output_tensors_[j - info_.num_loop_carried_vars].push_back(last_outputs[j + 1]);  // skip 'cond' in output
+  // save loop outputs as we have to concatenate at the end. iter_num was incremented after the last iteration.
+  const int64_t last_iter_num = *iter_num_mlvalue_.Get<Tensor>().Data<int64_t>() - 1;
+  for (int j = info_.num_loop_carried_vars; j < info_.num_outputs; ++j) {
+    // skip 'cond' in output
+    SaveScanOutput(j - info_.num_loop_carried_vars, last_outputs[static_cast<ptrdiff_t>(j) + 1], last_iter_num);
+  }
+}
+
+void LoopImpl::CreateFetches(const std::vector<OrtValue>& feeds, std::vector<OrtValue>& fetches) {
+  fetches.clear();
+  fetches.resize(info_.num_subgraph_outputs);
+
+  const int64_t iter_num = *iter_num_mlvalue_.Get<Tensor>().Data<int64_t>();
+
+  for (int i = 0; i < info_.num_loop_carried_vars; ++i) {
+    // the first iteration lets the subgraph allocate, so the shape it produces can be checked against the feed
+    const OrtValue& feed = feeds[static_cast<ptrdiff_t>(i) + 2];  // skip iter_num and cond
+    if (iter_num == 0 || !double_buffer_loop_carried_vars_[i] || !feed.IsTensor()) {
+      continue;
+    }
+
+    // the feed is the other buffer, or the Loop input in the first iteration
+    const Tensor& feed_tensor = feed.Get<Tensor>();
+    OrtValue& buffer = loop_carried_buffers_[i][iter_num % 2];
+    if (!buffer.IsAllocated() || buffer.Get<Tensor>().DataType() != feed_tensor.DataType() ||
+        buffer.Get<Tensor>().Shape() != feed_tensor.Shape()) {
+      auto allocator = session_state_.GetAllocator(feed_tensor.Location());
+      if (!allocator) {
+        continue;
+      }
+
+      Tensor::InitOrtValue(feed_tensor.DataType(), feed_tensor.Shape(), std::move(allocator), buffer);
+    }
+
+    fetches[static_cast<ptrdiff_t>(i) + 1] = buffer;  // skip cond
+  }
+
+  for (int j = info_.num_loop_carried_vars; j < info_.num_outputs; ++j) {
+    auto& scan_output = scan_output_buffers_[static_cast<ptrdiff_t>(j) - info_.num_loop_carried_vars];
+    if (!scan_output.buffer.IsAllocated()) {
+      continue;
+    }
+
+    Tensor& buffer = *scan_output.buffer.GetMutable<Tensor>();
+    if (iter_num == scan_output.capacity) {
+      // grow geometrically, but not past the trip count
+      const int64_t capacity = std::min(scan_output.capacity * 2, max_trip_count_);
+      TensorShape shape = buffer.Shape();
+      shape[0] = capacity;
+
+      OrtValue new_buffer;
+      Tensor::InitOrtValue(buffer.DataType(), shape, session_state_.GetAllocator(buffer.Location()), new_buffer);
+      memcpy(new_buffer.GetMutable<Tensor>()->MutableDataRaw(), buffer.DataRaw(),
+             static_cast<size_t>(iter_num) * scan_output.bytes_per_iteration);
+
+      scan_output.buffer = std::move(new_buffer);
+      scan_output.capacity = capacity;
+    }
+
+    Tensor& output = *scan_output.buffer.GetMutable<Tensor>();
+    Tensor::InitOrtValue(output.DataType(), output.Shape().Slice(1),
+                         static_cast<char*>(output.MutableDataRaw()) + iter_num * scan_output.bytes_per_iteration,
+                         output.Location(), fetches[static_cast<ptrdiff_t>(j) + 1]);  // skip cond
+  }
+}
+
+void LoopImpl::SaveScanOutput(int scan_output_index, const OrtValue& output, int64_t iter_num) {
+  ORT_ENFORCE(output.IsTensor(), "All scan outputs MUST be tensors");
+
+  auto& scan_output = scan_output_buffers_[scan_output_index];
+  if (scan_output.buffer.IsAllocated()) {
+    // written in place by the subgraph
+    return;
+  }
+
+  const auto& tensor = output.Get<Tensor>();
+  auto allocator = session_state_.GetAllocator(tensor.Location());
+  if (iter_num == 0 && info_.scan_outputs_in_place[scan_output_index] && allocator &&
+      tensor.Location().device.Type() == OrtDevice::CPU && !tensor.IsDataTypeString()) {
+    // Create the buffer from the output of the first iteration. It has room for every iteration if the trip count
+    // is small, or if there is no 'cond' input so the loop is expected to run that often. Otherwise a trip count
+    // such as INT64_MAX says nothing about the actual number of iterations, and the buffer grows as needed.
+    constexpr int64_t kInitialCapacity = 16;
+    constexpr int64_t kMaxSmallTripCount = 1024;
+    const bool has_trip_count = context_.Input<Tensor>(0) != nullptr;
+    const bool has_cond = context_.Input<Tensor>(1) != nullptr;
+    scan_output.capacity = has_trip_count && (!has_cond || max_trip_count_ <= kMaxSmallTripCount)
+                               ? max_trip_count_
+                               : std::min(max_trip_count_, kInitialCapacity);
+    scan_output.bytes_per_iteration = tensor.SizeInBytes();
+
+    std::vector<int64_t> dims{scan_output.capacity};
+    const auto& per_iteration_dims = tensor.Shape().GetDims();
+    dims.insert(dims.end(), per_iteration_dims.begin(), per_iteration_dims.end());
+    Tensor::InitOrtValue(tensor.DataType(), TensorShape(dims), std::move(allocator), scan_output.buffer);
+    memcpy(scan_output.buffer.GetMutable<Tensor>()->MutableDataRaw(), tensor.DataRaw(), tensor.SizeInBytes());
+    return;
   }
+
+  loop_output_tensors_[scan_output_index].push_back(output);
+}
+
+Status LoopImpl::CopyScanOutputBuffer(int scan_output_index, int output_index, int64_t num_iterations) {
+  const auto& scan_output = scan_output_buffers_[scan_output_index];
+  const auto& buffer = scan_output.buffer.Get<Tensor>();
+
+  TensorShape output_shape = buffer.Shape();
+  output_shape[0] = num_iterations;
+  Tensor* output = context_.Output(output_index, output_shape);
+  ORT_RETURN_IF(output == nullptr, "Failed to create output tensor for output ", output_index);
+
+  if (output->Location().device.Type() == OrtDevice::CPU) {
+    memcpy(output->MutableDataRaw(), buffer.DataRaw(), output->SizeInBytes());
+    return Status::OK();
+  }
+
+  Tensor used(buffer.DataType(), output_shape, const_cast<void*>(buffer.DataRaw()), buffer.Location());
+  return session_state_.GetDataTransferMgr().CopyTensor(used, *output);
 }
 
 Status LoopImpl::ConcatenateLoopOutput(std::vector<OrtValue>& per_iteration_output, int output_index) {
@@ -493,9 +710,10 @@ Status LoopImpl::Execute(const FeedsFetchesManager& ffm) {
   while (iter_num_value < max_trip_count_ && *condition_mlvalue_.GetMutable<Tensor>()->MutableData<bool>()) {
     if (iter_num_value != 0) {
       SaveOutputsAndUpdateFeeds(fetches, feeds);
-      fetches.clear();
     }
 
+    CreateFetches(feeds, fetches);
+
     status = utils::ExecuteSubgraph(session_state_, ffm, feeds, fetches, {},
                                     ExecutionMode::ORT_SEQUENTIAL, context_.GetTerminateFlag(), context_.Logger());
 
@@ -575,10 +793,14 @@ Status LoopImpl::Execute(const FeedsFetchesManager& ffm) {
 
     for (int i = info_.num_loop_carried_vars; i < info_.num_outputs; ++i) {
       // add last output
-      auto& per_iteration_outputs = loop_output_tensors_[static_cast<ptrdiff_t>(i) - info_.num_loop_carried_vars];
-      per_iteration_outputs.push_back(fetches[static_cast<ptrdiff_t>(i) + 1]);  // skip cond
+      const int scan_output_index = i - info_.num_loop_carried_vars;
+      SaveScanOutput(scan_output_index, fetches[static_cast<ptrdiff_t>(i) + 1], iter_num_value - 1);  // skip cond
 
-      ORT_RETURN_IF_ERROR(ConcatenateLoopOutput(per_iteration_outputs, i));
+      if (scan_output_buffers_[scan_output_index].buffer.IsAllocated()) {
+        ORT_RETURN_IF_ERROR(CopyScanOutputBuffer(scan_output_index, i, iter_num_value));
+      } else {
+        ORT_RETURN_IF_ERROR(ConcatenateLoopOutput(loop_output_tensors_[scan_output_index], i));
+      }
     }
   } else {
     // no iterations.
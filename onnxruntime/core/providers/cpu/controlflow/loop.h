@@ -39,6 +39,15 @@ class Loop : public controlflow::IControlFlowKernel {
     std::vector<std::string> subgraph_output_names;
 
     std::vector<const ONNX_NAMESPACE::TypeProto*> loop_carried_vars_types;
+
+    // loop carried variables whose subgraph output has the same shape as the subgraph input. the subgraph writes
+    // them into two buffers that alternate between being the feed and the fetch instead of a new allocation each
+    // iteration.
+    std::vector<bool> loop_carried_vars_double_buffered;
+
+    // scan outputs the subgraph can write directly into the Loop's buffer for them instead of a separate
+    // OrtValue per iteration that is concatenated at the end.
+    std::vector<bool> scan_outputs_in_place;
   };
 
   // function to concatenate the OrtValue instances from each Loop iteration into a single output buffer.
@@ -3,7 +3,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <limits>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 #include "tree_ensemble_aggregator.h"
+#include "core/platform/env_var_utils.h"
 #include "core/platform/ort_mutex.h"
 #include "core/platform/threadpool.h"
 #include "tree_ensemble_helper.h"
@@ -12,6 +20,12 @@ namespace onnxruntime {
 namespace ml {
 namespace detail {
 
+namespace tree_ensemble {
+// Environment variable to override the number of decision nodes per mean leaf depth up to which
+// the QuickScorer is used.
+constexpr const char* kQuickScorerMaxNodesPerDepth = "ORT_TREE_ENSEMBLE_QUICKSCORER_MAX_NODES_PER_DEPTH";
+}  // namespace tree_ensemble
+
 class TreeEnsembleCommonAttributes {
  public:
   int64_t get_target_or_class_count() const { return this->n_targets_or_classes_; }
@@ -32,15 +46,64 @@ class TreeEnsembleCommonAttributes {
   int parallel_N_;     // starts parallelizing the computing if n_rows >= parallel_N_
 };
 
+// Compiled form of the trees, built once by Init when all decision nodes share the same mode.
+// The decision nodes are stored as arrays, tree after tree, each tree breadth-first with the child
+// of higher hitrate placed first. Leaves are kept apart: a child index k < 0 refers to leaves[~k].
+template <typename ThresholdType>
+struct TreeEnsembleFlatLayout {
+  std::vector<int32_t> feature_ids;
+  std::vector<ThresholdType> thresholds;
+  // children[2 * k] is the true child of node k, children[2 * k + 1] its false child
+  std::vector<int32_t> children;
+  std::vector<uint8_t> missing_tracks_true;
+  std::vector<int32_t> roots;
+  std::vector<const TreeNodeElement<ThresholdType>*> leaves;
+};
+
+// QuickScorer form of ensembles of small BRANCH_LEQ trees without missing value tracks.
+// The leaves of a tree are numbered from left (true) to right (false) and every decision node gets
+// the mask of the leaves outside its true subtree. A row starts from all leaves of every tree and
+// clears, node by node, the masks of the conditions it fails; the exit leaf of a tree is then the
+// leftmost leaf left. The conditions are grouped by feature and sorted by threshold, those a value
+// fails are a prefix of its feature's list, so the evaluation does not branch on the tree structure.
+template <typename ThresholdType>
+struct TreeEnsembleQuickScorer {
+  // the conditions on features[f] are [feature_offsets[f], feature_offsets[f + 1])
+  std::vector<int64_t> features;
+  std::vector<size_t> feature_offsets;
+  std::vector<ThresholdType> thresholds;
+  std::vector<int32_t> tree_ids;
+  std::vector<uint64_t> masks;
+  // leaves of tree t are leaves[leaf_offsets[t]...]
+  std::vector<size_t> leaf_offsets;
+  std::vector<const TreeNodeElement<ThresholdType>*> leaves;
+};
+
 // TI: input type
 // TH: tree type (types of the node values and targets)
 // TO: output type, usually float
 template <typename InputType, typename ThresholdType, typename OutputType>
 class TreeEnsembleCommon : public TreeEnsembleCommonAttributes {
  protected:
+  // number of traversals walked together by ProcessTreeNodeLeaves
+  static constexpr int64_t kTraversalBlock = 8;
+
   std::vector<ThresholdType> base_values_;
   std::vector<TreeNodeElement<ThresholdType>> nodes_;
   std::vector<TreeNodeElement<ThresholdType>*> roots_;
+  TreeEnsembleFlatLayout<ThresholdType> flat_;
+  NODE_MODE flat_mode_;
+  bool use_flat_layout_;
+  TreeEnsembleQuickScorer<ThresholdType> quick_scorer_;
+  bool use_quick_scorer_;
+
+  // limits on the trees of an ensemble evaluated with the QuickScorer, a leaf mask is 64 bits
+  static constexpr int kQuickScorerMaxDepth = 8;
+  static constexpr size_t kQuickScorerMaxLeaves = 64;
+  // The QuickScorer visits about half the decision nodes of a tree, a traversal only one node per level
+  // but each step costs several times more. The QuickScorer is used when the decision nodes are at most
+  // this number times the mean depth of the leaves.
+  static constexpr double kQuickScorerMaxNodesPerDepth = 6;
 
  public:
   TreeEnsembleCommon() {}
@@ -76,6 +139,30 @@ class TreeEnsembleCommon : public TreeEnsembleCommonAttributes {
   TreeNodeElement<ThresholdType>* ProcessTreeNodeLeave(TreeNodeElement<ThresholdType>* root,
                                                        const InputType* x_data) const;
 
+  // Walks n <= kTraversalBlock traversals at once: traversal k evaluates tree first_tree + k * tree_step
+  // on the row x_data + k * row_stride and stores the leaf it reaches in leaves[k]. Interleaving
+  // independent traversals overlaps their memory accesses.
+  void ProcessTreeNodeLeaves(int64_t first_tree, int64_t tree_step,
+                             const InputType* x_data, int64_t row_stride, int64_t n,
+                             const TreeNodeElement<ThresholdType>** leaves) const;
+
+  template <NODE_MODE mode, bool has_missing_tracks>
+  void ProcessTreeNodeLeavesFlat(int64_t first_tree, int64_t tree_step,
+                                 const InputType* x_data, int64_t row_stride, int64_t n,
+                                 const TreeNodeElement<ThresholdType>** leaves) const;
+
+  bool BuildFlatLayout();
+
+  // Stores in leaves[t] the leaf of tree t reached by the row x_data, tree_masks is scratch of n_trees_.
+  void ProcessTreeNodeLeavesQuickScorer(const InputType* x_data, uint64_t* tree_masks,
+                                        const TreeNodeElement<ThresholdType>** leaves) const;
+
+  bool BuildQuickScorer();
+
+  template <typename AGG>
+  void ComputeAggQuickScorer(concurrency::ThreadPool* ttp, const InputType* x_data, int64_t stride, int64_t N,
+                             OutputType* z_data, int64_t* label_data, const AGG& agg) const;
+
   template <typename AGG>
   void ComputeAgg(concurrency::ThreadPool* ttp, const Tensor* X, Tensor* Y, Tensor* label, const AGG& agg) const;
 };
@@ -178,12 +265,14 @@ Status TreeEnsembleCommon<InputType, ThresholdType, OutputType>::Init(int parall
   std::vector<NODE_MODE> cmodes(nodes_modes.size());
   same_mode_ = true;
   int fpos = -1;
+  flat_mode_ = NODE_MODE::LEAF;
   for (i = 0, limit = nodes_modes.size(); i < limit; ++i) {
     cmodes[i] = MakeTreeNodeMode(nodes_modes[i]);
     if (cmodes[i] == NODE_MODE::LEAF)
       continue;
     if (fpos == -1) {
       fpos = static_cast<int>(i);
+      flat_mode_ = cmodes[i];
       continue;
     }
     if (cmodes[i] != cmodes[fpos])
@@ -297,9 +386,142 @@ Status TreeEnsembleCommon<InputType, ThresholdType, OutputType>::Init(int parall
       break;
     }
   }
+  use_flat_layout_ = BuildFlatLayout();
+  use_quick_scorer_ = BuildQuickScorer();
   return Status::OK();
 }
 
+template <typename InputType, typename ThresholdType, typename OutputType>
+bool TreeEnsembleCommon<InputType, ThresholdType, OutputType>::BuildFlatLayout() {
+  flat_ = TreeEnsembleFlatLayout<ThresholdType>();
+  if (!same_mode_ || n_nodes_ >= std::numeric_limits<int32_t>::max() / 2)
+    return false;
+
+  std::unordered_map<const TreeNodeElement<ThresholdType>*, int32_t> indices;
+  std::deque<const TreeNodeElement<ThresholdType>*> queue;
+  auto index_of = [this, &indices, &queue](const TreeNodeElement<ThresholdType>* node) {
+    auto found = indices.find(node);
+    if (found != indices.end())
+      return found->second;
+    int32_t index;
+    if (node->is_not_leaf) {
+      index = static_cast<int32_t>(flat_.feature_ids.size());
+      flat_.feature_ids.push_back(node->feature_id);
+      flat_.thresholds.push_back(node->value);
+      flat_.children.push_back(-1);
+      flat_.children.push_back(-1);
+      flat_.missing_tracks_true.push_back(node->is_missing_track_true ? 1 : 0);
+      queue.push_back(node);
+    } else {
+      index = ~static_cast<int32_t>(flat_.leaves.size());
+      flat_.leaves.push_back(node);
+    }
+    indices.insert({node, index});
+    return index;
+  };
+
+  flat_.roots.reserve(roots_.size());
+  for (const auto* root : roots_) {
+    flat_.roots.push_back(index_of(root));
+    // Indices are given in the order nodes are discovered, breadth-first, the likelier child first.
+    while (!queue.empty()) {
+      const auto* node = queue.front();
+      queue.pop_front();
+      if (node->truenode == nullptr || node->falsenode == nullptr)
+        return false;
+      const int32_t index = indices[node];
+      int32_t true_index, false_index;
+      if (node->falsenode->hitrates > node->truenode->hitrates) {
+        false_index = index_of(node->falsenode);
+        true_index = index_of(node->truenode);
+      } else {
+        true_index = index_of(node->truenode);
+        false_index = index_of(node->falsenode);
+      }
+      flat_.children[2 * index] = true_index;
+      flat_.children[2 * index + 1] = false_index;
+    }
+  }
+  return true;
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+bool TreeEnsembleCommon<InputType, ThresholdType, OutputType>::BuildQuickScorer() {
+  quick_scorer_ = TreeEnsembleQuickScorer<ThresholdType>();
+  if (!use_flat_layout_ || flat_mode_ != NODE_MODE::BRANCH_LEQ || has_missing_tracks_)
+    return false;
+
+  struct Condition {
+    int64_t feature_id;
+    ThresholdType threshold;
+    int32_t tree_id;
+    uint64_t mask;
+  };
+  std::vector<Condition> conditions;
+  auto& leaves = quick_scorer_.leaves;
+  size_t first_leaf = 0;
+  int64_t leaf_depths = 0;
+  double mean_depths = 0;
+
+  // Numbers the leaves below node from the left and returns false if the tree is too large.
+  std::function<bool(const TreeNodeElement<ThresholdType>*, int32_t, int)> add_subtree =
+      [&](const TreeNodeElement<ThresholdType>* node, int32_t tree_id, int depth) {
+        if (!node->is_not_leaf) {
+          if (leaves.size() - first_leaf >= kQuickScorerMaxLeaves)
+            return false;
+          leaves.push_back(node);
+          leaf_depths += depth;
+          return true;
+        }
+        if (depth >= kQuickScorerMaxDepth)
+          return false;
+        const size_t begin = leaves.size() - first_leaf;
+        if (!add_subtree(node->truenode, tree_id, depth + 1))
+          return false;
+        const size_t end = leaves.size() - first_leaf;
+        // the false subtree holds at least one leaf, so end < kQuickScorerMaxLeaves
+        uint64_t true_leaves = ((uint64_t(1) << end) - 1) & ~((uint64_t(1) << begin) - 1);
+        conditions.push_back({node->feature_id, node->value, tree_id, ~true_leaves});
+        return add_subtree(node->falsenode, tree_id, depth + 1);
+      };
+
+  quick_scorer_.leaf_offsets.reserve(roots_.size());
+  for (size_t j = 0; j < roots_.size(); ++j) {
+    first_leaf = leaves.size();
+    leaf_depths = 0;
+    quick_scorer_.leaf_offsets.push_back(first_leaf);
+    if (!add_subtree(roots_[j], static_cast<int32_t>(j), 0)) {
+      quick_scorer_ = TreeEnsembleQuickScorer<ThresholdType>();
+      return false;
+    }
+    mean_depths += static_cast<double>(leaf_depths) / static_cast<double>(leaves.size() - first_leaf);
+  }
+  const double max_nodes_per_depth = ParseEnvironmentVariableWithDefault<double>(
+      tree_ensemble::kQuickScorerMaxNodesPerDepth, kQuickScorerMaxNodesPerDepth);
+  if (static_cast<double>(conditions.size()) > max_nodes_per_depth * mean_depths) {
+    quick_scorer_ = TreeEnsembleQuickScorer<ThresholdType>();
+    return false;
+  }
+
+  std::stable_sort(conditions.begin(), conditions.end(), [](const Condition& a, const Condition& b) {
+    return a.feature_id < b.feature_id || (a.feature_id == b.feature_id && a.threshold < b.threshold);
+  });
+  quick_scorer_.thresholds.reserve(conditions.size());
+  quick_scorer_.tree_ids.reserve(conditions.size());
+  quick_scorer_.masks.reserve(conditions.size());
+  for (size_t k = 0; k < conditions.size(); ++k) {
+    if (k == 0 || conditions[k].feature_id != conditions[k - 1].feature_id) {
+      quick_scorer_.features.push_back(conditions[k].feature_id);
+      quick_scorer_.feature_offsets.push_back(k);
+    }
+    quick_scorer_.thresholds.push_back(conditions[k].threshold);
+    quick_scorer_.tree_ids.push_back(conditions[k].tree_id);
+    quick_scorer_.masks.push_back(conditions[k].mask);
+  }
+  quick_scorer_.feature_offsets.push_back(conditions.size());
+  return true;
+}
+
 template <typename InputType, typename ThresholdType, typename OutputType>
 Status TreeEnsembleCommon<InputType, ThresholdType, OutputType>::compute(OpKernelContext* ctx,
                                                                          const Tensor* X,
@@ -352,20 +574,37 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
   int64_t* label_data = label == nullptr ? nullptr : label->template MutableData<int64_t>();
   auto max_num_threads = concurrency::ThreadPool::DegreeOfParallelism(ttp);
 
+  // A single row with enough trees is better served by the parallelization over trees below.
+  if (use_quick_scorer_ && (N > 1 || n_trees_ <= parallel_tree_)) {
+    ComputeAggQuickScorer(ttp, x_data, stride, N, z_data, label_data, agg);
+    return;
+  }
+
   if (n_targets_or_classes_ == 1) {
     if (N == 1) {
       ScoreValue<ThresholdType> score = {0, 0};
       if (n_trees_ <= parallel_tree_) { /* section A: 1 output, 1 row and not enough trees to parallelize */
-        for (int64_t j = 0; j < n_trees_; ++j) {
-          agg.ProcessTreeNodePrediction1(score, *ProcessTreeNodeLeave(roots_[j], x_data));
+        const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
+        for (int64_t j = 0; j < n_trees_; j += kTraversalBlock) {
+          int64_t n = std::min<int64_t>(kTraversalBlock, n_trees_ - j);
+          ProcessTreeNodeLeaves(j, 1, x_data, 0, n, leaves);
+          for (int64_t k = 0; k < n; ++k) {
+            agg.ProcessTreeNodePrediction1(score, *leaves[k]);
+          }
         }
       } else { /* section B: 1 output, 1 row and enough trees to parallelize */
         std::vector<ScoreValue<ThresholdType>> scores(n_trees_, {0, 0});
         concurrency::ThreadPool::TryBatchParallelFor(
             ttp,
-            SafeInt<int32_t>(n_trees_),
-            [this, &scores, &agg, x_data](ptrdiff_t j) {
-              agg.ProcessTreeNodePrediction1(scores[j], *ProcessTreeNodeLeave(roots_[j], x_data));
+            SafeInt<int32_t>((n_trees_ + kTraversalBlock - 1) / kTraversalBlock),
+            [this, &scores, &agg, x_data](ptrdiff_t block) {
+              const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
+              int64_t j = block * kTraversalBlock;
+              int64_t n = std::min<int64_t>(kTraversalBlock, n_trees_ - j);
+              ProcessTreeNodeLeaves(j, 1, x_data, 0, n, leaves);
+              for (int64_t k = 0; k < n; ++k) {
+                agg.ProcessTreeNodePrediction1(scores[j + k], *leaves[k]);
+              }
             },
             0);
 
@@ -375,17 +614,23 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
       }
       agg.FinalizeScores1(z_data, score, label_data);
     } else if (N <= parallel_N_) { /* section C: 1 output, 2+ rows but not enough rows to parallelize */
-      ScoreValue<ThresholdType> score;
-      size_t j;
+      ScoreValue<ThresholdType> scores[kTraversalBlock];
+      const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
 
-      for (int64_t i = 0; i < N; ++i) {
-        score = {0, 0};
-        for (j = 0; j < static_cast<size_t>(n_trees_); ++j) {
-          agg.ProcessTreeNodePrediction1(score, *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
+      for (int64_t i = 0; i < N; i += kTraversalBlock) {
+        int64_t n = std::min<int64_t>(kTraversalBlock, N - i);
+        std::fill(scores, scores + n, ScoreValue<ThresholdType>({0, 0}));
+        for (int64_t j = 0; j < n_trees_; ++j) {
+          ProcessTreeNodeLeaves(j, 0, x_data + i * stride, stride, n, leaves);
+          for (int64_t k = 0; k < n; ++k) {
+            agg.ProcessTreeNodePrediction1(scores[k], *leaves[k]);
+          }
         }
 
-        agg.FinalizeScores1(z_data + i, score,
-                            label_data == nullptr ? nullptr : (label_data + i));
+        for (int64_t k = 0; k < n; ++k) {
+          agg.FinalizeScores1(z_data + i + k, scores[k],
+                              label_data == nullptr ? nullptr : (label_data + i + k));
+        }
       }
     } else if (n_trees_ > max_num_threads) { /* section D: 1 output, 2+ rows and enough trees to parallelize */
       auto num_threads = std::min<int32_t>(max_num_threads, SafeInt<int32_t>(n_trees_));
@@ -394,14 +639,18 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
           ttp,
           num_threads,
           [this, &agg, &scores, num_threads, x_data, N, stride](ptrdiff_t batch_num) {
+            const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
             auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, this->n_trees_);
             for (int64_t i = 0; i < N; ++i) {
               scores[batch_num * N + i] = {0, 0};
             }
             for (auto j = work.start; j < work.end; ++j) {
-              for (int64_t i = 0; i < N; ++i) {
-                agg.ProcessTreeNodePrediction1(scores[batch_num * N + i],
-                                               *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
+              for (int64_t i = 0; i < N; i += kTraversalBlock) {
+                int64_t n = std::min<int64_t>(kTraversalBlock, N - i);
+                ProcessTreeNodeLeaves(j, 0, x_data + i * stride, stride, n, leaves);
+                for (int64_t k = 0; k < n; ++k) {
+                  agg.ProcessTreeNodePrediction1(scores[batch_num * N + i + k], *leaves[k]);
+                }
               }
             }
           });
@@ -422,15 +671,24 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
     } else { /* section E: 1 output, 2+ rows, parallelization by rows */
       concurrency::ThreadPool::TryBatchParallelFor(
           ttp,
-          SafeInt<int32_t>(N),
-          [this, &agg, x_data, z_data, stride, label_data](ptrdiff_t i) {
-            ScoreValue<ThresholdType> score = {0, 0};
-            for (size_t j = 0; j < static_cast<size_t>(n_trees_); ++j) {
-              agg.ProcessTreeNodePrediction1(score, *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
+          SafeInt<int32_t>((N + kTraversalBlock - 1) / kTraversalBlock),
+          [this, &agg, x_data, z_data, stride, label_data, N](ptrdiff_t block) {
+            ScoreValue<ThresholdType> scores[kTraversalBlock];
+            const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
+            int64_t i = block * kTraversalBlock;
+            int64_t n = std::min<int64_t>(kTraversalBlock, N - i);
+            std::fill(scores, scores + n, ScoreValue<ThresholdType>({0, 0}));
+            for (int64_t j = 0; j < n_trees_; ++j) {
+              ProcessTreeNodeLeaves(j, 0, x_data + i * stride, stride, n, leaves);
+              for (int64_t k = 0; k < n; ++k) {
+                agg.ProcessTreeNodePrediction1(scores[k], *leaves[k]);
+              }
             }
 
-            agg.FinalizeScores1(z_data + i, score,
-                                label_data == nullptr ? nullptr : (label_data + i));
+            for (int64_t k = 0; k < n; ++k) {
+              agg.FinalizeScores1(z_data + i + k, scores[k],
+                                  label_data == nullptr ? nullptr : (label_data + i + k));
+            }
           },
           0);
     }
@@ -438,8 +696,13 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
     if (N == 1) {                       /* section A2: 2+ outputs, 1 row, not enough trees to parallelize */
       if (n_trees_ <= parallel_tree_) { /* section A2 */
         InlinedVector<ScoreValue<ThresholdType>> scores(n_targets_or_classes_, {0, 0});
-        for (int64_t j = 0; j < n_trees_; ++j) {
-          agg.ProcessTreeNodePrediction(scores, *ProcessTreeNodeLeave(roots_[j], x_data));
+        const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
+        for (int64_t j = 0; j < n_trees_; j += kTraversalBlock) {
+          int64_t n = std::min<int64_t>(kTraversalBlock, n_trees_ - j);
+          ProcessTreeNodeLeaves(j, 1, x_data, 0, n, leaves);
+          for (int64_t k = 0; k < n; ++k) {
+            agg.ProcessTreeNodePrediction(scores, *leaves[k]);
+          }
         }
         agg.FinalizeScores(scores, z_data, -1, label_data);
       } else { /* section B2: 2+ outputs, 1 row, enough trees to parallelize */
@@ -449,10 +712,15 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
             ttp,
             num_threads,
             [this, &agg, &scores, num_threads, x_data](ptrdiff_t batch_num) {
+              const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
               scores[batch_num].resize(n_targets_or_classes_, {0, 0});
               auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, n_trees_);
-              for (auto j = work.start; j < work.end; ++j) {
-                agg.ProcessTreeNodePrediction(scores[batch_num], *ProcessTreeNodeLeave(roots_[j], x_data));
+              for (auto j = work.start; j < work.end; j += kTraversalBlock) {
+                int64_t n = std::min<int64_t>(kTraversalBlock, work.end - j);
+                ProcessTreeNodeLeaves(j, 1, x_data, 0, n, leaves);
+                for (int64_t k = 0; k < n; ++k) {
+                  agg.ProcessTreeNodePrediction(scores[batch_num], *leaves[k]);
+                }
               }
             });
         for (size_t i = 1, limit = scores.size(); i < limit; ++i) {
@@ -461,17 +729,26 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
         agg.FinalizeScores(scores[0], z_data, -1, label_data);
       }
     } else if (N <= parallel_N_) { /* section C2: 2+ outputs, 2+ rows, not enough rows to parallelize */
-      InlinedVector<ScoreValue<ThresholdType>> scores(n_targets_or_classes_);
-      size_t j, limit;
+      std::vector<InlinedVector<ScoreValue<ThresholdType>>> scores(
+          kTraversalBlock, InlinedVector<ScoreValue<ThresholdType>>(n_targets_or_classes_));
+      const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
 
-      for (int64_t i = 0; i < N; ++i) {
-        std::fill(scores.begin(), scores.end(), ScoreValue<ThresholdType>({0, 0}));
-        for (j = 0, limit = roots_.size(); j < limit; ++j) {
-          agg.ProcessTreeNodePrediction(scores, *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
+      for (int64_t i = 0; i < N; i += kTraversalBlock) {
+        int64_t n = std::min<int64_t>(kTraversalBlock, N - i);
+        for (int64_t k = 0; k < n; ++k) {
+          std::fill(scores[k].begin(), scores[k].end(), ScoreValue<ThresholdType>({0, 0}));
+        }
+        for (int64_t j = 0; j < n_trees_; ++j) {
+          ProcessTreeNodeLeaves(j, 0, x_data + i * stride, stride, n, leaves);
+          for (int64_t k = 0; k < n; ++k) {
+            agg.ProcessTreeNodePrediction(scores[k], *leaves[k]);
+          }
         }
 
-        agg.FinalizeScores(scores, z_data + i * n_targets_or_classes_, -1,
-                           label_data == nullptr ? nullptr : (label_data + i));
+        for (int64_t k = 0; k < n; ++k) {
+          agg.FinalizeScores(scores[k], z_data + (i + k) * n_targets_or_classes_, -1,
+                             label_data == nullptr ? nullptr : (label_data + i + k));
+        }
       }
     } else if (n_trees_ >= max_num_threads) { /* section: D2: 2+ outputs, 2+ rows, enough trees to parallelize*/
       auto num_threads = std::min<int32_t>(max_num_threads, SafeInt<int32_t>(n_trees_));
@@ -480,14 +757,18 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
           ttp,
           num_threads,
           [this, &agg, &scores, num_threads, x_data, N, stride](ptrdiff_t batch_num) {
+            const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
             auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, this->n_trees_);
             for (int64_t i = 0; i < N; ++i) {
               scores[batch_num * N + i].resize(n_targets_or_classes_, {0, 0});
             }
             for (auto j = work.start; j < work.end; ++j) {
-              for (int64_t i = 0; i < N; ++i) {
-                agg.ProcessTreeNodePrediction(scores[batch_num * N + i],
-                                              *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
+              for (int64_t i = 0; i < N; i += kTraversalBlock) {
+                int64_t n = std::min<int64_t>(kTraversalBlock, N - i);
+                ProcessTreeNodeLeaves(j, 0, x_data + i * stride, stride, n, leaves);
+                for (int64_t k = 0; k < n; ++k) {
+                  agg.ProcessTreeNodePrediction(scores[batch_num * N + i + k], *leaves[k]);
+                }
               }
             }
           });
@@ -511,19 +792,28 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
           ttp,
           num_threads,
           [this, &agg, num_threads, x_data, z_data, label_data, N, stride](ptrdiff_t batch_num) {
-            size_t j, limit;
-            InlinedVector<ScoreValue<ThresholdType>> scores(n_targets_or_classes_);
+            std::vector<InlinedVector<ScoreValue<ThresholdType>>> scores(
+                kTraversalBlock, InlinedVector<ScoreValue<ThresholdType>>(n_targets_or_classes_));
+            const TreeNodeElement<ThresholdType>* leaves[kTraversalBlock];
             auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, N);
 
-            for (auto i = work.start; i < work.end; ++i) {
-              std::fill(scores.begin(), scores.end(), ScoreValue<ThresholdType>({0, 0}));
-              for (j = 0, limit = roots_.size(); j < limit; ++j) {
-                agg.ProcessTreeNodePrediction(scores, *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
+            for (auto i = work.start; i < work.end; i += kTraversalBlock) {
+              int64_t n = std::min<int64_t>(kTraversalBlock, work.end - i);
+              for (int64_t k = 0; k < n; ++k) {
+                std::fill(scores[k].begin(), scores[k].end(), ScoreValue<ThresholdType>({0, 0}));
+              }
+              for (int64_t j = 0; j < n_trees_; ++j) {
+                ProcessTreeNodeLeaves(j, 0, x_data + i * stride, stride, n, leaves);
+                for (int64_t k = 0; k < n; ++k) {
+                  agg.ProcessTreeNodePrediction(scores[k], *leaves[k]);
+                }
               }
 
-              agg.FinalizeScores(scores,
-                                 z_data + i * n_targets_or_classes_, -1,
-                                 label_data == nullptr ? nullptr : (label_data + i));
+              for (int64_t k = 0; k < n; ++k) {
+                agg.FinalizeScores(scores[k],
+                                   z_data + (i + k) * n_targets_or_classes_, -1,
+                                   label_data == nullptr ? nullptr : (label_data + i + k));
+              }
             }
           });
     }
@@ -636,6 +926,194 @@ TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeave(
   return root;
 }
 
+template <NODE_MODE mode, typename InputType, typename ThresholdType>
+inline bool TreeNodeCompare(InputType val, ThresholdType threshold) {
+  if constexpr (mode == NODE_MODE::BRANCH_LEQ)
+    return val <= threshold;
+  else if constexpr (mode == NODE_MODE::BRANCH_LT)
+    return val < threshold;
+  else if constexpr (mode == NODE_MODE::BRANCH_GTE)
+    return val >= threshold;
+  else if constexpr (mode == NODE_MODE::BRANCH_GT)
+    return val > threshold;
+  else if constexpr (mode == NODE_MODE::BRANCH_EQ)
+    return val == threshold;
+  else
+    return val != threshold;
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <NODE_MODE mode, bool has_missing_tracks>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeavesFlat(
+    int64_t first_tree, int64_t tree_step, const InputType* x_data, int64_t row_stride, int64_t n,
+    const TreeNodeElement<ThresholdType>** leaves) const {
+  const int32_t* feature_ids = flat_.feature_ids.data();
+  const ThresholdType* thresholds = flat_.thresholds.data();
+  const int32_t* children = flat_.children.data();
+  const uint8_t* missing_tracks_true = flat_.missing_tracks_true.data();
+
+  int32_t nodes[kTraversalBlock];
+  bool active = false;
+  for (int64_t k = 0; k < n; ++k) {
+    nodes[k] = flat_.roots[first_tree + k * tree_step];
+    active = active || nodes[k] >= 0;
+  }
+
+  // One step of every unfinished traversal per pass, the loads of a pass do not depend on each other.
+  while (active) {
+    active = false;
+    for (int64_t k = 0; k < n; ++k) {
+      int32_t node = nodes[k];
+      if (node < 0)
+        continue;
+      const InputType val = x_data[k * row_stride + feature_ids[node]];
+      bool cond = TreeNodeCompare<mode>(val, thresholds[node]);
+      if constexpr (has_missing_tracks) {
+        cond = cond || (missing_tracks_true[node] && _isnan_(val));
+      }
+      node = children[2 * node + (cond ? 0 : 1)];
+      nodes[k] = node;
+      active = active || node >= 0;
+    }
+  }
+
+  for (int64_t k = 0; k < n; ++k) {
+    leaves[k] = flat_.leaves[~nodes[k]];
+  }
+}
+
+#define TREE_FLAT_LEAVES(MODE)                                                                               \
+  if (has_missing_tracks_)                                                                                   \
+    ProcessTreeNodeLeavesFlat<NODE_MODE::MODE, true>(first_tree, tree_step, x_data, row_stride, n, leaves);  \
+  else                                                                                                       \
+    ProcessTreeNodeLeavesFlat<NODE_MODE::MODE, false>(first_tree, tree_step, x_data, row_stride, n, leaves);
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeaves(
+    int64_t first_tree, int64_t tree_step, const InputType* x_data, int64_t row_stride, int64_t n,
+    const TreeNodeElement<ThresholdType>** leaves) const {
+  if (!use_flat_layout_) {
+    for (int64_t k = 0; k < n; ++k) {
+      leaves[k] = ProcessTreeNodeLeave(roots_[first_tree + k * tree_step], x_data + k * row_stride);
+    }
+    return;
+  }
+  switch (flat_mode_) {
+    case NODE_MODE::BRANCH_LEQ:
+      TREE_FLAT_LEAVES(BRANCH_LEQ)
+      break;
+    case NODE_MODE::BRANCH_LT:
+      TREE_FLAT_LEAVES(BRANCH_LT)
+      break;
+    case NODE_MODE::BRANCH_GTE:
+      TREE_FLAT_LEAVES(BRANCH_GTE)
+      break;
+    case NODE_MODE::BRANCH_GT:
+      TREE_FLAT_LEAVES(BRANCH_GT)
+      break;
+    case NODE_MODE::BRANCH_EQ:
+      TREE_FLAT_LEAVES(BRANCH_EQ)
+      break;
+    case NODE_MODE::BRANCH_NEQ:
+      TREE_FLAT_LEAVES(BRANCH_NEQ)
+      break;
+    case NODE_MODE::LEAF:
+      // every tree is a single leaf
+      for (int64_t k = 0; k < n; ++k) {
+        leaves[k] = flat_.leaves[~flat_.roots[first_tree + k * tree_step]];
+      }
+      break;
+  }
+}
+
+#undef TREE_FLAT_LEAVES
+
+// index of the lowest bit set, leaves != 0
+inline int TreeLeafIndex(uint64_t leaves) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(leaves);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long index;
+  _BitScanForward64(&index, leaves);
+  return static_cast<int>(index);
+#else
+  int index = 0;
+  while ((leaves & 1) == 0) {
+    leaves >>= 1;
+    ++index;
+  }
+  return index;
+#endif
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeavesQuickScorer(
+    const InputType* x_data, uint64_t* tree_masks, const TreeNodeElement<ThresholdType>** leaves) const {
+  const ThresholdType* thresholds = quick_scorer_.thresholds.data();
+  const int32_t* tree_ids = quick_scorer_.tree_ids.data();
+  const uint64_t* masks = quick_scorer_.masks.data();
+
+  std::fill(tree_masks, tree_masks + n_trees_, ~uint64_t(0));
+  for (size_t f = 0, limit = quick_scorer_.features.size(); f < limit; ++f) {
+    const InputType val = x_data[quick_scorer_.features[f]];
+    // NaN fails every condition, like it does in ProcessTreeNodeLeave.
+    for (size_t k = quick_scorer_.feature_offsets[f], end = quick_scorer_.feature_offsets[f + 1];
+         k < end && !(val <= thresholds[k]); ++k) {
+      tree_masks[tree_ids[k]] &= masks[k];
+    }
+  }
+
+  const size_t* leaf_offsets = quick_scorer_.leaf_offsets.data();
+  for (int64_t j = 0; j < n_trees_; ++j) {
+    leaves[j] = quick_scorer_.leaves[leaf_offsets[j] + TreeLeafIndex(tree_masks[j])];
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <typename AGG>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAggQuickScorer(
+    concurrency::ThreadPool* ttp, const InputType* x_data, int64_t stride, int64_t N,
+    OutputType* z_data, int64_t* label_data, const AGG& agg) const {
+  auto compute_rows = [this, &agg, x_data, stride, z_data, label_data](int64_t begin, int64_t end) {
+    std::vector<uint64_t> tree_masks(n_trees_);
+    std::vector<const TreeNodeElement<ThresholdType>*> leaves(n_trees_);
+    if (n_targets_or_classes_ == 1) {
+      for (int64_t i = begin; i < end; ++i) {
+        ScoreValue<ThresholdType> score = {0, 0};
+        ProcessTreeNodeLeavesQuickScorer(x_data + i * stride, tree_masks.data(), leaves.data());
+        for (int64_t j = 0; j < n_trees_; ++j) {
+          agg.ProcessTreeNodePrediction1(score, *leaves[j]);
+        }
+        agg.FinalizeScores1(z_data + i, score, label_data == nullptr ? nullptr : (label_data + i));
+      }
+    } else {
+      InlinedVector<ScoreValue<ThresholdType>> scores(n_targets_or_classes_);
+      for (int64_t i = begin; i < end; ++i) {
+        std::fill(scores.begin(), scores.end(), ScoreValue<ThresholdType>({0, 0}));
+        ProcessTreeNodeLeavesQuickScorer(x_data + i * stride, tree_masks.data(), leaves.data());
+        for (int64_t j = 0; j < n_trees_; ++j) {
+          agg.ProcessTreeNodePrediction(scores, *leaves[j]);
+        }
+        agg.FinalizeScores(scores, z_data + i * n_targets_or_classes_, -1,
+                           label_data == nullptr ? nullptr : (label_data + i));
+      }
+    }
+  };
+
+  if (N <= parallel_N_) {
+    compute_rows(0, N);
+    return;
+  }
+  auto num_threads = std::min<int32_t>(concurrency::ThreadPool::DegreeOfParallelism(ttp), SafeInt<int32_t>(N));
+  concurrency::ThreadPool::TrySimpleParallelFor(
+      ttp,
+      num_threads,
+      [&compute_rows, num_threads, N](ptrdiff_t batch_num) {
+        auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, N);
+        compute_rows(work.start, work.end);
+      });
+}
+
 // TI: input type
 // TH: threshold type, double if T==double, float otherwise
 // TO: output type
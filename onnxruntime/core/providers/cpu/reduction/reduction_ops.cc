@@ -230,7 +230,7 @@ bool operator!=(FastReduceKind a, FastReduceKind b) {
 }
 
 bool ResultsNoTransposePrepareForReduce::equal(gsl::span<const int64_t> local_input_shape,
-                                               gsl::span<const int64_t> local_reduced_axes) {
+                                               gsl::span<const int64_t> local_reduced_axes) const {
   if (gsl::make_span(input_shape) != local_input_shape)
     return false;
   if (gsl::make_span(reduced_axes) != local_reduced_axes)
@@ -238,7 +238,7 @@ bool ResultsNoTransposePrepareForReduce::equal(gsl::span<const int64_t> local_in
   return true;
 }
 
-void ResultsNoTransposePrepareForReduce::ValidateNotEmpty() {
+void ResultsNoTransposePrepareForReduce::ValidateNotEmpty() const {
   ORT_ENFORCE(last_loop_red_size > 0);
   ORT_ENFORCE(last_loop_size > 0);
   ORT_ENFORCE(projected_index.size() > 0);
@@ -284,6 +284,10 @@ void ReduceAggregatorBase::FastReduceRKR(const Tensor&, const gsl::span<const in
 void NoTransposePrepareForReduce(const TensorShape& new_input_shape,
                                  gsl::span<const int64_t> reduced_axes,
                                  ResultsNoTransposePrepareForReduce& results) {
+  results.input_shape = new_input_shape.AsShapeVector();
+  results.reduced_axes.assign(reduced_axes.begin(), reduced_axes.end());
+  results.unprojected_index.clear();
+
   // Common initialisation for the indices.
   auto cumulative_shape = new_input_shape.AsShapeVector();
   cumulative_shape[cumulative_shape.size() - 1] = 1;
@@ -386,7 +390,7 @@ template <typename AGG>
 struct ParallelizedData {
   int64_t denominator;
   int64_t loop_size;
-  ResultsNoTransposePrepareForReduce* last_results;
+  const ResultsNoTransposePrepareForReduce* last_results;
   const typename AGG::input_type* from_data;
   typename AGG::value_type* to_data;
 };
@@ -394,7 +398,7 @@ struct ParallelizedData {
 template <typename AGG>
 void NoTransposeReduce1Loop(Tensor* output, const TensorShape& new_input_shape, const Tensor& input,
                             gsl::span<const int64_t> reduced_axes, concurrency::ThreadPool* tp,
-                            ResultsNoTransposePrepareForReduce& last_results) {
+                            const ResultsNoTransposePrepareForReduce& last_results) {
   auto output_shape = output->Shape();
   const typename AGG::input_type* from_data = input.template Data<typename AGG::input_type>();
   typename AGG::value_type* to_data = output->template MutableData<typename AGG::value_type>();
@@ -407,11 +411,10 @@ void NoTransposeReduce1Loop(Tensor* output, const TensorShape& new_input_shape,
     return;
   }
 
-  if (!last_results.equal(new_input_shape.GetDims(), reduced_axes)) {
-    NoTransposePrepareForReduce(new_input_shape, reduced_axes, last_results);
-    if (last_results.last_loop_red_size == 0 || last_results.last_loop_size == 0)
-      return;
-  }
+  ORT_ENFORCE(last_results.equal(new_input_shape.GetDims(), reduced_axes),
+              "The reduction was not prepared for this shape and these axes.");
+  if (last_results.last_loop_red_size == 0 || last_results.last_loop_size == 0)
+    return;
   last_results.ValidateNotEmpty();
 
   ParallelizedData<AGG> data;
@@ -459,7 +462,7 @@ void NoTransposeReduce1Loop(Tensor* output, const TensorShape& new_input_shape,
 template <typename AGG>
 void NoTransposeReduce2Loops(Tensor* output, const TensorShape& new_input_shape, const Tensor& input,
                              gsl::span<const int64_t> reduced_axes, concurrency::ThreadPool* tp,
-                             ResultsNoTransposePrepareForReduce& last_results) {
+                             const ResultsNoTransposePrepareForReduce& last_results) {
   auto output_shape = output->Shape();
   const typename AGG::input_type* from_data = input.template Data<typename AGG::input_type>();
   typename AGG::value_type* to_data = output->template MutableData<typename AGG::value_type>();
@@ -472,11 +475,10 @@ void NoTransposeReduce2Loops(Tensor* output, const TensorShape& new_input_shape,
     return;
   }
 
-  if (!last_results.equal(new_input_shape.GetDims(), reduced_axes)) {
-    NoTransposePrepareForReduce(new_input_shape, reduced_axes, last_results);
-    if (last_results.last_loop_red_size == 0 || last_results.last_loop_size == 0)
-      return;
-  }
+  ORT_ENFORCE(last_results.equal(new_input_shape.GetDims(), reduced_axes),
+              "The reduction was not prepared for this shape and these axes.");
+  if (last_results.last_loop_red_size == 0 || last_results.last_loop_size == 0)
+    return;
   last_results.ValidateNotEmpty();
 
   ParallelizedData<AGG> data;
@@ -665,97 +667,157 @@ bool CommonFastReduceCopy(OpKernelContext* ctx, TensorShapeVector& input_axes, b
   return false;
 }
 
-typedef void fast_reduce_fct(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
-                             Tensor& output, concurrency::ThreadPool* tp);
+std::shared_ptr<const ReducePlan> ReducePlanCache::Find(gsl::span<const int64_t> input_shape,
+                                                        gsl::span<const int64_t> axes) const {
+  std::lock_guard<OrtMutex> lock(mutex_);
+  if (plan_ != nullptr && gsl::make_span(plan_->input_shape) == input_shape && gsl::make_span(plan_->axes) == axes) {
+    return plan_;
+  }
+  return nullptr;
+}
 
-bool CommonFastReduceSwitch(OpKernelContext* ctx,
-                            const gsl::span<const int64_t>& axes_,
-                            int64_t keepdims_,
-                            bool noop_with_empty_axes,
-                            FastReduceKind& fast_kind,
-                            TensorShapeVector& fast_shape,
-                            TensorShapeVector& output_shape,
-                            TensorShapeVector& fast_axes,
-                            FastReduceKind which_fast_reduce,
-                            fast_reduce_fct* case_kr,
-                            fast_reduce_fct* case_rk,
-                            fast_reduce_fct* case_krk,
-                            fast_reduce_fct* case_rkr) {
-  TensorShapeVector axes;
-  const Tensor* input = ctx->Input<Tensor>(0);
-  auto reduced_dims = input->Shape().GetDims();
-  TensorShapeVector input_axes;
+void ReducePlanCache::Store(std::shared_ptr<const ReducePlan> plan) {
+  std::lock_guard<OrtMutex> lock(mutex_);
+  plan_ = std::move(plan);
+}
 
-  if (CommonFastReduceCopy(ctx, input_axes, noop_with_empty_axes)) {
-    return true;
+// A column of the fast RK implementations is processed with vector operations
+// while the generic implementation walks it with a stride.
+static constexpr int64_t kMinFastReduceRKColumns = 8;
+
+static std::shared_ptr<const ReducePlan> MakeReducePlan(gsl::span<const int64_t> input_shape,
+                                                        gsl::span<const int64_t> axes,
+                                                        bool keepdims,
+                                                        bool noop_with_empty_axes,
+                                                        FastReduceKind which_fast_reduce,
+                                                        concurrency::ThreadPool* tp) {
+  auto plan = std::make_shared<ReducePlan>();
+  plan->input_shape.assign(input_shape.begin(), input_shape.end());
+  plan->axes.assign(axes.begin(), axes.end());
+  plan->fast_kind = OptimizeShapeForFastReduce(input_shape, axes, plan->fast_shape, plan->output_shape,
+                                               plan->fast_axes, keepdims, noop_with_empty_axes);
+  plan->fast_impl = FastReduceKind::kNone;
+
+  // Dimensions equal to 1 may split the reduced or the kept dimensions: [N, 1, D] reduced on axes (0, 2)
+  // is a RKR reduction but becomes a reduction of all values once they are removed.
+  // The output shape does not change.
+  const auto rank = gsl::narrow<int64_t>(input_shape.size());
+  if (!axes.empty() && plan->fast_kind != FastReduceKind::kEmpty && plan->fast_kind != FastReduceKind::kR &&
+      std::find(input_shape.begin(), input_shape.end(), 1) != input_shape.end()) {
+    TensorShapeVector squeezed_shape, squeezed_axes;
+    for (int64_t i = 0; i < rank; ++i) {
+      if (input_shape[i] == 1)
+        continue;
+      if (std::any_of(axes.begin(), axes.end(), [i, rank](int64_t a) { return HandleNegativeAxis(a, rank) == i; }))
+        squeezed_axes.push_back(static_cast<int64_t>(squeezed_shape.size()));
+      squeezed_shape.push_back(input_shape[i]);
+    }
+    // Nothing is left to reduce if all reduced dimensions are equal to 1.
+    if (!squeezed_axes.empty()) {
+      TensorShapeVector squeezed_output_shape;
+      plan->fast_kind = OptimizeShapeForFastReduce(squeezed_shape, squeezed_axes, plan->fast_shape,
+                                                   squeezed_output_shape, plan->fast_axes, keepdims);
+    }
   }
 
-  fast_kind = OptimizeShapeForFastReduce(
-      reduced_dims, input_axes.empty() ? axes_ : input_axes,
-      fast_shape, output_shape, fast_axes, keepdims_ != 0, noop_with_empty_axes);
-
-  if (which_fast_reduce != FastReduceKind::kNone) {
-    if (IsFastReduceKindAvailable(fast_kind, which_fast_reduce)) {
-      Tensor* output = ctx->Output(0, output_shape);
-      switch (fast_kind) {
-        case FastReduceKind::kKR: {
-          ValidateFastReduceKR(fast_shape, *output);
-          case_kr(*input, fast_shape, *output, ctx->GetOperatorThreadPool());
-          return true;
+  if (IsFastReduceKindAvailable(plan->fast_kind, which_fast_reduce)) {
+    const auto& fast_shape = plan->fast_shape;
+    const int dop = concurrency::ThreadPool::DegreeOfParallelism(tp);
+    switch (plan->fast_kind) {
+      case FastReduceKind::kKR:
+        plan->fast_impl = FastReduceKind::kKR;
+        break;
+      case FastReduceKind::kRK:
+        // See benchmarks in PR #7719.
+        if (((fast_shape[0] > dop * 16) && (std::max(fast_shape[0], fast_shape[1]) > dop * 256)) ||
+            fast_shape[1] >= kMinFastReduceRKColumns) {
+          plan->fast_impl = FastReduceKind::kRK;
         }
-        case FastReduceKind::kRK: {
-          ValidateFastReduceRK(fast_shape, *output);
-          if ((fast_shape[0] > concurrency::ThreadPool::DegreeOfParallelism(ctx->GetOperatorThreadPool()) * 16) &&
-              (std::max(fast_shape[0], fast_shape[1]) >
-               concurrency::ThreadPool::DegreeOfParallelism(ctx->GetOperatorThreadPool()) * 256)) {
-            // See benchmarks in PR #7719.
-            case_rk(*input, fast_shape, *output, ctx->GetOperatorThreadPool());
-            return true;
-          } else {
-            break;
-          }
+        break;
+      case FastReduceKind::kKRK:
+        // See benchmarks in PR #7719.
+        if (fast_shape[0] >= std::max(2, dop)) {
+          plan->fast_impl = FastReduceKind::kKRK;
         }
-        case FastReduceKind::kKRK:
-          ValidateFastReduceKRK(fast_shape, *output);
-          if (fast_shape[0] >= std::max(2, concurrency::ThreadPool::DegreeOfParallelism(ctx->GetOperatorThreadPool()))) {
-            // See benchmarks in PR #7719.
-            case_krk(*input, fast_shape, *output, ctx->GetOperatorThreadPool());
-            return true;
-          } else {
-            break;
-          }
-        case FastReduceKind::kRKR:
-          ValidateFastReduceRKR(fast_shape, *output);
-          if (fast_shape[1] >= std::max(2, concurrency::ThreadPool::DegreeOfParallelism(ctx->GetOperatorThreadPool()))) {
-            case_rkr(*input, fast_shape, *output, ctx->GetOperatorThreadPool());
-            return true;
-          } else {
-            break;
-          }
-        case FastReduceKind::kR:
-        case FastReduceKind::kK:
-        case FastReduceKind::kNone:
-        default:
-          // Former implementation prevails in this case.
-          break;
-      }
+        break;
+      case FastReduceKind::kRKR:
+        if (fast_shape[1] >= std::max(2, dop)) {
+          plan->fast_impl = FastReduceKind::kRKR;
+        }
+        break;
+      case FastReduceKind::kR:
+      case FastReduceKind::kK:
+      case FastReduceKind::kNone:
+      default:
+        // Former implementation prevails in this case.
+        break;
     }
   }
-  return false;
+
+  if (plan->fast_impl == FastReduceKind::kNone && plan->fast_kind != FastReduceKind::kEmpty &&
+      plan->fast_axes.size() != 0 && plan->fast_axes.size() != plan->fast_shape.size()) {
+    NoTransposePrepareForReduce(TensorShape(plan->fast_shape), plan->fast_axes, plan->results);
+  }
+  return plan;
+}
+
+static std::shared_ptr<const ReducePlan> GetReducePlan(gsl::span<const int64_t> input_shape,
+                                                       gsl::span<const int64_t> axes,
+                                                       bool keepdims,
+                                                       bool noop_with_empty_axes,
+                                                       FastReduceKind which_fast_reduce,
+                                                       concurrency::ThreadPool* tp,
+                                                       ReducePlanCache* plan_cache) {
+  if (plan_cache != nullptr) {
+    auto plan = plan_cache->Find(input_shape, axes);
+    if (plan != nullptr) {
+      return plan;
+    }
+  }
+  auto plan = MakeReducePlan(input_shape, axes, keepdims, noop_with_empty_axes, which_fast_reduce, tp);
+  if (plan_cache != nullptr) {
+    plan_cache->Store(plan);
+  }
+  return plan;
+}
+
+typedef void fast_reduce_fct(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                             Tensor& output, concurrency::ThreadPool* tp);
+
+bool CommonFastReduceSwitch(const ReducePlan& plan,
+                            const Tensor& input,
+                            Tensor& output,
+                            concurrency::ThreadPool* tp,
+                            fast_reduce_fct* case_kr,
+                            fast_reduce_fct* case_rk,
+                            fast_reduce_fct* case_krk,
+                            fast_reduce_fct* case_rkr) {
+  switch (plan.fast_impl) {
+    case FastReduceKind::kKR:
+      ValidateFastReduceKR(plan.fast_shape, output);
+      case_kr(input, plan.fast_shape, output, tp);
+      return true;
+    case FastReduceKind::kRK:
+      ValidateFastReduceRK(plan.fast_shape, output);
+      case_rk(input, plan.fast_shape, output, tp);
+      return true;
+    case FastReduceKind::kKRK:
+      ValidateFastReduceKRK(plan.fast_shape, output);
+      case_krk(input, plan.fast_shape, output, tp);
+      return true;
+    case FastReduceKind::kRKR:
+      ValidateFastReduceRKR(plan.fast_shape, output);
+      case_rkr(input, plan.fast_shape, output, tp);
+      return true;
+    default:
+      return false;
+  }
 }
 
 template <typename AGG>
-bool CommonFastReduce(OpKernelContext* ctx,
-                      const gsl::span<const int64_t>& axes_,
-                      int64_t keepdims_,
-                      bool noop_with_empty_axes,
-                      FastReduceKind& fast_kind,
-                      TensorShapeVector& fast_shape,
-                      TensorShapeVector& output_shape,
-                      TensorShapeVector& fast_axes) {
-  return CommonFastReduceSwitch(ctx, axes_, keepdims_, noop_with_empty_axes,
-                                fast_kind, fast_shape, output_shape, fast_axes,
-                                AGG::WhichFastReduce(), &AGG::FastReduceKR, &AGG::FastReduceRK,
+bool CommonFastReduce(const ReducePlan& plan, const Tensor& input, Tensor& output, concurrency::ThreadPool* tp) {
+  return CommonFastReduceSwitch(plan, input, output, tp,
+                                &AGG::FastReduceKR, &AGG::FastReduceRK,
                                 &AGG::FastReduceKRK, &AGG::FastReduceRKR);
 }
 
@@ -773,19 +835,23 @@ static void ValidateKeepDims(const Tensor* input, int64_t keepdims) {
 template <typename AGG>
 void CommonReduce1Loop(OpKernelContext* ctx,
                        const gsl::span<const int64_t>& axes_, int64_t keepdims_,
-                       bool noop_with_empty_axes) {
-  FastReduceKind fast_kind;
-  TensorShapeVector fast_shape;
-  TensorShapeVector output_shape;
-  TensorShapeVector fast_axes;
-  if (CommonFastReduce<AGG>(ctx, axes_, keepdims_, noop_with_empty_axes,
-                            fast_kind, fast_shape, output_shape, fast_axes)) {
+                       bool noop_with_empty_axes, ReducePlanCache* plan_cache) {
+  TensorShapeVector input_axes;
+  if (CommonFastReduceCopy(ctx, input_axes, noop_with_empty_axes)) {
     return;
   }
 
   const Tensor* input = ctx->Input<Tensor>(0);
-  Tensor* output = ctx->Output(0, output_shape);
-  if (fast_kind == FastReduceKind::kEmpty) {
+  concurrency::ThreadPool* tp = ctx->GetOperatorThreadPool();
+  auto plan = GetReducePlan(input->Shape().GetDims(), input_axes.empty() ? axes_ : input_axes,
+                            keepdims_ != 0, noop_with_empty_axes, AGG::WhichFastReduce(), tp, plan_cache);
+
+  Tensor* output = ctx->Output(0, plan->output_shape);
+  if (CommonFastReduce<AGG>(*plan, *input, *output, tp)) {
+    return;
+  }
+
+  if (plan->fast_kind == FastReduceKind::kEmpty) {
     const TensorShape& new_input_shape = input->Shape();
     if (new_input_shape.Size() == 1) {
       const typename AGG::input_type* from_data = input->template Data<typename AGG::input_type>();
@@ -799,24 +865,29 @@ void CommonReduce1Loop(OpKernelContext* ctx,
     return;
   }
 
-  ResultsNoTransposePrepareForReduce last_results;
-  NoTransposeReduce1Loop<AGG>(output, fast_shape, *input, fast_axes, ctx->GetOperatorThreadPool(), last_results);
+  NoTransposeReduce1Loop<AGG>(output, plan->fast_shape, *input, plan->fast_axes, tp, plan->results);
 }
 
 template <typename AGG>
 void CommonReduce2Loops(OpKernelContext* ctx,
                         const gsl::span<const int64_t>& axes_, int64_t keepdims_,
-                        bool noop_with_empty_axes) {
-  FastReduceKind fast_kind;
-  TensorShapeVector fast_shape, output_shape, fast_axes;
-  if (CommonFastReduce<AGG>(ctx, axes_, keepdims_, noop_with_empty_axes,
-                            fast_kind, fast_shape, output_shape, fast_axes)) {
+                        bool noop_with_empty_axes, ReducePlanCache* plan_cache) {
+  TensorShapeVector input_axes;
+  if (CommonFastReduceCopy(ctx, input_axes, noop_with_empty_axes)) {
     return;
   }
 
   const Tensor* input = ctx->Input<Tensor>(0);
-  Tensor* output = ctx->Output(0, output_shape);
-  if (fast_kind == FastReduceKind::kEmpty) {
+  concurrency::ThreadPool* tp = ctx->GetOperatorThreadPool();
+  auto plan = GetReducePlan(input->Shape().GetDims(), input_axes.empty() ? axes_ : input_axes,
+                            keepdims_ != 0, noop_with_empty_axes, AGG::WhichFastReduce(), tp, plan_cache);
+
+  Tensor* output = ctx->Output(0, plan->output_shape);
+  if (CommonFastReduce<AGG>(*plan, *input, *output, tp)) {
+    return;
+  }
+
+  if (plan->fast_kind == FastReduceKind::kEmpty) {
     const TensorShape& new_input_shape = input->Shape();
     if (new_input_shape.Size() == 1) {
       const typename AGG::input_type* from_data = input->template Data<typename AGG::input_type>();
@@ -831,64 +902,60 @@ void CommonReduce2Loops(OpKernelContext* ctx,
     return;
   }
 
-  ResultsNoTransposePrepareForReduce last_results;
-  NoTransposeReduce2Loops<AGG>(output, fast_shape, *input, fast_axes, ctx->GetOperatorThreadPool(), last_results);
+  NoTransposeReduce2Loops<AGG>(output, plan->fast_shape, *input, plan->fast_axes, tp, plan->results);
 }
 
 template <typename T>
 Status ReduceL1<T>::Compute(OpKernelContext* ctx) const {
-  // The following variable does not change if the input tensor and the
-  // axes do not either. It could be either cached in ctx or precomputed
-  // in the constructor if shape and axes are known at this stage.
-  CommonReduce1Loop<ReduceAggregatorL1<T>>(ctx, axes_, keepdims_);
+  CommonReduce1Loop<ReduceAggregatorL1<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   return Status::OK();
 }
 
 template <typename T>
 Status ReduceL2<T>::Compute(OpKernelContext* ctx) const {
-  CommonReduce1Loop<ReduceAggregatorL2<T>>(ctx, axes_, keepdims_);
+  CommonReduce1Loop<ReduceAggregatorL2<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   return Status::OK();
 }
 
 template <typename T>
 Status ReduceLogSum<T>::Compute(OpKernelContext* ctx) const {
-  CommonReduce1Loop<ReduceAggregatorLogSum<T>>(ctx, axes_, keepdims_);
+  CommonReduce1Loop<ReduceAggregatorLogSum<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   return Status::OK();
 }
 
 template <typename T>
 Status ReduceLogSumExp<T>::Compute(OpKernelContext* ctx) const {
-  CommonReduce2Loops<ReduceAggregatorLogSumExp<T>>(ctx, axes_, keepdims_);
+  CommonReduce2Loops<ReduceAggregatorLogSumExp<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   return Status::OK();
 }
 
 template <typename T>
 Status ReduceMax<T>::Compute(OpKernelContext* ctx) const {
-  CommonReduce1Loop<ReduceAggregatorMax<T>>(ctx, axes_, keepdims_);
+  CommonReduce1Loop<ReduceAggregatorMax<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   return Status::OK();
 }
 
 template <typename T>
 Status ReduceMean<T>::Compute(OpKernelContext* ctx) const {
-  CommonReduce1Loop<ReduceAggregatorMean<T>>(ctx, axes_, keepdims_);
+  CommonReduce1Loop<ReduceAggregatorMean<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   return Status::OK();
 }
 
 template <typename T>
 Status ReduceMin<T>::Compute(OpKernelContext* ctx) const {
-  CommonReduce1Loop<ReduceAggregatorMin<T>>(ctx, axes_, keepdims_);
+  CommonReduce1Loop<ReduceAggregatorMin<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   return Status::OK();
 }
 
 template <typename T>
 Status ReduceProd<T>::Compute(OpKernelContext* ctx) const {
-  CommonReduce1Loop<ReduceAggregatorProd<T>>(ctx, axes_, keepdims_);
+  CommonReduce1Loop<ReduceAggregatorProd<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   return Status::OK();
 }
 
 template <typename T>
 Status ReduceSum<T>::Compute(OpKernelContext* ctx) const {
-  CommonReduce1Loop<ReduceAggregatorSum<T>>(ctx, axes_, keepdims_, noop_with_empty_axes_);
+  CommonReduce1Loop<ReduceAggregatorSum<T>>(ctx, axes_, keepdims_, noop_with_empty_axes_, &plan_cache_);
   return Status::OK();
 }
 
@@ -961,22 +1028,25 @@ std::unique_ptr<Tensor> ReduceSum<T>::Impl(const Tensor& input, gsl::span<const
   }
 
   ResultsNoTransposePrepareForReduce last_results;
+  if (fast_axes.size() != 0 && fast_axes.size() != fast_shape.size()) {
+    NoTransposePrepareForReduce(fast_shape, fast_axes, last_results);
+  }
   NoTransposeReduce1Loop<ReduceAggregatorSum<T>>(output.get(), fast_shape, input, fast_axes, tp, last_results);
   return output;
 }
 
 template <typename T>
 Status ReduceSumSquare<T>::Compute(OpKernelContext* ctx) const {
-  CommonReduce1Loop<ReduceAggregatorSumSquare<T>>(ctx, axes_, keepdims_);
+  CommonReduce1Loop<ReduceAggregatorSumSquare<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   return Status::OK();
 }
 
 template <typename T>
 Status ArgMax<T>::Compute(OpKernelContext* ctx) const {
   if (select_last_index_) {
-    CommonReduce1Loop<ReduceAggregatorArgMaxLastIndex<T>>(ctx, axes_, keepdims_);
+    CommonReduce1Loop<ReduceAggregatorArgMaxLastIndex<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   } else {
-    CommonReduce1Loop<ReduceAggregatorArgMax<T>>(ctx, axes_, keepdims_);
+    CommonReduce1Loop<ReduceAggregatorArgMax<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   }
   return Status::OK();
 }
@@ -984,9 +1054,9 @@ Status ArgMax<T>::Compute(OpKernelContext* ctx) const {
 template <typename T>
 Status ArgMin<T>::Compute(OpKernelContext* ctx) const {
   if (select_last_index_) {
-    CommonReduce1Loop<ReduceAggregatorArgMinLastIndex<T>>(ctx, axes_, keepdims_);
+    CommonReduce1Loop<ReduceAggregatorArgMinLastIndex<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   } else {
-    CommonReduce1Loop<ReduceAggregatorArgMin<T>>(ctx, axes_, keepdims_);
+    CommonReduce1Loop<ReduceAggregatorArgMin<T>>(ctx, axes_, keepdims_, false, &plan_cache_);
   }
   return Status::OK();
 }
@@ -1002,15 +1072,15 @@ template class ReduceSum<int64_t>;
 
 template void CommonReduce1Loop<ReduceAggregatorSum<float>>(OpKernelContext* ctx,
                                                             const gsl::span<const int64_t>& axes_, int64_t keepdims_,
-                                                            bool noop_with_empty_axes);
+                                                            bool noop_with_empty_axes, ReducePlanCache* plan_cache);
 template void CommonReduce1Loop<ReduceAggregatorSum<int32_t>>(OpKernelContext* ctx,
                                                               const gsl::span<const int64_t>& axes_, int64_t keepdims_,
-                                                              bool noop_with_empty_axes);
+                                                              bool noop_with_empty_axes, ReducePlanCache* plan_cache);
 template void CommonReduce1Loop<ReduceAggregatorSum<double>>(OpKernelContext* ctx,
                                                              const gsl::span<const int64_t>& axes_, int64_t keepdims_,
-                                                             bool noop_with_empty_axes);
+                                                             bool noop_with_empty_axes, ReducePlanCache* plan_cache);
 template void CommonReduce1Loop<ReduceAggregatorSum<int64_t>>(OpKernelContext* ctx,
                                                               const gsl::span<const int64_t>& axes_, int64_t keepdims_,
-                                                              bool noop_with_empty_axes);
+                                                              bool noop_with_empty_axes, ReducePlanCache* plan_cache);
 
 }  // namespace onnxruntime
@@ -12,9 +12,11 @@
 #include "core/util/math.h"
 #endif
 #include "core/util/math_cpuonly.h"
+#include "core/platform/ort_mutex.h"
 #include "core/platform/threadpool.h"
 #include "core/common/safeint.h"
 #include <cmath>
+#include <memory>
 
 namespace onnxruntime {
 
@@ -86,8 +88,37 @@ class ResultsNoTransposePrepareForReduce {
     last_loop_inc = 0;
   }
 
-  bool equal(gsl::span<const int64_t> local_input_shape, gsl::span<const int64_t> local_reduced_axes);
-  void ValidateNotEmpty();
+  bool equal(gsl::span<const int64_t> local_input_shape, gsl::span<const int64_t> local_reduced_axes) const;
+  void ValidateNotEmpty() const;
+};
+
+/**
+  Describes how a reduction is computed for one input shape and one set of axes.
+  The shape is canonicalized by OptimizeShapeForFastReduce once dimensions equal to 1
+  are removed, the plan then selects a fast implementation or prepares the indices
+  of the generic implementation.
+*/
+struct ReducePlan {
+  TensorShapeVector input_shape;
+  TensorShapeVector axes;
+  FastReduceKind fast_kind;         // layout of the canonical shape
+  FastReduceKind fast_impl;         // fast implementation to run, kNone for the generic one
+  TensorShapeVector fast_shape;
+  TensorShapeVector fast_axes;
+  TensorShapeVector output_shape;
+  ResultsNoTransposePrepareForReduce results;  // only prepared for the generic implementation
+};
+
+// Keeps the plan of the last input shape seen by a kernel.
+// Shapes seldom change between two runs of a model.
+class ReducePlanCache {
+ public:
+  std::shared_ptr<const ReducePlan> Find(gsl::span<const int64_t> input_shape, gsl::span<const int64_t> axes) const;
+  void Store(std::shared_ptr<const ReducePlan> plan);
+
+ private:
+  mutable OrtMutex mutex_;
+  std::shared_ptr<const ReducePlan> plan_;
 };
 
 template <typename T>
@@ -286,10 +317,81 @@ template <typename T, typename TVAL = T>
 class ReduceAggregatorSumSquare : public ReduceAggregator<T, TVAL> {
  public:
   inline ReduceAggregatorSumSquare(int64_t N, const T&) : ReduceAggregator<T, TVAL>(N, 0) {}
+  static TVAL aggall(const T* from_data, int64_t size) {
+    return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(from_data, size).squaredNorm();
+  }
   inline TVAL aggall(const T* from_data) {
-    return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(from_data, this->N_).squaredNorm();
+    return aggall(from_data, this->N_);
   }
   inline void update(const T& v) { this->accumulator_ += v * v; }
+
+  // Fast reduction, the fast implementations assume T and TVAL are the same type.
+  static inline FastReduceKind WhichFastReduce() {
+    return FastReduceKind::kKR | FastReduceKind::kRK | FastReduceKind::kKRK | FastReduceKind::kRKR;
+  }
+
+  static void FastReduceKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    const T* data = input.Data<T>();
+    T* out = output.MutableData<T>();
+    int64_t stridei = fast_shape[1];
+    concurrency::ThreadPool::TryParallelFor(
+        tp, fast_shape[0], ParallelReduceFastCost(1, stridei, sizeof(T), 6),
+        [data, stridei, out](ptrdiff_t first, ptrdiff_t last) {
+          for (ptrdiff_t d = first; d < last; ++d) {
+            out[d] = aggall(data + d * stridei, stridei);
+          }
+        });
+  }
+
+  static void FastReduceRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    int64_t N = fast_shape[1];
+    const T* data = input.Data<T>();
+    T* out = output.MutableData<T>();
+
+    int64_t n_rows = fast_shape[0];
+    concurrency::ThreadPool::TryParallelFor(
+        tp, N, ParallelReduceFastCost(1, n_rows, sizeof(T), 6),
+        [data, out, N, n_rows](ptrdiff_t begin, ptrdiff_t end) {
+          EigenVectorArrayMap<T>(out + begin, end - begin) =
+              ConstEigenVectorArrayMap<T>(data + begin, end - begin).square();
+          for (int64_t row = 1; row < n_rows; ++row) {
+            EigenVectorArrayMap<T>(out + begin, end - begin) += ConstEigenVectorArrayMap<T>(
+                                                                    data + row * N + begin, end - begin)
+                                                                    .square();
+          }
+        });
+  }
+
+  static void FastReduceKRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                            Tensor& output, concurrency::ThreadPool* tp) {
+    const T* data = input.Data<T>();
+    T* out = output.MutableData<T>();
+    int64_t stridei = fast_shape[1] * fast_shape[2];
+    int64_t strideo = fast_shape[2];
+    concurrency::ThreadPool::TryParallelFor(
+        tp, fast_shape[0], ParallelReduceFastCost(fast_shape[1], fast_shape[2], sizeof(T), 6),
+        [data, fast_shape, stridei, strideo, out](ptrdiff_t begin, ptrdiff_t end) {
+          for (ptrdiff_t j = begin; j < end; ++j) {
+            EigenVectorMap<T>(out + j * strideo, strideo) =
+                ConstEigenMatrixMap<T>(
+                    data + j * stridei, fast_shape[2], fast_shape[1])
+                    .rowwise()
+                    .squaredNorm();
+          }
+        });
+  }
+
+  static void FastReduceRKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                            Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregator<T, T>::CommonFastReduceRKR(
+        input, fast_shape, output, tp,
+        [=](const T*) -> T { return 0; },
+        [=](T& value, const T* p, int64_t size) {
+          value += aggall(p, size);
+        });
+  }
 };
 
 template <typename T>
@@ -310,51 +412,27 @@ class ReduceAggregatorMean : public ReduceAggregatorSum<T> {
   static void FastReduceKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
                            Tensor& output, concurrency::ThreadPool* tp) {
     ReduceAggregatorSum<T>::FastReduceKR(input, fast_shape, output, tp);
-    // TODO: use MLAS or BLAS
-    T* out = output.MutableData<T>();
-    T* end = out + fast_shape[0];
-    for (; out != end; ++out) {
-      *out /= static_cast<T>(fast_shape[1]);
-    }
+    EigenVectorArrayMap<T>(output.MutableData<T>(), fast_shape[0]) /= static_cast<T>(fast_shape[1]);
   }
 
   static void FastReduceRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
                            Tensor& output, concurrency::ThreadPool* tp) {
     ReduceAggregatorSum<T>::FastReduceRK(input, fast_shape, output, tp);
-    // TODO: use MLAS or BLAS
-    T* out = output.MutableData<T>();
-    T* end = out + fast_shape[1];
-    for (; out != end; ++out) {
-      *out /= static_cast<T>(fast_shape[0]);
-    }
+    EigenVectorArrayMap<T>(output.MutableData<T>(), fast_shape[1]) /= static_cast<T>(fast_shape[0]);
   }
 
   static void FastReduceKRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
                             Tensor& output, concurrency::ThreadPool* tp) {
     ReduceAggregatorSum<T>::FastReduceKRK(input, fast_shape, output, tp);
-    int64_t strideo = fast_shape[2];
-    T* out = output.MutableData<T>();
-    T* begin;
-    T* end;
-    T div = static_cast<T>(fast_shape[1]);
-    for (int64_t d = 0; d < fast_shape[0]; ++d) {
-      begin = out + strideo * d;
-      end = begin + strideo;
-      for (; begin != end; ++begin) {
-        *begin /= div;
-      }
-    }
+    EigenVectorArrayMap<T>(output.MutableData<T>(), fast_shape[0] * fast_shape[2]) /=
+        static_cast<T>(fast_shape[1]);
   }
 
   static void FastReduceRKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
                             Tensor& output, concurrency::ThreadPool* tp) {
     ReduceAggregatorSum<T>::FastReduceRKR(input, fast_shape, output, tp);
-    T* out = output.MutableData<T>();
-    T div = static_cast<T>(fast_shape[0] * fast_shape[2]);
-    T* end = out + fast_shape[1];
-    for (; out != end; ++out) {
-      *out /= div;
-    }
+    EigenVectorArrayMap<T>(output.MutableData<T>(), fast_shape[1]) /=
+        static_cast<T>(fast_shape[0] * fast_shape[2]);
   }
 };
 
@@ -633,32 +711,180 @@ template <typename T>
 class ReduceAggregatorL1 : public ReduceAggregator<T, T> {
  public:
   inline ReduceAggregatorL1(int64_t N, const T&) : ReduceAggregator<T, T>(N, 0) {}
+  static T aggall(const T* from_data, int64_t size) {
+    return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(from_data, size).cwiseAbs().sum();
+  }
   inline T aggall(const T* from_data) {
-    return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(from_data, this->N_).cwiseAbs().sum();
+    return aggall(from_data, this->N_);
   }
   inline void update(const T& v) { this->accumulator_ += v > 0 ? v : -v; }
+
+  // Fast reduction
+  static inline FastReduceKind WhichFastReduce() {
+    return FastReduceKind::kKR | FastReduceKind::kRK | FastReduceKind::kKRK | FastReduceKind::kRKR;
+  }
+
+  static void FastReduceKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    const T* data = input.Data<T>();
+    T* out = output.MutableData<T>();
+    int64_t stridei = fast_shape[1];
+    concurrency::ThreadPool::TryParallelFor(
+        tp, fast_shape[0], ParallelReduceFastCost(1, stridei, sizeof(T), 6),
+        [data, stridei, out](ptrdiff_t first, ptrdiff_t last) {
+          for (ptrdiff_t d = first; d < last; ++d) {
+            out[d] = aggall(data + d * stridei, stridei);
+          }
+        });
+  }
+
+  static void FastReduceRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    int64_t N = fast_shape[1];
+    const T* data = input.Data<T>();
+    T* out = output.MutableData<T>();
+
+    int64_t n_rows = fast_shape[0];
+    concurrency::ThreadPool::TryParallelFor(
+        tp, N, ParallelReduceFastCost(1, n_rows, sizeof(T), 6),
+        [data, out, N, n_rows](ptrdiff_t begin, ptrdiff_t end) {
+          EigenVectorArrayMap<T>(out + begin, end - begin) =
+              ConstEigenVectorArrayMap<T>(data + begin, end - begin).abs();
+          for (int64_t row = 1; row < n_rows; ++row) {
+            EigenVectorArrayMap<T>(out + begin, end - begin) += ConstEigenVectorArrayMap<T>(
+                                                                    data + row * N + begin, end - begin)
+                                                                    .abs();
+          }
+        });
+  }
+
+  static void FastReduceKRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                            Tensor& output, concurrency::ThreadPool* tp) {
+    const T* data = input.Data<T>();
+    T* out = output.MutableData<T>();
+    int64_t stridei = fast_shape[1] * fast_shape[2];
+    int64_t strideo = fast_shape[2];
+    concurrency::ThreadPool::TryParallelFor(
+        tp, fast_shape[0], ParallelReduceFastCost(fast_shape[1], fast_shape[2], sizeof(T), 6),
+        [data, fast_shape, stridei, strideo, out](ptrdiff_t begin, ptrdiff_t end) {
+          for (ptrdiff_t j = begin; j < end; ++j) {
+            EigenVectorMap<T>(out + j * strideo, strideo) =
+                ConstEigenMatrixMap<T>(
+                    data + j * stridei, fast_shape[2], fast_shape[1])
+                    .cwiseAbs()
+                    .rowwise()
+                    .sum();
+          }
+        });
+  }
+
+  static void FastReduceRKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                            Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregator<T, T>::CommonFastReduceRKR(
+        input, fast_shape, output, tp,
+        [=](const T*) -> T { return 0; },
+        [=](T& value, const T* p, int64_t size) {
+          value += aggall(p, size);
+        });
+  }
 };
 
 template <typename T>
-class ReduceAggregatorL2 : public ReduceAggregator<T, T> {
+class ReduceAggregatorL2 : public ReduceAggregatorSumSquare<T, T> {
  public:
-  inline ReduceAggregatorL2(int64_t N, const T&) : ReduceAggregator<T, T>(N, 0) {}
+  inline ReduceAggregatorL2(int64_t N, const T& init) : ReduceAggregatorSumSquare<T, T>(N, init) {}
   inline T aggall(const T* from_data) {
     return Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(from_data, this->N_).norm();
   }
-  inline void update(const T& v) { this->accumulator_ += v * v; }
   inline T get_value() { return reduce_sqrt<T>(this->accumulator_); }
+
+  // Fast reduction
+  // WhichFastReduce() already defined in ReduceAggregatorSumSquare
+
+  static void FastReduceKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregatorSumSquare<T, T>::FastReduceKR(input, fast_shape, output, tp);
+    Finalize(output);
+  }
+
+  static void FastReduceRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregatorSumSquare<T, T>::FastReduceRK(input, fast_shape, output, tp);
+    Finalize(output);
+  }
+
+  static void FastReduceKRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                            Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregatorSumSquare<T, T>::FastReduceKRK(input, fast_shape, output, tp);
+    Finalize(output);
+  }
+
+  static void FastReduceRKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                            Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregatorSumSquare<T, T>::FastReduceRKR(input, fast_shape, output, tp);
+    Finalize(output);
+  }
+
+ private:
+  // Replaces the sums of squares stored in the output by their square roots.
+  static void Finalize(Tensor& output) {
+    T* out = output.MutableData<T>();
+    int64_t size = output.Shape().Size();
+    if constexpr (std::is_floating_point<T>::value) {
+      EigenVectorArrayMap<T>(out, size) = ConstEigenVectorArrayMap<T>(out, size).sqrt();
+    } else {
+      for (int64_t i = 0; i < size; ++i) {
+        out[i] = reduce_sqrt<T>(out[i]);
+      }
+    }
+  }
 };
 
 template <typename T>
-class ReduceAggregatorLogSum : public ReduceAggregator<T, T> {
+class ReduceAggregatorLogSum : public ReduceAggregatorSum<T> {
  public:
-  inline ReduceAggregatorLogSum(int64_t N, const T&) : ReduceAggregator<T, T>(N, 0) {}
+  inline ReduceAggregatorLogSum(int64_t N, const T& init) : ReduceAggregatorSum<T>(N, init) {}
   inline T aggall(const T* from_data) {
-    return reduce_log<T>(Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, 1>>(from_data, this->N_).sum());
+    return reduce_log<T>(ReduceAggregatorSum<T>::aggall(from_data, this->N_));
   }
-  inline void update(const T& v) { this->accumulator_ += v; }
   inline T get_value() { return reduce_log<T>(this->accumulator_); }
+
+  // Fast reduction
+  // WhichFastReduce() already defined in ReduceAggregatorSum
+
+  static void FastReduceKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregatorSum<T>::FastReduceKR(input, fast_shape, output, tp);
+    Finalize(output);
+  }
+
+  static void FastReduceRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregatorSum<T>::FastReduceRK(input, fast_shape, output, tp);
+    Finalize(output);
+  }
+
+  static void FastReduceKRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                            Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregatorSum<T>::FastReduceKRK(input, fast_shape, output, tp);
+    Finalize(output);
+  }
+
+  static void FastReduceRKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                            Tensor& output, concurrency::ThreadPool* tp) {
+    ReduceAggregatorSum<T>::FastReduceRKR(input, fast_shape, output, tp);
+    Finalize(output);
+  }
+
+ private:
+  // Replaces the sums stored in the output by their logarithms.
+  static void Finalize(Tensor& output) {
+    T* out = output.MutableData<T>();
+    int64_t size = output.Shape().Size();
+    for (int64_t i = 0; i < size; ++i) {
+      out[i] = reduce_log<T>(out[i]);
+    }
+  }
 };
 
 template <typename T>
@@ -682,33 +908,138 @@ class ReduceAggregatorLogSumExp : public ReduceAggregator<T, T> {
   }
   inline void update(const T& v) { this->accumulator_ += reduce_exp(v - max_); }
   inline T get_value() { return reduce_log<T>(this->accumulator_) + max_; }
+
+  // Fast reduction, the maximum is computed as update0 does.
+  static inline FastReduceKind WhichFastReduce() {
+    return FastReduceKind::kKR | FastReduceKind::kRK | FastReduceKind::kKRK;
+  }
+
+  static void FastReduceKR(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    const T* data = input.Data<T>();
+    T* out = output.MutableData<T>();
+    int64_t stridei = fast_shape[1];
+    concurrency::ThreadPool::TryParallelFor(
+        tp, fast_shape[0], ParallelReduceFastCost(1, stridei, sizeof(T), 8),
+        [data, stridei, out](ptrdiff_t first, ptrdiff_t last) {
+          for (ptrdiff_t d = first; d < last; ++d) {
+            const T* p = data + d * stridei;
+            T max = reduce_isinf(p[0]) ? 0 : p[0];
+            for (int64_t i = 0; i < stridei; ++i) {
+              max = UpdateMax(max, p[i]);
+            }
+            T sum = 0;
+            if constexpr (std::is_floating_point<T>::value) {
+              sum = (ConstEigenVectorArrayMap<T>(p, stridei) - max).exp().sum();
+            } else {
+              for (int64_t i = 0; i < stridei; ++i) {
+                sum += reduce_exp(p[i] - max);
+              }
+            }
+            out[d] = reduce_log<T>(sum) + max;
+          }
+        });
+  }
+
+  static void FastReduceRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                           Tensor& output, concurrency::ThreadPool* tp) {
+    int64_t N = fast_shape[1];
+    const T* data = input.Data<T>();
+    T* out = output.MutableData<T>();
+
+    int64_t n_rows = fast_shape[0];
+    concurrency::ThreadPool::TryParallelFor(
+        tp, N, ParallelReduceFastCost(1, n_rows, sizeof(T), 8),
+        [data, out, N, n_rows](ptrdiff_t begin, ptrdiff_t end) {
+          std::vector<T> sum(end - begin);
+          ReduceColumns(data + begin, N, n_rows, end - begin, sum.data(), out + begin);
+        });
+  }
+
+  static void FastReduceKRK(const Tensor& input, const gsl::span<const int64_t>& fast_shape,
+                            Tensor& output, concurrency::ThreadPool* tp) {
+    const T* data = input.Data<T>();
+    T* out = output.MutableData<T>();
+    int64_t stridei = fast_shape[1] * fast_shape[2];
+    int64_t strideo = fast_shape[2];
+    concurrency::ThreadPool::TryParallelFor(
+        tp, fast_shape[0], ParallelReduceFastCost(fast_shape[1], fast_shape[2], sizeof(T), 8),
+        [data, fast_shape, stridei, strideo, out](ptrdiff_t begin, ptrdiff_t end) {
+          std::vector<T> sum(strideo);
+          for (ptrdiff_t j = begin; j < end; ++j) {
+            ReduceColumns(data + j * stridei, strideo, fast_shape[1], strideo, sum.data(), out + j * strideo);
+          }
+        });
+  }
+
+ private:
+  static inline T UpdateMax(const T& max, const T& v) {
+    return (reduce_isinf(v) || reduce_isnan(v) || v < max) ? max : v;
+  }
+
+  // Reduces n_rows rows of n_cols values separated by stride values into out,
+  // sum is a buffer of n_cols values.
+  static void ReduceColumns(const T* data, int64_t stride, int64_t n_rows, int64_t n_cols, T* sum, T* out) {
+    for (int64_t j = 0; j < n_cols; ++j) {
+      out[j] = reduce_isinf(data[j]) ? 0 : data[j];
+    }
+    for (int64_t row = 0; row < n_rows; ++row) {
+      const T* p = data + row * stride;
+      for (int64_t j = 0; j < n_cols; ++j) {
+        out[j] = UpdateMax(out[j], p[j]);
+      }
+    }
+    if constexpr (std::is_floating_point<T>::value) {
+      EigenVectorArrayMap<T> sum_map(sum, n_cols);
+      ConstEigenVectorArrayMap<T> max_map(out, n_cols);
+      sum_map = (ConstEigenVectorArrayMap<T>(data, n_cols) - max_map).exp();
+      for (int64_t row = 1; row < n_rows; ++row) {
+        sum_map += (ConstEigenVectorArrayMap<T>(data + row * stride, n_cols) - max_map).exp();
+      }
+      EigenVectorArrayMap<T>(out, n_cols) = sum_map.log() + max_map;
+    } else {
+      std::fill(sum, sum + n_cols, static_cast<T>(0));
+      for (int64_t row = 0; row < n_rows; ++row) {
+        const T* p = data + row * stride;
+        for (int64_t j = 0; j < n_cols; ++j) {
+          sum[j] += reduce_exp(p[j] - out[j]);
+        }
+      }
+      for (int64_t j = 0; j < n_cols; ++j) {
+        out[j] = reduce_log<T>(sum[j]) + out[j];
+      }
+    }
+  }
 };
 
 void NoTransposePrepareForReduce(const TensorShape& new_input_shape,
                                  gsl::span<const int64_t> reduced_axes,
                                  ResultsNoTransposePrepareForReduce& results);
 
+// last_results must be prepared by NoTransposePrepareForReduce for new_input_shape and reduced_axes
+// unless all axes are reduced.
 template <typename AGG>
 void NoTransposeReduce1Loop(Tensor* output, const TensorShape& new_input_shape, const Tensor& input,
                             gsl::span<const int64_t> reduced_axes, concurrency::ThreadPool* tp,
-                            ResultsNoTransposePrepareForReduce& last_results);
+                            const ResultsNoTransposePrepareForReduce& last_results);
 
 // Specific case for ReduceLogSumExp.
 template <typename AGG>
 void NoTransposeReduce2Loops(Tensor* output, const TensorShape& new_input_shape, const Tensor& input,
                              gsl::span<const int64_t> reduced_axes, concurrency::ThreadPool* tp,
-                             ResultsNoTransposePrepareForReduce& last_results);
+                             const ResultsNoTransposePrepareForReduce& last_results);
 
+// plan_cache, if not null, keeps the plan computed for the input shape for the next calls.
 template <typename AGG>
 void CommonReduce1Loop(OpKernelContext* ctx,
                        const gsl::span<const int64_t>& axes_, int64_t keepdims_,
-                       bool noop_with_empty_axes = false);
+                       bool noop_with_empty_axes = false, ReducePlanCache* plan_cache = nullptr);
 
 // Specific case for ReduceLogSumExp.
 template <typename AGG>
 void CommonReduce2Loops(OpKernelContext* ctx,
                         const gsl::span<const int64_t>& axes_, int64_t keepdims_,
-                        bool noop_with_empty_axes = false);
+                        bool noop_with_empty_axes = false, ReducePlanCache* plan_cache = nullptr);
 
 template <bool allow_multi_axes>
 class ReduceKernelBase {
@@ -743,6 +1074,8 @@ template <bool allow_multi_axes>
 class ReduceKernel : public OpKernel, public ReduceKernelBase<allow_multi_axes> {
  protected:
   ReduceKernel(const OpKernelInfo& info) : OpKernel(info), ReduceKernelBase<allow_multi_axes>(info) {}
+
+  mutable ReducePlanCache plan_cache_;
 };
 
 template <typename T>
@@ -0,0 +1,510 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/session/generation_engine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "core/framework/error_code_helper.h"
+#include "core/framework/gpt_subgraph_info.h"
+#include "core/framework/run_options.h"
+#include "core/framework/tensor.h"
+#include "core/session/inference_session.h"
+#include "core/session/ort_apis.h"
+
+namespace onnxruntime {
+
+Status GenerationEngine::Create(std::unique_ptr<InferenceSession> session, const GenerationEngineOptions& options,
+                                std::unique_ptr<GenerationEngine>& engine) {
+  ORT_RETURN_IF(session == nullptr, "session is null");
+  ORT_RETURN_IF(options.max_batch_size <= 0, "max_batch_size shall be positive, got ", options.max_batch_size);
+  ORT_RETURN_IF(options.max_length <= 1, "max_length shall be larger than 1, got ", options.max_length);
+  ORT_RETURN_IF(options.pad_token_id < 0, "pad_token_id shall not be negative, got ", options.pad_token_id);
+
+  std::unique_ptr<GenerationEngine> new_engine(new GenerationEngine(std::move(session), options));
+  ORT_RETURN_IF_ERROR(new_engine->Initialize());
+  engine = std::move(new_engine);
+  return Status::OK();
+}
+
+GenerationEngine::GenerationEngine(std::unique_ptr<InferenceSession> session, const GenerationEngineOptions& options)
+    : session_(std::move(session)),
+      options_(options),
+      allocator_(std::make_shared<CPUAllocator>()),
+      num_layers_(0),
+      num_heads_(0),
+      head_size_(0),
+      vocab_size_(0),
+      past_type_(nullptr) {
+}
+
+GenerationEngine::~GenerationEngine() = default;
+
+Status GenerationEngine::Initialize() {
+#if defined(ORT_MINIMAL_BUILD)
+  return ORT_MAKE_STATUS(ONNXRUNTIME, NOT_IMPLEMENTED, "GenerationEngine is not supported in this build.");
+#else
+  auto inputs = session_->GetModelInputs();
+  ORT_RETURN_IF_ERROR(inputs.first);
+  auto outputs = session_->GetModelOutputs();
+  ORT_RETURN_IF_ERROR(outputs.first);
+
+  GptSubgraphInfo info;
+  ORT_RETURN_IF_ERROR(ValidateGptSubgraph(*inputs.second, *outputs.second, info));
+
+  // The past state of every row would need the same number of valid positions.
+  ORT_RETURN_IF(info.past_present_share_buffer,
+                "GenerationEngine does not support decoder models with past_sequence_length and cache_indirection");
+  ORT_RETURN_IF(options_.eos_token_id >= info.vocab_size || options_.pad_token_id >= info.vocab_size,
+                "eos_token_id and pad_token_id shall be less than vocab_size ", info.vocab_size);
+
+  for (const NodeArg* input : *inputs.second) {
+    feed_names_.push_back(input->Name());
+  }
+  for (const NodeArg* output : *outputs.second) {
+    output_names_.push_back(output->Name());
+  }
+
+  num_layers_ = info.num_layers;
+  num_heads_ = info.num_heads;
+  head_size_ = info.head_size;
+  vocab_size_ = info.vocab_size;
+  past_type_ = info.is_output_float16 ? DataTypeImpl::GetType<MLFloat16>() : DataTypeImpl::GetType<float>();
+
+  return Status::OK();
+#endif
+}
+
+Status GenerationEngine::Submit(gsl::span<const int32_t> prompt, int max_new_tokens, int64_t& request_id) {
+  ORT_RETURN_IF(prompt.empty(), "prompt shall not be empty");
+  ORT_RETURN_IF(prompt.size() >= static_cast<size_t>(options_.max_length),
+                "prompt length ", prompt.size(), " shall be less than max_length ", options_.max_length);
+  ORT_RETURN_IF(max_new_tokens <= 0, "max_new_tokens shall be positive, got ", max_new_tokens);
+  for (int32_t token : prompt) {
+    ORT_RETURN_IF(token < 0 || token >= vocab_size_, "prompt token ", token, " is out of range [0, ", vocab_size_, ")");
+  }
+
+  std::lock_guard<OrtMutex> lock(mutex_);
+  request_id = next_request_id_++;
+  Request& request = requests_[request_id];
+  request.prompt.assign(prompt.begin(), prompt.end());
+  request.max_new_tokens = max_new_tokens;
+  request.state = GenerationRequestState::kQueued;
+  queue_.push_back(request_id);
+  return Status::OK();
+}
+
+Status GenerationEngine::Cancel(int64_t request_id) {
+  std::lock_guard<OrtMutex> lock(mutex_);
+  auto it = requests_.find(request_id);
+  ORT_RETURN_IF(it == requests_.end(), "unknown request id ", request_id);
+
+  Request& request = it->second;
+  if (request.state == GenerationRequestState::kQueued) {
+    queue_.erase(std::find(queue_.begin(), queue_.end(), request_id));
+    request.state = GenerationRequestState::kCancelled;
+  } else if (request.state == GenerationRequestState::kRunning) {
+    request.state = GenerationRequestState::kCancelled;
+  }
+  return Status::OK();
+}
+
+Status GenerationEngine::GetResult(int64_t request_id, std::vector<int32_t>& tokens, GenerationRequestState& state) {
+  return GetResult(request_id, [&tokens, &state](const std::vector<int32_t>& result_tokens,
+                                                 GenerationRequestState result_state) {
+    tokens = result_tokens;
+    state = result_state;
+    return Status::OK();
+  });
+}
+
+Status GenerationEngine::GetResult(int64_t request_id, const CopyResult& copy_result) {
+  std::lock_guard<OrtMutex> lock(mutex_);
+  auto it = requests_.find(request_id);
+  ORT_RETURN_IF(it == requests_.end(), "unknown request id ", request_id);
+
+  const GenerationRequestState state = it->second.state;
+  ORT_RETURN_IF_ERROR(copy_result(it->second.tokens, state));
+  if (state == GenerationRequestState::kFinished || state == GenerationRequestState::kCancelled) {
+    requests_.erase(it);
+  }
+  return Status::OK();
+}
+
+Status GenerationEngine::Step(size_t& num_pending) {
+  std::lock_guard<OrtMutex> step_lock(step_mutex_);
+
+  const size_t num_running = static_cast<size_t>(std::count_if(slots_.begin(), slots_.end(), [](const Slot& slot) {
+    return slot.request_id != kFreeSlot;
+  }));
+
+  std::vector<int64_t> admitted;
+  std::vector<std::vector<int32_t>> prompts;
+  {
+    std::lock_guard<OrtMutex> lock(mutex_);
+    while (!queue_.empty() && num_running + admitted.size() < static_cast<size_t>(options_.max_batch_size)) {
+      Request& request = requests_[queue_.front()];
+      request.state = GenerationRequestState::kRunning;
+      prompts.push_back(std::move(request.prompt));
+      admitted.push_back(queue_.front());
+      queue_.pop_front();
+    }
+  }
+
+  std::vector<int32_t> decoded;
+  std::vector<int32_t> prefill_tokens;
+  PastBatch prefilled;
+
+  Status status;
+  if (num_running > 0) {
+    status = Decode(decoded);
+  }
+  if (status.IsOK() && !admitted.empty()) {
+    status = Prefill(prompts, prefilled, prefill_tokens);
+  }
+
+  if (!status.IsOK()) {
+    // The past state of the running requests may be inconsistent with their tokens now.
+    std::lock_guard<OrtMutex> lock(mutex_);
+    for (const Slot& slot : slots_) {
+      auto it = requests_.find(slot.request_id);
+      if (it != requests_.end()) {
+        it->second.state = GenerationRequestState::kCancelled;
+      }
+    }
+    for (int64_t request_id : admitted) {
+      auto it = requests_.find(request_id);
+      if (it != requests_.end()) {
+        it->second.state = GenerationRequestState::kCancelled;
+      }
+    }
+    slots_.clear();
+    past_ = PastBatch();
+    num_pending = queue_.size();
+    return status;
+  }
+
+  // Record the generated tokens, free the slots of the requests that ended and give the admitted requests that
+  // continue a free slot, adding slots at the end if there are not enough.
+  std::vector<PastRow> new_rows;
+  {
+    std::lock_guard<OrtMutex> lock(mutex_);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      Slot& slot = slots_[i];
+      if (slot.request_id == kFreeSlot) {
+        continue;
+      }
+
+      if (RecordToken(slot.request_id, decoded[i], slot.past_length)) {
+        slot.next_token = decoded[i];
+      } else {
+        slot = {kFreeSlot, 0, options_.pad_token_id};
+      }
+    }
+
+    new_rows.resize(slots_.size(), {nullptr, 0, 0});
+    size_t free_slot = 0;
+    for (size_t i = 0; i < admitted.size(); ++i) {
+      const int prompt_length = static_cast<int>(prompts[i].size());
+      if (!RecordToken(admitted[i], prefill_tokens[i], prompt_length)) {
+        continue;
+      }
+
+      while (free_slot < slots_.size() && slots_[free_slot].request_id != kFreeSlot) {
+        ++free_slot;
+      }
+      if (free_slot == slots_.size()) {
+        slots_.push_back({kFreeSlot, 0, options_.pad_token_id});
+        new_rows.push_back({nullptr, 0, 0});
+      }
+
+      slots_[free_slot] = {admitted[i], prompt_length, prefill_tokens[i]};
+      new_rows[free_slot] = {&prefilled, static_cast<int64_t>(i), prompt_length};
+    }
+
+    num_pending = queue_.size();
+    for (const Slot& slot : slots_) {
+      num_pending += slot.request_id != kFreeSlot ? 1 : 0;
+    }
+  }
+
+  UpdatePast(new_rows);
+  return Status::OK();
+}
+
+bool GenerationEngine::RecordToken(int64_t request_id, int32_t token, int past_length) {
+  auto it = requests_.find(request_id);
+  if (it == requests_.end() || it->second.state != GenerationRequestState::kRunning) {
+    return false;  // cancelled
+  }
+
+  Request& request = it->second;
+  request.tokens.push_back(token);
+  if (token == options_.eos_token_id ||
+      static_cast<int>(request.tokens.size()) >= request.max_new_tokens ||
+      past_length + 1 >= options_.max_length) {
+    request.state = GenerationRequestState::kFinished;
+    return false;
+  }
+  return true;
+}
+
+void GenerationEngine::UpdatePast(const std::vector<PastRow>& new_rows) {
+  // The free slots at the end need no rows.
+  size_t num_slots = slots_.size();
+  while (num_slots > 0 && slots_[num_slots - 1].request_id == kFreeSlot) {
+    --num_slots;
+  }
+  slots_.resize(num_slots);
+  if (num_slots == 0) {
+    past_ = PastBatch();
+    return;
+  }
+
+  int64_t longest = 0;
+  for (const Slot& slot : slots_) {
+    longest = std::max(longest, static_cast<int64_t>(slot.past_length));
+  }
+
+  // Decode appends one position to every row, so rows that ran for a while leave masked positions behind. Drop
+  // them when they are most of the width, which bounds the wasted positions at the cost of an occasional copy.
+  const int64_t batch_size = static_cast<int64_t>(num_slots);
+  if (batch_size == past_.batch_size && longest <= past_.width && past_.width <= 2 * longest) {
+    for (size_t i = 0; i < num_slots; ++i) {
+      if (new_rows[i].batch != nullptr) {
+        CopyPastRow(new_rows[i], past_, static_cast<int64_t>(i));
+      }
+    }
+    return;
+  }
+
+  PastBatch resized;
+  AllocatePast(batch_size, longest, resized);
+  for (size_t i = 0; i < num_slots; ++i) {
+    const Slot& slot = slots_[i];
+    if (slot.request_id == kFreeSlot) {
+      continue;
+    }
+
+    const int64_t row = static_cast<int64_t>(i);
+    CopyPastRow(new_rows[i].batch != nullptr ? new_rows[i] : PastRow{&past_, row, slot.past_length}, resized, row);
+  }
+  past_ = std::move(resized);
+}
+
+Status GenerationEngine::Prefill(const std::vector<std::vector<int32_t>>& prompts, PastBatch& prefilled,
+                                 std::vector<int32_t>& tokens) {
+  const int64_t batch_size = static_cast<int64_t>(prompts.size());
+  int64_t sequence_length = 0;
+  for (const auto& prompt : prompts) {
+    sequence_length = std::max(sequence_length, static_cast<int64_t>(prompt.size()));
+  }
+
+  // input_ids, position_ids and attention_mask: (B, S), prompts right aligned.
+  auto int32_type = DataTypeImpl::GetType<int32_t>();
+  const TensorShape input_shape({batch_size, sequence_length});
+  OrtValue input_ids;
+  OrtValue position_ids;
+  OrtValue attention_mask;
+  Tensor::InitOrtValue(int32_type, input_shape, allocator_, input_ids);
+  Tensor::InitOrtValue(int32_type, input_shape, allocator_, position_ids);
+  Tensor::InitOrtValue(int32_type, input_shape, allocator_, attention_mask);
+
+  int32_t* input_ids_data = input_ids.GetMutable<Tensor>()->MutableData<int32_t>();
+  int32_t* position_ids_data = position_ids.GetMutable<Tensor>()->MutableData<int32_t>();
+  int32_t* attention_mask_data = attention_mask.GetMutable<Tensor>()->MutableData<int32_t>();
+  for (int64_t i = 0; i < batch_size; ++i) {
+    const int64_t padding = sequence_length - static_cast<int64_t>(prompts[i].size());
+    for (int64_t j = 0; j < sequence_length; ++j) {
+      const bool is_padding = j < padding;
+      const int64_t k = i * sequence_length + j;
+      input_ids_data[k] = is_padding ? options_.pad_token_id : prompts[i][j - padding];
+      position_ids_data[k] = is_padding ? 0 : static_cast<int32_t>(j - padding);
+      attention_mask_data[k] = is_padding ? 0 : 1;
+    }
+  }
+
+  OrtValue empty_past;
+  Tensor::InitOrtValue(past_type_, TensorShape({2, batch_size, num_heads_, 0, head_size_}), allocator_, empty_past);
+
+  std::vector<OrtValue> feeds{input_ids, position_ids, attention_mask};
+  feeds.resize(3 + num_layers_, empty_past);
+
+  std::vector<OrtValue> fetches;
+  ORT_RETURN_IF_ERROR(session_->Run(RunOptions(), feed_names_, feeds, output_names_, &fetches));
+
+  ArgMaxOfLastPosition(fetches[0].Get<Tensor>(), tokens);
+
+  prefilled.past.assign(fetches.begin() + 1, fetches.end());
+  prefilled.batch_size = batch_size;
+  prefilled.width = sequence_length;
+  return Status::OK();
+}
+
+Status GenerationEngine::Decode(std::vector<int32_t>& tokens) {
+  const int64_t batch_size = static_cast<int64_t>(slots_.size());
+  const int64_t width = past_.width;
+
+  auto int32_type = DataTypeImpl::GetType<int32_t>();
+  OrtValue input_ids;
+  OrtValue position_ids;
+  OrtValue attention_mask;
+  Tensor::InitOrtValue(int32_type, TensorShape({batch_size, 1}), allocator_, input_ids);
+  Tensor::InitOrtValue(int32_type, TensorShape({batch_size, 1}), allocator_, position_ids);
+  Tensor::InitOrtValue(int32_type, TensorShape({batch_size, width + 1}), allocator_, attention_mask);
+
+  int32_t* input_ids_data = input_ids.GetMutable<Tensor>()->MutableData<int32_t>();
+  int32_t* position_ids_data = position_ids.GetMutable<Tensor>()->MutableData<int32_t>();
+  int32_t* attention_mask_data = attention_mask.GetMutable<Tensor>()->MutableData<int32_t>();
+  for (int64_t i = 0; i < batch_size; ++i) {
+    const Slot& slot = slots_[i];
+    input_ids_data[i] = slot.next_token;
+    position_ids_data[i] = slot.past_length;
+
+    int32_t* mask = attention_mask_data + i * (width + 1);
+    std::fill_n(mask, width - slot.past_length, 0);
+    std::fill_n(mask + width - slot.past_length, slot.past_length + 1, 1);
+  }
+
+  std::vector<OrtValue> feeds{input_ids, position_ids, attention_mask};
+  feeds.insert(feeds.end(), past_.past.begin(), past_.past.end());
+
+  std::vector<OrtValue> fetches;
+  ORT_RETURN_IF_ERROR(session_->Run(RunOptions(), feed_names_, feeds, output_names_, &fetches));
+
+  ArgMaxOfLastPosition(fetches[0].Get<Tensor>(), tokens);
+
+  past_.past.assign(fetches.begin() + 1, fetches.end());
+  past_.width = width + 1;
+  for (Slot& slot : slots_) {
+    if (slot.request_id != kFreeSlot) {
+      ++slot.past_length;
+    }
+  }
+  return Status::OK();
+}
+
+void GenerationEngine::AllocatePast(int64_t batch_size, int64_t width, PastBatch& past) const {
+  past.past.clear();
+  past.batch_size = batch_size;
+  past.width = width;
+
+  for (int layer = 0; layer < num_layers_; ++layer) {
+    OrtValue layer_past;
+    Tensor::InitOrtValue(past_type_, TensorShape({2, batch_size, num_heads_, width, head_size_}), allocator_,
+                         layer_past);
+    // Free slots are masked out, but zero them so that they never hold NaN.
+    Tensor& tensor = *layer_past.GetMutable<Tensor>();
+    memset(tensor.MutableDataRaw(), 0, tensor.SizeInBytes());
+    past.past.push_back(layer_past);
+  }
+}
+
+void GenerationEngine::CopyPastRow(const PastRow& row, PastBatch& dst, int64_t dst_row) const {
+  const size_t position_bytes = static_cast<size_t>(head_size_) * past_type_->Size();
+  const size_t src_head_bytes = static_cast<size_t>(row.batch->width) * position_bytes;
+  const size_t dst_head_bytes = static_cast<size_t>(dst.width) * position_bytes;
+  const size_t valid_bytes = static_cast<size_t>(row.length) * position_bytes;
+
+  for (int layer = 0; layer < num_layers_; ++layer) {
+    const char* src = static_cast<const char*>(row.batch->past[layer].Get<Tensor>().DataRaw());
+    char* dst_data = static_cast<char*>(dst.past[layer].GetMutable<Tensor>()->MutableDataRaw());
+
+    // Past state is (2, B, N, W, H): the rows of each of key and value are the (N, W, H) blocks of a batch index.
+    for (int64_t kv = 0; kv < 2; ++kv) {
+      for (int64_t n = 0; n < num_heads_; ++n) {
+        const char* src_head = src + ((kv * row.batch->batch_size + row.row) * num_heads_ + n) * src_head_bytes;
+        char* dst_head = dst_data + ((kv * dst.batch_size + dst_row) * num_heads_ + n) * dst_head_bytes;
+
+        // Positions on the left are masked out, but zero them so that they never hold NaN.
+        memset(dst_head, 0, dst_head_bytes - valid_bytes);
+        memcpy(dst_head + dst_head_bytes - valid_bytes, src_head + src_head_bytes - valid_bytes, valid_bytes);
+      }
+    }
+  }
+}
+
+void GenerationEngine::ArgMaxOfLastPosition(const Tensor& logits, std::vector<int32_t>& tokens) {
+  const auto& shape = logits.Shape();
+  const int64_t batch_size = shape[0];
+  const int64_t sequence_length = shape[1];
+  const int64_t vocab_size = shape[2];
+
+  tokens.resize(static_cast<size_t>(batch_size));
+  for (int64_t i = 0; i < batch_size; ++i) {
+    const int64_t offset = (i * sequence_length + sequence_length - 1) * vocab_size;
+    if (logits.IsDataType<MLFloat16>()) {
+      const MLFloat16* row = logits.Data<MLFloat16>() + offset;
+      tokens[i] = static_cast<int32_t>(std::max_element(row, row + vocab_size, [](MLFloat16 a, MLFloat16 b) {
+                                         return a.ToFloat() < b.ToFloat();
+                                       }) -
+                                       row);
+    } else {
+      const float* row = logits.Data<float>() + offset;
+      tokens[i] = static_cast<int32_t>(std::max_element(row, row + vocab_size) - row);
+    }
+  }
+}
+
+}  // namespace onnxruntime
+
+ORT_API_STATUS_IMPL(OrtApis::GenerationEngineSubmit, _Inout_ OrtGenerationEngine* engine,
+                    _In_reads_(prompt_length) const int32_t* prompt, size_t prompt_length, size_t max_new_tokens,
+                    _Out_ int64_t* request_id) {
+  API_IMPL_BEGIN
+  auto* generation_engine = reinterpret_cast<onnxruntime::GenerationEngine*>(engine);
+  if (max_new_tokens > static_cast<size_t>(std::numeric_limits<int>::max())) {
+    return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, "max_new_tokens is too large");
+  }
+  ORT_API_RETURN_IF_STATUS_NOT_OK(generation_engine->Submit(gsl::make_span(prompt, prompt_length),
+                                                            static_cast<int>(max_new_tokens), *request_id));
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::GenerationEngineCancel, _Inout_ OrtGenerationEngine* engine, int64_t request_id) {
+  API_IMPL_BEGIN
+  auto* generation_engine = reinterpret_cast<onnxruntime::GenerationEngine*>(engine);
+  ORT_API_RETURN_IF_STATUS_NOT_OK(generation_engine->Cancel(request_id));
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::GenerationEngineStep, _Inout_ OrtGenerationEngine* engine, _Out_ size_t* num_pending) {
+  API_IMPL_BEGIN
+  auto* generation_engine = reinterpret_cast<onnxruntime::GenerationEngine*>(engine);
+  ORT_API_RETURN_IF_STATUS_NOT_OK(generation_engine->Step(*num_pending));
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::GenerationEngineGetResult, _Inout_ OrtGenerationEngine* engine, int64_t request_id,
+                    _Inout_ OrtAllocator* allocator, _Outptr_result_maybenull_ int32_t** tokens,
+                    _Out_ size_t* num_tokens, _Out_ OrtGenerationRequestState* state) {
+  API_IMPL_BEGIN
+  auto* generation_engine = reinterpret_cast<onnxruntime::GenerationEngine*>(engine);
+  // the tokens are copied before the request is forgotten, so they are not lost if the allocation fails
+  ORT_API_RETURN_IF_STATUS_NOT_OK(generation_engine->GetResult(
+      request_id,
+      [allocator, tokens, num_tokens, state](const std::vector<int32_t>& result,
+                                             onnxruntime::GenerationRequestState request_state) {
+        int32_t* buffer = nullptr;
+        if (!result.empty()) {
+          buffer = static_cast<int32_t*>(allocator->Alloc(allocator, result.size() * sizeof(int32_t)));
+          ORT_RETURN_IF(buffer == nullptr, "Failed to allocate the ", result.size(), " tokens of the result");
+          memcpy(buffer, result.data(), result.size() * sizeof(int32_t));
+        }
+        *tokens = buffer;
+        *num_tokens = result.size();
+        *state = static_cast<OrtGenerationRequestState>(request_state);
+        return onnxruntime::Status::OK();
+      }));
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API(void, OrtApis::ReleaseGenerationEngine, _Frees_ptr_opt_ OrtGenerationEngine* engine) {
+  delete reinterpret_cast<onnxruntime::GenerationEngine*>(engine);
+}
@@ -0,0 +1,157 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gsl/gsl"
+#include "core/common/common.h"
+#include "core/framework/allocator.h"
+#include "core/framework/ort_value.h"
+#include "core/platform/ort_mutex.h"
+
+namespace onnxruntime {
+class InferenceSession;
+
+struct GenerationEngineOptions {
+  int max_batch_size = 16;  // number of requests decoded together
+  int max_length = 1024;    // maximum number of prompt and generated tokens of a request
+  int pad_token_id = 0;     // input id of the positions that left pad shorter prompts
+  int eos_token_id = -1;    // a request ends when it generates this token. -1 for none.
+};
+
+enum class GenerationRequestState {
+  kQueued,     // waiting for a free slot
+  kRunning,    // decoded at each step
+  kFinished,   // generated eos_token_id, max_new_tokens tokens or max_length tokens in total
+  kCancelled,  // cancelled before it finished, or a step failed while it was running
+};
+
+/**
+ * Greedy generation with a GPT-2 decoder model, whose inputs and outputs follow the convention of the
+ * BeamSearch subgraph: input_ids, position_ids, attention_mask and past_i in, logits and present_i out.
+ *
+ * Requests are decoded in slots instead of fixed batches. Each Step admits queued requests into free slots,
+ * runs their prompts, runs one decoding step for the requests that were running, and retires the requests that
+ * finished so that their slots are free for the next Step. The past state of the slots is one batch with a row per
+ * slot, whose rows keep their valid positions right aligned; shorter rows are left padded and masked out in
+ * attention_mask. A request that joins has its prompt's past state written into the row of its slot, and a request
+ * that leaves only frees its slot, so the rows of the other requests stay where they are.
+ *
+ * Submit, Cancel and GetResult may be called from any thread, also while another thread runs Step.
+ */
+class GenerationEngine {
+ public:
+  static Status Create(std::unique_ptr<InferenceSession> session, const GenerationEngineOptions& options,
+                       std::unique_ptr<GenerationEngine>& engine);
+
+  ~GenerationEngine();
+
+  // Queues a request that generates at most max_new_tokens tokens after prompt.
+  Status Submit(gsl::span<const int32_t> prompt, int max_new_tokens, int64_t& request_id);
+
+  // A queued request is removed from the queue, and a running one leaves its slot at the end of the next Step.
+  Status Cancel(int64_t request_id);
+
+  // Runs one decoding step. num_pending is the number of queued and running requests after it.
+  Status Step(size_t& num_pending);
+
+  // Copies the tokens the request has generated so far. A finished or cancelled request is forgotten after its
+  // result has been retrieved.
+  Status GetResult(int64_t request_id, std::vector<int32_t>& tokens, GenerationRequestState& state);
+
+  using CopyResult = std::function<Status(const std::vector<int32_t>& tokens, GenerationRequestState state)>;
+
+  // Like GetResult, but passes the tokens to copy_result without copying them first. A finished or cancelled
+  // request is only forgotten if copy_result succeeds, so that a failed copy can be retried.
+  Status GetResult(int64_t request_id, const CopyResult& copy_result);
+
+ private:
+  struct Request {
+    std::vector<int32_t> prompt;
+    int max_new_tokens;
+    std::vector<int32_t> tokens;
+    GenerationRequestState state;
+  };
+
+  struct Slot {
+    int64_t request_id;  // kFreeSlot if no request runs in the slot
+    int past_length;     // valid positions of the row in the past state
+    int32_t next_token;  // generated token that is not in the past state yet
+  };
+
+  static constexpr int64_t kFreeSlot = -1;
+
+  // Past state of a batch of rows, each with its valid positions at the end of the width positions.
+  struct PastBatch {
+    std::vector<OrtValue> past;  // one (2, batch_size, num_heads, width, head_size) tensor per layer
+    int64_t batch_size = 0;
+    int64_t width = 0;
+  };
+
+  // A row of the past state that is copied into another batch.
+  struct PastRow {
+    const PastBatch* batch;
+    int64_t row;
+    int length;
+  };
+
+  GenerationEngine(std::unique_ptr<InferenceSession> session, const GenerationEngineOptions& options);
+
+  Status Initialize();
+
+  // Runs the prompts, left padded to the same length. Outputs their past state and first generated tokens.
+  Status Prefill(const std::vector<std::vector<int32_t>>& prompts, PastBatch& prefilled,
+                 std::vector<int32_t>& tokens);
+
+  // Runs the next tokens of the slots over past_. Outputs the generated tokens, one per slot.
+  Status Decode(std::vector<int32_t>& tokens);
+
+  // Records a token generated for a running request. Returns whether the request continues. Requires mutex_.
+  bool RecordToken(int64_t request_id, int32_t token, int past_length);
+
+  // Writes the past state of the requests that joined into the rows of their slots. new_rows has an entry per slot,
+  // with a null batch for the slots that didn't change. past_ is reallocated if it lacks the rows or the width,
+  // or is much wider than the longest row now.
+  void UpdatePast(const std::vector<PastRow>& new_rows);
+
+  // Allocates a zeroed batch.
+  void AllocatePast(int64_t batch_size, int64_t width, PastBatch& past) const;
+
+  // Copies the valid positions of row into row dst_row of dst, right aligned, and zeroes the positions before them.
+  void CopyPastRow(const PastRow& row, PastBatch& dst, int64_t dst_row) const;
+
+  // Returns the argmax of the last position of each batch row of logits (batch_size, sequence_length, vocab_size).
+  static void ArgMaxOfLastPosition(const Tensor& logits, std::vector<int32_t>& tokens);
+
+  const std::unique_ptr<InferenceSession> session_;
+  const GenerationEngineOptions options_;
+  AllocatorPtr allocator_;
+
+  std::vector<std::string> feed_names_;
+  std::vector<std::string> output_names_;
+  int num_layers_;
+  int num_heads_;
+  int head_size_;
+  int vocab_size_;
+  MLDataType past_type_;
+
+  // Serializes Step. The slots and past state are only used by Step.
+  OrtMutex step_mutex_;
+  std::vector<Slot> slots_;
+  PastBatch past_;
+
+  // Guards the requests and the queue.
+  OrtMutex mutex_;
+  std::unordered_map<int64_t, Request> requests_;
+  std::deque<int64_t> queue_;
+  int64_t next_request_id_ = 0;
+};
+
+}  // namespace onnxruntime
@@ -4,6 +4,7 @@
 #include "core/graph/onnx_protobuf.h"
 #include "core/session/inference_session.h"
 
+#include <algorithm>
 #include <memory>
 #include <sstream>
 #include <unordered_set>
@@ -299,8 +300,13 @@ void InferenceSession::ConstructorCommon(const SessionOptions& session_options,
         if (to.custom_create_thread_fn) {
           ORT_ENFORCE(to.custom_join_thread_fn, "custom join thread function not set for intra op thread pool");
         }
-        thread_pool_ =
-            concurrency::CreateThreadPool(&Env::Default(), to, concurrency::ThreadPoolType::INTRA_OP);
+        if (session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigIntraOpNumaPools, "0") == "1") {
+          CreateNumaIntraOpThreadPools(to);
+        }
+        if (!thread_pool_) {
+          thread_pool_ =
+              concurrency::CreateThreadPool(&Env::Default(), to, concurrency::ThreadPoolType::INTRA_OP);
+        }
       }
     }
     if (session_options_.execution_mode == ExecutionMode::ORT_PARALLEL) {
@@ -370,12 +376,34 @@ void InferenceSession::ConstructorCommon(const SessionOptions& session_options,
 
       // printf("event map size: %lu\n", event_map.size());
 
+      const std::string events_per_group =
+          session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigProfilerPerfEventsPerGroup, "4");
+      size_t max_events_per_group = 0;
+      if (!TryParseStringWithClassicLocale(events_per_group, max_events_per_group) || max_events_per_group == 0) {
+        ORT_THROW_IF_ERROR(ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Invalid value for ",
+                                           kOrtSessionOptionsConfigProfilerPerfEventsPerGroup, ": '",
+                                           events_per_group, "', expected an integer > 0"));
+      }
+
       PerfProfiler new_perf = PerfProfiler(&counter_name_map, &event_map, NULL);
+      new_perf.max_events_per_group = max_events_per_group;
 
       // store perf profiler configuration in Profiler
       session_profiler_.SetPerf(new_perf);
     }
 
+    const std::string sample_period =
+        session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigProfilerPerfSamplePeriod, "0");
+    uint64_t perf_sample_period = 0;
+    if (!TryParseStringWithClassicLocale(sample_period, perf_sample_period)) {
+      ORT_THROW_IF_ERROR(ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Invalid value for ",
+                                         kOrtSessionOptionsConfigProfilerPerfSamplePeriod, ": '", sample_period,
+                                         "', expected a non-negative integer"));
+    }
+    if (perf_sample_period > 0) {
+      session_profiler_.SetSamplingProfiler(std::make_unique<profiling::SamplingProfiler>(perf_sample_period));
+    }
+
     StartProfiling(session_options_.profile_file_prefix);
   }
 
@@ -474,7 +502,24 @@ InferenceSession::InferenceSession(const SessionOptions& session_options, const
 
 #endif  // !defined(ORT_MINIMAL_BUILD)
 
+struct InferenceSession::AsyncRun {
+  const RunOptions* run_options;
+  RunOptions default_run_options;
+  std::vector<std::string> feed_names;
+  std::vector<OrtValue> feeds;
+  std::vector<std::string> output_names;
+  std::vector<OrtValue> fetches;
+  RunAsyncCallback callback;
+};
+
 InferenceSession::~InferenceSession() {
+  // the queued runs use this session, so let them complete before any member is destroyed
+  {
+    std::unique_lock<OrtMutex> lock(async_run_mutex_);
+    async_run_cv_.wait(lock, [this]() { return num_async_run_workers_ == 0; });
+  }
+  async_run_thread_pool_.reset();
+
   if (session_options_.enable_profiling) {
     ORT_TRY {
       EndProfiling();
@@ -501,6 +546,105 @@ InferenceSession::~InferenceSession() {
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
   MemoryInfo::GenerateMemoryProfile();
 #endif
+
+  if (session_state_ && session_state_->GetEnableMemoryPattern()) {
+    const auto stats = session_state_->GetMemoryPatternCacheStats();
+    const size_t lookups = stats.hits + stats.misses;
+    if (lookups > 0) {
+      LOGS(*session_logger_, INFO) << "Memory pattern cache: " << stats.hits << " hits in " << lookups
+                                   << " lookups (" << 100.0 * stats.hits / lookups << "%), "
+                                   << stats.replacements << " replacements, " << stats.evictions << " evictions";
+    }
+  }
+}
+
+void InferenceSession::CreateNumaIntraOpThreadPools(const OrtThreadPoolParams& thread_pool_params) {
+  numa_node_processors_ = Env::Default().GetNumaNodeProcessors();
+  const size_t num_nodes = numa_node_processors_.size();
+  if (num_nodes < 2) {
+    LOGS(*session_logger_, INFO) << "Not creating NUMA node thread pools as the NUMA topology reports "
+                                 << num_nodes << " node(s)";
+    return;
+  }
+
+  if (thread_pool_params.affinity_vec_len != 0) {
+    LOGS(*session_logger_, WARNING) << "Not creating NUMA node thread pools as the thread affinity is set explicitly";
+    return;
+  }
+
+  const size_t num_threads = thread_pool_params.thread_pool_size > 0
+                                 ? static_cast<size_t>(thread_pool_params.thread_pool_size)
+                                 : Env::Default().GetThreadAffinityMasks().size();
+  const size_t threads_per_node = num_threads / num_nodes;
+  if (threads_per_node < 2) {
+    LOGS(*session_logger_, INFO) << "Not creating NUMA node thread pools as " << num_threads
+                                 << " intra-op threads can't be split across " << num_nodes << " nodes";
+    return;
+  }
+
+  std::vector<std::unique_ptr<concurrency::ThreadPool>> thread_pools;
+  numa_thread_pool_names_.resize(num_nodes);
+  for (size_t node = 0; node < num_nodes; ++node) {
+    auto& processors = numa_node_processors_[node];
+    OrtThreadPoolParams to = thread_pool_params;
+    // the first nodes take the threads left over by the division. the thread calling Run is the extra one.
+    const size_t node_threads = threads_per_node + (node < num_threads % num_nodes ? 1 : 0);
+    to.thread_pool_size = static_cast<int>(std::min(node_threads, processors.size() + 1));
+    to.auto_set_affinity = false;
+    to.affinity_vec = processors.data();
+    to.affinity_vec_len = processors.size();
+    std::basic_stringstream<ORTCHAR_T> ss;
+    ss << thread_pool_name_ << ORT_TSTR("-numa-") << node;
+    numa_thread_pool_names_[node] = ss.str();
+    to.name = numa_thread_pool_names_[node].c_str();
+    thread_pools.push_back(concurrency::CreateThreadPool(&Env::Default(), to, concurrency::ThreadPoolType::INTRA_OP));
+    if (!thread_pools.back()) {
+      LOGS(*session_logger_, WARNING) << "Failed to create the thread pool of NUMA node " << node;
+      return;
+    }
+  }
+
+  thread_pool_ = std::move(thread_pools[0]);
+  for (size_t node = 0; node < num_nodes; ++node) {
+    RunPlacement placement;
+    placement.session_thread_pool = thread_pool_.get();
+    placement.thread_pool = node == 0 ? thread_pool_.get() : thread_pools[node].get();
+    run_placements_.push_back(std::move(placement));
+  }
+  numa_thread_pools_.assign(std::make_move_iterator(thread_pools.begin() + 1),
+                            std::make_move_iterator(thread_pools.end()));
+
+  LOGS(*session_logger_, INFO) << "Created intra-op thread pools for " << num_nodes << " NUMA nodes with "
+                               << threads_per_node << " threads each";
+}
+
+void InferenceSession::CreateNumaNodeAllocators() {
+  const auto* cpu_ep = execution_providers_.Get(onnxruntime::kCpuExecutionProvider);
+  AllocatorPtr cpu_allocator = cpu_ep ? cpu_ep->GetAllocator(0, OrtMemTypeDefault) : nullptr;
+  if (!cpu_allocator) {
+    return;
+  }
+
+  // same kind of allocator as the CPU EP's so it serves the requests for the same OrtMemoryInfo
+  const bool use_arena = cpu_allocator->Info().alloc_type == OrtAllocatorType::OrtArenaAllocator;
+  std::vector<AllocatorPtr> node_allocators;
+  for (size_t node = 0; node < run_placements_.size(); ++node) {
+    AllocatorCreationInfo creation_info{
+        [node](int) { return std::make_unique<NumaNodeCPUAllocator>(static_cast<int>(node)); },
+        0,
+        use_arena};
+    AllocatorPtr node_allocator = CreateAllocator(creation_info);
+    if (!node_allocator || !(node_allocator->Info() == cpu_allocator->Info())) {
+      LOGS(*session_logger_, WARNING) << "Not using NUMA node local allocators as they don't match the CPU allocator "
+                                      << cpu_allocator->Info();
+      return;
+    }
+    node_allocators.push_back(std::move(node_allocator));
+  }
+
+  for (size_t node = 0; node < run_placements_.size(); ++node) {
+    run_placements_[node].cpu_allocator = std::move(node_allocators[node]);
+  }
 }
 
 common::Status InferenceSession::RegisterExecutionProvider(const std::shared_ptr<IExecutionProvider>& p_exec_provider) {
@@ -1467,6 +1611,17 @@ common::Status InferenceSession::Initialize() {
 #endif  // !defined(ORT_MINIMAL_BUILD) || defined(ORT_EXTENDED_MINIMAL_BUILD)
     }
 
+#if !defined(ORT_MINIMAL_BUILD)
+    std::string node_costs_file;
+    if (session_options_.execution_mode == ExecutionMode::ORT_PARALLEL &&
+        session_options_.config_options.TryGetConfigEntry(kOrtSessionOptionsConfigInterOpNodeCostsFile,
+                                                          node_costs_file)) {
+      std::unordered_map<std::string, double> node_costs;
+      ORT_RETURN_IF_ERROR_SESSIONID_(inference_session_utils::ParseNodeCostsFromProfile(node_costs_file, node_costs));
+      session_state_->SetMeasuredNodeCosts(std::move(node_costs));
+    }
+#endif  // !defined(ORT_MINIMAL_BUILD)
+
     ORT_RETURN_IF_ERROR_SESSIONID_(
         session_state_->FinalizeSessionState(model_location_, kernel_registry_manager_,
                                              session_options_,
@@ -1504,6 +1659,10 @@ common::Status InferenceSession::Initialize() {
     // Resolve memory pattern flags of the main graph and subgraph session states
     ResolveMemoryPatternFlags(*session_state_);
 
+    if (!run_placements_.empty()) {
+      CreateNumaNodeAllocators();
+    }
+
     is_inited_ = true;
 
     // we don't directly use the ORT format bytes currently, so free those now
@@ -1639,115 +1798,153 @@ static common::Status CheckTypes(MLDataType actual, MLDataType expected, const s
   return Status(common::ONNXRUNTIME, common::INVALID_ARGUMENT, ostr.str());
 }
 
-common::Status InferenceSession::ValidateInputs(const std::vector<std::string>& feed_names,
-                                                const std::vector<OrtValue>& feeds) const {
-  if (feed_names.size() != feeds.size()) {
-    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Size mismatch: feed_names has ", feed_names.size(),
-                           "elements, but feeds has ", feeds.size(), " elements.");
-  }
-
-  for (size_t i = 0; i < feeds.size(); ++i) {
-    const auto& feed_name = feed_names[i];
-
-    auto iter = input_def_map_.find(feed_name);
-    if (input_def_map_.end() == iter) {
-      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Invalid Feed Input Name:", feed_name);
-    }
-
-    auto expected_type = iter->second.ml_data_type;
-    auto& input_ml_value = feeds.at(i);
-    if (input_ml_value.IsTensor()) {
-      if (!expected_type->IsTensorType()
+common::Status InferenceSession::ValidateInput(const std::string& feed_name, const InputDefMetaData& input_def,
+                                               const OrtValue& input_ml_value) const {
+  auto expected_type = input_def.ml_data_type;
+  if (input_ml_value.IsTensor()) {
+    if (!expected_type->IsTensorType()
 #if !defined(DISABLE_OPTIONAL_TYPE)
-          && !utils::IsOptionalTensor(expected_type)
+        && !utils::IsOptionalTensor(expected_type)
 #endif
-      ) {
-        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input with name: ", feed_name,
-                               " is not expected to be of type tensor.");
-      }
+    ) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input with name: ", feed_name,
+                             " is not expected to be of type tensor.");
+    }
 
-      // check for type
+    // check for type
 #if !defined(DISABLE_OPTIONAL_TYPE)
-      auto expected_element_type = expected_type->IsTensorType()
-                                       ? expected_type
-                                             ->AsTensorType()
-                                             ->GetElementType()
-                                       : utils::GetElementTypeFromOptionalTensor(expected_type);
+    auto expected_element_type = expected_type->IsTensorType()
+                                     ? expected_type
+                                           ->AsTensorType()
+                                           ->GetElementType()
+                                     : utils::GetElementTypeFromOptionalTensor(expected_type);
 #else
-      auto expected_element_type = expected_type->AsTensorType()->GetElementType();
+    auto expected_element_type = expected_type->AsTensorType()->GetElementType();
 #endif
 
-      auto input_element_type = input_ml_value.Get<Tensor>().DataType();
-      ORT_RETURN_IF_ERROR_SESSIONID_(CheckTypes(input_element_type, expected_element_type, "tensor"));
+    auto input_element_type = input_ml_value.Get<Tensor>().DataType();
+    ORT_RETURN_IF_ERROR_SESSIONID_(CheckTypes(input_element_type, expected_element_type, "tensor"));
 
-      // check for shape
-      const auto& expected_shape = iter->second.tensor_shape;
-      if (expected_shape.NumDimensions() > 0) {
-        const auto& input_shape = input_ml_value.Get<Tensor>().Shape();
-        ORT_RETURN_IF_ERROR_SESSIONID_(CheckShapes(feed_name, input_shape, expected_shape));
-      }
-    } else if (input_ml_value.IsSparseTensor()) {
+    // check for shape
+    const auto& expected_shape = input_def.tensor_shape;
+    if (expected_shape.NumDimensions() > 0) {
+      const auto& input_shape = input_ml_value.Get<Tensor>().Shape();
+      ORT_RETURN_IF_ERROR_SESSIONID_(CheckShapes(feed_name, input_shape, expected_shape));
+    }
+  } else if (input_ml_value.IsSparseTensor()) {
 #if !defined(DISABLE_SPARSE_TENSORS)
-      if (!expected_type->IsSparseTensorType()) {
-        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input with name: ", feed_name,
-                               " is not expected to be of type sparse tensor.");
-      }
-      auto expected_element_type = expected_type->AsSparseTensorType()->GetElementType();
-      const SparseTensor& sparse_tensor = input_ml_value.Get<SparseTensor>();
-      auto input_element_type = sparse_tensor.DataType();
-      ORT_RETURN_IF_ERROR_SESSIONID_(CheckTypes(input_element_type, expected_element_type, "sparse_tensor"));
-      // Check shape
-      const auto& expected_shape = iter->second.tensor_shape;
-      if (expected_shape.NumDimensions() > 0) {
-        const auto& input_shape = sparse_tensor.DenseShape();
-        ORT_RETURN_IF_ERROR_SESSIONID_(CheckShapes(feed_name, input_shape, expected_shape));
-      }
+    if (!expected_type->IsSparseTensorType()) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input with name: ", feed_name,
+                             " is not expected to be of type sparse tensor.");
+    }
+    auto expected_element_type = expected_type->AsSparseTensorType()->GetElementType();
+    const SparseTensor& sparse_tensor = input_ml_value.Get<SparseTensor>();
+    auto input_element_type = sparse_tensor.DataType();
+    ORT_RETURN_IF_ERROR_SESSIONID_(CheckTypes(input_element_type, expected_element_type, "sparse_tensor"));
+    // Check shape
+    const auto& expected_shape = input_def.tensor_shape;
+    if (expected_shape.NumDimensions() > 0) {
+      const auto& input_shape = sparse_tensor.DenseShape();
+      ORT_RETURN_IF_ERROR_SESSIONID_(CheckShapes(feed_name, input_shape, expected_shape));
+    }
 #else
-      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input with name ", feed_name,
-                             " is a sparse tensor, which is not supported in this build.");
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input with name ", feed_name,
+                           " is a sparse tensor, which is not supported in this build.");
 #endif
 
-    } else if (input_ml_value.IsTensorSequence()) {
-      if (!expected_type->IsTensorSequenceType()
+  } else if (input_ml_value.IsTensorSequence()) {
+    if (!expected_type->IsTensorSequenceType()
 #if !defined(DISABLE_OPTIONAL_TYPE)
-          && !utils::IsOptionalSeqTensor(expected_type)
+        && !utils::IsOptionalSeqTensor(expected_type)
 #endif
-      ) {
-        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input with name: ", feed_name,
-                               " is not expected to be of type tensor sequence.");
-      }
+    ) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Input with name: ", feed_name,
+                             " is not expected to be of type tensor sequence.");
+    }
 
 #if !defined(DISABLE_OPTIONAL_TYPE)
-      auto expected_element_type = expected_type->IsTensorSequenceType()
-                                       ? expected_type
-                                             ->AsSequenceTensorType()
-                                             ->GetElementType()
-                                       : utils::GetElementTypeFromOptionalSeqTensor(expected_type);
+    auto expected_element_type = expected_type->IsTensorSequenceType()
+                                     ? expected_type
+                                           ->AsSequenceTensorType()
+                                           ->GetElementType()
+                                     : utils::GetElementTypeFromOptionalSeqTensor(expected_type);
 #else
-      auto expected_element_type = expected_type->AsSequenceTensorType()->GetElementType();
+    auto expected_element_type = expected_type->AsSequenceTensorType()->GetElementType();
 #endif
 
-      auto input_element_type = input_ml_value.Get<TensorSeq>().DataType();
-      ORT_RETURN_IF_ERROR_SESSIONID_(CheckTypes(input_element_type, expected_element_type, "seq"));
-    } else {
-      auto input_type = input_ml_value.Type();
-      ORT_RETURN_IF_ERROR_SESSIONID_(CheckTypes(input_type, expected_type, ""));
-    }
+    auto input_element_type = input_ml_value.Get<TensorSeq>().DataType();
+    ORT_RETURN_IF_ERROR_SESSIONID_(CheckTypes(input_element_type, expected_element_type, "seq"));
+  } else {
+    auto input_type = input_ml_value.Type();
+    ORT_RETURN_IF_ERROR_SESSIONID_(CheckTypes(input_type, expected_type, ""));
   }
 
   return Status::OK();
 }
 
-common::Status InferenceSession::ValidateOutputs(const std::vector<std::string>& output_names,
-                                                 const std::vector<OrtValue>* p_fetches) const {
-  if (p_fetches == nullptr) {
-    return common::Status(common::ONNXRUNTIME, common::INVALID_ARGUMENT, "Output vector pointer is NULL");
+common::Status InferenceSession::PrepareRun(const std::vector<std::string>& feed_names,
+                                            const std::vector<std::string>& output_names,
+                                            std::unique_ptr<PreparedRun>& prepared_run) const {
+  if (!is_inited_) {
+    LOGS(*session_logger_, ERROR) << "Session was not initialized";
+    return Status(common::ONNXRUNTIME, common::FAIL, "Session not initialized.");
+  }
+
+  std::vector<const InputDefMetaData*> feed_defs;
+  feed_defs.reserve(feed_names.size());
+  for (const auto& feed_name : feed_names) {
+    auto iter = input_def_map_.find(feed_name);
+    if (input_def_map_.end() == iter) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Invalid Feed Input Name:", feed_name);
+    }
+    feed_defs.push_back(&iter->second);
   }
 
   if (output_names.empty()) {
     return common::Status(common::ONNXRUNTIME, common::INVALID_ARGUMENT, "At least one output should be requested.");
   }
 
+  for (const auto& name : output_names) {
+    if (model_output_names_.find(name) == model_output_names_.end()) {
+      return common::Status(common::ONNXRUNTIME, common::INVALID_ARGUMENT, "Invalid Output Name:" + name);
+    }
+  }
+
+  FeedsFetchesInfo info;
+  info.feed_names = feed_names;
+  info.output_names = output_names;
+  ORT_RETURN_IF_ERROR(info.SetMLValueIdxs(session_state_->GetOrtValueNameIdxMap()));
+
+  std::unique_ptr<PreparedRun> run{new PreparedRun(*this, std::move(info))};
+  run->feed_defs_ = std::move(feed_defs);
+  ORT_RETURN_IF_ERROR(utils::InitializeFeedFetchCopyInfo(*session_state_, run->feeds_fetches_manager_));
+
+  prepared_run = std::move(run);
+  return Status::OK();
+}
+
+common::Status InferenceSession::ValidateFeedsAndFetches(const PreparedRun& prepared_run,
+                                                         const std::vector<OrtValue>& feeds,
+                                                         const std::vector<OrtValue>* p_fetches) const {
+  if (&prepared_run.session_ != this) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "The prepared run was prepared by another session.");
+  }
+
+  const auto& feed_names = prepared_run.GetFeedNames();
+  if (feed_names.size() != feeds.size()) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Size mismatch: feed_names has ", feed_names.size(),
+                           "elements, but feeds has ", feeds.size(), " elements.");
+  }
+
+  for (size_t i = 0; i < feeds.size(); ++i) {
+    ORT_RETURN_IF_ERROR(ValidateInput(feed_names[i], *prepared_run.feed_defs_[i], feeds[i]));
+  }
+
+  if (p_fetches == nullptr) {
+    return common::Status(common::ONNXRUNTIME, common::INVALID_ARGUMENT, "Output vector pointer is NULL");
+  }
+
+  const auto& output_names = prepared_run.GetOutputNames();
   if (!p_fetches->empty() && (output_names.size() != p_fetches->size())) {
     std::ostringstream ostr;
     ostr << "Output vector incorrectly sized: output_names.size(): " << output_names.size()
@@ -1755,12 +1952,6 @@ common::Status InferenceSession::ValidateOutputs(const std::vector<std::string>&
     return common::Status(common::ONNXRUNTIME, common::INVALID_ARGUMENT, ostr.str());
   }
 
-  for (const auto& name : output_names) {
-    if (model_output_names_.find(name) == model_output_names_.end()) {
-      return common::Status(common::ONNXRUNTIME, common::INVALID_ARGUMENT, "Invalid Output Name:" + name);
-    }
-  }
-
   // TODO add more validation here like checking shape of the allocated buffers
 
   return common::Status::OK();
@@ -1843,6 +2034,102 @@ Status InferenceSession::Run(const RunOptions& run_options,
                              const std::vector<std::string>& feed_names, const std::vector<OrtValue>& feeds,
                              const std::vector<std::string>& output_names, std::vector<OrtValue>* p_fetches,
                              const std::vector<OrtDevice>* p_fetches_device_info) {
+  return RunImpl(run_options, nullptr, &feed_names, &output_names, feeds, p_fetches, p_fetches_device_info);
+}
+
+Status InferenceSession::Run(const RunOptions& run_options, const PreparedRun& prepared_run,
+                             const std::vector<OrtValue>& feeds, std::vector<OrtValue>* p_fetches) {
+  return RunImpl(run_options, &prepared_run, nullptr, nullptr, feeds, p_fetches, nullptr);
+}
+
+Status InferenceSession::RunAsync(const RunOptions* run_options, std::vector<std::string> feed_names,
+                                  std::vector<OrtValue> feeds, std::vector<std::string> output_names,
+                                  std::vector<OrtValue> fetches, RunAsyncCallback callback) {
+  if (!is_inited_) {
+    LOGS(*session_logger_, ERROR) << "Session was not initialized";
+    return Status(common::ONNXRUNTIME, common::FAIL, "Session not initialized.");
+  }
+
+  if (!callback) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "The callback of an asynchronous run must be set.");
+  }
+
+  auto async_run = std::make_unique<AsyncRun>();
+  async_run->run_options = run_options;
+  async_run->feed_names = std::move(feed_names);
+  async_run->feeds = std::move(feeds);
+  async_run->output_names = std::move(output_names);
+  async_run->fetches = std::move(fetches);
+  async_run->callback = std::move(callback);
+
+  concurrency::ThreadPool* thread_pool;
+  {
+    std::lock_guard<OrtMutex> lock(async_run_mutex_);
+    if (!async_run_thread_pool_) {
+      OrtThreadPoolParams to = session_options_.inter_op_param;
+      std::basic_stringstream<ORTCHAR_T> ss;
+      if (to.name) {
+        ss << to.name << ORT_TSTR("-");
+      }
+      ss << ORT_TSTR("session-") << session_id_ << ORT_TSTR("-async-run");
+      async_run_thread_pool_name_ = ss.str();
+      to.name = async_run_thread_pool_name_.c_str();
+      // The caller does not take part in the runs, so at least one thread besides it is needed. The size is
+      // resolved here, as by default CreateThreadPool creates no pool on a single CPU.
+      const int num_cpus = static_cast<int>(Env::Default().GetThreadAffinityMasks().size());
+      to.thread_pool_size = std::max(2, to.thread_pool_size > 0 ? to.thread_pool_size : num_cpus);
+      to.auto_set_affinity = false;
+      // the threads wait for the runs to be queued, which may take a while
+      to.allow_spinning = false;
+      to.custom_create_thread_fn = session_options_.custom_create_thread_fn;
+      to.custom_thread_creation_options = session_options_.custom_thread_creation_options;
+      to.custom_join_thread_fn = session_options_.custom_join_thread_fn;
+      async_run_thread_pool_ =
+          concurrency::CreateThreadPool(&Env::Default(), to, concurrency::ThreadPoolType::INTER_OP);
+      ORT_RETURN_IF_NOT(async_run_thread_pool_, "Failed to create the thread pool of the asynchronous runs.");
+    }
+
+    async_run_queue_.push_back(std::move(async_run));
+
+    // each worker executes the queued runs until the queue is empty, so the pool is never given more tasks than it
+    // has threads and does not fall back to executing them on this thread
+    if (num_async_run_workers_ >= concurrency::ThreadPool::NumThreads(async_run_thread_pool_.get())) {
+      return Status::OK();
+    }
+    ++num_async_run_workers_;
+    thread_pool = async_run_thread_pool_.get();
+  }
+
+  concurrency::ThreadPool::Schedule(thread_pool, [this]() { RunAsyncWorker(); });
+  return Status::OK();
+}
+
+void InferenceSession::RunAsyncWorker() {
+  std::unique_lock<OrtMutex> lock(async_run_mutex_);
+  while (!async_run_queue_.empty()) {
+    std::unique_ptr<AsyncRun> async_run = std::move(async_run_queue_.front());
+    async_run_queue_.pop_front();
+    lock.unlock();
+
+    const RunOptions& run_options =
+        async_run->run_options != nullptr ? *async_run->run_options : async_run->default_run_options;
+    Status status = Run(run_options, async_run->feed_names, async_run->feeds, async_run->output_names,
+                        &async_run->fetches);
+    async_run->callback(status, async_run->fetches);
+    async_run.reset();
+
+    lock.lock();
+  }
+
+  --num_async_run_workers_;
+  async_run_cv_.notify_all();
+}
+
+Status InferenceSession::RunImpl(const RunOptions& run_options, const PreparedRun* prepared_run,
+                                 const std::vector<std::string>* feed_names,
+                                 const std::vector<std::string>* output_names,
+                                 const std::vector<OrtValue>& feeds, std::vector<OrtValue>* p_fetches,
+                                 const std::vector<OrtDevice>* p_fetches_device_info) {
   TimePoint tp;
   if (session_profiler_.IsEnabled()) {
     tp = session_profiler_.Start();
@@ -1878,8 +2165,15 @@ Status InferenceSession::Run(const RunOptions& run_options,
       // log evaluation start to trace logging provider
       env.GetTelemetryProvider().LogEvaluationStart();
 
-      ORT_RETURN_IF_ERROR_SESSIONID_(ValidateInputs(feed_names, feeds));
-      ORT_RETURN_IF_ERROR_SESSIONID_(ValidateOutputs(output_names, p_fetches));
+      // resolve the names for this call only if they were not prepared
+      std::unique_ptr<PreparedRun> owned_prepared_run;
+      const PreparedRun* run = prepared_run;
+      if (run == nullptr) {
+        ORT_RETURN_IF_ERROR_SESSIONID_(PrepareRun(*feed_names, *output_names, owned_prepared_run));
+        run = owned_prepared_run.get();
+      }
+
+      ORT_RETURN_IF_ERROR_SESSIONID_(ValidateFeedsAndFetches(*run, feeds, p_fetches));
 
       // shrink certain default memory arenas if the user has requested for it
       const std::string& shrink_memory_arenas =
@@ -1889,18 +2183,7 @@ Status InferenceSession::Run(const RunOptions& run_options,
         ORT_RETURN_IF_ERROR_SESSIONID_(ValidateAndParseShrinkArenaString(shrink_memory_arenas, arenas_to_shrink));
       }
 
-      FeedsFetchesInfo info(feed_names, output_names, session_state_->GetOrtValueNameIdxMap());
-      FeedsFetchesManager feeds_fetches_manager{std::move(info)};
-
-      if (p_fetches_device_info) {
-        // populate the target device info. ignored if pre-allocated fetches are provided
-        const auto& fetch_device_info = *p_fetches_device_info;
-        auto& fetch_info = feeds_fetches_manager.GetMutableFetchesDeviceCopyInfo();
-
-        for (size_t i = 0, end = output_names.size(); i < end; ++i) {
-          fetch_info[i].target_device = fetch_device_info[i];
-        }
-      }
+      const FeedsFetchesManager& feeds_fetches_manager = run->feeds_fetches_manager_;
 
       if (!run_options.run_tag.empty()) {
         LOGS(*session_logger_, INFO) << "Running with tag: " << run_options.run_tag;
@@ -1908,6 +2191,13 @@ Status InferenceSession::Run(const RunOptions& run_options,
 
       ++current_num_runs_;
 
+      // with NUMA node thread pools, run on the next node
+      std::optional<RunPlacement::Scope> run_placement_scope;
+      if (!run_placements_.empty()) {
+        const size_t node = next_run_placement_.fetch_add(1, std::memory_order_relaxed) % run_placements_.size();
+        run_placement_scope.emplace(&run_placements_[node]);
+      }
+
       // scope of owned_run_logger is just the call to Execute.
       // If Execute ever becomes async we need a different approach
       std::unique_ptr<logging::Logger> owned_run_logger;
@@ -1943,9 +2233,10 @@ Status InferenceSession::Run(const RunOptions& run_options,
 #ifdef DEBUG_NODE_INPUTS_OUTPUTS
       session_state_->IncrementGraphExecutionCounter();
 #endif
-      ORT_CHECK_AND_SET_RETVAL(utils::ExecuteGraph(*session_state_, feeds_fetches_manager, feeds, *p_fetches,
-                                                   session_options_.execution_mode, run_options.terminate, run_logger,
-                                                   run_options.only_execute_path_to_fetches));
+      ORT_CHECK_AND_SET_RETVAL(utils::ExecutePreparedGraph(*session_state_, feeds_fetches_manager, feeds, *p_fetches,
+                                                           session_options_.execution_mode, run_options.terminate,
+                                                           run_logger, run_options.only_execute_path_to_fetches,
+                                                           p_fetches_device_info));
     }
     ORT_CATCH(const std::exception& e) {
       ORT_HANDLE_EXCEPTION([&]() {
@@ -2003,7 +2294,8 @@ Status InferenceSession::Run(const RunOptions& run_options,
     LOGS(*session_logger_, INFO) << "Start the second Run() to capture the graph. "
                                     "The first one is for necessary memory allocation;"
                                     "The second one is for capturing the graph.";
-    ORT_RETURN_IF_ERROR(Run(run_options, feed_names, feeds, output_names, p_fetches, p_fetches_device_info));
+    ORT_RETURN_IF_ERROR(RunImpl(run_options, prepared_run, feed_names, output_names, feeds, p_fetches,
+                                p_fetches_device_info));
   }
   return retval;
 }
@@ -3,6 +3,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <functional>
 #include <string>
 #include <unordered_map>
 
@@ -16,11 +19,13 @@
 #include "core/framework/iexecutor.h"
 #include "core/framework/kernel_registry_manager.h"
 #include "core/framework/prepacked_weights_container.h"
+#include "core/framework/run_placement.h"
 #include "core/framework/session_state.h"
 #include "core/graph/basic_types.h"
 #include "core/optimizer/graph_transformer_level.h"
 #include "core/optimizer/graph_transformer_mgr.h"
 #include "core/optimizer/insert_cast_transformer.h"
+#include "core/platform/ort_mutex.h"
 #include "core/framework/session_options.h"
 #include "core/framework/allocatormgr.h"
 #ifdef ENABLE_LANGUAGE_INTEROP_OPS
@@ -306,6 +311,51 @@ class InferenceSession {
                      std::vector<OrtValue>* p_fetches,
                      const std::vector<OrtDevice>* p_fetches_device_info = nullptr) ORT_MUST_USE_RESULT;
 
+  class PreparedRun;
+
+  /**
+   * Resolve the feed and output names of Run once. The returned handle can be used by any number of calls to
+   * Run, including concurrent ones, which then only check the types and shapes of the feeds.
+   * This API is thread-safe.
+   * @param feed_names names of the inputs, in the order of the feeds that will be given to Run.
+   * @param output_names names of the outputs, in the order of the fetches that will be returned by Run.
+   * @param prepared_run the resolved names. It must not outlive this session.
+   * @return OK if success.
+   */
+  common::Status PrepareRun(const std::vector<std::string>& feed_names, const std::vector<std::string>& output_names,
+                            std::unique_ptr<PreparedRun>& prepared_run) const ORT_MUST_USE_RESULT;
+
+  /**
+   * Run a pre-loaded and pre-intialized model with the names resolved by PrepareRun.
+   * Multiple threads are allowed to run this function; hence its thread-safe.
+   * @param prepared_run the names of the feeds and fetches, prepared by this session.
+   * @param feeds inputs in the order of the feed names of prepared_run.
+   * @param p_fetches output values in the order of the output names of prepared_run.
+   * @return OK if success.
+   */
+  common::Status Run(const RunOptions& run_options, const PreparedRun& prepared_run,
+                     const std::vector<OrtValue>& feeds, std::vector<OrtValue>* p_fetches) ORT_MUST_USE_RESULT;
+
+  /**
+   * Callback of RunAsync, invoked with the status and the fetches of the run. It must not destroy the session.
+   */
+  using RunAsyncCallback = std::function<void(const common::Status& status, std::vector<OrtValue>& fetches)>;
+
+  /**
+   * Queue a run of a pre-loaded and pre-intialized model, and return without waiting for it.
+   * The queued runs are executed by a thread pool of the session, created by the first call with the inter-op
+   * thread pool options, and the callback is invoked on the thread that executed the run.
+   * Multiple threads are allowed to run this function; hence its thread-safe.
+   * @param run_options options of the run, or nullptr for the default options. They must stay valid until the
+   *        callback is invoked. Setting their terminate flag cancels the run, queued or running.
+   * @param fetches optional pre-allocated output values in the order specified by output_names.
+   * @param callback invoked once the run completes, with the output values in the order specified by output_names.
+   * @return OK if the run was queued.
+   */
+  common::Status RunAsync(const RunOptions* run_options, std::vector<std::string> feed_names,
+                          std::vector<OrtValue> feeds, std::vector<std::string> output_names,
+                          std::vector<OrtValue> fetches, RunAsyncCallback callback) ORT_MUST_USE_RESULT;
+
   /**
    * Run a pre-loaded and pre-intialized model.
    * Multiple threads are allowed to run this function; hence its thread-safe.
@@ -549,6 +599,13 @@ class InferenceSession {
   void ConstructorCommon(const SessionOptions& session_options,
                          const Environment& session_env);
 
+  // Creates one intra-op thread pool per NUMA node with its threads pinned to the node, if there is more than one
+  // node. thread_pool_ becomes the pool of node 0. Called by the constructor.
+  void CreateNumaIntraOpThreadPools(const OrtThreadPoolParams& thread_pool_params);
+
+  // Gives each NUMA node an allocator for the CPU memory of the Runs assigned to it. Called by Initialize.
+  void CreateNumaNodeAllocators();
+
   common::Status SaveModelMetadata(const onnxruntime::Model& model) ORT_MUST_USE_RESULT;
 
 #if !defined(ORT_MINIMAL_BUILD)
@@ -598,11 +655,25 @@ class InferenceSession {
   common::Status CheckShapes(const std::string& input_name, const TensorShape& input_shape,
                              const TensorShape& expected_shape) const ORT_MUST_USE_RESULT;
 
-  common::Status ValidateInputs(const std::vector<std::string>& feed_names,
-                                const std::vector<OrtValue>& feeds) const ORT_MUST_USE_RESULT;
+  struct InputDefMetaData;
 
-  common::Status ValidateOutputs(const std::vector<std::string>& output_names,
-                                 const std::vector<OrtValue>* p_fetches) const ORT_MUST_USE_RESULT;
+  common::Status ValidateInput(const std::string& feed_name, const InputDefMetaData& input_def,
+                               const OrtValue& input_ml_value) const ORT_MUST_USE_RESULT;
+
+  // Check the feeds and fetches of a call to Run against the names resolved by PrepareRun.
+  common::Status ValidateFeedsAndFetches(const PreparedRun& prepared_run, const std::vector<OrtValue>& feeds,
+                                         const std::vector<OrtValue>* p_fetches) const ORT_MUST_USE_RESULT;
+
+  struct AsyncRun;
+
+  // Executes the runs queued by RunAsync until the queue is empty. Invoked on the threads of async_run_thread_pool_.
+  void RunAsyncWorker();
+
+  // Either prepared_run, or the feed and output names to prepare a run with, are provided.
+  common::Status RunImpl(const RunOptions& run_options, const PreparedRun* prepared_run,
+                         const std::vector<std::string>* feed_names, const std::vector<std::string>* output_names,
+                         const std::vector<OrtValue>& feeds, std::vector<OrtValue>* p_fetches,
+                         const std::vector<OrtDevice>* p_fetches_device_info) ORT_MUST_USE_RESULT;
 
   common::Status WaitForNotification(Notification* p_executor_done, int64_t timeout_in_ms) ORT_MUST_USE_RESULT;
 
@@ -672,6 +743,14 @@ class InferenceSession {
   std::unique_ptr<onnxruntime::concurrency::ThreadPool> thread_pool_;
   std::unique_ptr<onnxruntime::concurrency::ThreadPool> inter_op_thread_pool_;
 
+  // Intra-op thread pools of NUMA node 1 and up when kOrtSessionOptionsConfigIntraOpNumaPools is set.
+  // Runs are assigned to the nodes round-robin and use the thread pool and allocator of their run_placements_ entry.
+  std::vector<std::basic_string<ORTCHAR_T>> numa_thread_pool_names_;
+  std::vector<std::vector<size_t>> numa_node_processors_;
+  std::vector<std::unique_ptr<onnxruntime::concurrency::ThreadPool>> numa_thread_pools_;
+  std::vector<RunPlacement> run_placements_;
+  std::atomic<size_t> next_run_placement_{0};
+
   // Global threadpools. These are intialized and used when use_per_session_threads is false *and*
   // the environment is created with create_global_thread_pools = true.
   onnxruntime::concurrency::ThreadPool* intra_op_thread_pool_from_env_{};
@@ -720,6 +799,15 @@ class InferenceSession {
   // Number of concurrently running executors
   std::atomic<int> current_num_runs_;
 
+  // The runs queued by RunAsync, and the number of threads of async_run_thread_pool_ executing them.
+  // The pool is created by the first call to RunAsync.
+  OrtMutex async_run_mutex_;
+  OrtCondVar async_run_cv_;
+  std::deque<std::unique_ptr<AsyncRun>> async_run_queue_;  // GUARDED_BY(async_run_mutex_)
+  int num_async_run_workers_ = 0;                           // GUARDED_BY(async_run_mutex_)
+  std::basic_string<ORTCHAR_T> async_run_thread_pool_name_;
+  std::unique_ptr<onnxruntime::concurrency::ThreadPool> async_run_thread_pool_;  // GUARDED_BY(async_run_mutex_)
+
   mutable onnxruntime::OrtMutex session_mutex_;  // to ensure only one thread can invoke Load/Initialize
   bool is_model_loaded_ = false;                 // GUARDED_BY(session_mutex_)
   bool is_inited_ = false;                       // GUARDED_BY(session_mutex_)
@@ -827,6 +915,35 @@ class InferenceSession {
   CachedExecutionProviderForGraphReplay cached_execution_provider_for_graph_replay_;
 };
 
+/**
+ * The names of the feeds and fetches of InferenceSession::Run, resolved by InferenceSession::PrepareRun to the
+ * indices of the values, the static device copy info and the metadata of the inputs.
+ * It is not modified by Run, so that concurrent calls may share it.
+ */
+class InferenceSession::PreparedRun {
+ public:
+  const std::vector<std::string>& GetFeedNames() const {
+    return feeds_fetches_manager_.GetFeedsFetchesInfo().feed_names;
+  }
+
+  const std::vector<std::string>& GetOutputNames() const {
+    return feeds_fetches_manager_.GetFeedsFetchesInfo().output_names;
+  }
+
+ private:
+  friend class InferenceSession;
+
+  PreparedRun(const InferenceSession& session, FeedsFetchesInfo&& info)
+      : session_(session), feeds_fetches_manager_(std::move(info)) {}
+
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(PreparedRun);
+
+  const InferenceSession& session_;
+  FeedsFetchesManager feeds_fetches_manager_;
+  // metadata of the inputs in the order of the feeds. points to the entries of input_def_map_.
+  std::vector<const InputDefMetaData*> feed_defs_;
+};
+
 struct SessionIOBinding {
  public:
   SessionIOBinding(InferenceSession* session);
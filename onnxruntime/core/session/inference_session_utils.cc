@@ -5,6 +5,8 @@
 
 #include "core/session/inference_session_utils.h"
 
+#include <fstream>
+
 namespace onnxruntime {
 
 //---------------------
@@ -227,6 +229,51 @@ Status JsonConfigParser::ParseRunOptionsFromModelProto(RunOptions& /*run_options
                          "Parsing RunOptions from ModelProto is not supported yet");
 }
 
+Status ParseNodeCostsFromProfile(const std::string& profile_file,
+                                 std::unordered_map<std::string, double>& node_costs) {
+  static const std::string kernel_time_suffix = "_kernel_time";
+
+  std::ifstream input(profile_file);
+  if (!input) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Failed to open profiling file: ", profile_file);
+  }
+
+  std::unordered_map<std::string, std::pair<double, size_t>> totals;
+  auto status = Status::OK();
+  ORT_TRY {
+    const auto events = json::parse(input);
+    for (const auto& event : events) {
+      if (!event.contains("name") || !event.contains("dur") || event.value("cat", "") != "Node") {
+        continue;
+      }
+
+      const auto& name = event["name"].get_ref<const std::string&>();
+      if (name.size() <= kernel_time_suffix.size() ||
+          name.compare(name.size() - kernel_time_suffix.size(), kernel_time_suffix.size(), kernel_time_suffix) != 0) {
+        continue;
+      }
+
+      auto& total = totals[name.substr(0, name.size() - kernel_time_suffix.size())];
+      total.first += event["dur"].get<double>();
+      ++total.second;
+    }
+  }
+  ORT_CATCH(const std::exception& e) {
+    ORT_HANDLE_EXCEPTION([&]() {
+      status = ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Profiling file ", profile_file,
+                               " cannot be parsed. Error message: ", e.what());
+    });
+  }
+  ORT_RETURN_IF_ERROR(status);
+
+  node_costs.clear();
+  for (const auto& entry : totals) {
+    node_costs[entry.first] = entry.second.first / static_cast<double>(entry.second.second);
+  }
+
+  return Status::OK();
+}
+
 }  // namespace inference_session_utils
 }  // namespace onnxruntime
 
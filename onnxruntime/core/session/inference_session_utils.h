@@ -56,6 +56,10 @@ class JsonConfigParser {
   bool is_ort_config_json_available_ = false;
 };
 
+// Reads the average kernel time in microseconds of each node from a profiling output file
+Status ParseNodeCostsFromProfile(const std::string& profile_file,
+                                 /*out*/ std::unordered_map<std::string, double>& node_costs);
+
 #endif  // !defined(ORT_MINIMAL_BUILD)
 
 }  // namespace inference_session_utils
@@ -13,6 +13,7 @@
 #include <cassert>
 #include <cstring>
 #include <functional>
+#include <limits>
 #include <sstream>
 
 #include "core/common/common.h"
@@ -26,6 +27,8 @@
 #include "core/framework/ort_value.h"
 #include "core/providers/get_execution_providers.h"
 #include "core/session/environment.h"
+#include "core/session/generation_engine.h"
+#include "core/session/request_batcher.h"
 #include "core/framework/callback.h"
 #include "core/framework/tensorprotoutils.h"
 #include "core/framework/onnxruntime_typeinfo.h"
@@ -742,47 +745,177 @@ ORT_API_STATUS_IMPL(OrtApis::CreateSessionFromArray, _In_ const OrtEnv* env, _In
   API_IMPL_END
 }
 
-ORT_API_STATUS_IMPL(OrtApis::Run, _Inout_ OrtSession* sess, _In_opt_ const OrtRunOptions* run_options,
-                    _In_reads_(input_len) const char* const* input_names,
-                    _In_reads_(input_len) const OrtValue* const* input, size_t input_len,
-                    _In_reads_(output_names_len) const char* const* output_names1, size_t output_names_len,
-                    _Inout_updates_all_(output_names_len) OrtValue** output) {
+ORT_API_STATUS_IMPL(OrtApis::CreateGenerationEngine, _In_ const OrtEnv* env, _In_ const ORTCHAR_T* model_path,
+                    _In_opt_ const OrtSessionOptions* options,
+                    _In_reads_(num_keys) const char* const* engine_option_keys,
+                    _In_reads_(num_keys) const int64_t* engine_option_values, _In_ size_t num_keys,
+                    _Outptr_ OrtGenerationEngine** out) {
   API_IMPL_BEGIN
-  auto session = reinterpret_cast<::onnxruntime::InferenceSession*>(sess);
-  constexpr int queue_id = 0;
+  *out = nullptr;
 
-  std::vector<std::string> feed_names(input_len);
-  std::vector<OrtValue> feeds(input_len);
+  onnxruntime::GenerationEngineOptions engine_options;
+  for (size_t i = 0; i < num_keys; ++i) {
+    const int64_t value = engine_option_values[i];
+    if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+      std::ostringstream oss;
+      oss << "Value of " << engine_option_keys[i] << " is out of range: " << value;
+      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, oss.str().c_str());
+    }
 
-  for (size_t i = 0; i != input_len; ++i) {
-    if (input_names[i] == nullptr || input_names[i][0] == '\0') {
-      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, "input name cannot be empty");
+    if (strcmp(engine_option_keys[i], "max_batch_size") == 0) {
+      engine_options.max_batch_size = static_cast<int>(value);
+    } else if (strcmp(engine_option_keys[i], "max_length") == 0) {
+      engine_options.max_length = static_cast<int>(value);
+    } else if (strcmp(engine_option_keys[i], "pad_token_id") == 0) {
+      engine_options.pad_token_id = static_cast<int>(value);
+    } else if (strcmp(engine_option_keys[i], "eos_token_id") == 0) {
+      engine_options.eos_token_id = static_cast<int>(value);
+    } else {
+      std::ostringstream oss;
+      oss << "Invalid key found: " << engine_option_keys[i];
+      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, oss.str().c_str());
     }
+  }
 
-    feed_names[i] = input_names[i];
-    auto& ort_value = feeds[i] = *reinterpret_cast<const ::OrtValue*>(input[i]);
+  std::unique_ptr<onnxruntime::InferenceSession> sess;
+  std::unique_ptr<onnxruntime::GenerationEngine> engine;
+  OrtStatus* status = nullptr;
+
+  ORT_TRY {
+    ORT_API_RETURN_IF_ERROR(CreateSessionAndLoadModel(options, env, model_path, nullptr, 0, sess));
+    ORT_API_RETURN_IF_ERROR(InitializeSession(options, sess));
+    ORT_API_RETURN_IF_STATUS_NOT_OK(onnxruntime::GenerationEngine::Create(std::move(sess), engine_options, engine));
 
-    if (ort_value.Fence()) ort_value.Fence()->BeforeUsingAsInput(onnxruntime::kCpuExecutionProvider, queue_id);
+    *out = reinterpret_cast<OrtGenerationEngine*>(engine.release());
   }
+  ORT_CATCH(const std::exception& e) {
+    ORT_HANDLE_EXCEPTION([&]() {
+      status = OrtApis::CreateStatus(ORT_FAIL, e.what());
+    });
+  }
+
+  return status;
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::CreateRequestBatcher, _In_ const OrtEnv* env, _In_ const ORTCHAR_T* model_path,
+                    _In_opt_ const OrtSessionOptions* options,
+                    _In_reads_(num_keys) const char* const* batcher_option_keys,
+                    _In_reads_(num_keys) const int64_t* batcher_option_values, _In_ size_t num_keys,
+                    _Outptr_ OrtRequestBatcher** out) {
+  API_IMPL_BEGIN
+  *out = nullptr;
 
-  // Create output feed
-  std::vector<std::string> output_names(output_names_len);
-  for (size_t i = 0; i != output_names_len; ++i) {
-    if (output_names1[i] == nullptr || output_names1[i][0] == '\0') {
-      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, "output name cannot be empty");
+  onnxruntime::RequestBatcherOptions batcher_options;
+  for (size_t i = 0; i < num_keys; ++i) {
+    const int64_t value = batcher_option_values[i];
+    if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+      std::ostringstream oss;
+      oss << "Value of " << batcher_option_keys[i] << " is out of range: " << value;
+      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, oss.str().c_str());
+    }
+
+    if (strcmp(batcher_option_keys[i], "max_batch_size") == 0) {
+      batcher_options.max_batch_size = static_cast<int>(value);
+    } else if (strcmp(batcher_option_keys[i], "max_delay_us") == 0) {
+      batcher_options.max_delay_us = static_cast<int>(value);
+    } else if (strcmp(batcher_option_keys[i], "pad_to_bucket") == 0) {
+      batcher_options.pad_to_bucket = value != 0;
+    } else {
+      std::ostringstream oss;
+      oss << "Invalid key found: " << batcher_option_keys[i];
+      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, oss.str().c_str());
     }
-    output_names[i] = output_names1[i];
   }
 
-  std::vector<OrtValue> fetches(output_names_len);
-  for (size_t i = 0; i != output_names_len; ++i) {
+  std::unique_ptr<onnxruntime::InferenceSession> sess;
+  std::unique_ptr<onnxruntime::RequestBatcher> batcher;
+  OrtStatus* status = nullptr;
+
+  ORT_TRY {
+    ORT_API_RETURN_IF_ERROR(CreateSessionAndLoadModel(options, env, model_path, nullptr, 0, sess));
+    ORT_API_RETURN_IF_ERROR(InitializeSession(options, sess));
+    ORT_API_RETURN_IF_STATUS_NOT_OK(onnxruntime::RequestBatcher::Create(std::move(sess), batcher_options, batcher));
+
+    *out = reinterpret_cast<OrtRequestBatcher*>(batcher.release());
+  }
+  ORT_CATCH(const std::exception& e) {
+    ORT_HANDLE_EXCEPTION([&]() {
+      status = OrtApis::CreateStatus(ORT_FAIL, e.what());
+    });
+  }
+
+  return status;
+  API_IMPL_END
+}
+
+// Copies the names of the inputs or outputs of a Run. kind is "input" or "output".
+static ORT_STATUS_PTR GetRunNames(_In_reads_(len) const char* const* names, size_t len, const char* kind,
+                                  std::vector<std::string>& out) {
+  out.resize(len);
+  for (size_t i = 0; i != len; ++i) {
+    if (names[i] == nullptr || names[i][0] == '\0') {
+      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, (std::string(kind) + " name cannot be empty").c_str());
+    }
+    out[i] = names[i];
+  }
+  return nullptr;
+}
+
+static constexpr int kRunQueueId = 0;
+
+// Returns the inputs of a Run once their fences allow using them.
+static std::vector<OrtValue> GetRunFeeds(_In_reads_(input_len) const OrtValue* const* input, size_t input_len) {
+  std::vector<OrtValue> feeds(input_len);
+  for (size_t i = 0; i != input_len; ++i) {
+    auto& ort_value = feeds[i] = *reinterpret_cast<const ::OrtValue*>(input[i]);
+    if (ort_value.Fence()) ort_value.Fence()->BeforeUsingAsInput(onnxruntime::kCpuExecutionProvider, kRunQueueId);
+  }
+  return feeds;
+}
+
+// Returns the fetches of a Run, with the outputs the caller pre-allocated once their fences allow writing them.
+static std::vector<OrtValue> GetRunFetches(_In_reads_(output_len) OrtValue* const* output, size_t output_len) {
+  std::vector<OrtValue> fetches(output_len);
+  for (size_t i = 0; i != output_len; ++i) {
     if (output[i] != nullptr) {
       ::OrtValue& value = *(output[i]);
       if (value.Fence())
-        value.Fence()->BeforeUsingAsOutput(onnxruntime::kCpuExecutionProvider, queue_id);
+        value.Fence()->BeforeUsingAsOutput(onnxruntime::kCpuExecutionProvider, kRunQueueId);
       fetches[i] = value;
     }
   }
+  return fetches;
+}
+
+// Hands the fetches of a successful Run to the caller. The outputs it didn't pre-allocate are created.
+static void SetRunOutputs(std::vector<OrtValue>& fetches, _Inout_updates_all_(output_len) OrtValue** output,
+                          size_t output_len) {
+  for (size_t i = 0; i != output_len; ++i) {
+    ::OrtValue& value = fetches[i];
+    if (value.Fence())
+      value.Fence()->BeforeUsingAsInput(onnxruntime::kCpuExecutionProvider, kRunQueueId);
+    if (output[i] == nullptr) {
+      output[i] = new OrtValue(value);
+    }
+  }
+}
+
+ORT_API_STATUS_IMPL(OrtApis::Run, _Inout_ OrtSession* sess, _In_opt_ const OrtRunOptions* run_options,
+                    _In_reads_(input_len) const char* const* input_names,
+                    _In_reads_(input_len) const OrtValue* const* input, size_t input_len,
+                    _In_reads_(output_names_len) const char* const* output_names1, size_t output_names_len,
+                    _Inout_updates_all_(output_names_len) OrtValue** output) {
+  API_IMPL_BEGIN
+  auto session = reinterpret_cast<::onnxruntime::InferenceSession*>(sess);
+
+  std::vector<std::string> feed_names;
+  ORT_API_RETURN_IF_ERROR(GetRunNames(input_names, input_len, "input", feed_names));
+  std::vector<std::string> output_names;
+  ORT_API_RETURN_IF_ERROR(GetRunNames(output_names1, output_names_len, "output", output_names));
+
+  std::vector<OrtValue> feeds = GetRunFeeds(input, input_len);
+  std::vector<OrtValue> fetches = GetRunFetches(output, output_names_len);
   Status status;
   if (run_options == nullptr) {
     OrtRunOptions op;
@@ -793,14 +926,85 @@ ORT_API_STATUS_IMPL(OrtApis::Run, _Inout_ OrtSession* sess, _In_opt_ const OrtRu
 
   if (!status.IsOK())
     return ToOrtStatus(status);
-  for (size_t i = 0; i != output_names_len; ++i) {
-    ::OrtValue& value = fetches[i];
-    if (value.Fence())
-      value.Fence()->BeforeUsingAsInput(onnxruntime::kCpuExecutionProvider, queue_id);
-    if (output[i] == nullptr) {
-      output[i] = new OrtValue(value);
-    }
+  SetRunOutputs(fetches, output, output_names_len);
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::PrepareRun, _In_ const OrtSession* sess,
+                    _In_reads_(input_len) const char* const* input_names, size_t input_len,
+                    _In_reads_(output_names_len) const char* const* output_names1, size_t output_names_len,
+                    _Outptr_ OrtPreparedRun** out) {
+  API_IMPL_BEGIN
+  auto session = reinterpret_cast<const ::onnxruntime::InferenceSession*>(sess);
+
+  std::vector<std::string> feed_names;
+  ORT_API_RETURN_IF_ERROR(GetRunNames(input_names, input_len, "input", feed_names));
+  std::vector<std::string> output_names;
+  ORT_API_RETURN_IF_ERROR(GetRunNames(output_names1, output_names_len, "output", output_names));
+
+  std::unique_ptr<::onnxruntime::InferenceSession::PreparedRun> prepared_run;
+  ORT_API_RETURN_IF_STATUS_NOT_OK(session->PrepareRun(feed_names, output_names, prepared_run));
+  *out = reinterpret_cast<OrtPreparedRun*>(prepared_run.release());
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::RunPrepared, _Inout_ OrtSession* sess, _In_opt_ const OrtRunOptions* run_options,
+                    _In_ const OrtPreparedRun* prepared, _In_reads_(input_len) const OrtValue* const* input,
+                    size_t input_len, _Inout_updates_all_(output_len) OrtValue** output, size_t output_len) {
+  API_IMPL_BEGIN
+  auto session = reinterpret_cast<::onnxruntime::InferenceSession*>(sess);
+  const auto& prepared_run = *reinterpret_cast<const ::onnxruntime::InferenceSession::PreparedRun*>(prepared);
+
+  std::vector<OrtValue> feeds = GetRunFeeds(input, input_len);
+  std::vector<OrtValue> fetches = GetRunFetches(output, output_len);
+  Status status;
+  if (run_options == nullptr) {
+    OrtRunOptions op;
+    status = session->Run(op, prepared_run, feeds, &fetches);
+  } else {
+    status = session->Run(*run_options, prepared_run, feeds, &fetches);
   }
+
+  if (!status.IsOK())
+    return ToOrtStatus(status);
+  SetRunOutputs(fetches, output, output_len);
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::RunAsync, _Inout_ OrtSession* sess, _In_opt_ const OrtRunOptions* run_options,
+                    _In_reads_(input_len) const char* const* input_names,
+                    _In_reads_(input_len) const OrtValue* const* input, size_t input_len,
+                    _In_reads_(output_names_len) const char* const* output_names1, size_t output_names_len,
+                    _Inout_updates_all_(output_names_len) OrtValue** output,
+                    _In_ RunAsyncCallbackFn run_async_callback, _In_opt_ void* user_data) {
+  API_IMPL_BEGIN
+  auto session = reinterpret_cast<::onnxruntime::InferenceSession*>(sess);
+
+  if (run_async_callback == nullptr) {
+    return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, "run_async_callback cannot be null");
+  }
+
+  std::vector<std::string> feed_names;
+  ORT_API_RETURN_IF_ERROR(GetRunNames(input_names, input_len, "input", feed_names));
+  std::vector<std::string> output_names;
+  ORT_API_RETURN_IF_ERROR(GetRunNames(output_names1, output_names_len, "output", output_names));
+
+  std::vector<OrtValue> feeds = GetRunFeeds(input, input_len);
+  std::vector<OrtValue> fetches = GetRunFetches(output, output_names_len);
+  auto callback = [output, output_names_len, run_async_callback, user_data](const Status& status,
+                                                                            std::vector<OrtValue>& fetches) {
+    if (status.IsOK()) {
+      SetRunOutputs(fetches, output, output_names_len);
+    }
+    run_async_callback(user_data, output, output_names_len, ToOrtStatus(status));
+  };
+
+  ORT_API_RETURN_IF_STATUS_NOT_OK(session->RunAsync(run_options, std::move(feed_names), std::move(feeds),
+                                                    std::move(output_names), std::move(fetches),
+                                                    std::move(callback)));
   return nullptr;
   API_IMPL_END
 }
@@ -2118,6 +2322,8 @@ ORT_API_STATUS_IMPL(OrtApis::CreateArenaCfgV2, _In_reads_(num_keys) const char*
       cfg->max_dead_bytes_per_chunk = static_cast<int>(arena_config_values[i]);
     } else if (strcmp(arena_config_keys[i], "initial_growth_chunk_size_bytes") == 0) {
       cfg->initial_growth_chunk_size_bytes = static_cast<int>(arena_config_values[i]);
+    } else if (strcmp(arena_config_keys[i], "max_small_alloc_bytes") == 0) {
+      cfg->max_small_alloc_bytes = static_cast<int>(arena_config_values[i]);
     } else {
       std::ostringstream oss;
       oss << "Invalid key found: " << arena_config_keys[i];
@@ -2528,6 +2734,19 @@ static constexpr OrtApi ort_api_1_to_12 = {
     &OrtApis::InvokeOp,
     &OrtApis::ReleaseOp,
     &OrtApis::SessionOptionsAppendExecutionProvider_SNPE,
+    &OrtApis::CreateGenerationEngine,
+    &OrtApis::ReleaseGenerationEngine,
+    &OrtApis::GenerationEngineSubmit,
+    &OrtApis::GenerationEngineCancel,
+    &OrtApis::GenerationEngineStep,
+    &OrtApis::GenerationEngineGetResult,
+    &OrtApis::PrepareRun,
+    &OrtApis::ReleasePreparedRun,
+    &OrtApis::RunPrepared,
+    &OrtApis::RunAsync,
+    &OrtApis::CreateRequestBatcher,
+    &OrtApis::ReleaseRequestBatcher,
+    &OrtApis::RequestBatcherRun,
 };
 
 // Asserts to do a some checks to ensure older Versions of the OrtApi never change (will detect an addition or deletion but not if they cancel out each other)
@@ -2576,4 +2795,5 @@ ORT_API(void, OrtApis::ReleaseEnv, OrtEnv* value) {
 DEFINE_RELEASE_ORT_OBJECT_FUNCTION(Value, OrtValue)
 DEFINE_RELEASE_ORT_OBJECT_FUNCTION(RunOptions, OrtRunOptions)
 DEFINE_RELEASE_ORT_OBJECT_FUNCTION(Session, ::onnxruntime::InferenceSession)
+DEFINE_RELEASE_ORT_OBJECT_FUNCTION(PreparedRun, ::onnxruntime::InferenceSession::PreparedRun)
 DEFINE_RELEASE_ORT_OBJECT_FUNCTION(ModelMetadata, ::onnxruntime::ModelMetadata)
@@ -381,4 +381,43 @@ ORT_API_STATUS_IMPL(SessionOptionsAppendExecutionProvider_SNPE,
                     _In_reads_(num_keys) const char* const* provider_options_values,
                     _In_ size_t num_keys);
 
+ORT_API_STATUS_IMPL(CreateGenerationEngine, _In_ const OrtEnv* env, _In_ const ORTCHAR_T* model_path,
+                    _In_opt_ const OrtSessionOptions* options,
+                    _In_reads_(num_keys) const char* const* engine_option_keys,
+                    _In_reads_(num_keys) const int64_t* engine_option_values, _In_ size_t num_keys,
+                    _Outptr_ OrtGenerationEngine** out);
+ORT_API(void, ReleaseGenerationEngine, _Frees_ptr_opt_ OrtGenerationEngine*);
+ORT_API_STATUS_IMPL(GenerationEngineSubmit, _Inout_ OrtGenerationEngine* engine,
+                    _In_reads_(prompt_length) const int32_t* prompt, size_t prompt_length, size_t max_new_tokens,
+                    _Out_ int64_t* request_id);
+ORT_API_STATUS_IMPL(GenerationEngineCancel, _Inout_ OrtGenerationEngine* engine, int64_t request_id);
+ORT_API_STATUS_IMPL(GenerationEngineStep, _Inout_ OrtGenerationEngine* engine, _Out_ size_t* num_pending);
+ORT_API_STATUS_IMPL(GenerationEngineGetResult, _Inout_ OrtGenerationEngine* engine, int64_t request_id,
+                    _Inout_ OrtAllocator* allocator, _Outptr_result_maybenull_ int32_t** tokens,
+                    _Out_ size_t* num_tokens, _Out_ OrtGenerationRequestState* state);
+
+ORT_API_STATUS_IMPL(PrepareRun, _In_ const OrtSession* session, _In_reads_(input_len) const char* const* input_names,
+                    size_t input_len, _In_reads_(output_names_len) const char* const* output_names,
+                    size_t output_names_len, _Outptr_ OrtPreparedRun** out);
+ORT_API(void, ReleasePreparedRun, _Frees_ptr_opt_ OrtPreparedRun*);
+ORT_API_STATUS_IMPL(RunPrepared, _Inout_ OrtSession* session, _In_opt_ const OrtRunOptions* run_options,
+                    _In_ const OrtPreparedRun* prepared_run, _In_reads_(input_len) const OrtValue* const* inputs,
+                    size_t input_len, _Inout_updates_all_(output_len) OrtValue** outputs, size_t output_len);
+ORT_API_STATUS_IMPL(RunAsync, _Inout_ OrtSession* session, _In_opt_ const OrtRunOptions* run_options,
+                    _In_reads_(input_len) const char* const* input_names,
+                    _In_reads_(input_len) const OrtValue* const* input, size_t input_len,
+                    _In_reads_(output_names_len) const char* const* output_names, size_t output_names_len,
+                    _Inout_updates_all_(output_names_len) OrtValue** output,
+                    _In_ RunAsyncCallbackFn run_async_callback, _In_opt_ void* user_data);
+
+ORT_API_STATUS_IMPL(CreateRequestBatcher, _In_ const OrtEnv* env, _In_ const ORTCHAR_T* model_path,
+                    _In_opt_ const OrtSessionOptions* options,
+                    _In_reads_(num_keys) const char* const* batcher_option_keys,
+                    _In_reads_(num_keys) const int64_t* batcher_option_values, _In_ size_t num_keys,
+                    _Outptr_ OrtRequestBatcher** out);
+ORT_API(void, ReleaseRequestBatcher, _Frees_ptr_opt_ OrtRequestBatcher*);
+ORT_API_STATUS_IMPL(RequestBatcherRun, _Inout_ OrtRequestBatcher* batcher,
+                    _In_reads_(input_len) const OrtValue* const* inputs, size_t input_len,
+                    _Out_writes_all_(output_len) OrtValue** outputs, size_t output_len);
+
 }  // namespace OrtApis
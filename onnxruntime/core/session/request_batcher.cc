@@ -0,0 +1,281 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/session/request_batcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#include "core/framework/error_code_helper.h"
+#include "core/framework/run_options.h"
+#include "core/framework/tensor.h"
+#include "core/session/ort_apis.h"
+
+namespace onnxruntime {
+
+Status RequestBatcher::Create(std::unique_ptr<InferenceSession> session, const RequestBatcherOptions& options,
+                              std::unique_ptr<RequestBatcher>& batcher) {
+  ORT_RETURN_IF(session == nullptr, "session is null");
+  ORT_RETURN_IF(options.max_batch_size <= 0, "max_batch_size shall be positive, got ", options.max_batch_size);
+  ORT_RETURN_IF(options.max_delay_us < 0, "max_delay_us shall not be negative, got ", options.max_delay_us);
+
+  std::unique_ptr<RequestBatcher> new_batcher(new RequestBatcher(std::move(session), options));
+  ORT_RETURN_IF_ERROR(new_batcher->Initialize());
+  batcher = std::move(new_batcher);
+  return Status::OK();
+}
+
+RequestBatcher::RequestBatcher(std::unique_ptr<InferenceSession> session, const RequestBatcherOptions& options)
+    : session_(std::move(session)),
+      options_(options),
+      allocator_(std::make_shared<CPUAllocator>()) {
+}
+
+RequestBatcher::~RequestBatcher() = default;
+
+Status RequestBatcher::Initialize() {
+  auto inputs = session_->GetModelInputs();
+  ORT_RETURN_IF_ERROR(inputs.first);
+  auto outputs = session_->GetModelOutputs();
+  ORT_RETURN_IF_ERROR(outputs.first);
+
+  for (const NodeArg* input : *inputs.second) {
+    const auto* shape = input->Shape();
+    ORT_RETURN_IF(shape == nullptr || shape->dim_size() == 0 || shape->dim(0).has_dim_value(),
+                  "Input ", input->Name(), " does not have a symbolic batch dimension first");
+    feed_names_.push_back(input->Name());
+  }
+
+  for (const NodeArg* output : *outputs.second) {
+    // outputs of unknown shape are checked after each run
+    const auto* shape = output->Shape();
+    ORT_RETURN_IF(shape != nullptr && (shape->dim_size() == 0 || shape->dim(0).has_dim_value()),
+                  "Output ", output->Name(), " does not have a symbolic batch dimension first");
+    output_names_.push_back(output->Name());
+  }
+
+  return session_->PrepareRun(feed_names_, output_names_, prepared_run_);
+}
+
+Status RequestBatcher::ValidateRequest(const std::vector<OrtValue>& feeds, int64_t& rows) const {
+  ORT_RETURN_IF(feeds.size() != feed_names_.size(), "Expected ", feed_names_.size(), " inputs, got ", feeds.size());
+
+  rows = -1;
+  for (size_t i = 0; i < feeds.size(); ++i) {
+    ORT_RETURN_IF_NOT(feeds[i].IsTensor(), "Input ", feed_names_[i], " is not a tensor");
+    const Tensor& tensor = feeds[i].Get<Tensor>();
+    ORT_RETURN_IF(tensor.IsDataTypeString(), "Input ", feed_names_[i], " is a string tensor, which is not supported");
+    ORT_RETURN_IF(tensor.Location().device.Type() != OrtDevice::CPU, "Input ", feed_names_[i], " is not on CPU");
+    ORT_RETURN_IF(tensor.Shape().NumDimensions() == 0, "Input ", feed_names_[i], " has no batch dimension");
+
+    if (rows < 0) {
+      rows = tensor.Shape()[0];
+    }
+    ORT_RETURN_IF(tensor.Shape()[0] != rows, "The inputs of a request shall have the same number of rows");
+  }
+
+  ORT_RETURN_IF(rows <= 0, "A request shall have at least one row");
+  return Status::OK();
+}
+
+bool RequestBatcher::HaveSameRowShapes(const std::vector<OrtValue>& feeds,
+                                       const std::vector<OrtValue>& other_feeds) {
+  for (size_t i = 0; i < feeds.size(); ++i) {
+    const Tensor& tensor = feeds[i].Get<Tensor>();
+    const Tensor& other_tensor = other_feeds[i].Get<Tensor>();
+    if (tensor.DataType() != other_tensor.DataType() ||
+        tensor.Shape().NumDimensions() != other_tensor.Shape().NumDimensions() ||
+        tensor.Shape().Slice(1) != other_tensor.Shape().Slice(1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status RequestBatcher::Run(const std::vector<OrtValue>& feeds, std::vector<OrtValue>& fetches) {
+  Request request;
+  ORT_RETURN_IF_ERROR(ValidateRequest(feeds, request.rows));
+  request.feeds = &feeds;
+  request.fetches = &fetches;
+
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(options_.max_delay_us);
+
+  std::unique_lock<OrtMutex> lock(mutex_);
+  queue_.push_back(&request);
+  queued_rows_ += request.rows;
+
+  if (leader_waiting_) {
+    if (queued_rows_ >= options_.max_batch_size) {
+      leader_cv_.notify_one();
+    }
+
+    done_cv_.wait(lock, [this, &request]() {
+      return request.done || (!request.taken && !leader_waiting_ && queue_.front() == &request);
+    });
+    if (request.done) {
+      return request.status;
+    }
+  }
+
+  // No batch is filling up, so this request is the first of the next one. Wait for more requests, but not past the
+  // deadline of this request, which may have been queued for a while already.
+  leader_waiting_ = true;
+  while (queued_rows_ < options_.max_batch_size) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      break;
+    }
+    leader_cv_.wait_for(lock, deadline - now);
+  }
+
+  std::vector<Request*> batch;
+  TakeBatch(request, batch);
+  leader_waiting_ = false;
+  if (!queue_.empty()) {
+    // the first of the remaining requests leads the next batch while this one runs
+    done_cv_.notify_all();
+  }
+  lock.unlock();
+
+  Status status = RunBatch(batch);
+
+  lock.lock();
+  for (Request* batched_request : batch) {
+    batched_request->status = status;
+    batched_request->done = true;
+  }
+  done_cv_.notify_all();
+  return status;
+}
+
+void RequestBatcher::TakeBatch(Request& first, std::vector<Request*>& batch) {
+  queue_.erase(std::find(queue_.begin(), queue_.end(), &first));
+  first.taken = true;
+  batch.push_back(&first);
+  int64_t rows = first.rows;
+
+  for (auto it = queue_.begin(); it != queue_.end();) {
+    Request* request = *it;
+    if (rows + request->rows <= options_.max_batch_size && HaveSameRowShapes(*first.feeds, *request->feeds)) {
+      request->taken = true;
+      batch.push_back(request);
+      rows += request->rows;
+      it = queue_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  queued_rows_ -= rows;
+}
+
+Status RequestBatcher::RunBatch(const std::vector<Request*>& batch) {
+  int64_t rows = 0;
+  for (const Request* request : batch) {
+    rows += request->rows;
+  }
+
+  int64_t padded_rows = rows;
+  if (options_.pad_to_bucket) {
+    int64_t bucket = 1;
+    while (bucket < rows) {
+      bucket *= 2;
+    }
+    padded_rows = std::max(rows, std::min(bucket, static_cast<int64_t>(options_.max_batch_size)));
+  }
+
+  // a request run alone is not copied
+  if (batch.size() == 1 && padded_rows == rows) {
+    return session_->Run(RunOptions(), *prepared_run_, *batch[0]->feeds, batch[0]->fetches);
+  }
+
+  // Concatenate the inputs along the batch dimension. The padding rows repeat the last row so that they hold
+  // values the model accepts; their outputs are dropped.
+  std::vector<OrtValue> feeds(feed_names_.size());
+  for (size_t i = 0; i < feeds.size(); ++i) {
+    const Tensor& first = (*batch[0]->feeds)[i].Get<Tensor>();
+    TensorShape shape = first.Shape();
+    shape[0] = padded_rows;
+    Tensor::InitOrtValue(first.DataType(), shape, allocator_, feeds[i]);
+
+    char* dst = static_cast<char*>(feeds[i].GetMutable<Tensor>()->MutableDataRaw());
+    for (const Request* request : batch) {
+      const Tensor& tensor = (*request->feeds)[i].Get<Tensor>();
+      memcpy(dst, tensor.DataRaw(), tensor.SizeInBytes());
+      dst += tensor.SizeInBytes();
+    }
+
+    const size_t row_bytes = first.SizeInBytes() / static_cast<size_t>(first.Shape()[0]);
+    for (int64_t row = rows; row < padded_rows; ++row) {
+      memcpy(dst, dst - row_bytes, row_bytes);
+      dst += row_bytes;
+    }
+  }
+
+  std::vector<OrtValue> fetches;
+  ORT_RETURN_IF_ERROR(session_->Run(RunOptions(), *prepared_run_, feeds, &fetches));
+
+  for (Request* request : batch) {
+    request->fetches->resize(fetches.size());
+  }
+
+  // Slice the outputs back to the requests.
+  for (size_t i = 0; i < fetches.size(); ++i) {
+    ORT_RETURN_IF_NOT(fetches[i].IsTensor(), "Output ", output_names_[i], " is not a tensor");
+    const Tensor& output = fetches[i].Get<Tensor>();
+    ORT_RETURN_IF(output.IsDataTypeString(), "Output ", output_names_[i], " is a string tensor, which is not supported");
+    ORT_RETURN_IF(output.Location().device.Type() != OrtDevice::CPU, "Output ", output_names_[i], " is not on CPU");
+    ORT_RETURN_IF(output.Shape().NumDimensions() == 0 || output.Shape()[0] != padded_rows,
+                  "Output ", output_names_[i], " does not have the batch dimension first");
+
+    const size_t row_bytes = output.SizeInBytes() / static_cast<size_t>(padded_rows);
+    const char* src = static_cast<const char*>(output.DataRaw());
+    for (Request* request : batch) {
+      TensorShape shape = output.Shape();
+      shape[0] = request->rows;
+      OrtValue& value = (*request->fetches)[i];
+      Tensor::InitOrtValue(output.DataType(), shape, allocator_, value);
+
+      const size_t bytes = static_cast<size_t>(request->rows) * row_bytes;
+      memcpy(value.GetMutable<Tensor>()->MutableDataRaw(), src, bytes);
+      src += bytes;
+    }
+  }
+
+  return Status::OK();
+}
+
+}  // namespace onnxruntime
+
+ORT_API_STATUS_IMPL(OrtApis::RequestBatcherRun, _Inout_ OrtRequestBatcher* batcher,
+                    _In_reads_(input_len) const OrtValue* const* inputs, size_t input_len,
+                    _Out_writes_all_(output_len) OrtValue** outputs, size_t output_len) {
+  API_IMPL_BEGIN
+  auto* request_batcher = reinterpret_cast<onnxruntime::RequestBatcher*>(batcher);
+  if (output_len != request_batcher->GetOutputNames().size()) {
+    std::ostringstream oss;
+    oss << "Expected " << request_batcher->GetOutputNames().size() << " outputs, got " << output_len;
+    return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, oss.str().c_str());
+  }
+
+  std::vector<OrtValue> feeds;
+  feeds.reserve(input_len);
+  for (size_t i = 0; i < input_len; ++i) {
+    feeds.push_back(*inputs[i]);
+  }
+
+  std::vector<OrtValue> fetches;
+  ORT_API_RETURN_IF_STATUS_NOT_OK(request_batcher->Run(feeds, fetches));
+
+  for (size_t i = 0; i < output_len; ++i) {
+    outputs[i] = new OrtValue(fetches[i]);
+  }
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API(void, OrtApis::ReleaseRequestBatcher, _Frees_ptr_opt_ OrtRequestBatcher* batcher) {
+  delete reinterpret_cast<onnxruntime::RequestBatcher*>(batcher);
+}
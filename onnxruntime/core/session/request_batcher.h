@@ -0,0 +1,94 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/common/common.h"
+#include "core/framework/allocator.h"
+#include "core/framework/ort_value.h"
+#include "core/platform/ort_mutex.h"
+#include "core/session/inference_session.h"
+
+namespace onnxruntime {
+
+struct RequestBatcherOptions {
+  int max_batch_size = 16;     // largest number of rows of the requests run together
+  int max_delay_us = 1000;     // longest time the first request of a batch waits for more requests
+  bool pad_to_bucket = false;  // pad the rows of a batch to the next power of two, at most max_batch_size
+};
+
+/**
+ * Coalesces concurrent requests to a model whose inputs and outputs have a symbolic batch dimension first.
+ *
+ * Each request gives all the inputs of the model, with the same number of rows. The first queued request waits
+ * at most max_delay_us for more requests, then it and the queued requests whose inputs have the same types and
+ * row shapes, up to max_batch_size rows, are concatenated along the batch dimension and run once. The outputs are
+ * sliced back to the requests. The batch is run on the thread of its first request, so no thread is added.
+ *
+ * Run may be called from any number of threads. Only tensors on CPU are supported, except string tensors.
+ */
+class RequestBatcher {
+ public:
+  static Status Create(std::unique_ptr<InferenceSession> session, const RequestBatcherOptions& options,
+                       std::unique_ptr<RequestBatcher>& batcher);
+
+  ~RequestBatcher();
+
+  // Runs a request with the other requests of its batch. The feeds are in the order of the model inputs, and the
+  // fetches are returned in the order of the model outputs.
+  Status Run(const std::vector<OrtValue>& feeds, std::vector<OrtValue>& fetches);
+
+  const std::vector<std::string>& GetFeedNames() const { return feed_names_; }
+  const std::vector<std::string>& GetOutputNames() const { return output_names_; }
+
+ private:
+  struct Request {
+    const std::vector<OrtValue>* feeds;
+    std::vector<OrtValue>* fetches;
+    int64_t rows;
+    // taken into a batch by its leader, which may still be running it
+    bool taken = false;
+    bool done = false;
+    Status status;
+  };
+
+  RequestBatcher(std::unique_ptr<InferenceSession> session, const RequestBatcherOptions& options);
+
+  Status Initialize();
+
+  // Checks that the feeds are CPU tensors with the same number of rows, and returns it.
+  Status ValidateRequest(const std::vector<OrtValue>& feeds, int64_t& rows) const;
+
+  // Removes the first request of the batch and the queued requests that can be run with it from the queue.
+  void TakeBatch(Request& first, std::vector<Request*>& batch);
+
+  // Runs the requests together and scatters the outputs to them.
+  Status RunBatch(const std::vector<Request*>& batch);
+
+  // Returns true if the feeds have the same types and the same shapes but for the batch dimension.
+  static bool HaveSameRowShapes(const std::vector<OrtValue>& feeds, const std::vector<OrtValue>& other_feeds);
+
+  const std::unique_ptr<InferenceSession> session_;
+  const RequestBatcherOptions options_;
+  AllocatorPtr allocator_;
+
+  std::vector<std::string> feed_names_;
+  std::vector<std::string> output_names_;
+  std::unique_ptr<InferenceSession::PreparedRun> prepared_run_;
+
+  // Guards the queue. A request waits on leader_cv_ while it waits for its batch to fill up, and the other
+  // requests wait on done_cv_ until their batch ran, or until they are the first of the queue without a batch.
+  OrtMutex mutex_;
+  OrtCondVar leader_cv_;
+  OrtCondVar done_cv_;
+  std::deque<Request*> queue_;
+  int64_t queued_rows_ = 0;
+  bool leader_waiting_ = false;
+};
+
+}  // namespace onnxruntime
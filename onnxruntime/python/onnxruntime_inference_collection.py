@@ -251,6 +251,35 @@ class Session:
             else:
                 raise
 
+    def prepare_run(self, input_names, output_names=None):
+        """
+        Resolve the names of the inputs and outputs once for :meth:`run_prepared`.
+
+        :param input_names: names of the inputs, in the order of the inputs given to :meth:`run_prepared`
+        :param output_names: names of the outputs, all the outputs of the model if None
+        :return: a prepared run, only valid for this session until its providers are changed
+
+        ::
+
+            prepared = sess.prepare_run([input_name], [output_name])
+            sess.run_prepared(prepared, [x])
+        """
+        if not output_names:
+            output_names = [output.name for output in self._outputs_meta]
+        return self._sess.prepare_run(input_names, output_names)
+
+    def run_prepared(self, prepared_run, inputs, run_options=None):
+        """
+        Compute the predictions with the names resolved by :meth:`prepare_run`.
+        Only the types and shapes of the inputs are checked.
+
+        :param prepared_run: returned by :meth:`prepare_run`
+        :param inputs: list of the input values, in the order of the prepared input names
+        :param run_options: See :class:`onnxruntime.RunOptions`.
+        :return: list of the outputs, in the order of the prepared output names
+        """
+        return self._sess.run_prepared(prepared_run, inputs, run_options)
+
     def end_profiling(self):
         """
         End profiling and return results in a file.
@@ -1012,6 +1012,28 @@ void addGlobalMethods(py::module& m, Environment& env) {
 #endif
 }
 
+// Returns the python objects of the fetches of a run. None is returned for the empty values.
+static std::vector<py::object> FetchesToPyObjects(const std::vector<OrtValue>& fetches) {
+  std::vector<py::object> rfetch;
+  rfetch.reserve(fetches.size());
+  size_t pos = 0;
+  for (const auto& fet : fetches) {
+    if (fet.IsAllocated()) {
+      if (fet.IsTensor()) {
+        rfetch.push_back(AddTensorAsPyObj(fet, nullptr, nullptr));
+      } else if (fet.IsSparseTensor()) {
+        rfetch.push_back(GetPyObjectFromSparseTensor(pos, fet, nullptr));
+      } else {
+        rfetch.push_back(AddNonTensorAsPyObj(fet, nullptr, nullptr));
+      }
+    } else {  // Send back None because the corresponding OrtValue was empty
+      rfetch.push_back(py::none());
+    }
+    ++pos;
+  }
+  return rfetch;
+}
+
 void addObjectMethods(py::module& m, Environment& env, ExecutionProviderRegistrationFn ep_registration_fn) {
   py::enum_<GraphOptimizationLevel>(m, "GraphOptimizationLevel")
       .value("ORT_DISABLE_ALL", GraphOptimizationLevel::ORT_DISABLE_ALL)
@@ -1368,6 +1390,11 @@ including arg name, arg type (contains both type and shape).)pbdoc")
           },
           "node shape (assuming the node holds a tensor)");
 
+  py::class_<InferenceSession::PreparedRun>(m, "PreparedRun",
+                                            R"pbdoc(Input and output names resolved by InferenceSession.prepare_run.)pbdoc")
+      .def_property_readonly("input_names", &InferenceSession::PreparedRun::GetFeedNames)
+      .def_property_readonly("output_names", &InferenceSession::PreparedRun::GetOutputNames);
+
   py::class_<SessionObjectInitializer> sessionObjectInitializer(m, "SessionObjectInitializer");
   py::class_<PyInferenceSession>(m, "InferenceSession", R"pbdoc(This is the main class used to run a model.)pbdoc")
       // In Python3, a Python bytes object will be passed to C++ functions that accept std::string or char*
@@ -1451,24 +1478,52 @@ including arg name, arg type (contains both type and shape).)pbdoc")
                }
              }
 
-             std::vector<py::object> rfetch;
-             rfetch.reserve(fetches.size());
-             size_t pos = 0;
-             for (auto fet : fetches) {
-               if (fet.IsAllocated()) {
-                 if (fet.IsTensor()) {
-                   rfetch.push_back(AddTensorAsPyObj(fet, nullptr, nullptr));
-                 } else if (fet.IsSparseTensor()) {
-                   rfetch.push_back(GetPyObjectFromSparseTensor(pos, fet, nullptr));
-                 } else {
-                   rfetch.push_back(AddNonTensorAsPyObj(fet, nullptr, nullptr));
-                 }
-               } else {  // Send back None because the corresponding OrtValue was empty
-                 rfetch.push_back(py::none());
+             return FetchesToPyObjects(fetches);
+           })
+      .def(
+          "prepare_run",
+          [](const PyInferenceSession* sess, const std::vector<std::string>& input_names,
+             const std::vector<std::string>& output_names) -> std::unique_ptr<InferenceSession::PreparedRun> {
+            std::unique_ptr<InferenceSession::PreparedRun> prepared_run;
+            OrtPybindThrowIfError(sess->GetSessionHandle()->PrepareRun(input_names, output_names, prepared_run));
+            return prepared_run;
+          },
+          // the session is kept alive as long as the prepared run
+          py::keep_alive<0, 1>(),
+          R"pbdoc(Resolve the input and output names once for run_prepared.)pbdoc")
+      .def("run_prepared",
+           [](PyInferenceSession* sess, const InferenceSession::PreparedRun& prepared_run,
+              const std::vector<py::object>& pyfeeds, RunOptions* run_options = nullptr)
+               -> std::vector<py::object> {
+             const auto& feed_names = prepared_run.GetFeedNames();
+             if (pyfeeds.size() != feed_names.size()) {
+               throw std::runtime_error("Expected " + std::to_string(feed_names.size()) + " inputs, got " +
+                                        std::to_string(pyfeeds.size()));
+             }
+
+             auto px = sess->GetSessionHandle()->GetModelInputs();
+             if (!px.first.IsOK() || !px.second) {
+               throw std::runtime_error("Either failed to get model inputs from the session object or the input def list was null");
+             }
+
+             std::vector<OrtValue> feeds(pyfeeds.size());
+             for (size_t i = 0; i < pyfeeds.size(); ++i) {
+               CreateGenericMLValue(px.second, GetAllocator(), feed_names[i], pyfeeds[i], &feeds[i]);
+               ThrowIfPyErrOccured();
+             }
+
+             std::vector<OrtValue> fetches;
+             {
+               // release GIL to allow multiple python threads to invoke Run() in parallel.
+               py::gil_scoped_release release;
+               if (run_options != nullptr) {
+                 OrtPybindThrowIfError(sess->GetSessionHandle()->Run(*run_options, prepared_run, feeds, &fetches));
+               } else {
+                 OrtPybindThrowIfError(sess->GetSessionHandle()->Run(RunOptions(), prepared_run, feeds, &fetches));
                }
-               ++pos;
              }
-             return rfetch;
+
+             return FetchesToPyObjects(fetches);
            })
       /// This method accepts a dictionary of feeds (name -> OrtValue) and the list of output_names
       /// and returns a list of python objects representing OrtValues. Each name may represent either
@@ -0,0 +1,341 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+
+#include "core/common/profiler.h"
+#include "core/platform/env.h"
+#include "core/platform/threadpool.h"
+#include "test/test_environment.h"
+
+namespace onnxruntime {
+namespace test {
+
+namespace {
+
+// Whether perf_event_open can count each of the events on the calling thread. PerfProfiler exits the process
+// when it cannot open its counters, so the tests check first and are skipped where perf is not usable, like in
+// containers or with a restrictive /proc/sys/kernel/perf_event_paranoid.
+bool CanOpenPerfEvents(const std::map<perf_type_config_t, std::string>& counters) {
+  for (const auto& kv : counters) {
+    perf_event_attr pea;
+    memset(&pea, 0, sizeof(perf_event_attr));
+    pea.type = kv.first.type;
+    pea.size = sizeof(perf_event_attr);
+    pea.config = kv.first.config;
+    pea.disabled = 1;
+    pea.exclude_kernel = 1;
+    pea.exclude_hv = 1;
+    int fd = static_cast<int>(syscall(__NR_perf_event_open, &pea, 0, -1, -1, 0));
+    if (fd == -1) {
+      return false;
+    }
+    close(fd);
+  }
+  return true;
+}
+
+void Spin(std::chrono::milliseconds duration) {
+  auto end = std::chrono::steady_clock::now() + duration;
+  volatile uint64_t sink = 0;
+  while (std::chrono::steady_clock::now() < end) {
+    for (int i = 0; i < 1000; i++) {
+      sink = sink + i;
+    }
+  }
+}
+
+// The software task clock counts on any machine where perf_event_open works, with or without a PMU.
+std::map<perf_type_config_t, std::string> TaskClockCounter() {
+  return {{{PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK}, "task-clock"}};
+}
+
+// Starts profiling into file_name with the counters, counting on the calling thread only.
+void StartPerfProfiling(profiling::Profiler& profiler, const std::map<perf_type_config_t, std::string>& counters,
+                        const std::string& file_name) {
+  profiler.Initialize(&DefaultLoggingManager().DefaultLogger());
+  std::map<perf_type_config_t, std::string> counter_name_map = counters;
+  std::map<std::string, std::string> no_raw_events;
+  profiler.SetPerf(PerfProfiler(&counter_name_map, &no_raw_events, nullptr));
+  profiler.StartProfiling(file_name);
+  profiler.GetPerfProfiler()->Initialize();
+  profiler.PreparePerfRecords();
+}
+
+// Ends profiling and returns the events of the trace.
+nlohmann::json EndPerfProfiling(profiling::Profiler& profiler) {
+  std::string file_name = profiler.EndProfiling();
+  profiler.GetPerfProfiler()->Close();
+  std::ifstream trace(file_name);
+  nlohmann::json events = nlohmann::json::parse(trace);
+  trace.close();
+  std::remove(file_name.c_str());
+  return events;
+}
+
+}  // namespace
+
+TEST(PerfProfilerTest, CountsOnThreadPoolWorkers) {
+  auto counters = TaskClockCounter();
+  if (!CanOpenPerfEvents(counters)) {
+    GTEST_SKIP() << "perf_event_open is not available";
+  }
+
+  constexpr int kThreads = 3;
+  auto thread_pool = std::make_unique<concurrency::ThreadPool>(&Env::Default(), ThreadOptions{}, nullptr, kThreads,
+                                                               true);
+  // workers publish their thread id once they run
+  std::vector<unsigned> worker_ids;
+  for (int tries = 0; tries < 5000; tries++) {
+    worker_ids = concurrency::ThreadPool::GetWorkerThreadIds(thread_pool.get());
+    if (std::all_of(worker_ids.begin(), worker_ids.end(), [](unsigned tid) { return tid != 0; })) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(worker_ids.size(), static_cast<size_t>(kThreads - 1));
+
+  std::map<std::string, std::string> no_raw_events;
+  PerfProfiler perf(&counters, &no_raw_events, nullptr);
+  perf.Initialize(worker_ids);
+  ASSERT_EQ(perf.perf_thread_groups.size(), static_cast<size_t>(kThreads));
+
+  // the same threads keep their groups
+  int first_fd = perf.perf_thread_groups[1].perf_syscall_data[0].fd;
+  perf.Initialize(worker_ids);
+  EXPECT_EQ(perf.perf_thread_groups[1].perf_syscall_data[0].fd, first_fd);
+
+  perf.StartRun();
+  // every iteration waits for the others, so the caller and both workers each run one
+  std::atomic<int> started{0};
+  concurrency::ThreadPool::TrySimpleParallelFor(thread_pool.get(), kThreads, [&](std::ptrdiff_t) {
+    started++;
+    auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (started.load() < kThreads && std::chrono::steady_clock::now() < give_up) {
+    }
+    Spin(std::chrono::milliseconds(20));
+  });
+  perf.StopRun();
+  ASSERT_EQ(started.load(), kThreads);
+
+  auto per_thread = perf.ReadPerThread();
+  ASSERT_EQ(per_thread.size(), static_cast<size_t>(kThreads));
+  for (size_t i = 0; i < per_thread.size(); i++) {
+    // task-clock counts nanoseconds, each thread spun for at least 20 ms
+    EXPECT_GT(per_thread[i]["task-clock"], 10u * 1000 * 1000) << "thread group " << i;
+  }
+  perf.Close();
+}
+
+TEST(PerfProfilerTest, RecordRingFlushesWhenFull) {
+  auto counters = TaskClockCounter();
+  if (!CanOpenPerfEvents(counters)) {
+    GTEST_SKIP() << "perf_event_open is not available";
+  }
+
+  profiling::Profiler profiler;
+  StartPerfProfiling(profiler, counters, "perf_record_ring_test.json");
+  ASSERT_EQ(profiler.GetPerfProfiler()->NumValues(), PerfProfiler::kValuesPerCounter);
+
+  // twice the 16K records the ring holds and a few more, every record must reach its event
+  constexpr uint64_t kNumEvents = 2 * 16 * 1024 + 3;
+  for (uint64_t i = 0; i < kNumEvents; i++) {
+    const uint64_t values[PerfProfiler::kValuesPerCounter] = {i, 100, 100};
+    profiler.EndTimeAndRecordEvent(profiling::NODE_EVENT, "node_" + std::to_string(i) + "_kernel_time",
+                                   profiler.Start(), {{"op_name", "Add"}}, values);
+  }
+  nlohmann::json events = EndPerfProfiling(profiler);
+
+  uint64_t num_node_events = 0;
+  bool found_summary = false;
+  for (const auto& event : events) {
+    const std::string name = event["name"];
+    if (event["cat"] == "Node") {
+      uint64_t i = std::stoull(name.substr(5, name.size() - 5 - std::string("_kernel_time").size()));
+      EXPECT_EQ(event.at("args").value("task-clock", std::string()), std::to_string(i)) << name;
+      num_node_events++;
+    } else if (name == "Add_perf_summary") {
+      found_summary = true;
+      EXPECT_EQ(event.at("args").value("node_count", std::string()), std::to_string(kNumEvents));
+      EXPECT_EQ(event.at("args").value("task-clock", std::string()), std::to_string(kNumEvents * (kNumEvents - 1) / 2));
+    }
+  }
+  EXPECT_EQ(num_node_events, kNumEvents);
+  EXPECT_TRUE(found_summary);
+}
+
+TEST(PerfProfilerTest, ReadValuesReportsFailedReads) {
+  auto counters = TaskClockCounter();
+  if (!CanOpenPerfEvents(counters)) {
+    GTEST_SKIP() << "perf_event_open is not available";
+  }
+
+  std::map<std::string, std::string> no_raw_events;
+  PerfProfiler perf(&counters, &no_raw_events, nullptr);
+  perf.Initialize();
+  std::vector<uint64_t> values(perf.NumValues());
+  EXPECT_TRUE(perf.ReadValues(values.data()));
+
+  // a group that cannot be read makes the whole sample invalid
+  perf_syscall_data_t& leader = perf.perf_thread_groups[0].perf_syscall_data[0];
+  close(leader.fd);
+  EXPECT_FALSE(perf.ReadValues(values.data()));
+
+  // unopened groups read as zeros
+  leader.fd = -1;
+  EXPECT_TRUE(perf.ReadValues(values.data()));
+  EXPECT_EQ(values, std::vector<uint64_t>(perf.NumValues(), 0));
+  perf.Close();
+}
+
+TEST(PerfProfilerTest, ScaleValue) {
+  EXPECT_EQ(PerfProfiler::ScaleValue(100, 1000, 1000), 100.0);
+  // counted half of the time the group was enabled
+  EXPECT_EQ(PerfProfiler::ScaleValue(100, 1000, 500), 200.0);
+  EXPECT_EQ(PerfProfiler::ScaleValue(100, 3000, 1000), 300.0);
+  // never scheduled
+  EXPECT_EQ(PerfProfiler::ScaleValue(100, 1000, 0), 0.0);
+  EXPECT_EQ(PerfProfiler::ScaleValue(0, 0, 0), 0.0);
+  // deltas of two reads may see slightly more running than enabled time, which is not scaled down
+  EXPECT_EQ(PerfProfiler::ScaleValue(100, 999, 1000), 100.0);
+}
+
+TEST(PerfProfilerTest, DerivedMetrics) {
+  const unsigned long long kL1dReadMiss = PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                          PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+  const unsigned long long kLlcReadMiss = PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                                          PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+  // in perf (type, config) order, which is the order of the values of a record
+  std::map<perf_type_config_t, std::string> counters{
+      {{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES}, "cycles"},
+      {{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS}, "instructions"},
+      {{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES}, "cache-misses"},
+      {{PERF_TYPE_HW_CACHE, kL1dReadMiss}, "L1-dcache-load-misses"},
+      {{PERF_TYPE_HW_CACHE, kLlcReadMiss}, "LLC-load-misses"}};
+  if (!CanOpenPerfEvents(counters)) {
+    GTEST_SKIP() << "perf_event_open is not available for the hardware events";
+  }
+
+  profiling::Profiler profiler;
+  StartPerfProfiling(profiler, counters, "perf_derived_metrics_test.json");
+  ASSERT_EQ(profiler.GetPerfProfiler()->NumValues(), counters.size() * PerfProfiler::kValuesPerCounter);
+
+  // cycles were counted half of the time and scale to 2000
+  const uint64_t values[] = {1000, 200, 100,
+                             3000, 200, 200,
+                             6, 200, 200,
+                             30, 200, 200,
+                             600, 200, 200};
+  auto start = profiler.Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  profiler.EndTimeAndRecordEvent(profiling::NODE_EVENT, "node_kernel_time", start, {{"op_name", "Add"}}, values);
+  nlohmann::json events = EndPerfProfiling(profiler);
+
+  auto check_metrics = [](const nlohmann::json& event) {
+    const auto& args = event.at("args");
+    EXPECT_EQ(args.value("cycles", std::string()), "2000");
+    EXPECT_EQ(args.value("instructions", std::string()), "3000");
+    EXPECT_EQ(args.value("ipc", std::string()), "1.500");
+    EXPECT_EQ(args.value("l1d_mpki", std::string()), "10.000");
+    // LLC misses come from cache-misses only, the LLC-load-misses counter measures the same thing
+    EXPECT_EQ(args.value("llc_mpki", std::string()), "2.000");
+    EXPECT_EQ(args.value("dram_bytes_est", std::string()), "384.000");
+    const double dur_us = event.at("dur").get<double>();
+    ASSERT_GT(dur_us, 0.0);
+    EXPECT_NEAR(std::stod(args.value("dram_gbps_est", std::string("0"))), 384.0 / dur_us / 1000.0, 0.001);
+  };
+
+  bool found_node = false;
+  bool found_summary = false;
+  for (const auto& event : events) {
+    if (event.at("name") == "node_kernel_time") {
+      found_node = true;
+      check_metrics(event);
+      EXPECT_EQ(event.at("args").value("perf_running_ratio", std::string()), "0.500");
+    } else if (event.at("name") == "Add_perf_summary") {
+      found_summary = true;
+      check_metrics(event);
+    }
+  }
+  EXPECT_TRUE(found_node);
+  EXPECT_TRUE(found_summary);
+}
+
+TEST(PerfProfilerTest, SamplesAttributedToNodeEvents) {
+  std::map<perf_type_config_t, std::string> cycles{{{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES}, "cycles"}};
+  if (!CanOpenPerfEvents(cycles)) {
+    GTEST_SKIP() << "perf_event_open is not available for cycles";
+  }
+
+  profiling::Profiler profiler;
+  profiler.Initialize(&DefaultLoggingManager().DefaultLogger());
+  profiler.SetSamplingProfiler(std::make_unique<profiling::SamplingProfiler>(100000));
+  profiler.StartProfiling(std::string("perf_sampling_test.json"));
+  profiling::SamplingProfiler* sampling = profiler.GetSamplingProfiler();
+  sampling->Start({});
+
+  // two nodes run one after the other, like the sequential executor publishes them
+  const std::vector<std::pair<int, std::string>> nodes{{1, "Add_1"}, {2, "Mul_2"}};
+  for (const auto& node : nodes) {
+    auto start = profiler.Start();
+    profiling::SamplingProfiler::SetCurrentNode(node.first);
+    Spin(std::chrono::milliseconds(50));
+    profiling::SamplingProfiler::SetCurrentNode(-1);
+    profiler.EndTimeAndRecordEvent(profiling::NODE_EVENT, node.second + "_kernel_time", start,
+                                   {{"op_name", "Add"}, {"graph_index", std::to_string(node.first)}});
+  }
+  // EndProfiling stops the sampling and writes the report
+  std::string file_name = profiler.EndProfiling();
+  std::ifstream trace(file_name);
+  nlohmann::json events = nlohmann::json::parse(trace);
+  trace.close();
+  std::remove(file_name.c_str());
+
+  auto sampling_event = std::find_if(events.begin(), events.end(), [](const nlohmann::json& event) {
+    return event.at("name") == "perf_sampling";
+  });
+  ASSERT_NE(sampling_event, events.end());
+  const auto& args = sampling_event->at("args");
+  for (const auto& node : nodes) {
+    const std::string index = std::to_string(node.first);
+    EXPECT_EQ(args.at("node_names").value(index, std::string()), node.second);
+    ASSERT_TRUE(args.at("report").at("nodes").contains(index)) << node.second << " has no samples";
+    const auto& node_report = args.at("report").at("nodes").at(index);
+    EXPECT_GT(node_report.at("samples").get<uint64_t>(), 0u);
+    EXPECT_FALSE(node_report.at("ips").empty());
+  }
+}
+
+TEST(PerfProfilerTest, SamplingStopsOnce) {
+  std::map<perf_type_config_t, std::string> cycles{{{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES}, "cycles"}};
+  if (!CanOpenPerfEvents(cycles)) {
+    GTEST_SKIP() << "perf_event_open is not available for cycles";
+  }
+
+  // Start and Stop race when EndProfiling runs while a Run starts sampling
+  profiling::SamplingProfiler sampling(100000);
+  std::atomic<bool> stop{false};
+  std::thread runs([&]() {
+    while (!stop) {
+      sampling.Start({});
+    }
+  });
+  for (int i = 0; i < 100; i++) {
+    sampling.Stop();
+  }
+  stop = true;
+  runs.join();
+  sampling.Stop();
+  EXPECT_FALSE(profiling::SamplingProfiler::IsActive());
+}
+
+}  // namespace test
+}  // namespace onnxruntime
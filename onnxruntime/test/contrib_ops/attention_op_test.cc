@@ -3,9 +3,14 @@
 // Licensed under the MIT License.
 
 #include "gtest/gtest.h"
+#include "core/session/inference_session.h"
+#include "core/session/IOBinding.h"
 #include "test/common/tensor_op_test_utils.h"
 #include "test/common/cuda_op_test_utils.h"
+#include "test/framework/test_utils.h"
 #include "test/providers/provider_test_utils.h"
+#include "test/util/include/scoped_env_vars.h"
+#include "contrib_ops/cpu/bert/attention_cpu_base.h"
 
 namespace onnxruntime {
 namespace test {
@@ -201,6 +206,205 @@ static void RunAttentionTest(
                      only_enable_cuda, only_enable_cpu, qkv_sizes, extra_add_data);
 }
 
+// Runs Attention in a session that binds past and present to one buffer of max_sequence_length positions, which the
+// kernel appends to in place. buffer holds the past state, and expected_buffer the present state after the run.
+static void RunAttentionInPlace(
+    const std::vector<float>& input_data,
+    const std::vector<float>& weights_data,
+    const std::vector<float>& bias_data,
+    const std::vector<float>& output_data,
+    std::vector<float> buffer,
+    const std::vector<float>& expected_buffer,
+    const std::vector<int32_t>* cache_indirection,
+    int batch_size,
+    int sequence_length,
+    int hidden_size,
+    int number_of_heads,
+    int past_sequence_length,
+    int max_sequence_length) {
+  const int head_size = hidden_size / number_of_heads;
+  const std::vector<int64_t> past_dims = {2, batch_size, number_of_heads, max_sequence_length, head_size};
+
+  Model model("attention", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+              {{kOnnxDomain, 12}, {kMSDomain, 1}}, {}, DefaultLoggingManager().DefaultLogger());
+  Graph& graph = model.MainGraph();
+  auto make_type = [](ONNX_NAMESPACE::TensorProto_DataType elem_type, const std::vector<int64_t>& dims) {
+    ONNX_NAMESPACE::TypeProto type;
+    type.mutable_tensor_type()->set_elem_type(elem_type);
+    for (int64_t dim : dims) {
+      type.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_value(dim);
+    }
+    return type;
+  };
+  auto input_type = make_type(ONNX_NAMESPACE::TensorProto_DataType_FLOAT, {batch_size, sequence_length, hidden_size});
+  auto weight_type = make_type(ONNX_NAMESPACE::TensorProto_DataType_FLOAT, {hidden_size, 3 * hidden_size});
+  auto bias_type = make_type(ONNX_NAMESPACE::TensorProto_DataType_FLOAT, {3 * hidden_size});
+  auto past_type = make_type(ONNX_NAMESPACE::TensorProto_DataType_FLOAT, past_dims);
+  auto past_sequence_length_type = make_type(ONNX_NAMESPACE::TensorProto_DataType_INT32, {1});
+  auto cache_indirection_type = make_type(ONNX_NAMESPACE::TensorProto_DataType_INT32,
+                                          {batch_size, max_sequence_length});
+
+  auto& input = graph.GetOrCreateNodeArg("input", &input_type);
+  auto& weight = graph.GetOrCreateNodeArg("weight", &weight_type);
+  auto& bias = graph.GetOrCreateNodeArg("bias", &bias_type);
+  auto& past = graph.GetOrCreateNodeArg("past", &past_type);
+  auto& past_sequence_length_arg = graph.GetOrCreateNodeArg("past_sequence_length", &past_sequence_length_type);
+  auto& none = graph.GetOrCreateNodeArg("", nullptr);
+  auto& output = graph.GetOrCreateNodeArg("output", &input_type);
+  auto& present = graph.GetOrCreateNodeArg("present", &past_type);
+
+  std::vector<const NodeArg*> graph_inputs{&input, &weight, &bias, &past, &past_sequence_length_arg};
+  std::vector<NodeArg*> node_inputs{&input, &weight, &bias, &none, &past, &none, &past_sequence_length_arg};
+  if (cache_indirection != nullptr) {
+    auto& cache_indirection_arg = graph.GetOrCreateNodeArg("cache_indirection", &cache_indirection_type);
+    graph_inputs.push_back(&cache_indirection_arg);
+    node_inputs.push_back(&cache_indirection_arg);
+  }
+  auto& node = graph.AddNode("attention", "Attention", "in place attention", node_inputs, {&output, &present},
+                             nullptr, kMSDomain);
+  node.AddAttribute("num_heads", static_cast<int64_t>(number_of_heads));
+  node.AddAttribute("unidirectional", static_cast<int64_t>(1));
+  node.AddAttribute("past_present_share_buffer", static_cast<int64_t>(1));
+  graph.SetInputs(graph_inputs);
+  graph.SetOutputs({&output, &present});
+  ASSERT_STATUS_OK(graph.Resolve());
+
+  std::string model_data;
+  model.ToProto().SerializeToString(&model_data);
+  SessionOptions so;
+  so.session_logid = "AttentionInPlace";
+  InferenceSession session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(model_data.data(), static_cast<int>(model_data.size())));
+  ASSERT_STATUS_OK(session.Initialize());
+
+  auto allocator = TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault);
+  std::unique_ptr<IOBinding> io_binding;
+  ASSERT_STATUS_OK(session.NewIOBinding(&io_binding));
+  auto bind_input = [&](const std::string& name, const std::vector<int64_t>& dims, const auto& data) {
+    OrtValue value;
+    CreateMLValue(allocator, dims, data, &value);
+    ASSERT_STATUS_OK(io_binding->BindInput(name, value));
+  };
+  bind_input("input", {batch_size, sequence_length, hidden_size}, input_data);
+  bind_input("weight", {hidden_size, 3 * hidden_size}, weights_data);
+  bind_input("bias", {3 * hidden_size}, bias_data);
+  bind_input("past_sequence_length", {1}, std::vector<int32_t>{past_sequence_length});
+  if (cache_indirection != nullptr) {
+    bind_input("cache_indirection", {batch_size, max_sequence_length}, *cache_indirection);
+  }
+
+  OrtValue buffer_value;
+  CreateMLValue<float>(past_dims, buffer.data(), allocator->Info(), &buffer_value);
+  ASSERT_STATUS_OK(io_binding->BindInput("past", buffer_value));
+  ASSERT_STATUS_OK(io_binding->BindOutput("output"));
+  ASSERT_STATUS_OK(io_binding->BindOutput("present", buffer_value));
+  ASSERT_STATUS_OK(session.Run(RunOptions{}, *io_binding));
+
+  const auto& outputs = io_binding->GetOutputs();
+  ASSERT_EQ(outputs.size(), 2u);
+  ASSERT_EQ(outputs[1].Get<Tensor>().Data<float>(), buffer.data());
+  auto output_span = outputs[0].Get<Tensor>().DataAsSpan<float>();
+  const std::vector<float> actual_output(output_span.begin(), output_span.end());
+  ASSERT_EQ(actual_output.size(), output_data.size());
+  for (size_t i = 0; i < output_data.size(); i++) {
+    EXPECT_NEAR(actual_output[i], output_data[i], 1e-4f) << "output " << i;
+  }
+
+  // Only the new positions are written, so the past positions and the ones after the new positions keep their values.
+  ASSERT_EQ(buffer.size(), expected_buffer.size());
+  for (size_t i = 0; i < buffer.size(); i++) {
+    const int m = static_cast<int>(i / head_size) % max_sequence_length;
+    if (m >= past_sequence_length && m < past_sequence_length + sequence_length) {
+      EXPECT_NEAR(buffer[i], expected_buffer[i], 1e-4f) << "present " << i;
+    } else {
+      EXPECT_EQ(buffer[i], expected_buffer[i]) << "present " << i;
+    }
+  }
+}
+
+// Runs a test with past state like RunAttentionTest, but in buffers of max_sequence_length positions that past and
+// present share (past_present_share_buffer = 1). When swap_batch_items is true, the buffer holds the past state of
+// batch item b in the rows of item (batch_size - 1 - b), and cache_indirection points each item at the right rows.
+// When alias_buffer is true, present is bound to the buffer of past, otherwise the kernel copies past into present.
+static void RunAttentionSharedBufferTest(
+    const std::vector<float>& input_data,
+    const std::vector<float>& weights_data,
+    const std::vector<float>& bias_data,
+    const std::vector<float>& output_data,
+    const std::vector<float>& past_data,     // past:    [2, batch_size, number_of_heads, past_sequence_length, head_size]
+    const std::vector<float>& present_data,  // present: [2, batch_size, number_of_heads, past_sequence_length + sequence_length, head_size]
+    int batch_size,
+    int sequence_length,
+    int hidden_size,
+    int number_of_heads,
+    int past_sequence_length,
+    int max_sequence_length,
+    bool swap_batch_items,
+    bool alias_buffer) {
+  const int head_size = hidden_size / number_of_heads;
+  const int all_sequence_length = past_sequence_length + sequence_length;
+
+  // Positions after the first past_sequence_length + sequence_length ones are not touched by the kernel.
+  constexpr float unused_value = 100.0f;
+  std::vector<float> past_buffer(static_cast<size_t>(2) * batch_size * number_of_heads * max_sequence_length * head_size,
+                                 unused_value);
+  std::vector<float> present_buffer = past_buffer;
+  std::vector<int32_t> cache_indirection(static_cast<size_t>(batch_size) * max_sequence_length);
+  for (int b = 0; b < batch_size; b++) {
+    const int row = swap_batch_items ? batch_size - 1 - b : b;
+    for (int m = 0; m < max_sequence_length; m++) {
+      cache_indirection[b * max_sequence_length + m] = m < past_sequence_length ? row : b;
+    }
+
+    for (int kv = 0; kv < 2; kv++) {
+      for (int n = 0; n < number_of_heads; n++) {
+        for (int m = 0; m < all_sequence_length; m++) {
+          // New positions are written into the rows of the batch item itself.
+          const int buffer_row = m < past_sequence_length ? row : b;
+          float* present_dest = &present_buffer[(((kv * batch_size + buffer_row) * number_of_heads + n) * max_sequence_length + m) * head_size];
+          const float* present_src = &present_data[(((kv * batch_size + b) * number_of_heads + n) * all_sequence_length + m) * head_size];
+          std::copy(present_src, present_src + head_size, present_dest);
+          if (m < past_sequence_length) {
+            float* past_dest = &past_buffer[(((kv * batch_size + buffer_row) * number_of_heads + n) * max_sequence_length + m) * head_size];
+            const float* past_src = &past_data[(((kv * batch_size + b) * number_of_heads + n) * past_sequence_length + m) * head_size];
+            std::copy(past_src, past_src + head_size, past_dest);
+          }
+        }
+      }
+    }
+  }
+
+  if (alias_buffer) {
+    RunAttentionInPlace(input_data, weights_data, bias_data, output_data, past_buffer, present_buffer,
+                        swap_batch_items ? &cache_indirection : nullptr, batch_size, sequence_length, hidden_size,
+                        number_of_heads, past_sequence_length, max_sequence_length);
+    return;
+  }
+
+  OpTester tester("Attention", 1, onnxruntime::kMSDomain);
+  tester.AddAttribute<int64_t>("num_heads", static_cast<int64_t>(number_of_heads));
+  tester.AddAttribute<int64_t>("unidirectional", static_cast<int64_t>(1));
+  tester.AddAttribute<int64_t>("past_present_share_buffer", static_cast<int64_t>(1));
+
+  std::vector<int64_t> past_dims = {2, batch_size, number_of_heads, max_sequence_length, head_size};
+  tester.AddInput<float>("input", {batch_size, sequence_length, hidden_size}, input_data);
+  tester.AddInput<float>("weight", {hidden_size, 3 * hidden_size}, weights_data);
+  tester.AddInput<float>("bias", {3 * hidden_size}, bias_data);
+  tester.AddOptionalInputEdge<int32_t>();
+  tester.AddInput<float>("past", past_dims, past_buffer);
+  tester.AddOptionalInputEdge<float>();
+  tester.AddInput<int32_t>("past_sequence_length", {1}, {past_sequence_length});
+  if (swap_batch_items) {
+    tester.AddInput<int32_t>("cache_indirection", {batch_size, max_sequence_length}, cache_indirection);
+  }
+  tester.AddOutput<float>("output", {batch_size, sequence_length, hidden_size}, output_data);
+  tester.AddOutput<float>("present", past_dims, present_buffer);
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  tester.Run(OpTester::ExpectResult::kExpectSuccess, "", {}, nullptr, &execution_providers);
+}
+
 TEST(AttentionTest, AttentionBatch1) {
   int batch_size = 1;
   int sequence_length = 2;
@@ -924,6 +1128,16 @@ TEST(AttentionTest, AttentionPastStateBatch2) {
   RunAttentionTest(input_data, weight_data, bias_data, mask_index_data, output_data,
                    batch_size, sequence_length, hidden_size, number_of_heads, false, is_unidirectional,
                    use_past_state, past_sequence_length, &past_data, &present_data);
+
+  int max_sequence_length = 6;
+  for (bool alias_buffer : {false, true}) {
+    RunAttentionSharedBufferTest(input_data, weight_data, bias_data, output_data, past_data, present_data,
+                                 batch_size, sequence_length, hidden_size, number_of_heads,
+                                 past_sequence_length, max_sequence_length, false, alias_buffer);
+    RunAttentionSharedBufferTest(input_data, weight_data, bias_data, output_data, past_data, present_data,
+                                 batch_size, sequence_length, hidden_size, number_of_heads,
+                                 past_sequence_length, max_sequence_length, true, alias_buffer);
+  }
 }
 
 TEST(AttentionTest, AttentionPastStateBatch2WithPadding) {
@@ -1794,6 +2008,121 @@ TEST(AttentionTest, AttentionPrunedModel) {
                    use_float16, is_unidirectional, use_past_state, past_sequence_length, past_data, present_data, kMaskRaw, input_hidden_size);
 }
 
+// Runs Attention on CPU without verifying the outputs, and returns the output and present state.
+static std::vector<OrtValue> RunAttentionOnCpu(const std::vector<float>& input_data,
+                                               const std::vector<float>& weight_data,
+                                               const std::vector<float>& bias_data,
+                                               const std::vector<float>& past_data,
+                                               int batch_size,
+                                               int sequence_length,
+                                               int hidden_size,
+                                               int number_of_heads,
+                                               int past_sequence_length,
+                                               bool is_unidirectional) {
+  const int head_size = hidden_size / number_of_heads;
+  std::vector<int64_t> input_dims = {batch_size, sequence_length, hidden_size};
+  std::vector<int64_t> weight_dims = {hidden_size, 3 * hidden_size};
+  std::vector<int64_t> bias_dims = {3 * hidden_size};
+  std::vector<int64_t> past_dims = {2, batch_size, number_of_heads, past_sequence_length, head_size};
+  std::vector<int64_t> present_dims = {2, batch_size, number_of_heads, past_sequence_length + sequence_length, head_size};
+
+  OpTester tester("Attention", 1, onnxruntime::kMSDomain, false /*verify_output*/);
+  tester.AddAttribute<int64_t>("num_heads", static_cast<int64_t>(number_of_heads));
+  tester.AddAttribute<int64_t>("unidirectional", static_cast<int64_t>(is_unidirectional ? 1 : 0));
+  tester.AddInput<float>("input", input_dims, input_data);
+  tester.AddInput<float>("weight", weight_dims, weight_data);
+  tester.AddInput<float>("bias", bias_dims, bias_data);
+  tester.AddOptionalInputEdge<int32_t>();
+  if (past_sequence_length > 0) {
+    tester.AddInput<float>("past", past_dims, past_data);
+  }
+
+  // Outputs are only added to be fetched, their values are not verified.
+  tester.AddOutput<float>("output", input_dims, std::vector<float>(input_data.size()));
+  tester.AddOutput<float>("present", present_dims,
+                          std::vector<float>(static_cast<size_t>(2) * batch_size * number_of_heads *
+                                             (past_sequence_length + sequence_length) * head_size));
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  tester.Run(OpTester::ExpectResult::kExpectSuccess, "", {}, nullptr, &execution_providers);
+  return tester.GetFetches();
+}
+
+// Compares the block by block attention against the materialized attention probs. The flash attention threshold
+// is lowered to 1 when force_flash_attention is true, otherwise the default threshold has to be reached.
+static void RunFlashAttentionTest(int batch_size,
+                                  int sequence_length,
+                                  int hidden_size,
+                                  int number_of_heads,
+                                  int past_sequence_length,
+                                  bool is_unidirectional,
+                                  bool force_flash_attention) {
+  const int head_size = hidden_size / number_of_heads;
+  std::vector<int64_t> input_dims = {batch_size, sequence_length, hidden_size};
+  std::vector<int64_t> weight_dims = {hidden_size, 3 * hidden_size};
+  std::vector<int64_t> bias_dims = {3 * hidden_size};
+  std::vector<int64_t> past_dims = {2, batch_size, number_of_heads, past_sequence_length, head_size};
+
+  RandomValueGenerator random{};
+  std::vector<float> input_data = random.Gaussian<float>(input_dims, 0.0f, 0.3f);
+  std::vector<float> weight_data = random.Gaussian<float>(weight_dims, 0.0f, 0.3f);
+  std::vector<float> bias_data = random.Gaussian<float>(bias_dims, 0.0f, 0.3f);
+  std::vector<float> past_data = random.Gaussian<float>(past_dims, 0.0f, 0.3f);
+
+  std::vector<OrtValue> flash_fetches;
+  {
+    ScopedEnvironmentVariables scoped_env_vars{
+        EnvVarMap{
+            {onnxruntime::contrib::attention::kFlashAttentionMinimumScores,
+             force_flash_attention ? optional<std::string>{"1"} : optional<std::string>{}},
+        }};
+    flash_fetches = RunAttentionOnCpu(input_data, weight_data, bias_data, past_data, batch_size, sequence_length,
+                                      hidden_size, number_of_heads, past_sequence_length, is_unidirectional);
+  }
+
+  std::vector<OrtValue> expected_fetches;
+  {
+    ScopedEnvironmentVariables scoped_env_vars{
+        EnvVarMap{
+            {onnxruntime::contrib::attention::kFlashAttentionMinimumScores, "1000000000"},
+        }};
+    expected_fetches = RunAttentionOnCpu(input_data, weight_data, bias_data, past_data, batch_size, sequence_length,
+                                         hidden_size, number_of_heads, past_sequence_length, is_unidirectional);
+  }
+
+  ASSERT_EQ(flash_fetches.size(), expected_fetches.size());
+  for (size_t i = 0; i < flash_fetches.size(); ++i) {
+    const Tensor& actual = flash_fetches[i].Get<Tensor>();
+    const Tensor& expected = expected_fetches[i].Get<Tensor>();
+    ASSERT_EQ(actual.Shape(), expected.Shape());
+    auto actual_data = actual.DataAsSpan<float>();
+    auto expected_data = expected.DataAsSpan<float>();
+    for (size_t j = 0; j < expected_data.size(); ++j) {
+      ASSERT_NEAR(actual_data[j], expected_data[j], 1e-4f) << "output " << i << " element " << j;
+    }
+  }
+}
+
+TEST(AttentionTest, FlashAttentionAtThreshold) {
+  // S x S* = 512 x 512 is exactly the default threshold.
+  RunFlashAttentionTest(1, 512, 16, 2, 0, false, false);
+}
+
+TEST(AttentionTest, FlashAttentionUnidirectionalPastStateAboveThreshold) {
+  // S x S* = 512 x 513 is just above the default threshold.
+  RunFlashAttentionTest(1, 512, 16, 2, 1, true, false);
+}
+
+TEST(AttentionTest, FlashAttentionBlocks) {
+  // Query rows cross the 64 row blocks and keys cross the 128 row blocks of MLAS.
+  RunFlashAttentionTest(2, 70, 16, 2, 0, false, true);
+  RunFlashAttentionTest(2, 70, 16, 2, 0, true, true);
+  RunFlashAttentionTest(2, 70, 16, 2, 90, false, true);
+  RunFlashAttentionTest(2, 70, 16, 2, 90, true, true);
+  RunFlashAttentionTest(2, 1, 16, 2, 130, true, true);
+}
+
 #ifndef ENABLE_TRAINING  // Prepacking is enabled only on non-training builds
 TEST(AttentionTest, SharedPrepackedWeights) {
   int batch_size = 2;
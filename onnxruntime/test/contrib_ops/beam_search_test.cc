@@ -0,0 +1,542 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "core/graph/model.h"
+#include "core/platform/env.h"
+#include "core/platform/threadpool.h"
+#include "core/providers/cpu/math/softmax_shared.h"
+#include "core/session/inference_session.h"
+#include "contrib_ops/cpu/transformers/beam_search_device_helper.h"
+#include "contrib_ops/cpu/transformers/logits_processor.h"
+#include "test/common/tensor_op_test_utils.h"
+#include "test/framework/test_utils.h"
+#include "test/test_environment.h"
+#include "test/util/include/asserts.h"
+
+using namespace ONNX_NAMESPACE;
+
+namespace onnxruntime {
+namespace test {
+
+namespace {
+
+constexpr int64_t kVocabSize = 16;
+constexpr int64_t kNumHeads = 2;
+constexpr int64_t kHeadSize = 4;
+constexpr int64_t kHiddenSize = kNumHeads * kHeadSize;
+constexpr int64_t kMaxPositions = 16;
+
+template <typename T>
+std::vector<T> GetData(const OrtValue& value) {
+  auto data = value.Get<Tensor>().DataAsSpan<T>();
+  return std::vector<T>(data.begin(), data.end());
+}
+
+// A dimension of -1 is left symbolic.
+TypeProto MakeTensorType(TensorProto_DataType elem_type, const std::vector<int64_t>& dims) {
+  TypeProto type;
+  type.mutable_tensor_type()->set_elem_type(elem_type);
+  auto* shape = type.mutable_tensor_type()->mutable_shape();
+  for (int64_t dim : dims) {
+    auto* dimension = shape->add_dim();
+    if (dim >= 0) {
+      dimension->set_dim_value(dim);
+    }
+  }
+  return type;
+}
+
+NodeArg& AddInitializer(Graph& graph, RandomValueGenerator& random, const std::string& name,
+                        const std::vector<int64_t>& dims, float range) {
+  std::vector<float> data = random.Uniform<float>(dims, -range, range);
+  TensorProto tensor_proto;
+  tensor_proto.set_name(name);
+  tensor_proto.set_data_type(TensorProto_DataType_FLOAT);
+  tensor_proto.set_raw_data(data.data(), data.size() * sizeof(float));
+  for (int64_t dim : dims) {
+    tensor_proto.add_dims(dim);
+  }
+  graph.AddInitializedTensor(tensor_proto);
+  return graph.GetOrCreateNodeArg(name, nullptr);
+}
+
+// Creates a one layer GPT-2 style decoder for BeamSearch: token and position embeddings, unidirectional
+// Attention with past state and a projection to the vocabulary. With share_buffer, Attention appends to
+// the past buffer in place and reads past positions through the cache indirection of BeamSearch.
+// Both variants get the same weights. logits_range scales the projection, so a large range gives
+// peaked distributions where the beams tend to keep their place.
+GraphProto CreateDecoder(bool share_buffer, float logits_range) {
+  Model model("decoder", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+              {{kOnnxDomain, 12}, {kMSDomain, 1}}, {}, DefaultLoggingManager().DefaultLogger());
+  Graph& graph = model.MainGraph();
+  RandomValueGenerator random{optional<RandomValueGenerator::RandomSeedType>{2345}};
+
+  TypeProto int32_2d = MakeTensorType(TensorProto_DataType_INT32, {-1, -1});
+  TypeProto past_type = MakeTensorType(TensorProto_DataType_FLOAT, {2, -1, kNumHeads, -1, kHeadSize});
+  TypeProto logits_type = MakeTensorType(TensorProto_DataType_FLOAT, {-1, -1, kVocabSize});
+  TypeProto past_sequence_length_type = MakeTensorType(TensorProto_DataType_INT32, {1});
+
+  auto& input_ids = graph.GetOrCreateNodeArg("input_ids", &int32_2d);
+  auto& position_ids = graph.GetOrCreateNodeArg("position_ids", &int32_2d);
+  auto& attention_mask = graph.GetOrCreateNodeArg("attention_mask", &int32_2d);
+  auto& past = graph.GetOrCreateNodeArg("past_0", &past_type);
+  auto& logits = graph.GetOrCreateNodeArg("logits", &logits_type);
+  auto& present = graph.GetOrCreateNodeArg("present_0", &past_type);
+
+  auto& token_embedding = AddInitializer(graph, random, "token_embedding", {kVocabSize, kHiddenSize}, 1.f);
+  auto& position_embedding = AddInitializer(graph, random, "position_embedding", {kMaxPositions, kHiddenSize}, 1.f);
+  auto& attention_weights = AddInitializer(graph, random, "attention_weights", {kHiddenSize, 3 * kHiddenSize}, 1.f);
+  auto& attention_bias = AddInitializer(graph, random, "attention_bias", {3 * kHiddenSize}, 0.1f);
+  auto& projection = AddInitializer(graph, random, "projection", {kHiddenSize, kVocabSize}, logits_range);
+
+  auto& token_hidden = graph.GetOrCreateNodeArg("token_hidden", nullptr);
+  auto& position_hidden = graph.GetOrCreateNodeArg("position_hidden", nullptr);
+  auto& hidden = graph.GetOrCreateNodeArg("hidden", nullptr);
+  auto& attention_out = graph.GetOrCreateNodeArg("attention_out", nullptr);
+  auto& residual = graph.GetOrCreateNodeArg("residual", nullptr);
+
+  graph.AddNode("token_gather", "Gather", "token embedding", {&token_embedding, &input_ids}, {&token_hidden});
+  graph.AddNode("position_gather", "Gather", "position embedding", {&position_embedding, &position_ids},
+                {&position_hidden});
+  graph.AddNode("embedding_add", "Add", "embedding", {&token_hidden, &position_hidden}, {&hidden});
+
+  std::vector<const NodeArg*> inputs{&input_ids, &position_ids, &attention_mask, &past};
+  std::vector<NodeArg*> attention_inputs{&hidden, &attention_weights, &attention_bias, &attention_mask, &past};
+  if (share_buffer) {
+    auto& past_sequence_length = graph.GetOrCreateNodeArg("past_sequence_length", &past_sequence_length_type);
+    auto& cache_indirection = graph.GetOrCreateNodeArg("cache_indirection", &int32_2d);
+    inputs.push_back(&past_sequence_length);
+    inputs.push_back(&cache_indirection);
+    attention_inputs.push_back(&graph.GetOrCreateNodeArg("", nullptr));
+    attention_inputs.push_back(&past_sequence_length);
+    attention_inputs.push_back(&cache_indirection);
+  }
+  auto& attention = graph.AddNode("attention", "Attention", "self attention", attention_inputs,
+                                  {&attention_out, &present}, nullptr, kMSDomain);
+  attention.AddAttribute("num_heads", kNumHeads);
+  attention.AddAttribute("unidirectional", static_cast<int64_t>(1));
+  if (share_buffer) {
+    attention.AddAttribute("past_present_share_buffer", static_cast<int64_t>(1));
+  }
+
+  graph.AddNode("residual_add", "Add", "residual", {&hidden, &attention_out}, {&residual});
+  graph.AddNode("projection_matmul", "MatMul", "logits", {&residual, &projection}, {&logits});
+
+  graph.SetInputs(inputs);
+  graph.SetOutputs({&logits, &present});
+
+  auto status = graph.Resolve();
+  EXPECT_TRUE(status.IsOK()) << status.ErrorMessage();
+  return graph.ToGraphProto();
+}
+
+// Serializes a model with a BeamSearch node over the decoder from CreateDecoder.
+std::string CreateBeamSearchModel(bool share_buffer, float logits_range) {
+  Model model("beam_search", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+              {{kOnnxDomain, 12}, {kMSDomain, 1}}, {}, DefaultLoggingManager().DefaultLogger());
+  Graph& graph = model.MainGraph();
+
+  TypeProto int32_2d = MakeTensorType(TensorProto_DataType_INT32, {-1, -1});
+  TypeProto int32_scalar = MakeTensorType(TensorProto_DataType_INT32, {1});
+  TypeProto float_scalar = MakeTensorType(TensorProto_DataType_FLOAT, {1});
+  TypeProto sequences_type = MakeTensorType(TensorProto_DataType_INT32, {-1, -1, -1});
+  TypeProto sequences_scores_type = MakeTensorType(TensorProto_DataType_FLOAT, {-1, -1});
+  TypeProto scores_type = MakeTensorType(TensorProto_DataType_FLOAT, {-1, -1, -1, -1});
+
+  auto& input_ids = graph.GetOrCreateNodeArg("input_ids", &int32_2d);
+  auto& max_length = graph.GetOrCreateNodeArg("max_length", &int32_scalar);
+  auto& num_beams = graph.GetOrCreateNodeArg("num_beams", &int32_scalar);
+  auto& num_return_sequences = graph.GetOrCreateNodeArg("num_return_sequences", &int32_scalar);
+  auto& temperature = graph.GetOrCreateNodeArg("temperature", &float_scalar);
+  auto& length_penalty = graph.GetOrCreateNodeArg("length_penalty", &float_scalar);
+  auto& sequences = graph.GetOrCreateNodeArg("sequences", &sequences_type);
+  auto& sequences_scores = graph.GetOrCreateNodeArg("sequences_scores", &sequences_scores_type);
+  auto& scores = graph.GetOrCreateNodeArg("scores", &scores_type);
+
+  auto& beam_search = graph.AddNode("beam_search", "BeamSearch", "beam search",
+                                    {&input_ids, &max_length, &graph.GetOrCreateNodeArg("", nullptr), &num_beams,
+                                     &num_return_sequences, &temperature, &length_penalty},
+                                    {&sequences, &sequences_scores, &scores}, nullptr, kMSDomain);
+  beam_search.AddAttribute("eos_token_id", kVocabSize - 1);
+  beam_search.AddAttribute("pad_token_id", kVocabSize - 1);
+  beam_search.AddAttribute("decoder", CreateDecoder(share_buffer, logits_range));
+
+  graph.SetInputs({&input_ids, &max_length, &num_beams, &num_return_sequences, &temperature, &length_penalty});
+  graph.SetOutputs({&sequences, &sequences_scores, &scores});
+
+  auto status = graph.Resolve();
+  EXPECT_TRUE(status.IsOK()) << status.ErrorMessage();
+
+  std::string model_data;
+  model.ToProto().SerializeToString(&model_data);
+  return model_data;
+}
+
+void RunBeamSearch(const std::string& model_data, const std::vector<int32_t>& input_ids, int64_t batch_size,
+                   int32_t max_length, int32_t num_beams, int32_t num_return_sequences,
+                   std::vector<OrtValue>& fetches) {
+  SessionOptions so;
+  so.session_logid = "BeamSearch";
+  InferenceSession session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(model_data.data(), static_cast<int>(model_data.size())));
+  ASSERT_STATUS_OK(session.Initialize());
+
+  auto allocator = TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault);
+  NameMLValMap feeds;
+  auto add_feed = [&](const std::string& name, const std::vector<int64_t>& dims, auto value) {
+    OrtValue ml_value;
+    CreateMLValue<decltype(value)>(allocator, dims, {value}, &ml_value);
+    feeds.insert(std::make_pair(name, ml_value));
+  };
+
+  OrtValue input_ids_value;
+  CreateMLValue<int32_t>(allocator, {batch_size, static_cast<int64_t>(input_ids.size()) / batch_size}, input_ids,
+                         &input_ids_value);
+  feeds.insert(std::make_pair("input_ids", input_ids_value));
+  add_feed("max_length", {1}, max_length);
+  add_feed("num_beams", {1}, num_beams);
+  add_feed("num_return_sequences", {1}, num_return_sequences);
+  add_feed("temperature", {1}, 1.f);
+  add_feed("length_penalty", {1}, 1.f);
+
+  ASSERT_STATUS_OK(session.Run(RunOptions{}, feeds, {"sequences", "sequences_scores", "scores"}, &fetches));
+}
+
+// Runs BeamSearch with a decoder that shares its past and present buffers, and with one that copies its past
+// state, and checks that both generate the same sequences and scores.
+void RunSharedBufferParityTest(float logits_range, int32_t num_beams, int32_t num_return_sequences) {
+  const std::vector<int32_t> input_ids{3, 7, 1, 12, 5, 9};  // batch_size 2, sequence_length 3
+  constexpr int64_t batch_size = 2;
+  constexpr int32_t max_length = 10;
+
+  std::vector<OrtValue> expected;
+  ASSERT_NO_FATAL_FAILURE(RunBeamSearch(CreateBeamSearchModel(false, logits_range), input_ids, batch_size,
+                                        max_length, num_beams, num_return_sequences, expected));
+
+  std::vector<OrtValue> actual;
+  ASSERT_NO_FATAL_FAILURE(RunBeamSearch(CreateBeamSearchModel(true, logits_range), input_ids, batch_size,
+                                        max_length, num_beams, num_return_sequences, actual));
+
+  ASSERT_EQ(actual.size(), 3u);
+  ASSERT_EQ(expected.size(), 3u);
+
+  ASSERT_EQ(actual[0].Get<Tensor>().Shape(), expected[0].Get<Tensor>().Shape());
+  EXPECT_EQ(GetData<int32_t>(actual[0]), GetData<int32_t>(expected[0]));
+
+  // sequences_scores, and scores of each step
+  for (size_t i = 1; i < 3; i++) {
+    ASSERT_EQ(actual[i].Get<Tensor>().Shape(), expected[i].Get<Tensor>().Shape());
+    std::vector<float> expected_data = GetData<float>(expected[i]);
+    std::vector<float> actual_data = GetData<float>(actual[i]);
+    for (size_t j = 0; j < expected_data.size(); j++) {
+      EXPECT_NEAR(actual_data[j], expected_data[j], 1e-4f) << "output " << i << " index " << j;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(BeamSearchTest, SharedBufferMatchesCopy) {
+  RunSharedBufferParityTest(1.f, 3, 2);
+}
+
+// With peaked distributions the beams mostly keep their place after the first step. The copy path then feeds
+// present state through without picking it, and the shared path keeps each row of the cache indirection.
+TEST(BeamSearchTest, SharedBufferMatchesCopyBeamsInPlace) {
+  RunSharedBufferParityTest(20.f, 3, 3);
+}
+
+TEST(BeamSearchTest, SharedBufferMatchesCopySingleBeam) {
+  RunSharedBufferParityTest(1.f, 1, 1);
+}
+
+namespace {
+
+OrtValue CreateInt32Value(AllocatorPtr allocator, const std::vector<int64_t>& dims, const std::vector<int32_t>& data) {
+  OrtValue value;
+  CreateMLValue<int32_t>(allocator, dims, data, &value);
+  return value;
+}
+
+// Feeds of the decoder after its first run over a prompt of 2 tokens, for 2 beams of one batch item.
+// present_0 has shape (2, 2, 1, 2, 1): keys 0 to 3 and values 4 to 7, each beam holding 2 positions.
+struct UpdateFeedsTestData {
+  explicit UpdateFeedsTestData(bool share_buffer)
+      : allocator(TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault)) {
+    OrtValue logits;
+    CreateMLValue<float>(allocator, {2, 1, 3}, std::vector<float>(6, 0.f), &logits);
+    OrtValue present;
+    CreateMLValue<float>(allocator, {2, 2, 1, 2, 1}, {0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f}, &present);
+    last_outputs = {logits, present};
+
+    position_ids = CreateInt32Value(allocator, {2, 1}, {1, 1});
+    next_inputs = {CreateInt32Value(allocator, {2, 2}, {1, 2, 1, 2}),
+                   position_ids,
+                   CreateInt32Value(allocator, {2, 2}, {1, 1, 1, 1}),
+                   present};
+    if (share_buffer) {
+      next_inputs.push_back(CreateInt32Value(allocator, {1}, {0}));
+      next_inputs.push_back(CreateInt32Value(allocator, {2, 4}, {0, 0, 0, 0, 1, 1, 1, 1}));
+    }
+  }
+
+  Status UpdateFeeds(int current_length, const std::vector<int32_t>& beam_indices, bool share_buffer) {
+    const std::vector<int32_t> beam_next_tokens{5, 6};
+    return contrib::BeamSearchCpuDeviceHelper::UpdateFeeds<float>(
+        allocator, nullptr, last_outputs, next_inputs, current_length, position_ids, beam_next_tokens,
+        beam_indices, 2, share_buffer, nullptr);
+  }
+
+  AllocatorPtr allocator;
+  std::vector<OrtValue> last_outputs;
+  std::vector<OrtValue> next_inputs;
+  OrtValue position_ids;
+};
+
+}  // namespace
+
+TEST(BeamSearchTest, UpdateFeedsBeamsInPlace) {
+  UpdateFeedsTestData data(false);
+  ASSERT_STATUS_OK(data.UpdateFeeds(3, {0, 1}, false));
+
+  // present_0 is fed as past_0 without a copy.
+  EXPECT_EQ(data.next_inputs[3].Get<Tensor>().DataRaw(), data.last_outputs[1].Get<Tensor>().DataRaw());
+  EXPECT_EQ(GetData<int32_t>(data.next_inputs[0]), (std::vector<int32_t>{5, 6}));
+  EXPECT_EQ(GetData<int32_t>(data.next_inputs[1]), (std::vector<int32_t>{2, 2}));
+  EXPECT_EQ(GetData<int32_t>(data.next_inputs[2]), (std::vector<int32_t>{1, 1, 1, 1, 1, 1}));
+}
+
+TEST(BeamSearchTest, UpdateFeedsPicksPastState) {
+  UpdateFeedsTestData data(false);
+  ASSERT_STATUS_OK(data.UpdateFeeds(3, {1, 1}, false));
+
+  // Both beams continue from beam 1, so its keys and values are copied to both beams.
+  const Tensor& past = data.next_inputs[3].Get<Tensor>();
+  EXPECT_NE(past.DataRaw(), data.last_outputs[1].Get<Tensor>().DataRaw());
+  EXPECT_EQ(GetData<float>(data.next_inputs[3]), (std::vector<float>{2.f, 3.f, 2.f, 3.f, 6.f, 7.f, 6.f, 7.f}));
+}
+
+TEST(BeamSearchTest, UpdateFeedsSharedBufferBeamsInPlace) {
+  UpdateFeedsTestData data(true);
+  const void* past_buffer = data.next_inputs[3].Get<Tensor>().DataRaw();
+  ASSERT_STATUS_OK(data.UpdateFeeds(3, {0, 1}, true));
+
+  // The buffer of past_0 stays, and each beam keeps reading its own row.
+  EXPECT_EQ(data.next_inputs[3].Get<Tensor>().DataRaw(), past_buffer);
+  EXPECT_EQ(GetData<int32_t>(data.next_inputs[4]), (std::vector<int32_t>{2}));
+  EXPECT_EQ(GetData<int32_t>(data.next_inputs[5]), (std::vector<int32_t>{0, 0, 0, 0, 1, 1, 1, 1}));
+}
+
+TEST(BeamSearchTest, UpdateFeedsSharedBufferPicksCacheIndirection) {
+  UpdateFeedsTestData data(true);
+  const void* past_buffer = data.next_inputs[3].Get<Tensor>().DataRaw();
+
+  // The beams swap: each reads the 2 past positions from the row of the other beam, and writes the
+  // positions from now on into its own row.
+  ASSERT_STATUS_OK(data.UpdateFeeds(3, {1, 0}, true));
+  EXPECT_EQ(data.next_inputs[3].Get<Tensor>().DataRaw(), past_buffer);
+  EXPECT_EQ(GetData<int32_t>(data.next_inputs[4]), (std::vector<int32_t>{2}));
+  EXPECT_EQ(GetData<int32_t>(data.next_inputs[5]), (std::vector<int32_t>{1, 1, 0, 0, 0, 0, 1, 1}));
+
+  // Both beams continue from beam 1, whose first 2 positions are in row 0 and its third position in row 1.
+  ASSERT_STATUS_OK(data.UpdateFeeds(4, {1, 1}, true));
+  EXPECT_EQ(GetData<int32_t>(data.next_inputs[4]), (std::vector<int32_t>{3}));
+  EXPECT_EQ(GetData<int32_t>(data.next_inputs[5]), (std::vector<int32_t>{0, 0, 1, 0, 0, 0, 1, 1}));
+}
+
+namespace {
+
+// Records the candidates that ProcessLogits hands to the beam scorer.
+class RecordingBeamScorer : public contrib::transformers::IBeamScorer {
+ public:
+  void Initialize(AllocatorPtr& /*allocator*/, int /*sequence_length*/) override {}
+
+  void Process(contrib::transformers::ISequences* /*sequences*/,
+               gsl::span<const float>& next_scores,
+               gsl::span<const int32_t>& next_tokens,
+               gsl::span<const int32_t>& next_indices) override {
+    scores.assign(next_scores.begin(), next_scores.end());
+    tokens.assign(next_tokens.begin(), next_tokens.end());
+    indices.assign(next_indices.begin(), next_indices.end());
+  }
+
+  void Finalize(contrib::transformers::ISequences* /*sequences*/,
+                gsl::span<const float>& /*final_beam_scores*/,
+                Tensor* /*output_sequences*/,
+                Tensor* /*output_sequence_scores*/) override {}
+
+  std::vector<float> scores;
+  std::vector<int32_t> tokens;
+  std::vector<int32_t> indices;
+};
+
+// Compares the candidates selected by ProcessLogits with the previous selection, which applied log-softmax and the
+// logits processors to all rows before running TopK over (batch_size, num_beams * vocab_size).
+// logits has shape (batch_size * num_beams, input_length, vocab_size) and sequences (batch_size * num_beams,
+// sequence_length).
+void RunProcessLogitsParityTest(contrib::transformers::BeamSearchParameters parameters,
+                                const std::vector<float>& logits,
+                                const std::vector<float>& beam_scores,
+                                const std::vector<int32_t>& sequences,
+                                concurrency::ThreadPool* thread_pool) {
+  namespace transformers = contrib::transformers;
+  AllocatorPtr allocator = TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault);
+  const int batch_beam_size = parameters.BatchBeamSize();
+  const int vocab_size = parameters.vocab_size;
+  const int top_k = 2 * parameters.num_beams;
+  const int64_t input_length = static_cast<int64_t>(logits.size()) / (batch_beam_size * vocab_size);
+
+  std::vector<int32_t> sequences_space(2 * static_cast<size_t>(batch_beam_size) * parameters.max_length);
+  for (int i = 0; i < batch_beam_size; i++) {
+    std::copy_n(sequences.begin() + i * parameters.sequence_length, parameters.sequence_length,
+                sequences_space.begin() + i * parameters.max_length);
+  }
+  transformers::Sequences current_sequences;
+  current_sequences.Init(gsl::make_span(sequences_space), batch_beam_size, parameters.sequence_length,
+                         parameters.max_length);
+
+  transformers::LogitsProcessorList logits_processors;
+  logits_processors.Init(parameters);
+
+  // The previous selection.
+  std::vector<float> last_logits;
+  for (int i = 0; i < batch_beam_size; i++) {
+    auto row = logits.begin() + ((i + 1) * input_length - 1) * vocab_size;
+    last_logits.insert(last_logits.end(), row, row + vocab_size);
+  }
+  std::vector<float> expected_scores(last_logits.size());
+  ASSERT_STATUS_OK(SoftmaxCPU<float>(static_cast<size_t>(batch_beam_size), static_cast<size_t>(vocab_size),
+                                     last_logits.data(), expected_scores.data(), true, nullptr));
+  gsl::span<float> expected_span = gsl::make_span(expected_scores);
+  logits_processors.Process(&current_sequences, expected_span, 1);
+  for (size_t i = 0; i < expected_scores.size(); i++) {
+    expected_scores[i] += beam_scores[i / static_cast<size_t>(vocab_size)];
+  }
+
+  Tensor scores_tensor(DataTypeImpl::GetType<float>(),
+                       TensorShape({parameters.batch_size, static_cast<int64_t>(parameters.num_beams) * vocab_size}),
+                       expected_scores.data(), allocator->Info());
+  std::unique_ptr<Tensor> topk_scores;
+  std::unique_ptr<Tensor> topk_indices;
+  ASSERT_STATUS_OK(contrib::BeamSearchCpuDeviceHelper::TopK(&scores_tensor, 1, static_cast<unsigned>(top_k), true,
+                                                            true, allocator, nullptr, nullptr, topk_scores,
+                                                            topk_indices));
+  auto scores_data = topk_scores->DataAsSpan<float>();
+  auto indices_data = topk_indices->DataAsSpan<int64_t>();
+  const std::vector<float> expected_topk_scores(scores_data.begin(), scores_data.end());
+  const std::vector<int64_t> expected_topk_indices(indices_data.begin(), indices_data.end());
+
+  // The selection of ProcessLogits.
+  std::vector<float> next_token_scores(static_cast<size_t>(batch_beam_size) * vocab_size);
+  std::vector<int32_t> next_tokens(static_cast<size_t>(parameters.batch_size) * top_k);
+  std::vector<int32_t> next_indices(next_tokens.size());
+  std::vector<float> current_beam_scores(beam_scores);
+  transformers::IBeamSearchState<float> beam_state;
+  beam_state.next_token_scores = gsl::make_span(next_token_scores);
+  beam_state.next_tokens = gsl::make_span(next_tokens);
+  beam_state.next_indices = gsl::make_span(next_indices);
+  beam_state.beam_scores = gsl::make_span(current_beam_scores);
+  transformers::IBeamSearchCpuState cpu_state;
+
+  OrtValue logits_value;
+  CreateMLValue<float>(allocator, {batch_beam_size, input_length, vocab_size}, logits, &logits_value);
+  RecordingBeamScorer beam_scorer;
+  ASSERT_STATUS_OK(contrib::BeamSearchCpuDeviceHelper::ProcessLogits<float>(
+      logits_value, &beam_state, &cpu_state, &current_sequences, allocator, thread_pool, &logits_processors,
+      &beam_scorer, &parameters, 1, nullptr, nullptr));
+
+  ASSERT_EQ(beam_scorer.scores.size(), expected_topk_scores.size());
+  for (size_t i = 0; i < beam_scorer.scores.size(); i++) {
+    const int64_t index = expected_topk_indices[i];
+    EXPECT_EQ(beam_scorer.indices[i], index / vocab_size) << "candidate " << i;
+    EXPECT_EQ(beam_scorer.tokens[i], index % vocab_size) << "candidate " << i;
+    EXPECT_NEAR(beam_scorer.scores[i], expected_topk_scores[i], 1e-5f) << "candidate " << i;
+  }
+}
+
+contrib::transformers::BeamSearchParameters MakeProcessLogitsParameters(int batch_size, int num_beams,
+                                                                        int vocab_size, int sequence_length) {
+  contrib::transformers::BeamSearchParameters parameters{};
+  parameters.batch_size = batch_size;
+  parameters.num_beams = num_beams;
+  parameters.vocab_size = vocab_size;
+  parameters.sequence_length = sequence_length;
+  parameters.max_length = sequence_length + 4;
+  parameters.eos_token_id = vocab_size - 1;
+  parameters.pad_token_id = vocab_size - 1;
+  parameters.repetition_penalty = 1.0f;
+  parameters.temperature = 1.0f;
+  parameters.length_penalty = 1.0f;
+  return parameters;
+}
+
+}  // namespace
+
+TEST(BeamSearchTest, ProcessLogitsMatchesTopK) {
+  // A vocabulary that is not a multiple of the selection block, and logits of a prompt of 2 tokens.
+  auto parameters = MakeProcessLogitsParameters(2, 3, 50, 2);
+  RandomValueGenerator random{2345};
+  const std::vector<int64_t> logits_dims{6, 2, 50};
+  const std::vector<int64_t> beam_scores_dims{6};
+  const std::vector<float> logits = random.Uniform<float>(logits_dims, -5.f, 5.f);
+  const std::vector<float> beam_scores = random.Uniform<float>(beam_scores_dims, -2.f, 0.f);
+  const std::vector<int32_t> sequences{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+
+  RunProcessLogitsParityTest(parameters, logits, beam_scores, sequences, nullptr);
+
+  auto thread_pool = std::make_unique<concurrency::ThreadPool>(&Env::Default(), ThreadOptions{}, nullptr, 4, true);
+  RunProcessLogitsParityTest(parameters, logits, beam_scores, sequences, thread_pool.get());
+}
+
+TEST(BeamSearchTest, ProcessLogitsTiesPreferLowerIndex) {
+  // Every fourth token has the highest score, within a row and across the two beams, so the lowest indices win.
+  auto parameters = MakeProcessLogitsParameters(1, 2, 40, 1);
+  std::vector<float> logits;
+  for (int i = 0; i < 2 * 40; i++) {
+    logits.push_back(static_cast<float>(i % 4));
+  }
+  RunProcessLogitsParityTest(parameters, logits, {0.f, 0.f}, {0, 0}, nullptr);
+
+  // All scores are equal.
+  RunProcessLogitsParityTest(parameters, std::vector<float>(2 * 40, 1.f), {-1.f, -1.f}, {0, 0}, nullptr);
+}
+
+TEST(BeamSearchTest, ProcessLogitsTopKEqualsVocabSize) {
+  auto parameters = MakeProcessLogitsParameters(2, 2, 4, 1);
+  const std::vector<float> logits{0.5f, -1.f, 2.f, 0.f,
+                                  1.f, 1.f, -3.f, 0.25f,
+                                  -0.5f, 3.f, 3.f, 1.f,
+                                  2.f, 0.f, 0.f, -2.f};
+  RunProcessLogitsParityTest(parameters, logits, {-0.5f, -1.f, 0.f, -0.75f}, {1, 2, 0, 3}, nullptr);
+}
+
+TEST(BeamSearchTest, ProcessLogitsRepetitionPenaltyAndMinLength) {
+  // The highest logits belong to tokens already in the sequences and to the end of sequence token, which the
+  // minimum length keeps out until the sequences reach 5 tokens.
+  auto parameters = MakeProcessLogitsParameters(1, 2, 20, 3);
+  parameters.repetition_penalty = 2.0f;
+  parameters.min_length = 5;
+  std::vector<float> logits(2 * 20);
+  for (int i = 0; i < 2 * 20; i++) {
+    logits[i] = static_cast<float>(i % 20) * 0.1f;
+  }
+  logits[19] = 4.f;
+  logits[20 + 19] = 4.f;
+  logits[3] = 3.f;
+  logits[20 + 7] = 3.f;
+  const std::vector<int32_t> sequences{3, 3, 18, 7, 17, 2};
+
+  RunProcessLogitsParityTest(parameters, logits, {0.f, -0.1f}, sequences, nullptr);
+
+  parameters.min_length = 3;
+  RunProcessLogitsParityTest(parameters, logits, {0.f, -0.1f}, sequences, nullptr);
+}
+
+}  // namespace test
+}  // namespace onnxruntime
@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "test/providers/provider_test_utils.h"
+
+namespace onnxruntime {
+namespace test {
+
+// (x + bias) * scale, then Tanh. bias is broadcast over the rows and scale is a scalar.
+TEST(FusedElementwiseOpTest, BroadcastChain) {
+  OpTester test("FusedElementwise", 1, onnxruntime::kMSDomain);
+  test.AddAttribute<std::vector<std::string>>("ops", {"Add", "Mul", "Tanh"});
+  test.AddAttribute<std::vector<int64_t>>("operands", {0, 1, 3, 2, 4, -1});
+
+  const std::vector<float> x = {-2.0f, -1.0f, 0.0f, 1.0f, 2.0f, 3.0f};
+  const std::vector<float> bias = {0.5f, -0.5f, 1.0f};
+  const float scale = 0.25f;
+
+  std::vector<float> expected(x.size());
+  for (size_t i = 0; i < x.size(); i++) {
+    expected[i] = std::tanh((x[i] + bias[i % bias.size()]) * scale);
+  }
+
+  test.AddInput<float>("x", {2, 3}, x);
+  test.AddInput<float>("bias", {3}, bias);
+  test.AddInput<float>("scale", {}, {scale});
+  test.AddOutput<float>("output", {2, 3}, expected);
+  test.Run();
+}
+
+// An intermediate value used by two operators: Sigmoid(x) * Relu(x - y), with x of shape {2, 1} and y of shape {3}.
+TEST(FusedElementwiseOpTest, SharedIntermediate) {
+  OpTester test("FusedElementwise", 1, onnxruntime::kMSDomain);
+  test.AddAttribute<std::vector<std::string>>("ops", {"Sub", "Relu", "Sigmoid", "Mul"});
+  test.AddAttribute<std::vector<int64_t>>("operands", {0, 1, 2, -1, 0, -1, 4, 3});
+
+  const std::vector<float> x = {1.0f, -1.0f};
+  const std::vector<float> y = {0.0f, 0.5f, 2.0f};
+
+  std::vector<float> expected;
+  for (float a : x) {
+    for (float b : y) {
+      expected.push_back(std::max(a - b, 0.0f) / (1.0f + std::exp(-a)));
+    }
+  }
+
+  test.AddInput<float>("x", {2, 1}, x);
+  test.AddInput<float>("y", {3}, y);
+  test.AddOutput<float>("output", {2, 3}, expected);
+  test.Run();
+}
+
+TEST(FusedElementwiseOpTest, IncompatibleShapes) {
+  OpTester test("FusedElementwise", 1, onnxruntime::kMSDomain);
+  test.AddAttribute<std::vector<std::string>>("ops", {"Add", "Exp"});
+  test.AddAttribute<std::vector<int64_t>>("operands", {0, 1, 2, -1});
+
+  test.AddInput<float>("x", {2, 3}, {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f});
+  test.AddInput<float>("y", {2}, {1.0f, 2.0f});
+  test.AddOutput<float>("output", {2, 3}, {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f});
+  test.Run(OpTester::ExpectResult::kExpectFailure, "", {kTensorrtExecutionProvider});
+}
+
+}  // namespace test
+}  // namespace onnxruntime
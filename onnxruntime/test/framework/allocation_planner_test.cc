@@ -140,15 +140,19 @@ typedef std::unordered_map<const onnxruntime::NodeArg*, TensorShapeProto*> Shape
 
 class SequentialPlannerTestContext : public ISequentialPlannerContext {
  public:
-  SequentialPlannerTestContext(ShapeMap* shape_map) : shape_map_(shape_map) {}
+  SequentialPlannerTestContext(ShapeMap* shape_map, bool parallel_execution = false)
+      : shape_map_(shape_map), parallel_execution_(parallel_execution) {}
 
   TensorShapeProto* GetShape(const onnxruntime::NodeArg& arg) const override {
     auto iter = shape_map_->find(&arg);
     return (shape_map_->end() != iter) ? iter->second : nullptr;
   }
 
+  bool IsParallelExecutionEnabled() const override { return parallel_execution_; }
+
  private:
   ShapeMap* shape_map_;
+  bool parallel_execution_;
 };
 
 class PlannerTest : public ::testing::Test {
@@ -181,6 +185,7 @@ class PlannerTest : public ::testing::Test {
   profiling::Profiler profiler_;
   std::unique_ptr<SessionState> state_;
   ShapeMap shape_map_;
+  bool parallel_execution_ = false;
   std::unique_ptr<SequentialExecutionPlan> plan_;
 
  public:
@@ -304,7 +309,7 @@ class PlannerTest : public ::testing::Test {
     status = state_->FinalizeSessionState(ORT_TSTR(""), kernel_registry_manager, {}, nullptr, remove_initializers);
 
     EXPECT_TRUE(status.IsOK()) << status.ErrorMessage();
-    SequentialPlannerTestContext test_context(&shape_map_);
+    SequentialPlannerTestContext test_context(&shape_map_, parallel_execution_);
 
     status = SequentialPlanner::CreatePlan(nullptr, GraphViewer(graph_), outer_scope_node_args, execution_providers_,
                                            kernel_create_info_map, {}, {}, state_->GetOrtValueNameIdxMap(), test_context,
@@ -338,6 +343,8 @@ class PlannerTest : public ::testing::Test {
  protected:
   Graph& GetGraph() { return graph_; }
   const SequentialExecutionPlan& GetPlan() const { return *plan_; }
+  SequentialExecutionPlan& GetMutablePlan() { return *plan_; }
+  void EnableParallelExecution() { parallel_execution_ = true; }
   const SessionState& GetState() const { return *state_; }
 };
 
@@ -380,6 +387,39 @@ TEST_F(PlannerTest, ChainTest) {
   CheckFreed(3, {"X"});
 }
 
+TEST_F(PlannerTest, CriticalPathTest) {
+  // tensor variables:
+  std::string X("X"), S1("S1"), L1("L1"), L2("L2"), L3("L3");
+
+  // graph structure: a short branch X -> S1 and a long branch X -> L1 -> L2 -> L3
+  auto* short_node = AddNormalNode(X, S1);
+  auto* long_head = AddNormalNode(X, L1);
+  AddNormalNode(L1, L2);
+  AddNormalNode(L2, L3);
+
+  EnableParallelExecution();
+  CreatePlan();
+
+  const auto& dependencies = GetPlan().node_dependencies;
+  ASSERT_EQ(dependencies.root_nodes.size(), 2u);
+  EXPECT_EQ(dependencies.dependency_counts[long_head->Index()], 0);
+  EXPECT_EQ(dependencies.successor_offsets[long_head->Index() + 1] - dependencies.successor_offsets[long_head->Index()],
+            1u);
+
+  // with estimated costs the long branch goes first
+  SequentialPlanner::ComputeCriticalPathCosts(GraphViewer(GetGraph()), {}, GetMutablePlan());
+  EXPECT_EQ(dependencies.root_nodes[0], long_head->Index());
+  EXPECT_GT(dependencies.critical_path_costs[long_head->Index()],
+            dependencies.critical_path_costs[short_node->Index()]);
+
+  // measured costs override the estimates. Unmeasured nodes get the average measured cost.
+  SequentialPlanner::ComputeCriticalPathCosts(GraphViewer(GetGraph()),
+                                              {{short_node->Name(), 1000.0}, {long_head->Name(), 10.0}},
+                                              GetMutablePlan());
+  EXPECT_EQ(dependencies.root_nodes[0], short_node->Index());
+  EXPECT_DOUBLE_EQ(dependencies.critical_path_costs[long_head->Index()], 10.0 + 2 * 505.0);
+}
+
 /* InputOutputTest: Test that:
 (a) All inputs are classified as kPreExisting,
 (b) All outer scope node args are classified as kPreExisting,
@@ -4,7 +4,10 @@
 #include "core/framework/bfc_arena.h"
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <thread>
 
 namespace onnxruntime {
 namespace test {
@@ -298,5 +301,70 @@ TEST(BFCArenaTest, TestBackoffDoesntHang) {
   BFCArena a(std::unique_ptr<IAllocator>(new BadAllocator()), 10 * 1024 * 1024);
   EXPECT_THROW(a.Alloc(1024), OnnxRuntimeException) << "Arena should be unable to allocate memory";
 }
+
+TEST(BFCArenaTest, SmallAllocCache) {
+  BFCArena a(std::unique_ptr<IAllocator>(new CPUAllocator()), 1 << 30, ArenaExtendStrategy::kNextPowerOfTwo,
+             BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+             BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES, 4096);
+
+  std::vector<std::pair<char*, size_t>> ptrs;
+  for (size_t s = 1; s <= 4096; s += 7) {
+    char* raw = static_cast<char*>(a.Alloc(s));
+    ASSERT_NE(raw, nullptr);
+    // cached allocations are rounded up to a power of two
+    size_t expected_size = 256;
+    while (expected_size < s) {
+      expected_size *= 2;
+    }
+    EXPECT_EQ(expected_size, a.AllocatedSize(raw));
+    ptrs.emplace_back(raw, expected_size);
+  }
+
+  std::sort(ptrs.begin(), ptrs.end());
+  for (size_t i = 1; i < ptrs.size(); ++i) {
+    EXPECT_LE(ptrs[i - 1].first + ptrs[i - 1].second, ptrs[i].first);
+  }
+
+  // freed objects are reused
+  void* p = a.Alloc(1000);
+  a.Free(p);
+  EXPECT_EQ(p, a.Alloc(1000));
+  a.Free(p);
+
+  // larger allocations go to the arena
+  void* large = a.Alloc(4097);
+  EXPECT_EQ(4097u, a.RequestedSize(large));
+  a.Free(large);
+
+  for (auto& ptr : ptrs) {
+    a.Free(ptr.first);
+  }
+
+  // objects freed by another thread than the one that allocated them
+  std::vector<void*> shared_ptrs(1000);
+  std::thread producer([&]() {
+    for (auto& shared_ptr : shared_ptrs) {
+      shared_ptr = a.Alloc(64);
+    }
+  });
+  producer.join();
+
+  std::vector<std::thread> consumers;
+  for (size_t t = 0; t < 4; ++t) {
+    consumers.emplace_back([&, t]() {
+      for (size_t i = t; i < shared_ptrs.size(); i += 4) {
+        a.Free(shared_ptrs[i]);
+      }
+      for (size_t i = 0; i < 100; ++i) {
+        void* raw = a.Alloc(512);
+        memset(raw, 0, 512);
+        a.Free(raw);
+      }
+    });
+  }
+  for (auto& consumer : consumers) {
+    consumer.join();
+  }
+}
 }  // namespace test
 }  // namespace onnxruntime
@@ -7,6 +7,7 @@
 #include "core/graph/model.h"
 #include "core/providers/cpu/cpu_execution_provider.h"
 #include "core/session/inference_session.h"
+#include "core/session/onnxruntime_session_options_config_keys.h"
 #include "test_utils.h"
 #include "test/test_environment.h"
 #include "test/framework/TestAllocatorManager.h"
@@ -37,6 +38,68 @@ class ExecutionFrameTest : public ::testing::Test {
   concurrency::ThreadPool tp_;
   ExecutionFrameTest() : tp_(&onnxruntime::Env::Default(), ThreadOptions(), ORT_TSTR("ExecutionFrameTest"), 2, true) {
   }
+
+  // Creates state_ for a graph that applies op_types one after the other to the float input X, with the outputs
+  // T1, T2, ... A dim of X that is -1 is symbolic. config_entries are added to the session options.
+  void CreateSessionState(const std::vector<std::string>& op_types, const std::vector<int64_t>& dims,
+                          bool enable_mem_pattern,
+                          const std::vector<std::pair<const char*, const char*>>& config_entries) {
+    auto cpu_xp = CreateCPUExecutionProvider();
+    auto xp_type = cpu_xp->Type();
+    std::unordered_map<std::string, int> domain_to_version;
+    domain_to_version[onnxruntime::kOnnxDomain] = 7;
+    model_ = std::make_unique<onnxruntime::Model>("test", true, ModelMetaData(), PathString(),
+                                                  IOnnxRuntimeOpSchemaRegistryList(), domain_to_version,
+                                                  std::vector<ONNX_NAMESPACE::FunctionProto>{},
+                                                  DefaultLoggingManager().DefaultLogger());
+    onnxruntime::Graph& graph = model_->MainGraph();
+    TypeProto tensor_float;
+    tensor_float.mutable_tensor_type()->set_elem_type(TensorProto_DataType_FLOAT);
+    for (int64_t dim : dims) {
+      auto* dimension = tensor_float.mutable_tensor_type()->mutable_shape()->add_dim();
+      if (dim >= 0) {
+        dimension->set_dim_value(dim);
+      }
+    }
+
+    NodeArg* input = &graph.GetOrCreateNodeArg("X", &tensor_float);
+    for (size_t i = 0; i < op_types.size(); i++) {
+      const std::string index = std::to_string(i + 1);
+      NodeArg* output = &graph.GetOrCreateNodeArg("T" + index, &tensor_float);
+      graph.AddNode("node" + index, op_types[i], op_types[i], ArgMap{input}, ArgMap{output})
+          .SetExecutionProviderType(xp_type);
+      input = output;
+    }
+    ASSERT_STATUS_OK(graph.Resolve());
+
+    ASSERT_STATUS_OK(execution_providers_.Add(xp_type, std::move(cpu_xp)));
+    ASSERT_STATUS_OK(kernel_registry_manager_.RegisterKernels(execution_providers_));
+    state_ = std::make_unique<SessionState>(graph, execution_providers_, enable_mem_pattern, &tp_, nullptr, dtm_,
+                                            DefaultLoggingManager().DefaultLogger(), profiler_);
+
+    SessionOptions so;
+    for (const auto& entry : config_entries) {
+      ASSERT_STATUS_OK(so.config_options.AddConfigEntry(entry.first, entry.second));
+    }
+    ASSERT_STATUS_OK(state_->FinalizeSessionState(ORT_TSTR(""), kernel_registry_manager_, so));
+  }
+
+  int GetIdx(const std::string& name) const {
+    int idx = -1;
+    EXPECT_STATUS_OK(state_->GetOrtValueNameIdxMap().GetIdx(name, idx));
+    return idx;
+  }
+
+  AllocatorPtr GetCpuAllocator() const {
+    return execution_providers_.Get(onnxruntime::kCpuExecutionProvider)->GetAllocator(0, OrtMemTypeDefault);
+  }
+
+  std::unique_ptr<onnxruntime::Model> model_;
+  ExecutionProviders execution_providers_;
+  KernelRegistryManager kernel_registry_manager_;
+  DataTransferManager dtm_;
+  profiling::Profiler profiler_;
+  std::unique_ptr<SessionState> state_;
 };
 
 TEST_F(ExecutionFrameTest, TensorAllocationTest) {
@@ -301,6 +364,142 @@ TEST_F(ExecutionFrameTest, MemPatternTest) {
   ASSERT_EQ(p->GetBlock(4)->offset_, kAllocAlignment);
 }
 
+// training builds generate the patterns from the input shapes on a miss
+#ifndef ENABLE_TRAINING
+TEST_F(ExecutionFrameTest, MemPatternBucketTest) {
+  CreateSessionState({"Relu", "Sigmoid"}, {-1, -1}, true,
+                     {{kOrtSessionOptionsConfigMemPatternBucketGranularity, "32"},
+                      {kOrtSessionOptionsConfigMemPatternMaxCached, "1"}});
+  SessionState& state = *state_;
+
+  auto cpu_allocator = GetCpuAllocator();
+  auto make_feeds = [&](int64_t batch, int64_t sequence) {
+    std::vector<OrtValue> feeds(1);
+    CreateMLValue<float>(cpu_allocator, std::vector<int64_t>{batch, sequence},
+                         std::vector<float>(static_cast<size_t>(batch * sequence), 1.0f), &feeds[0]);
+    return feeds;
+  };
+
+  std::unordered_map<int, TensorShape> inferred_shapes;
+  ASSERT_EQ(state.GetMemoryPatternGroup(make_feeds(3, 40), {0}, inferred_shapes), nullptr);
+  ASSERT_STATUS_OK(state.UpdateMemoryPatternGroupCache(make_feeds(3, 40), std::make_unique<MemoryPatternGroup>()));
+
+  // same bucket, shapes covered by the pattern
+  EXPECT_NE(state.GetMemoryPatternGroup(make_feeds(3, 40), {0}, inferred_shapes), nullptr);
+  EXPECT_NE(state.GetMemoryPatternGroup(make_feeds(4, 33), {0}, inferred_shapes), nullptr);
+
+  // same bucket, but larger than the shapes the pattern was generated for
+  EXPECT_EQ(state.GetMemoryPatternGroup(make_feeds(4, 64), {0}, inferred_shapes), nullptr);
+  ASSERT_STATUS_OK(state.UpdateMemoryPatternGroupCache(make_feeds(4, 64), std::make_unique<MemoryPatternGroup>()));
+  EXPECT_NE(state.GetMemoryPatternGroup(make_feeds(3, 40), {0}, inferred_shapes), nullptr);
+
+  // another bucket evicts the only entry
+  EXPECT_EQ(state.GetMemoryPatternGroup(make_feeds(5, 40), {0}, inferred_shapes), nullptr);
+  ASSERT_STATUS_OK(state.UpdateMemoryPatternGroupCache(make_feeds(5, 40), std::make_unique<MemoryPatternGroup>()));
+  EXPECT_EQ(state.GetMemoryPatternGroup(make_feeds(3, 40), {0}, inferred_shapes), nullptr);
+
+  const auto stats = state.GetMemoryPatternCacheStats();
+  EXPECT_EQ(stats.hits, 3u);
+  EXPECT_EQ(stats.misses, 4u);
+  EXPECT_EQ(stats.replacements, 1u);
+  EXPECT_EQ(stats.evictions, 1u);
+}
+
+TEST_F(ExecutionFrameTest, CachedFrameBuffersTest) {
+  CreateSessionState({"Relu", "Sigmoid"}, {-1, 3}, true, {{kOrtSessionOptionsConfigMaxCachedFrameBuffers, "2"}});
+  SessionState& state = *state_;
+  ASSERT_EQ(state.GetMaxCachedFrameBuffers(), 2u);
+
+  int x_idx = GetIdx("X"), t1_idx = GetIdx("T1"), t2_idx = GetIdx("T2");
+  auto cpu_allocator = GetCpuAllocator();
+  auto make_feeds = [&](int64_t batch) {
+    std::vector<OrtValue> feeds(1);
+    CreateMLValue<float>(cpu_allocator, std::vector<int64_t>{batch, 3},
+                         std::vector<float>(static_cast<size_t>(batch * 3), 1.0f), &feeds[0]);
+    return feeds;
+  };
+
+  // allocates T1 in a new frame and returns where it was placed
+  auto allocate_t1 = [&](ExecutionFrame& frame, int64_t batch) -> const void* {
+    OrtValue& t1 = frame.GetMutableMLValue(t1_idx);
+    EXPECT_STATUS_OK(frame.AllocateMLValueTensorSelfOwnBuffer(t1, t1_idx, DataTypeImpl::GetType<float>(),
+                                                              cpu_allocator->Info(), TensorShape({batch, 3})));
+    return t1.Get<Tensor>().DataRaw();
+  };
+
+  std::vector<OrtValue> fetches;
+  {
+    // no pattern yet, so there are no buffers to cache
+    auto feeds = make_feeds(2);
+    ExecutionFrame frame({x_idx}, feeds, {t2_idx}, fetches, {}, state);
+    ASSERT_TRUE(frame.HasMemoryPatternPlanner());
+    allocate_t1(frame, 2);
+    auto pattern = std::make_unique<MemoryPatternGroup>();
+    ASSERT_STATUS_OK(frame.GeneratePatterns(pattern.get()));
+    ASSERT_STATUS_OK(state.UpdateMemoryPatternGroupCache(feeds, std::move(pattern)));
+  }
+
+  const void* t1_data = nullptr;
+  {
+    ExecutionFrame frame({x_idx}, make_feeds(2), {t2_idx}, fetches, {}, state);
+    ASSERT_FALSE(frame.HasMemoryPatternPlanner());
+    t1_data = allocate_t1(frame, 2);
+  }
+  EXPECT_EQ(state.GetMemoryPatternCacheStats().hits, 1u);
+
+  // the next frames with the same shapes reuse the buffers without looking up the pattern
+  for (int i = 0; i < 2; ++i) {
+    ExecutionFrame frame({x_idx}, make_feeds(2), {t2_idx}, fetches, {}, state);
+    ASSERT_FALSE(frame.HasMemoryPatternPlanner());
+    EXPECT_EQ(allocate_t1(frame, 2), t1_data);
+  }
+  EXPECT_EQ(state.GetMemoryPatternCacheStats().hits, 1u);
+
+  // other shapes don't match the cached buffers
+  {
+    ExecutionFrame frame({x_idx}, make_feeds(4), {t2_idx}, fetches, {}, state);
+    EXPECT_TRUE(frame.HasMemoryPatternPlanner());
+  }
+  EXPECT_EQ(state.GetMemoryPatternCacheStats().misses, 2u);
+}
+#endif
+
+TEST_F(ExecutionFrameTest, RunArenaTest) {
+  CreateSessionState({"Relu", "Sigmoid", "Relu"}, {2, 3}, false, {{kOrtSessionOptionsConfigRunArenaMaxBytes, "1048576"}});
+  int x_idx = GetIdx("X"), t1_idx = GetIdx("T1"), t2_idx = GetIdx("T2"), t3_idx = GetIdx("T3");
+  auto cpu_allocator = GetCpuAllocator();
+
+  OrtValue x;
+  CreateMLValue<float>(cpu_allocator, std::vector<int64_t>{2, 3}, std::vector<float>(6, 1.0f), &x);
+
+  auto run = [&](const void*& t1_data, const void*& t2_data) {
+    vector<OrtValue> outputs;
+    ExecutionFrame frame({x_idx}, {x}, {t3_idx}, outputs, {}, *state_);
+
+    OrtValue& t1 = frame.GetMutableMLValue(t1_idx);
+    OrtValue& t2 = frame.GetMutableMLValue(t2_idx);
+    ASSERT_STATUS_OK(frame.AllocateMLValueTensorSelfOwnBuffer(t1, t1_idx, DataTypeImpl::GetType<float>(),
+                                                              cpu_allocator->Info(), TensorShape({2, 3})));
+    ASSERT_STATUS_OK(frame.AllocateMLValueTensorSelfOwnBuffer(t2, t2_idx, DataTypeImpl::GetType<float>(),
+                                                              cpu_allocator->Info(), TensorShape({2, 3})));
+    t1_data = t1.Get<Tensor>().DataRaw();
+    t2_data = t2.Get<Tensor>().DataRaw();
+  };
+
+  // the first run measures the size the arena needs
+  const void* t1_data = nullptr;
+  const void* t2_data = nullptr;
+  run(t1_data, t2_data);
+  auto sizes = state_->GetRunArenaSizes();
+  ASSERT_EQ(sizes.size(), 1u);
+  EXPECT_EQ(sizes[0].first, cpu_allocator->Info());
+  EXPECT_EQ(sizes[0].second, 2u * kAllocAlignment);  // each allocation is kAllocAlignment-byte aligned
+
+  // the next runs bump both activations off one buffer
+  run(t1_data, t2_data);
+  EXPECT_EQ(static_cast<const char*>(t1_data) + kAllocAlignment, t2_data);
+}
+
 #ifdef ENABLE_TRAINING
 TEST_F(ExecutionFrameTest, MemPatternWithExternalOutputsTest) {
   auto cpu_xp = CreateCPUExecutionProvider();
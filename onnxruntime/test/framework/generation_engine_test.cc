@@ -0,0 +1,333 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#if !defined(ORT_MINIMAL_BUILD)
+
+#include <limits>
+#include <map>
+#include <sstream>
+
+#include "core/graph/model.h"
+#include "core/session/generation_engine.h"
+#include "core/session/inference_session.h"
+#include "test/test_environment.h"
+#include "test/util/include/asserts.h"
+#include "gtest/gtest.h"
+
+using namespace ONNX_NAMESPACE;
+
+namespace onnxruntime {
+namespace test {
+
+namespace {
+
+constexpr int kVocabSize = 16;
+
+void AddDim(TypeProto& type, int64_t value) {
+  type.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_value(value);
+}
+
+void AddDim(TypeProto& type, const std::string& param) {
+  type.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_param(param);
+}
+
+TypeProto TensorType(TensorProto_DataType elem_type) {
+  TypeProto type;
+  type.mutable_tensor_type()->set_elem_type(elem_type);
+  type.mutable_tensor_type()->mutable_shape();
+  return type;
+}
+
+template <typename T>
+void AddInitializer(Graph& graph, const std::string& name, TensorProto_DataType data_type,
+                    const std::vector<int64_t>& dims, const std::vector<T>& values) {
+  TensorProto tensor;
+  tensor.set_name(name);
+  tensor.set_data_type(data_type);
+  for (int64_t dim : dims) {
+    tensor.add_dims(dim);
+  }
+  tensor.set_raw_data(values.data(), values.size() * sizeof(T));
+  graph.AddInitializedTensor(tensor);
+}
+
+// A GPT-2 like decoder with one layer, one head of size 1 and a vocabulary of kVocabSize tokens. Its past state
+// holds the input ids, and the next token after each position is the sum of the unmasked input ids up to it
+// modulo kVocabSize. The tokens a request generates thus only depend on its own history, and wrong past state rows,
+// alignment or attention mask change them.
+std::unique_ptr<Model> CreateDecoderModel() {
+  auto model = std::make_unique<Model>("decoder", false, ModelMetaData(), PathString(),
+                                       IOnnxRuntimeOpSchemaRegistryList(), std::unordered_map<std::string, int>{{kOnnxDomain, 12}},
+                                       std::vector<ONNX_NAMESPACE::FunctionProto>{},
+                                       DefaultLoggingManager().DefaultLogger());
+  Graph& graph = model->MainGraph();
+
+  TypeProto ids_type = TensorType(TensorProto_DataType_INT32);
+  AddDim(ids_type, "batch_size");
+  AddDim(ids_type, "seq_len");
+  TypeProto mask_type = TensorType(TensorProto_DataType_INT32);
+  AddDim(mask_type, "batch_size");
+  AddDim(mask_type, "total_seq_len");
+  TypeProto past_type = TensorType(TensorProto_DataType_FLOAT);
+  AddDim(past_type, 2);
+  AddDim(past_type, "batch_size");
+  AddDim(past_type, 1);
+  AddDim(past_type, "past_seq_len");
+  AddDim(past_type, 1);
+  TypeProto logits_type = TensorType(TensorProto_DataType_FLOAT);
+  AddDim(logits_type, "batch_size");
+  AddDim(logits_type, "seq_len");
+  AddDim(logits_type, kVocabSize);
+  TypeProto present_type = TensorType(TensorProto_DataType_FLOAT);
+  AddDim(present_type, 2);
+  AddDim(present_type, "batch_size");
+  AddDim(present_type, 1);
+  AddDim(present_type, "total_seq_len");
+  AddDim(present_type, 1);
+
+  auto& input_ids = graph.GetOrCreateNodeArg("input_ids", &ids_type);
+  auto& position_ids = graph.GetOrCreateNodeArg("position_ids", &ids_type);
+  auto& attention_mask = graph.GetOrCreateNodeArg("attention_mask", &mask_type);
+  auto& past = graph.GetOrCreateNodeArg("past_0", &past_type);
+  auto& logits = graph.GetOrCreateNodeArg("logits", &logits_type);
+  auto& present = graph.GetOrCreateNodeArg("present_0", &present_type);
+
+  AddInitializer<int64_t>(graph, "zero", TensorProto_DataType_INT64, {}, {0});
+  AddInitializer<int64_t>(graph, "one", TensorProto_DataType_INT64, {1}, {1});
+  AddInitializer<int64_t>(graph, "max", TensorProto_DataType_INT64, {1}, {std::numeric_limits<int64_t>::max()});
+  AddInitializer<int32_t>(graph, "axis", TensorProto_DataType_INT32, {}, {1});
+  AddInitializer<int32_t>(graph, "vocab_size", TensorProto_DataType_INT32, {}, {kVocabSize});
+  AddInitializer<int32_t>(graph, "depth", TensorProto_DataType_INT32, {1}, {kVocabSize});
+  AddInitializer<float>(graph, "one_hot_values", TensorProto_DataType_FLOAT, {2}, {0.0f, 1.0f});
+
+  auto arg = [&graph](const std::string& name) -> NodeArg* { return &graph.GetOrCreateNodeArg(name, nullptr); };
+
+  // next token = CumSum(Concat(past ids, input ids) * attention_mask)[:, -S:] % kVocabSize
+  graph.AddNode("past_key", "Gather", "", {&past, arg("zero")}, {arg("past_key")}).AddAttribute("axis", int64_t{0});
+  graph.AddNode("past_ids", "Squeeze", "", {arg("past_key")}, {arg("past_ids_f")})
+      .AddAttribute("axes", std::vector<int64_t>{1, 3});
+  graph.AddNode("past_ids_i", "Cast", "", {arg("past_ids_f")}, {arg("past_ids")})
+      .AddAttribute("to", static_cast<int64_t>(TensorProto_DataType_INT32));
+  graph.AddNode("ids", "Concat", "", {arg("past_ids"), &input_ids}, {arg("ids")}).AddAttribute("axis", int64_t{1});
+  graph.AddNode("masked", "Mul", "", {arg("ids"), &attention_mask}, {arg("masked")});
+  graph.AddNode("sums", "CumSum", "", {arg("masked"), arg("axis")}, {arg("sums")});
+  graph.AddNode("shape", "Shape", "", {&input_ids}, {arg("shape")});
+  graph.AddNode("seq_len", "Gather", "", {arg("shape"), arg("one")}, {arg("seq_len")});
+  graph.AddNode("start", "Neg", "", {arg("seq_len")}, {arg("start")});
+  graph.AddNode("input_sums", "Slice", "", {arg("sums"), arg("start"), arg("max"), arg("one")}, {arg("input_sums")});
+  graph.AddNode("next", "Mod", "", {arg("input_sums"), arg("vocab_size")}, {arg("next")});
+  graph.AddNode("logits", "OneHot", "", {arg("next"), arg("depth"), arg("one_hot_values")}, {&logits});
+
+  // present = Concat(past, input ids as key and value)
+  graph.AddNode("input_f", "Cast", "", {&input_ids}, {arg("input_f")})
+      .AddAttribute("to", static_cast<int64_t>(TensorProto_DataType_FLOAT));
+  graph.AddNode("input_kv", "Unsqueeze", "", {arg("input_f")}, {arg("input_kv")})
+      .AddAttribute("axes", std::vector<int64_t>{0, 2, 4});
+  graph.AddNode("new_kv", "Concat", "", {arg("input_kv"), arg("input_kv")}, {arg("new_kv")})
+      .AddAttribute("axis", int64_t{0});
+  graph.AddNode("present", "Concat", "", {&past, arg("new_kv")}, {&present}).AddAttribute("axis", int64_t{3});
+
+  graph.SetInputs({&input_ids, &position_ids, &attention_mask, &past});
+  graph.SetOutputs({&logits, &present});
+  EXPECT_STATUS_OK(graph.Resolve());
+  return model;
+}
+
+std::unique_ptr<GenerationEngine> CreateEngine(const GenerationEngineOptions& options) {
+  std::string serialized;
+  CreateDecoderModel()->ToProto().SerializeToString(&serialized);
+  std::stringstream stream(serialized);
+
+  auto session = std::make_unique<InferenceSession>(SessionOptions(), GetEnvironment());
+  EXPECT_STATUS_OK(session->Load(stream));
+  EXPECT_STATUS_OK(session->Initialize());
+
+  std::unique_ptr<GenerationEngine> engine;
+  EXPECT_STATUS_OK(GenerationEngine::Create(std::move(session), options, engine));
+  return engine;
+}
+
+std::vector<int32_t> ExpectedTokens(const std::vector<int32_t>& prompt, int max_new_tokens,
+                                    const GenerationEngineOptions& options) {
+  int32_t sum = 0;
+  for (int32_t token : prompt) {
+    sum += token;
+  }
+
+  std::vector<int32_t> tokens;
+  while (true) {
+    const int32_t next = sum % kVocabSize;
+    tokens.push_back(next);
+    sum += next;
+    if (next == options.eos_token_id || static_cast<int>(tokens.size()) >= max_new_tokens ||
+        static_cast<int>(prompt.size() + tokens.size()) >= options.max_length) {
+      return tokens;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(GenerationEngineTest, AdmitsAndRetiresRequestsAtEachStep) {
+  GenerationEngineOptions options;
+  options.max_batch_size = 3;
+  options.max_length = 12;
+  options.pad_token_id = 5;  // padded positions change the sums unless they are masked out
+  options.eos_token_id = 9;
+  auto engine = CreateEngine(options);
+  ASSERT_NE(engine, nullptr);
+
+  const std::vector<std::pair<std::vector<int32_t>, int>> requests = {
+      {{1, 2, 3}, 6},
+      {{7}, 8},
+      {{4, 4, 4, 4, 4, 4}, 10},  // ends at max_length
+      {{2, 5}, 3},
+      {{4, 5}, 20},  // generates eos_token_id first
+      {{1, 1, 1, 1}, 7},
+      {{6, 2}, 4},
+  };
+
+  std::map<int64_t, size_t> submitted;
+  auto submit = [&](size_t i) {
+    int64_t request_id;
+    ASSERT_STATUS_OK(engine->Submit(requests[i].first, requests[i].second, request_id));
+    submitted[request_id] = i;
+  };
+
+  // More requests than slots, and more arriving while the first ones run.
+  for (size_t i = 0; i < 5; ++i) {
+    submit(i);
+  }
+
+  size_t num_pending = 0;
+  size_t steps = 0;
+  std::map<int64_t, std::vector<int32_t>> results;
+  do {
+    ASSERT_STATUS_OK(engine->Step(num_pending));
+    if (++steps == 2) {
+      submit(5);
+      submit(6);
+    }
+
+    for (const auto& entry : submitted) {
+      if (results.count(entry.first) == 0) {
+        std::vector<int32_t> tokens;
+        GenerationRequestState state;
+        ASSERT_STATUS_OK(engine->GetResult(entry.first, tokens, state));
+        ASSERT_NE(state, GenerationRequestState::kCancelled);
+        if (state == GenerationRequestState::kFinished) {
+          results[entry.first] = tokens;
+        }
+      }
+    }
+  } while (num_pending > 0);
+
+  ASSERT_EQ(results.size(), requests.size());
+  for (const auto& entry : submitted) {
+    const auto& request = requests[entry.second];
+    EXPECT_EQ(results[entry.first], ExpectedTokens(request.first, request.second, options))
+        << "request " << entry.second;
+  }
+
+  // Requests take the slots of those that finished right away. Fixed batches of 3 requests, each decoded until
+  // its longest request finishes, would take 8 + 7 + 4 steps.
+  EXPECT_EQ(steps, 14u);
+}
+
+// Requests leave from the middle slot while their neighbours keep running, and the freed slot is reused by a
+// shorter prompt that is written into the existing rows, and by a longer one that needs wider rows.
+TEST(GenerationEngineTest, ReusesFreedSlots) {
+  GenerationEngineOptions options;
+  options.max_batch_size = 3;
+  options.max_length = 32;
+  options.pad_token_id = 5;
+  auto engine = CreateEngine(options);
+  ASSERT_NE(engine, nullptr);
+
+  const std::vector<std::pair<std::vector<int32_t>, int>> requests = {
+      {{1}, 20},
+      {{2, 3}, 2},
+      {{4}, 20},
+      {{3}, 2},                                      // joins when the rows are wider than its prompt
+      {{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}, 4},  // joins when the rows are narrower than its prompt
+  };
+
+  std::map<int64_t, size_t> submitted;
+  auto submit = [&](size_t i) {
+    int64_t request_id;
+    ASSERT_STATUS_OK(engine->Submit(requests[i].first, requests[i].second, request_id));
+    submitted[request_id] = i;
+  };
+
+  for (size_t i = 0; i < 3; ++i) {
+    submit(i);
+  }
+
+  size_t num_pending = 0;
+  size_t steps = 0;
+  do {
+    ASSERT_STATUS_OK(engine->Step(num_pending));
+    if (++steps == 3) {
+      submit(3);
+    } else if (steps == 6) {
+      submit(4);
+    }
+  } while (num_pending > 0);
+
+  for (const auto& entry : submitted) {
+    std::vector<int32_t> tokens;
+    GenerationRequestState state;
+    ASSERT_STATUS_OK(engine->GetResult(entry.first, tokens, state));
+    EXPECT_EQ(state, GenerationRequestState::kFinished) << "request " << entry.second;
+    const auto& request = requests[entry.second];
+    EXPECT_EQ(tokens, ExpectedTokens(request.first, request.second, options)) << "request " << entry.second;
+  }
+}
+
+TEST(GenerationEngineTest, CancelFreesSlot) {
+  GenerationEngineOptions options;
+  options.max_batch_size = 1;
+  options.max_length = 64;
+  auto engine = CreateEngine(options);
+  ASSERT_NE(engine, nullptr);
+
+  int64_t first;
+  int64_t second;
+  ASSERT_STATUS_OK(engine->Submit(std::vector<int32_t>{1}, 50, first));
+  ASSERT_STATUS_OK(engine->Submit(std::vector<int32_t>{2, 3}, 2, second));
+
+  size_t num_pending;
+  ASSERT_STATUS_OK(engine->Step(num_pending));
+  ASSERT_EQ(num_pending, 2u);
+  ASSERT_STATUS_OK(engine->Cancel(first));
+  ASSERT_STATUS_OK(engine->Step(num_pending));
+
+  // a result whose copy fails is kept, so that it can be retrieved again
+  EXPECT_FALSE(engine->GetResult(first, [](const std::vector<int32_t>&, GenerationRequestState) {
+                       return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "out of memory");
+                     })
+                   .IsOK());
+
+  std::vector<int32_t> tokens;
+  GenerationRequestState state;
+  ASSERT_STATUS_OK(engine->GetResult(first, tokens, state));
+  EXPECT_EQ(state, GenerationRequestState::kCancelled);
+  EXPECT_EQ(tokens, std::vector<int32_t>{1});
+  EXPECT_FALSE(engine->GetResult(first, tokens, state).IsOK());
+
+  // The cancelled request left its slot at the end of the step, so the next one is admitted now.
+  ASSERT_STATUS_OK(engine->Step(num_pending));
+  ASSERT_STATUS_OK(engine->Step(num_pending));
+  EXPECT_EQ(num_pending, 0u);
+  ASSERT_STATUS_OK(engine->GetResult(second, tokens, state));
+  EXPECT_EQ(state, GenerationRequestState::kFinished);
+  EXPECT_EQ(tokens, ExpectedTokens({2, 3}, 2, options));
+
+  EXPECT_FALSE(engine->Submit(std::vector<int32_t>{}, 1, first).IsOK());
+  EXPECT_FALSE(engine->Submit(std::vector<int32_t>{kVocabSize}, 1, first).IsOK());
+}
+
+}  // namespace test
+}  // namespace onnxruntime
+
+#endif
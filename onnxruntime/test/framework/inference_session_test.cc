@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <cfloat>
 #include <functional>
+#include <future>
 #include <iterator>
 #include <thread>
 #include <fstream>
@@ -991,6 +992,152 @@ TEST(InferenceSessionTests, InvalidInputTypeOfTensorElement) {
   ASSERT_TRUE(!st.IsOK());
 }
 
+TEST(InferenceSessionTests, PrepareRun) {
+  SessionOptions so;
+
+  so.session_logid = "InferenceSessionTests.PrepareRun";
+
+  InferenceSession session_object{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session_object.Load(MODEL_URI));
+
+  std::unique_ptr<InferenceSession::PreparedRun> prepared_run;
+  ASSERT_FALSE(session_object.PrepareRun({"X"}, {"Y"}, prepared_run).IsOK());  // not initialized
+
+  ASSERT_STATUS_OK(session_object.Initialize());
+  ASSERT_FALSE(session_object.PrepareRun({"X"}, {"Z"}, prepared_run).IsOK());
+  ASSERT_FALSE(session_object.PrepareRun({"W"}, {"Y"}, prepared_run).IsOK());
+  ASSERT_STATUS_OK(session_object.PrepareRun({"X"}, {"Y"}, prepared_run));
+  ASSERT_EQ(prepared_run->GetFeedNames(), std::vector<std::string>{"X"});
+  ASSERT_EQ(prepared_run->GetOutputNames(), std::vector<std::string>{"Y"});
+
+  RunOptions run_options;
+  run_options.run_tag = so.session_logid;
+
+  std::vector<int64_t> dims_mul_x = {3, 2};
+  std::vector<float> values_mul_x = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+  std::vector<int64_t> expected_dims_mul_y = {3, 2};
+  std::vector<float> expected_values_mul_y = {1.0f, 4.0f, 9.0f, 16.0f, 25.0f, 36.0f};
+
+  // the prepared run is reused by each run
+  for (int i = 0; i < 2; i++) {
+    std::vector<OrtValue> feeds(1);
+    CreateMLValue<float>(TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault), dims_mul_x, values_mul_x,
+                         &feeds[0]);
+    std::vector<OrtValue> fetches;
+    ASSERT_STATUS_OK(session_object.Run(run_options, *prepared_run, feeds, &fetches));
+    VerifyOutputs(fetches, expected_dims_mul_y, expected_values_mul_y);
+  }
+
+  // the types of the feeds are still checked
+  std::vector<int64_t> int_values_mul_x = {1, 2, 3, 4, 5, 6};
+  std::vector<OrtValue> feeds(1);
+  CreateMLValue<int64_t>(TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault), dims_mul_x,
+                         int_values_mul_x, &feeds[0]);
+  std::vector<OrtValue> fetches;
+  ASSERT_FALSE(session_object.Run(run_options, *prepared_run, feeds, &fetches).IsOK());
+
+  // and the handle is only valid for the session that prepared it
+  InferenceSession other_session_object{so, GetEnvironment()};
+  ASSERT_STATUS_OK(other_session_object.Load(MODEL_URI));
+  ASSERT_STATUS_OK(other_session_object.Initialize());
+  CreateMLValue<float>(TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault), dims_mul_x, values_mul_x,
+                       &feeds[0]);
+  ASSERT_FALSE(other_session_object.Run(run_options, *prepared_run, feeds, &fetches).IsOK());
+}
+
+TEST(InferenceSessionTests, RunAsync) {
+  SessionOptions so;
+
+  so.session_logid = "InferenceSessionTests.RunAsync";
+
+  InferenceSession session_object{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session_object.Load(MODEL_URI));
+  ASSERT_STATUS_OK(session_object.Initialize());
+
+  std::vector<int64_t> dims_mul_x = {3, 2};
+  std::vector<float> values_mul_x = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+  std::vector<int64_t> expected_dims_mul_y = {3, 2};
+  std::vector<float> expected_values_mul_y = {1.0f, 4.0f, 9.0f, 16.0f, 25.0f, 36.0f};
+
+  // queue more runs than the pool has threads
+  constexpr int num_runs = 32;
+  std::vector<std::promise<void>> completions(num_runs);
+  for (int i = 0; i < num_runs; i++) {
+    std::vector<OrtValue> feeds(1);
+    CreateMLValue<float>(TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault), dims_mul_x, values_mul_x,
+                         &feeds[0]);
+    auto& completion = completions[i];
+    ASSERT_STATUS_OK(session_object.RunAsync(
+        nullptr, {"X"}, std::move(feeds), {"Y"}, {},
+        [&](const Status& status, std::vector<OrtValue>& fetches) {
+          EXPECT_TRUE(status.IsOK()) << status.ErrorMessage();
+          if (status.IsOK()) {
+            VerifyOutputs(fetches, expected_dims_mul_y, expected_values_mul_y);
+          }
+          completion.set_value();
+        }));
+  }
+
+  for (auto& completion : completions) {
+    completion.get_future().wait();
+  }
+
+  // a run is cancelled with the terminate flag of its options
+  RunOptions run_options;
+  run_options.run_tag = so.session_logid;
+  run_options.terminate = true;
+
+  std::vector<OrtValue> feeds(1);
+  CreateMLValue<float>(TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault), dims_mul_x, values_mul_x,
+                       &feeds[0]);
+  std::promise<Status> cancelled;
+  ASSERT_STATUS_OK(session_object.RunAsync(
+      &run_options, {"X"}, std::move(feeds), {"Y"}, {},
+      [&cancelled](const Status& status, std::vector<OrtValue>&) { cancelled.set_value(status); }));
+  ASSERT_FALSE(cancelled.get_future().get().IsOK());
+}
+
+TEST(InferenceSessionTests, RunAsyncThreadPoolSize) {
+  std::vector<int64_t> dims_mul_x = {3, 2};
+  std::vector<float> values_mul_x = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+  std::vector<int64_t> expected_dims_mul_y = {3, 2};
+  std::vector<float> expected_values_mul_y = {1.0f, 4.0f, 9.0f, 16.0f, 25.0f, 36.0f};
+
+  // 0 is the number of CPUs and 1 runs on the caller for synchronous runs. Both get a thread for the asynchronous
+  // runs, also with a single CPU.
+  for (int thread_pool_size : {0, 1}) {
+    SessionOptions so;
+    so.session_logid = "InferenceSessionTests.RunAsyncThreadPoolSize";
+    so.inter_op_param.thread_pool_size = thread_pool_size;
+
+    InferenceSession session_object{so, GetEnvironment()};
+    ASSERT_STATUS_OK(session_object.Load(MODEL_URI));
+    ASSERT_STATUS_OK(session_object.Initialize());
+
+    constexpr int num_runs = 4;
+    std::vector<std::promise<void>> completions(num_runs);
+    for (int i = 0; i < num_runs; i++) {
+      std::vector<OrtValue> feeds(1);
+      CreateMLValue<float>(TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault), dims_mul_x,
+                           values_mul_x, &feeds[0]);
+      auto& completion = completions[i];
+      ASSERT_STATUS_OK(session_object.RunAsync(
+          nullptr, {"X"}, std::move(feeds), {"Y"}, {},
+          [&](const Status& status, std::vector<OrtValue>& fetches) {
+            EXPECT_TRUE(status.IsOK()) << status.ErrorMessage();
+            if (status.IsOK()) {
+              VerifyOutputs(fetches, expected_dims_mul_y, expected_values_mul_y);
+            }
+            completion.set_value();
+          }));
+    }
+
+    for (auto& completion : completions) {
+      completion.get_future().wait();
+    }
+  }
+}
+
 #if defined(USE_CUDA) || defined(USE_ROCM)
 #if USE_CUDA
 constexpr const char* kGpuExecutionProvider = kCudaExecutionProvider;
@@ -1,13 +1,21 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <sstream>
+#include <thread>
+
 #include "core/framework/data_types.h"
 #include "core/framework/op_kernel.h"
+#include "core/graph/model.h"
 #include "test/providers/provider_test_utils.h"
+#include "test/test_environment.h"
+#include "test/util/include/asserts.h"
 #include "test_utils.h"
 #include "core/session/inference_session.h"
+#include "core/session/onnxruntime_session_options_config_keys.h"
 
 #include "gtest/gtest.h"
+#include "gmock/gmock.h"
 
 using namespace ONNX_NAMESPACE;
 using namespace onnxruntime::common;
@@ -117,6 +125,120 @@ TEST(ParallelExecutor, TestStatusPropagation) {
   }
 }
 
+// Graph with a fan-out and a fan-in, for the work stealing executor:
+// X -> kNumBranches chains of Add(x, x) of different lengths -> Sum -> Y, and action -> TestOp -> action_out.
+// Branch b doubles X b + 1 times, so Y = X * (2^(kNumBranches + 1) - 2).
+constexpr int kNumBranches = 8;
+
+static std::unique_ptr<InferenceSession> CreateFanOutFanInSession(const std::shared_ptr<CustomRegistry>& registry) {
+  onnxruntime::SessionOptions so;
+  so.session_logid = "FanOutFanIn";
+  so.execution_mode = ExecutionMode::ORT_PARALLEL;
+  so.inter_op_param.thread_pool_size = 4;
+  // keep the identical prefixes of the branches apart
+  so.graph_optimization_level = TransformerLevel::Default;
+  EXPECT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsConfigInterOpWorkStealing, "1"));
+
+  auto session = std::make_unique<InferenceSession>(so, GetEnvironment());
+  EXPECT_STATUS_OK(session->RegisterCustomRegistry(registry));
+
+  Model model("FanOutFanIn", false, ModelMetaData(), PathString(), {registry->GetOpschemaRegistry()},
+              {{kOnnxDomain, 12}, {TestOp::OpDomain, 10}}, {}, DefaultLoggingManager().DefaultLogger());
+  Graph& graph = model.MainGraph();
+
+  TypeProto float_type;
+  float_type.mutable_tensor_type()->set_elem_type(TensorProto_DataType_FLOAT);
+  float_type.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_value(4);
+  TypeProto int64_type;
+  int64_type.mutable_tensor_type()->set_elem_type(TensorProto_DataType_INT64);
+  int64_type.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_value(1);
+
+  auto& x = graph.GetOrCreateNodeArg("X", &float_type);
+  std::vector<NodeArg*> branch_outputs;
+  for (int branch = 0; branch < kNumBranches; ++branch) {
+    NodeArg* input = &x;
+    for (int i = 0; i <= branch; ++i) {
+      const std::string name = "B" + std::to_string(branch) + "_" + std::to_string(i);
+      auto& output = graph.GetOrCreateNodeArg(name, &float_type);
+      graph.AddNode(name, "Add", "", {input, input}, {&output});
+      input = &output;
+    }
+    branch_outputs.push_back(input);
+  }
+  auto& y = graph.GetOrCreateNodeArg("Y", &float_type);
+  graph.AddNode("sum", "Sum", "", branch_outputs, {&y});
+
+  auto& action = graph.GetOrCreateNodeArg("action", &int64_type);
+  auto& action_out = graph.GetOrCreateNodeArg("action_out", &int64_type);
+  graph.AddNode("test_op", TestOp::OpName, "", {&action}, {&action_out}, nullptr, TestOp::OpDomain);
+
+  graph.SetInputs({&x, &action});
+  graph.SetOutputs({&y, &action_out});
+  EXPECT_STATUS_OK(graph.Resolve());
+
+  std::string serialized;
+  model.ToProto().SerializeToString(&serialized);
+  std::stringstream stream(serialized);
+  EXPECT_STATUS_OK(session->Load(stream));
+  EXPECT_STATUS_OK(session->Initialize());
+  return session;
+}
+
+static Status RunFanOutFanIn(InferenceSession& session, const std::vector<float>& x, int64_t action,
+                             std::vector<OrtValue>& fetches) {
+  auto allocator = TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault);
+  std::vector<OrtValue> feeds(2);
+  CreateMLValue<float>(allocator, {4}, x, &feeds[0]);
+  CreateMLValue<int64_t>(allocator, {1}, {action}, &feeds[1]);
+  fetches.clear();
+  return session.Run(RunOptions(), {"X", "action"}, feeds, {"Y", "action_out"}, &fetches);
+}
+
+// runs the fan-out and fan-in from several threads at once, so that the nodes of concurrent runs are stolen by
+// the threads of the pool
+TEST(ParallelExecutor, TestWorkStealingFanOutFanIn) {
+  auto registry = std::make_shared<CustomRegistry>();
+  std::vector<OpSchema> schemas{TestOp::OpSchema()};
+  ASSERT_STATUS_OK(registry->RegisterOpSet(schemas, TestOp::OpDomain, 10, 11));
+  KernelCreateFn kernel_create_fn = [](FuncManager&, const OpKernelInfo& info, std::unique_ptr<OpKernel>& out) { out = std::make_unique<typename TestOp::OpKernelImpl>(info); return Status::OK(); };
+  auto kernel_def = TestOp::KernelDef();
+  ASSERT_STATUS_OK(registry->RegisterCustomKernel(kernel_def, kernel_create_fn));
+
+  auto session = CreateFanOutFanInSession(registry);
+  constexpr float kScale = static_cast<float>((1 << (kNumBranches + 1)) - 2);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&session, t]() {
+      for (int i = 0; i < 25; ++i) {
+        const std::vector<float> x = {static_cast<float>(t), static_cast<float>(i), -1.0f, 0.5f};
+        std::vector<OrtValue> fetches;
+        ASSERT_STATUS_OK(RunFanOutFanIn(*session, x, /*success*/ 0, fetches));
+        const float* y = fetches[0].Get<Tensor>().Data<float>();
+        for (size_t j = 0; j < x.size(); ++j) {
+          ASSERT_EQ(y[j], x[j] * kScale) << "run " << i << " of thread " << t;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // a failing branch stops the run, and the next runs are not affected
+  std::vector<OrtValue> fetches;
+  Status status = RunFanOutFanIn(*session, {1.0f, 2.0f, 3.0f, 4.0f}, /*failure*/ 1, fetches);
+  ASSERT_FALSE(status.IsOK());
+  EXPECT_THAT(status.ErrorMessage(), testing::HasSubstr("Action was 1"));
+
+  status = RunFanOutFanIn(*session, {1.0f, 2.0f, 3.0f, 4.0f}, /*exception*/ 2, fetches);
+  ASSERT_FALSE(status.IsOK());
+  EXPECT_THAT(status.ErrorMessage(), testing::HasSubstr("Throwing as action was 2"));
+
+  ASSERT_STATUS_OK(RunFanOutFanIn(*session, {1.0f, 2.0f, 3.0f, 4.0f}, /*success*/ 0, fetches));
+  EXPECT_EQ(fetches[0].Get<Tensor>().Data<float>()[3], 4.0f * kScale);
+}
+
 class ParallelExecutorThreadPoolTest : public testing::TestWithParam<int> {
 };
 
@@ -0,0 +1,170 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#if !defined(ORT_MINIMAL_BUILD)
+
+#include <sstream>
+#include <thread>
+
+#include "core/graph/model.h"
+#include "core/session/inference_session.h"
+#include "core/session/request_batcher.h"
+#include "test/framework/test_utils.h"
+#include "test/test_environment.h"
+#include "test/util/include/asserts.h"
+#include "gtest/gtest.h"
+
+using namespace ONNX_NAMESPACE;
+
+namespace onnxruntime {
+namespace test {
+
+namespace {
+
+void AddDim(TypeProto& type, int64_t value) {
+  type.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_value(value);
+}
+
+void AddDim(TypeProto& type, const std::string& param) {
+  type.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_param(param);
+}
+
+TypeProto TensorType(TensorProto_DataType elem_type) {
+  TypeProto type;
+  type.mutable_tensor_type()->set_elem_type(elem_type);
+  type.mutable_tensor_type()->mutable_shape();
+  return type;
+}
+
+// Y = X * X and Z = ReduceSum(X, axis 1), so that each output row only depends on the same input row.
+// X is [batch_size, n], or [2, n] if fixed_batch_size is set.
+std::unique_ptr<InferenceSession> CreateSession(bool fixed_batch_size = false) {
+  Model model("square", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+              std::unordered_map<std::string, int>{{kOnnxDomain, 12}}, std::vector<ONNX_NAMESPACE::FunctionProto>{},
+              DefaultLoggingManager().DefaultLogger());
+  Graph& graph = model.MainGraph();
+
+  TypeProto x_type = TensorType(TensorProto_DataType_FLOAT);
+  TypeProto z_type = TensorType(TensorProto_DataType_FLOAT);
+  if (fixed_batch_size) {
+    AddDim(x_type, 2);
+    AddDim(z_type, 2);
+  } else {
+    AddDim(x_type, "batch_size");
+    AddDim(z_type, "batch_size");
+  }
+  AddDim(x_type, "n");
+  AddDim(z_type, 1);
+
+  auto& x = graph.GetOrCreateNodeArg("X", &x_type);
+  auto& y = graph.GetOrCreateNodeArg("Y", &x_type);
+  auto& z = graph.GetOrCreateNodeArg("Z", &z_type);
+  graph.AddNode("square", "Mul", "", {&x, &x}, {&y});
+  graph.AddNode("sum", "ReduceSum", "", {&x}, {&z}).AddAttribute("axes", std::vector<int64_t>{1});
+  graph.SetInputs({&x});
+  graph.SetOutputs({&y, &z});
+  EXPECT_STATUS_OK(graph.Resolve());
+
+  std::string serialized;
+  model.ToProto().SerializeToString(&serialized);
+  std::stringstream stream(serialized);
+
+  auto session = std::make_unique<InferenceSession>(SessionOptions(), GetEnvironment());
+  EXPECT_STATUS_OK(session->Load(stream));
+  EXPECT_STATUS_OK(session->Initialize());
+  return session;
+}
+
+// Runs a request of `rows` rows of `n` values starting at `first` and checks its outputs.
+void RunAndCheck(RequestBatcher& batcher, int64_t rows, int64_t n, float first) {
+  std::vector<float> x;
+  for (int64_t i = 0; i < rows * n; ++i) {
+    x.push_back(first + static_cast<float>(i));
+  }
+
+  std::vector<OrtValue> feeds(1);
+  CreateMLValue<float>(TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault), {rows, n}, x, &feeds[0]);
+  std::vector<OrtValue> fetches;
+  ASSERT_STATUS_OK(batcher.Run(feeds, fetches));
+  ASSERT_EQ(fetches.size(), 2u);
+
+  const Tensor& y = fetches[0].Get<Tensor>();
+  ASSERT_EQ(y.Shape(), TensorShape({rows, n}));
+  const Tensor& z = fetches[1].Get<Tensor>();
+  ASSERT_EQ(z.Shape(), TensorShape({rows, 1}));
+  for (int64_t row = 0; row < rows; ++row) {
+    float sum = 0.0f;
+    for (int64_t i = 0; i < n; ++i) {
+      const float value = x[row * n + i];
+      EXPECT_EQ(y.Data<float>()[row * n + i], value * value);
+      sum += value;
+    }
+    EXPECT_EQ(z.Data<float>()[row], sum);
+  }
+}
+
+}  // namespace
+
+TEST(RequestBatcherTest, ConcurrentRequestsGetTheirOwnRows) {
+  RequestBatcherOptions options;
+  options.max_batch_size = 8;
+  options.max_delay_us = 2000;
+  std::unique_ptr<RequestBatcher> batcher;
+  ASSERT_STATUS_OK(RequestBatcher::Create(CreateSession(), options, batcher));
+
+  // Requests of 1 to 3 rows, and of 2 or 3 values per row which cannot be batched together.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 12; ++t) {
+    threads.emplace_back([&batcher, t]() {
+      for (int i = 0; i < 20; ++i) {
+        RunAndCheck(*batcher, 1 + (t + i) % 3, 2 + t % 2, static_cast<float>(100 * t + i));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(RequestBatcherTest, PadsToBucket) {
+  RequestBatcherOptions options;
+  options.max_batch_size = 8;
+  options.max_delay_us = 0;
+  options.pad_to_bucket = true;
+  std::unique_ptr<RequestBatcher> batcher;
+  ASSERT_STATUS_OK(RequestBatcher::Create(CreateSession(), options, batcher));
+
+  // 3 rows are run as 4 and 6 rows as 8, with the padding rows dropped.
+  RunAndCheck(*batcher, 3, 2, 1.0f);
+  RunAndCheck(*batcher, 6, 3, -4.0f);
+  // requests larger than max_batch_size are run alone and not padded
+  RunAndCheck(*batcher, 10, 2, 0.5f);
+}
+
+TEST(RequestBatcherTest, InvalidRequests) {
+  std::unique_ptr<RequestBatcher> batcher;
+  EXPECT_FALSE(RequestBatcher::Create(CreateSession(true), RequestBatcherOptions(), batcher).IsOK());
+
+  RequestBatcherOptions options;
+  options.max_batch_size = 0;
+  EXPECT_FALSE(RequestBatcher::Create(CreateSession(), options, batcher).IsOK());
+
+  ASSERT_STATUS_OK(RequestBatcher::Create(CreateSession(), RequestBatcherOptions(), batcher));
+  auto allocator = TestCPUExecutionProvider()->GetAllocator(0, OrtMemTypeDefault);
+  std::vector<OrtValue> fetches;
+
+  std::vector<OrtValue> feeds;
+  EXPECT_FALSE(batcher->Run(feeds, fetches).IsOK());
+
+  feeds.resize(1);
+  CreateMLValue<float>(allocator, {}, {1.0f}, &feeds[0]);
+  EXPECT_FALSE(batcher->Run(feeds, fetches).IsOK());
+
+  CreateMLValue<float>(allocator, {0, 2}, {}, &feeds[0]);
+  EXPECT_FALSE(batcher->Run(feeds, fetches).IsOK());
+}
+
+}  // namespace test
+}  // namespace onnxruntime
+
+#endif  // !defined(ORT_MINIMAL_BUILD)
@@ -0,0 +1,54 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <cstring>
+
+#include "core/framework/run_placement.h"
+#include "core/platform/env.h"
+#include "gtest/gtest.h"
+
+namespace onnxruntime {
+namespace test {
+
+TEST(RunPlacementTest, ReplacesThreadPoolAndAllocatorOfItsSession) {
+  concurrency::ThreadPool session_pool(&Env::Default(), ThreadOptions(), ORT_TSTR("session"), 2, true);
+  concurrency::ThreadPool node_pool(&Env::Default(), ThreadOptions(), ORT_TSTR("node"), 2, true);
+  concurrency::ThreadPool other_session_pool(&Env::Default(), ThreadOptions(), ORT_TSTR("other"), 2, true);
+
+  RunPlacement placement;
+  placement.session_thread_pool = &session_pool;
+  placement.thread_pool = &node_pool;
+  placement.cpu_allocator = std::make_shared<NumaNodeCPUAllocator>(0);
+  const OrtMemoryInfo& cpu_info = placement.cpu_allocator->Info();
+
+  EXPECT_EQ(RunPlacement::Current(), nullptr);
+  EXPECT_EQ(RunPlacement::GetThreadPool(&session_pool), &session_pool);
+  EXPECT_EQ(RunPlacement::GetAllocator(&session_pool, cpu_info), nullptr);
+
+  {
+    RunPlacement::Scope scope(&placement);
+    EXPECT_EQ(RunPlacement::Current(), &placement);
+    EXPECT_EQ(RunPlacement::GetThreadPool(&session_pool), &node_pool);
+    EXPECT_EQ(RunPlacement::GetAllocator(&session_pool, cpu_info), placement.cpu_allocator);
+
+    // other sessions and memory locations are not affected
+    EXPECT_EQ(RunPlacement::GetThreadPool(&other_session_pool), &other_session_pool);
+    EXPECT_EQ(RunPlacement::GetAllocator(&other_session_pool, cpu_info), nullptr);
+    EXPECT_EQ(RunPlacement::GetAllocator(&session_pool, OrtMemoryInfo(CPU, OrtArenaAllocator)), nullptr);
+
+    // an executor passing on a missing placement clears it
+    RunPlacement::Scope nested_scope(nullptr);
+    EXPECT_EQ(RunPlacement::GetThreadPool(&session_pool), &session_pool);
+  }
+
+  EXPECT_EQ(RunPlacement::Current(), nullptr);
+
+  // the allocation works whether or not the platform can place it
+  void* p = placement.cpu_allocator->Alloc(1 << 20);
+  ASSERT_NE(p, nullptr);
+  memset(p, 0, 1 << 20);
+  placement.cpu_allocator->Free(p);
+}
+
+}  // namespace test
+}  // namespace onnxruntime
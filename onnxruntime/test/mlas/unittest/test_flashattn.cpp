@@ -0,0 +1,151 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "test_util.h"
+
+template <bool Threaded>
+class MlasFlashAttentionTest : public MlasTestBase {
+ private:
+  MatrixGuardBuffer<float> BufferQuery;
+  MatrixGuardBuffer<float> BufferKey;
+  MatrixGuardBuffer<float> BufferValue;
+  MatrixGuardBuffer<float> BufferOutput;
+  MatrixGuardBuffer<float> BufferOutputReference;
+  MLAS_THREADPOOL* threadpool_;
+
+  void Test(size_t BatchCount, size_t HeadCount, size_t SequenceLength, size_t KvSequenceLength,
+            size_t QkHeadSize, size_t VHeadSize, bool Causal, size_t KvPadding = 0) {
+    // The key and value rows of a head are followed by KvPadding unused rows, like in a buffer that has room
+    // for more positions than are valid.
+    const size_t KeyHeadStride = (KvSequenceLength + KvPadding) * QkHeadSize;
+    const size_t ValueHeadStride = (KvSequenceLength + KvPadding) * VHeadSize;
+    const size_t BatchHeadCount = BatchCount * HeadCount;
+
+    float* Query = BufferQuery.GetBuffer(BatchHeadCount * SequenceLength * QkHeadSize);
+    float* Key = BufferKey.GetBuffer(BatchHeadCount * KeyHeadStride);
+    float* Value = BufferValue.GetBuffer(BatchHeadCount * ValueHeadStride);
+    float* Output = BufferOutput.GetBuffer(BatchHeadCount * SequenceLength * VHeadSize);
+    float* OutputReference = BufferOutputReference.GetBuffer(BatchHeadCount * SequenceLength * VHeadSize);
+
+    std::default_random_engine generator(static_cast<unsigned>(BatchHeadCount * SequenceLength * KvSequenceLength));
+    std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+
+    for (size_t i = 0; i < BatchHeadCount * SequenceLength * QkHeadSize; i++) {
+      Query[i] = distribution(generator);
+    }
+    for (size_t i = 0; i < BatchHeadCount * KeyHeadStride; i++) {
+      Key[i] = distribution(generator);
+    }
+    for (size_t i = 0; i < BatchHeadCount * ValueHeadStride; i++) {
+      Value[i] = distribution(generator);
+    }
+
+    MLAS_FLASH_ATTENTION_PARAMS Parameters;
+    Parameters.BatchCount = BatchCount;
+    Parameters.HeadCount = HeadCount;
+    Parameters.SequenceLength = SequenceLength;
+    Parameters.KvSequenceLength = KvSequenceLength;
+    Parameters.QkHeadSize = QkHeadSize;
+    Parameters.VHeadSize = VHeadSize;
+    Parameters.Scale = 1.0f / std::sqrt(float(QkHeadSize));
+    Parameters.Causal = Causal;
+    Parameters.Query = Query;
+    Parameters.Key = Key;
+    Parameters.KeyHeadStride = KeyHeadStride;
+    Parameters.Value = Value;
+    Parameters.ValueHeadStride = ValueHeadStride;
+    Parameters.Output = Output;
+
+    MlasFlashAttention(&Parameters, threadpool_);
+    ReferenceAttention(Parameters, OutputReference);
+
+    constexpr float AbsoluteTolerance = 1e-5f;
+    constexpr float RelativeTolerance = 1e-4f;
+
+    for (size_t i = 0; i < BatchHeadCount * SequenceLength * VHeadSize; i++) {
+      float diff = std::fabs(Output[i] - OutputReference[i]);
+      ASSERT_TRUE(diff <= AbsoluteTolerance || diff <= std::fabs(OutputReference[i]) * RelativeTolerance)
+          << "@" << i << " of B=" << BatchCount << " N=" << HeadCount << " S=" << SequenceLength
+          << " S*=" << KvSequenceLength << " H=" << QkHeadSize << "/" << VHeadSize << " Causal=" << Causal
+          << ", got: " << Output[i] << ", expecting: " << OutputReference[i];
+    }
+  }
+
+  static void ReferenceAttention(const MLAS_FLASH_ATTENTION_PARAMS& Parameters, float* Output) {
+    const size_t S = Parameters.SequenceLength;
+    const size_t SKv = Parameters.KvSequenceLength;
+    std::vector<double> Scores(SKv);
+
+    for (size_t bn = 0; bn < Parameters.BatchCount * Parameters.HeadCount; bn++) {
+      const size_t b = bn / Parameters.HeadCount;
+      const size_t n = bn % Parameters.HeadCount;
+      const float* Key = Parameters.Key + bn * Parameters.KeyHeadStride;
+      const float* Value = Parameters.Value + bn * Parameters.ValueHeadStride;
+
+      for (size_t s = 0; s < S; s++) {
+        const float* Query = Parameters.Query + (bn * S + s) * Parameters.QkHeadSize;
+        const size_t CountKv = Parameters.Causal ? SKv - S + s + 1 : SKv;
+
+        double Maximum = std::numeric_limits<double>::lowest();
+        for (size_t k = 0; k < CountKv; k++) {
+          double Dot = 0.0;
+          for (size_t h = 0; h < Parameters.QkHeadSize; h++) {
+            Dot += double(Query[h]) * double(Key[k * Parameters.QkHeadSize + h]);
+          }
+          Scores[k] = Dot * Parameters.Scale;
+          Maximum = (std::max)(Maximum, Scores[k]);
+        }
+
+        double Sum = 0.0;
+        for (size_t k = 0; k < CountKv; k++) {
+          Scores[k] = std::exp(Scores[k] - Maximum);
+          Sum += Scores[k];
+        }
+
+        float* Row = Output + ((b * S + s) * Parameters.HeadCount + n) * Parameters.VHeadSize;
+        for (size_t h = 0; h < Parameters.VHeadSize; h++) {
+          double Accumulation = 0.0;
+          for (size_t k = 0; k < CountKv; k++) {
+            Accumulation += Scores[k] * double(Value[k * Parameters.VHeadSize + h]);
+          }
+          Row[h] = float(Accumulation / Sum);
+        }
+      }
+    }
+  }
+
+ public:
+  static const char* GetTestSuiteName() {
+    static const std::string suite_name(Threaded ? "FlashAttention_Threaded" : "FlashAttention_SingleThread");
+    return suite_name.c_str();
+  }
+
+  MlasFlashAttentionTest() : threadpool_(Threaded ? GetMlasThreadPool() : nullptr) {}
+
+  void ExecuteShort(void) override {
+    for (bool Causal : {false, true}) {
+      Test(1, 1, 1, 1, 8, 8, Causal);
+      Test(2, 3, 5, 5, 16, 16, Causal);
+      Test(1, 2, 1, 37, 64, 64, Causal);
+      Test(2, 2, 33, 33, 64, 64, Causal);
+      Test(1, 4, 7, 300, 64, 32, Causal);
+      Test(1, 2, 70, 270, 32, 64, Causal, 5);
+      Test(2, 1, 40, 130, 24, 300, Causal);
+      Test(1, 1, 129, 129, 80, 80, Causal, 3);
+    }
+  }
+};
+
+template <> MlasFlashAttentionTest<false>* MlasTestFixture<MlasFlashAttentionTest<false>>::mlas_tester(nullptr);
+template <> MlasFlashAttentionTest<true>* MlasTestFixture<MlasFlashAttentionTest<true>>::mlas_tester(nullptr);
+
+static UNUSED_VARIABLE bool added_to_main = AddTestRegister([](bool is_short_execute) {
+  size_t count = 0;
+  if (is_short_execute) {
+    count += MlasDirectShortExecuteTests<MlasFlashAttentionTest<false>>::RegisterShortExecute();
+    if (GetMlasThreadPool() != nullptr) {
+      count += MlasDirectShortExecuteTests<MlasFlashAttentionTest<true>>::RegisterShortExecute();
+    }
+  }
+  return count;
+});
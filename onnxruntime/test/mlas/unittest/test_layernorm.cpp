@@ -0,0 +1,141 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "test_util.h"
+
+template <bool Threaded>
+class MlasLayerNormTest : public MlasTestBase {
+ private:
+  MatrixGuardBuffer<float> BufferInput;
+  MatrixGuardBuffer<float> BufferSkip;
+  MatrixGuardBuffer<float> BufferBias;
+  MatrixGuardBuffer<float> BufferGamma;
+  MatrixGuardBuffer<float> BufferBeta;
+  MatrixGuardBuffer<float> BufferOutput;
+  MatrixGuardBuffer<float> BufferOutputReference;
+  MatrixGuardBuffer<float> BufferMean;
+  MatrixGuardBuffer<float> BufferInvStdDev;
+  MLAS_THREADPOOL* threadpool_;
+
+  void Test(size_t N, size_t D, bool HasSkip, bool HasBias, bool HasBeta, bool Simplified) {
+    float* Input = BufferInput.GetBuffer(N * D);
+    float* Skip = BufferSkip.GetBuffer(N * D);
+    float* Bias = BufferBias.GetBuffer(D);
+    float* Gamma = BufferGamma.GetBuffer(D);
+    float* Beta = BufferBeta.GetBuffer(D);
+    float* Output = BufferOutput.GetBuffer(N * D);
+    float* OutputReference = BufferOutputReference.GetBuffer(N * D);
+    float* Mean = BufferMean.GetBuffer(N);
+    float* InvStdDev = BufferInvStdDev.GetBuffer(N);
+
+    std::default_random_engine generator(static_cast<unsigned>(N * D));
+    std::uniform_real_distribution<float> distribution(-4.0f, 4.0f);
+
+    for (size_t nd = 0; nd < N * D; nd++) {
+      Input[nd] = distribution(generator);
+      Skip[nd] = distribution(generator);
+    }
+    for (size_t d = 0; d < D; d++) {
+      Bias[d] = distribution(generator);
+      Gamma[d] = distribution(generator);
+      Beta[d] = distribution(generator);
+    }
+
+    MLAS_LAYER_NORM_PARAMS Parameters;
+    Parameters.N = N;
+    Parameters.D = D;
+    Parameters.Input = Input;
+    Parameters.Skip = HasSkip ? Skip : nullptr;
+    Parameters.Bias = HasBias ? Bias : nullptr;
+    Parameters.Gamma = Gamma;
+    Parameters.Beta = HasBeta ? Beta : nullptr;
+    Parameters.Output = Output;
+    Parameters.Mean = Mean;
+    Parameters.InvStdDev = InvStdDev;
+    Parameters.Epsilon = 1e-5f;
+    Parameters.Simplified = Simplified;
+
+    MlasComputeLayerNorm(&Parameters, threadpool_);
+
+    constexpr float AbsoluteTolerance = 1e-4f;
+    constexpr float RelativeTolerance = 1e-4f;
+
+    for (size_t n = 0; n < N; n++) {
+      double Sum = 0.0;
+      double SquareSum = 0.0;
+
+      for (size_t d = 0; d < D; d++) {
+        double Value = Input[n * D + d];
+        if (HasSkip) {
+          Value += Skip[n * D + d];
+        }
+        if (HasBias) {
+          Value += Bias[d];
+        }
+        OutputReference[n * D + d] = float(Value);
+        Sum += Value;
+        SquareSum += Value * Value;
+      }
+
+      double MeanReference = Simplified ? 0.0 : Sum / D;
+      double InvStdDevReference = 1.0 / std::sqrt(SquareSum / D - MeanReference * MeanReference + 1e-5);
+
+      for (size_t d = 0; d < D; d++) {
+        double Value = (OutputReference[n * D + d] - MeanReference) * InvStdDevReference * Gamma[d];
+        if (HasBeta) {
+          Value += Beta[d];
+        }
+        OutputReference[n * D + d] = float(Value);
+      }
+
+      if (!Simplified) {
+        ASSERT_NEAR(Mean[n], MeanReference, AbsoluteTolerance) << "row " << n << " " << N << "/" << D;
+      }
+      ASSERT_NEAR(InvStdDev[n], InvStdDevReference, InvStdDevReference * RelativeTolerance)
+          << "row " << n << " " << N << "/" << D;
+    }
+
+    for (size_t nd = 0; nd < N * D; nd++) {
+      float diff = std::fabs(Output[nd] - OutputReference[nd]);
+      ASSERT_TRUE(diff <= AbsoluteTolerance || diff <= std::fabs(OutputReference[nd]) * RelativeTolerance)
+          << "Skip:" << HasSkip << " Bias:" << HasBias << " Beta:" << HasBeta << " Simplified:" << Simplified
+          << " difference " << N << "/" << D << ", got: " << Output[nd] << ", expecting: " << OutputReference[nd];
+    }
+  }
+
+ public:
+  static const char* GetTestSuiteName() {
+    static const std::string suite_name(Threaded ? "LayerNorm_Threaded" : "LayerNorm_SingleThread");
+    return suite_name.c_str();
+  }
+
+  MlasLayerNormTest() : threadpool_(Threaded ? GetMlasThreadPool() : nullptr) {}
+
+  void ExecuteShort(void) override {
+    for (size_t d = 1; d < 80; d++) {
+      Test(3, d, true, true, true, false);
+      Test(2, d, false, false, false, true);
+    }
+
+    Test(17, 768, true, true, true, false);
+    Test(17, 768, true, false, true, false);
+    Test(17, 768, false, false, true, false);
+    Test(17, 768, false, false, false, false);
+    Test(33, 1024, true, true, false, true);
+    Test(128, 384, false, true, true, false);
+  }
+};
+
+template <> MlasLayerNormTest<false>* MlasTestFixture<MlasLayerNormTest<false>>::mlas_tester(nullptr);
+template <> MlasLayerNormTest<true>* MlasTestFixture<MlasLayerNormTest<true>>::mlas_tester(nullptr);
+
+static UNUSED_VARIABLE bool added_to_main = AddTestRegister([](bool is_short_execute) {
+  size_t count = 0;
+  if (is_short_execute) {
+    count += MlasDirectShortExecuteTests<MlasLayerNormTest<false>>::RegisterShortExecute();
+    if (GetMlasThreadPool() != nullptr) {
+      count += MlasDirectShortExecuteTests<MlasLayerNormTest<true>>::RegisterShortExecute();
+    }
+  }
+  return count;
+});
@@ -35,6 +35,7 @@
 #include "core/optimizer/div_mul_fusion.h"
 #include "core/optimizer/dropout_elimination.h"
 #include "core/optimizer/dynamic_quantize_matmul_fusion.h"
+#include "core/optimizer/elementwise_fusion.h"
 #include "core/optimizer/embed_layer_norm_fusion.h"
 #include "core/optimizer/expand_elimination.h"
 #include "core/optimizer/fast_gelu_fusion.h"
@@ -73,6 +74,7 @@
 #include "test/common/tensor_op_test_utils.h"
 #include "test/compare_ortvalue.h"
 #include "test/framework/test_utils.h"
+#include "test/optimizer/graph_transform_test_builder.h"
 #include "test/optimizer/graph_transform_test_fixture.h"
 #include "test/providers/provider_test_utils.h"
 #include "test/test_environment.h"
@@ -818,6 +820,338 @@ TEST_F(GraphTransformationTests, FuseCpuConvAdd) {
 
 #endif
 
+#if !defined(DISABLE_CONTRIB_OPS)
+// Returns the FusedElementwise nodes of the graph.
+static std::vector<const Node*> GetFusedElementwiseNodes(const Graph& graph) {
+  std::vector<const Node*> fused_nodes;
+  for (const auto& node : graph.Nodes()) {
+    if (node.OpType() == "FusedElementwise" && node.Domain() == kMSDomain) {
+      fused_nodes.push_back(&node);
+    }
+  }
+  return fused_nodes;
+}
+
+// Add->Sigmoid->Mul will be transformed to one FusedElementwise
+TEST_F(GraphTransformationTests, ElementwiseFusionChain) {
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* input_arg = builder.MakeInput<float>({2, 3, 4}, -3.f, 3.f);
+    auto* bias_arg = builder.MakeInitializer<float>({4}, -1.f, 1.f);
+    auto* add_out = builder.MakeIntermediate();
+    auto* sigmoid_out = builder.MakeIntermediate();
+    auto* output_arg = builder.MakeOutput();
+    builder.AddNode("Add", {input_arg, bias_arg}, {add_out});
+    builder.AddNode("Sigmoid", {add_out}, {sigmoid_out});
+    builder.AddNode("Mul", {sigmoid_out, input_arg}, {output_arg});
+  };
+
+  auto check_graph = [](InferenceSessionWrapper& session) {
+    const Graph& graph = session.GetGraph();
+    auto op_to_count = CountOpsInGraph(graph);
+    EXPECT_EQ(op_to_count["com.microsoft.FusedElementwise"], 1);
+    EXPECT_EQ(op_to_count["Add"], 0);
+    EXPECT_EQ(op_to_count["Sigmoid"], 0);
+    EXPECT_EQ(op_to_count["Mul"], 0);
+
+    auto fused_nodes = GetFusedElementwiseNodes(graph);
+    ASSERT_EQ(fused_nodes.size(), 1u);
+    const auto& attributes = fused_nodes[0]->GetAttributes();
+    const auto& ops = attributes.at("ops").strings();
+    EXPECT_EQ(std::vector<std::string>(ops.begin(), ops.end()), (std::vector<std::string>{"Add", "Sigmoid", "Mul"}));
+    // Values 0 and 1 are the input and the bias, 2 and 3 are the results of Add and Sigmoid.
+    const auto& operands = attributes.at("operands").ints();
+    EXPECT_EQ(std::vector<int64_t>(operands.begin(), operands.end()), (std::vector<int64_t>{0, 1, 2, -1, 3, 0}));
+  };
+
+  TransformerTester(build_test_case,
+                    check_graph,
+                    TransformerLevel::Level1,
+                    TransformerLevel::Level3,
+                    12 /*opset_version*/,
+                    1e-6 /*per_sample_tolerance*/,
+                    1e-6 /*relative_per_sample_tolerance*/,
+                    std::make_unique<ElementwiseFusion>());
+}
+
+// Exp->Sigmoid->Mul will be partly fused to Exp->FusedElementwise since Softmax also consumes the output of Exp
+TEST_F(GraphTransformationTests, ElementwiseFusionOutOfGroupConsumer) {
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* input_arg = builder.MakeInput<float>({2, 8}, -3.f, 3.f);
+    auto* exp_out = builder.MakeIntermediate();
+    auto* sigmoid_out = builder.MakeIntermediate();
+    auto* mul_out = builder.MakeOutput();
+    auto* softmax_out = builder.MakeOutput();
+    builder.AddNode("Exp", {input_arg}, {exp_out});
+    builder.AddNode("Sigmoid", {exp_out}, {sigmoid_out});
+    builder.AddNode("Mul", {sigmoid_out, input_arg}, {mul_out});
+    builder.AddNode("Softmax", {exp_out}, {softmax_out});
+  };
+
+  auto check_graph = [](InferenceSessionWrapper& session) {
+    const Graph& graph = session.GetGraph();
+    auto op_to_count = CountOpsInGraph(graph);
+    EXPECT_EQ(op_to_count["com.microsoft.FusedElementwise"], 1);
+    EXPECT_EQ(op_to_count["Exp"], 1);  // Exp remains
+    EXPECT_EQ(op_to_count["Softmax"], 1);
+    EXPECT_EQ(op_to_count["Sigmoid"], 0);
+    EXPECT_EQ(op_to_count["Mul"], 0);
+
+    auto fused_nodes = GetFusedElementwiseNodes(graph);
+    ASSERT_EQ(fused_nodes.size(), 1u);
+    const auto& operands = fused_nodes[0]->GetAttributes().at("operands").ints();
+    EXPECT_EQ(std::vector<int64_t>(operands.begin(), operands.end()), (std::vector<int64_t>{0, -1, 2, 1}));
+  };
+
+  TransformerTester(build_test_case,
+                    check_graph,
+                    TransformerLevel::Level1,
+                    TransformerLevel::Level3,
+                    12 /*opset_version*/,
+                    1e-6 /*per_sample_tolerance*/,
+                    1e-6 /*relative_per_sample_tolerance*/,
+                    std::make_unique<ElementwiseFusion>());
+}
+
+// Mul(x, x)->Sigmoid will be fused with the repeated input of Mul, the first node of the group, as one input
+TEST_F(GraphTransformationTests, ElementwiseFusionRepeatedInputOfFirstNode) {
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* input_arg = builder.MakeInput<float>({2, 8}, -3.f, 3.f);
+    auto* exp_out = builder.MakeIntermediate();
+    auto* mul_out = builder.MakeIntermediate();
+    auto* sigmoid_out = builder.MakeOutput();
+    auto* softmax_out = builder.MakeOutput();
+    builder.AddNode("Exp", {input_arg}, {exp_out});
+    builder.AddNode("Mul", {exp_out, exp_out}, {mul_out});
+    builder.AddNode("Sigmoid", {mul_out}, {sigmoid_out});
+    builder.AddNode("Softmax", {exp_out}, {softmax_out});
+  };
+
+  auto check_graph = [](InferenceSessionWrapper& session) {
+    const Graph& graph = session.GetGraph();
+    auto op_to_count = CountOpsInGraph(graph);
+    EXPECT_EQ(op_to_count["com.microsoft.FusedElementwise"], 1);
+    EXPECT_EQ(op_to_count["Exp"], 1);  // Exp remains
+    EXPECT_EQ(op_to_count["Mul"], 0);
+    EXPECT_EQ(op_to_count["Sigmoid"], 0);
+
+    auto fused_nodes = GetFusedElementwiseNodes(graph);
+    ASSERT_EQ(fused_nodes.size(), 1u);
+    const Node& fused_node = *fused_nodes[0];
+    ASSERT_EQ(fused_node.InputDefs().size(), 1u);
+    const auto& operands = fused_node.GetAttributes().at("operands").ints();
+    EXPECT_EQ(std::vector<int64_t>(operands.begin(), operands.end()), (std::vector<int64_t>{0, 0, 1, -1}));
+
+    // the edge from Exp goes to the only input of the fused node
+    ASSERT_EQ(fused_node.GetInputEdgesCount(), 1u);
+    EXPECT_EQ(fused_node.InputEdgesBegin()->GetNode().OpType(), "Exp");
+    EXPECT_EQ(fused_node.InputEdgesBegin()->GetDstArgIndex(), 0);
+  };
+
+  TransformerTester(build_test_case,
+                    check_graph,
+                    TransformerLevel::Level1,
+                    TransformerLevel::Level3,
+                    12 /*opset_version*/,
+                    1e-6 /*per_sample_tolerance*/,
+                    1e-6 /*relative_per_sample_tolerance*/,
+                    std::make_unique<ElementwiseFusion>());
+}
+
+// Exp->Sigmoid->Mul will be partly fused to Exp->FusedElementwise since the output of Exp is a graph output
+TEST_F(GraphTransformationTests, ElementwiseFusionGraphOutputProducer) {
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* input_arg = builder.MakeInput<float>({2, 8}, -3.f, 3.f);
+    auto* exp_out = builder.MakeOutput();
+    auto* sigmoid_out = builder.MakeIntermediate();
+    auto* mul_out = builder.MakeOutput();
+    builder.AddNode("Exp", {input_arg}, {exp_out});
+    builder.AddNode("Sigmoid", {exp_out}, {sigmoid_out});
+    builder.AddNode("Mul", {sigmoid_out, input_arg}, {mul_out});
+  };
+
+  auto check_graph = [](InferenceSessionWrapper& session) {
+    auto op_to_count = CountOpsInGraph(session.GetGraph());
+    EXPECT_EQ(op_to_count["com.microsoft.FusedElementwise"], 1);
+    EXPECT_EQ(op_to_count["Exp"], 1);  // Exp remains
+    EXPECT_EQ(op_to_count["Sigmoid"], 0);
+    EXPECT_EQ(op_to_count["Mul"], 0);
+  };
+
+  TransformerTester(build_test_case,
+                    check_graph,
+                    TransformerLevel::Level1,
+                    TransformerLevel::Level3,
+                    12 /*opset_version*/,
+                    1e-6 /*per_sample_tolerance*/,
+                    1e-6 /*relative_per_sample_tolerance*/,
+                    std::make_unique<ElementwiseFusion>());
+}
+
+// Add->Abs->Neg on int64 tensors will not be fused
+TEST_F(GraphTransformationTests, ElementwiseFusionSkipsNonFloat) {
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* input1_arg = builder.MakeInput<int64_t>({2, 8}, -100, 100);
+    auto* input2_arg = builder.MakeInput<int64_t>({2, 8}, -100, 100);
+    auto* add_out = builder.MakeIntermediate();
+    auto* abs_out = builder.MakeIntermediate();
+    auto* output_arg = builder.MakeOutput();
+    builder.AddNode("Add", {input1_arg, input2_arg}, {add_out});
+    builder.AddNode("Abs", {add_out}, {abs_out});
+    builder.AddNode("Neg", {abs_out}, {output_arg});
+  };
+
+  auto check_graph = [](InferenceSessionWrapper& session) {
+    auto op_to_count = CountOpsInGraph(session.GetGraph());
+    EXPECT_EQ(op_to_count["com.microsoft.FusedElementwise"], 0);
+    EXPECT_EQ(op_to_count["Add"], 1);
+    EXPECT_EQ(op_to_count["Abs"], 1);
+    EXPECT_EQ(op_to_count["Neg"], 1);
+  };
+
+  TransformerTester(build_test_case,
+                    check_graph,
+                    TransformerLevel::Level1,
+                    TransformerLevel::Level3,
+                    12 /*opset_version*/,
+                    0.0 /*per_sample_tolerance*/,
+                    0.0 /*relative_per_sample_tolerance*/,
+                    std::make_unique<ElementwiseFusion>());
+}
+
+// Add->Exp->Sigmoid->Tanh->Relu will be fused to FusedElementwise->Sigmoid->FusedElementwise
+// since Sigmoid is assigned to an execution provider that FusedElementwise is not compatible with
+TEST_F(GraphTransformationTests, ElementwiseFusionSkipsIncompatibleProvider) {
+  Model model("ElementwiseFusion", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+              {{kOnnxDomain, 12}, {kMSDomain, 1}}, {}, *logger_);
+  Graph& graph = model.MainGraph();
+  ModelTestBuilder builder(graph);
+  auto* input_arg = builder.MakeInput<float>({2, 8}, -3.f, 3.f);
+  auto* bias_arg = builder.MakeInitializer<float>({8}, -1.f, 1.f);
+  auto* add_out = builder.MakeIntermediate();
+  auto* exp_out = builder.MakeIntermediate();
+  auto* sigmoid_out = builder.MakeIntermediate();
+  auto* tanh_out = builder.MakeIntermediate();
+  auto* output_arg = builder.MakeOutput();
+  builder.AddNode("Add", {input_arg, bias_arg}, {add_out});
+  builder.AddNode("Exp", {add_out}, {exp_out});
+  auto& sigmoid_node = builder.AddNode("Sigmoid", {exp_out}, {sigmoid_out});
+  builder.AddNode("Tanh", {sigmoid_out}, {tanh_out});
+  builder.AddNode("Relu", {tanh_out}, {output_arg});
+  builder.SetGraphOutputs();
+  ASSERT_STATUS_OK(graph.Resolve());
+
+  for (auto& node : graph.Nodes()) {
+    node.SetExecutionProviderType(kCpuExecutionProvider);
+  }
+  sigmoid_node.SetExecutionProviderType(kCudaExecutionProvider);
+
+  onnxruntime::GraphTransformerManager graph_transformation_mgr{5};
+  ASSERT_STATUS_OK(graph_transformation_mgr.Register(
+      std::make_unique<ElementwiseFusion>(InlinedHashSet<std::string_view>{kCpuExecutionProvider}),
+      TransformerLevel::Level3));
+  ASSERT_STATUS_OK(graph_transformation_mgr.ApplyTransformers(graph, TransformerLevel::Level3, *logger_));
+
+  auto op_to_count = CountOpsInGraph(graph);
+  EXPECT_EQ(op_to_count["com.microsoft.FusedElementwise"], 2);
+  EXPECT_EQ(op_to_count["Sigmoid"], 1);  // Sigmoid remains
+  EXPECT_EQ(op_to_count["Add"], 0);
+  EXPECT_EQ(op_to_count["Exp"], 0);
+  EXPECT_EQ(op_to_count["Tanh"], 0);
+  EXPECT_EQ(op_to_count["Relu"], 0);
+  for (const Node* fused_node : GetFusedElementwiseNodes(graph)) {
+    EXPECT_EQ(fused_node->GetExecutionProviderType(), kCpuExecutionProvider);
+  }
+}
+
+// A chain of 40 unary operators will be fused to two FusedElementwise nodes of 8 and 32 operators
+TEST_F(GraphTransformationTests, ElementwiseFusionMaxFusedNodes) {
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    constexpr int num_nodes = 40;
+    NodeArg* value_arg = builder.MakeInput<float>({2, 8}, -3.f, 3.f);
+    for (int i = 0; i < num_nodes; i++) {
+      auto* output_arg = i == num_nodes - 1 ? builder.MakeOutput() : builder.MakeIntermediate();
+      builder.AddNode(i % 2 == 0 ? "Abs" : "Neg", {value_arg}, {output_arg});
+      value_arg = output_arg;
+    }
+  };
+
+  auto check_graph = [](InferenceSessionWrapper& session) {
+    const Graph& graph = session.GetGraph();
+    auto op_to_count = CountOpsInGraph(graph);
+    EXPECT_EQ(op_to_count["com.microsoft.FusedElementwise"], 2);
+    EXPECT_EQ(op_to_count["Abs"], 0);
+    EXPECT_EQ(op_to_count["Neg"], 0);
+
+    std::vector<int> fused_sizes;
+    for (const Node* fused_node : GetFusedElementwiseNodes(graph)) {
+      fused_sizes.push_back(fused_node->GetAttributes().at("ops").strings_size());
+    }
+    std::sort(fused_sizes.begin(), fused_sizes.end());
+    EXPECT_EQ(fused_sizes, (std::vector<int>{8, 32}));
+  };
+
+  TransformerTester(build_test_case,
+                    check_graph,
+                    TransformerLevel::Level1,
+                    TransformerLevel::Level3,
+                    12 /*opset_version*/,
+                    0.0 /*per_sample_tolerance*/,
+                    0.0 /*relative_per_sample_tolerance*/,
+                    std::make_unique<ElementwiseFusion>());
+}
+
+// A graph of broadcasting binary and transcendental operators will be fused to one FusedElementwise,
+// and it matches the unfused graph.
+TEST_F(GraphTransformationTests, ElementwiseFusionParity) {
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* input_arg = builder.MakeInput<float>({2, 3, 37}, -3.f, 3.f);
+    auto* scale_arg = builder.MakeInput<float>({3, 1}, 0.5f, 2.f);
+    auto* bias_arg = builder.MakeInitializer<float>({37}, -1.f, 1.f);
+    auto* offset_arg = builder.MakeScalarInitializer<float>(0.25f);
+    auto* add_out = builder.MakeIntermediate();
+    auto* sigmoid_out = builder.MakeIntermediate();
+    auto* mul_out = builder.MakeIntermediate();
+    auto* tanh_out = builder.MakeIntermediate();
+    auto* abs_out = builder.MakeIntermediate();
+    auto* offset_out = builder.MakeIntermediate();
+    auto* sqrt_out = builder.MakeIntermediate();
+    auto* div_out = builder.MakeIntermediate();
+    auto* erf_out = builder.MakeIntermediate();
+    auto* neg_out = builder.MakeIntermediate();
+    auto* exp_out = builder.MakeIntermediate();
+    auto* output_arg = builder.MakeOutput();
+    builder.AddNode("Add", {input_arg, bias_arg}, {add_out});
+    builder.AddNode("Sigmoid", {add_out}, {sigmoid_out});
+    builder.AddNode("Mul", {sigmoid_out, scale_arg}, {mul_out});
+    builder.AddNode("Tanh", {mul_out}, {tanh_out});
+    builder.AddNode("Abs", {input_arg}, {abs_out});
+    builder.AddNode("Add", {abs_out, offset_arg}, {offset_out});
+    builder.AddNode("Sqrt", {offset_out}, {sqrt_out});
+    builder.AddNode("Div", {tanh_out, sqrt_out}, {div_out});
+    builder.AddNode("Erf", {div_out}, {erf_out});
+    builder.AddNode("Neg", {input_arg}, {neg_out});
+    builder.AddNode("Exp", {neg_out}, {exp_out});
+    builder.AddNode("Max", {erf_out, exp_out}, {output_arg});
+  };
+
+  auto check_graph = [](InferenceSessionWrapper& session) {
+    const Graph& graph = session.GetGraph();
+    auto op_to_count = CountOpsInGraph(graph);
+    EXPECT_EQ(op_to_count["com.microsoft.FusedElementwise"], 1);
+    EXPECT_EQ(graph.NumberOfNodes(), 1);
+  };
+
+  TransformerTester(build_test_case,
+                    check_graph,
+                    TransformerLevel::Level1,
+                    TransformerLevel::Level3,
+                    12 /*opset_version*/,
+                    1e-5 /*per_sample_tolerance*/,
+                    1e-5 /*relative_per_sample_tolerance*/,
+                    std::make_unique<ElementwiseFusion>());
+}
+#endif
+
 #if !defined(DISABLE_CONTRIB_OPS)
 TEST_F(GraphTransformationTests, FuseConvActivation) {
 #ifdef USE_CUDA
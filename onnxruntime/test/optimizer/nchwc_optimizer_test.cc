@@ -1360,8 +1360,11 @@ TEST(NchwcOptimizerTests, Activation) {
       EXPECT_EQ(op_to_count["com.microsoft.nchwc.Conv"], 2);
       EXPECT_EQ(op_to_count["com.microsoft.nchwc.ReorderInput"], 1);
       EXPECT_EQ(op_to_count["com.microsoft.nchwc.ReorderOutput"], 1);
-      EXPECT_EQ(op_to_count[activation_op_type], 1);
-      EXPECT_EQ(op_to_count["Add"], 1);
+      // ElementwiseFusion runs after the NCHWc transformer and fuses the activation and the Add, which stay
+      // in the NCHWc format.
+      EXPECT_EQ(op_to_count[activation_op_type], 0);
+      EXPECT_EQ(op_to_count["Add"], 0);
+      EXPECT_EQ(op_to_count["com.microsoft.FusedElementwise"], 1);
     };
 
     NchwcOptimizerTester(build_test_case, check_nchwc_graph);
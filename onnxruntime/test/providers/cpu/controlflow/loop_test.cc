@@ -1038,6 +1038,168 @@ TEST(Loop, IterationCountAsOutput) {
   test.Run(OpTester::ExpectResult::kExpectSuccess, "", {kTensorrtExecutionProvider});
 }
 
+// many iterations with an unknown trip count so the scan output buffer has to grow, and a loop carried variable
+// with the same shape in each iteration so the subgraph writes it into alternating buffers.
+TEST(Loop, ScanOutputGrowthAndStableLoopCarriedVar) {
+  constexpr int64_t kIterations = 100;
+
+  auto create_subgraph = []() {
+    Model model("Loop with stable shapes", false, DefaultLoggingManager().DefaultLogger());
+    auto& graph = model.MainGraph();
+
+    /* Inputs: iter_num, cond_in, loop_var_0_in
+
+         iter_num_in  limit     loop_var_0_in  one       loop_var_0_in
+              \       /                 \      /              |
+               [Less]                    [Add]              [Mul] (squared)
+                 |                         |                  |
+              cond_out              loop_var_0_out        scan_out_0
+    */
+
+    TypeProto int64_scalar;
+    int64_scalar.mutable_tensor_type()->set_elem_type(TensorProto_DataType_INT64);
+    int64_scalar.mutable_tensor_type()->mutable_shape();
+
+    TypeProto bool_scalar;
+    bool_scalar.mutable_tensor_type()->set_elem_type(TensorProto_DataType_BOOL);
+    bool_scalar.mutable_tensor_type()->mutable_shape();
+
+    TypeProto float_tensor;
+    float_tensor.mutable_tensor_type()->set_elem_type(TensorProto_DataType_FLOAT);
+    float_tensor.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_value(2);
+
+    auto& iter_num_in = graph.GetOrCreateNodeArg("iter_num_in", &int64_scalar);
+    auto& cond_in = graph.GetOrCreateNodeArg("cond_in", &bool_scalar);
+    auto& loop_var_0_in = graph.GetOrCreateNodeArg("loop_var_0_in", &float_tensor);
+    auto& limit = graph.GetOrCreateNodeArg("limit", &int64_scalar);
+    auto& one = graph.GetOrCreateNodeArg("one", &float_tensor);
+
+    auto& cond_out = graph.GetOrCreateNodeArg("cond_out", &bool_scalar);
+    auto& loop_var_0_out = graph.GetOrCreateNodeArg("loop_var_0_out", &float_tensor);
+    auto& scan_out_0 = graph.GetOrCreateNodeArg("scan_out_0", &float_tensor);
+
+    TensorProto limit_proto;
+    limit_proto.set_name("limit");
+    limit_proto.set_data_type(TensorProto_DataType_INT64);
+    limit_proto.add_int64_data(kIterations - 1);
+    graph.AddInitializedTensor(limit_proto);
+
+    TensorProto one_proto;
+    one_proto.set_name("one");
+    one_proto.set_data_type(TensorProto_DataType_FLOAT);
+    one_proto.add_dims(2);
+    one_proto.add_float_data(1.f);
+    one_proto.add_float_data(1.f);
+    graph.AddInitializedTensor(one_proto);
+
+    graph.AddNode("less", "Less", "Continue until iter_num reaches limit", {&iter_num_in, &limit}, {&cond_out});
+    graph.AddNode("add", "Add", "Increment loop_var_0", {&loop_var_0_in, &one}, {&loop_var_0_out});
+    graph.AddNode("mul", "Mul", "Square loop_var_0", {&loop_var_0_in, &loop_var_0_in}, {&scan_out_0});
+
+    graph.SetInputs({&iter_num_in, &cond_in, &loop_var_0_in});
+    graph.SetOutputs({&cond_out, &loop_var_0_out, &scan_out_0});
+
+    auto status = graph.Resolve();
+    EXPECT_EQ(status, Status::OK());
+
+    return graph.ToGraphProto();
+  };
+
+  OpTester test("Loop", 13);
+  auto body = create_subgraph();
+  test.AddAttribute<GraphProto>("body", body);
+  test.AddOptionalInputEdge<int64_t>();  // no 'M' so the trip count is unknown
+  test.AddInput<bool>("cond", {}, {true});
+  test.AddInput<float>("loop_var_0_orig", {2}, {0.f, 1.f});
+
+  std::vector<float> scan_out_0;
+  for (int64_t i = 0; i < kIterations; ++i) {
+    scan_out_0.push_back(static_cast<float>(i * i));
+    scan_out_0.push_back(static_cast<float>((i + 1) * (i + 1)));
+  }
+
+  test.AddOutput<float>("loop_var_0_final", {2},
+                        {static_cast<float>(kIterations), static_cast<float>(kIterations + 1)});
+  test.AddOutput<float>("scan_out_0_final", {kIterations, 2}, scan_out_0);
+
+  // Disable TensorRT on unsupported data type BOOL
+  test.Run(OpTester::ExpectResult::kExpectSuccess, "", {kTensorrtExecutionProvider});
+}
+
+// a loop carried variable whose input and output declare the same dim symbol but whose shape grows in each
+// iteration, so it must not be written to a buffer with the shape of its feed.
+TEST(Loop, LoopCarriedVarWithSameSymbolicDimsChangesShape) {
+  auto create_subgraph = []() {
+    Model model("Loop with growing loop carried var", false, DefaultLoggingManager().DefaultLogger());
+    auto& graph = model.MainGraph();
+
+    /* Inputs: iter_num, cond, loop_var_0_in
+
+                cond_in      loop_var_0_in  one
+                   |                  \      /
+               [Identity]             [Concat]
+                   |                     |
+                cond_out          loop_var_0_out
+    */
+
+    TypeProto int64_scalar;
+    int64_scalar.mutable_tensor_type()->set_elem_type(TensorProto_DataType_INT64);
+    int64_scalar.mutable_tensor_type()->mutable_shape();
+
+    TypeProto bool_scalar;
+    bool_scalar.mutable_tensor_type()->set_elem_type(TensorProto_DataType_BOOL);
+    bool_scalar.mutable_tensor_type()->mutable_shape();
+
+    TypeProto float_tensor;
+    float_tensor.mutable_tensor_type()->set_elem_type(TensorProto_DataType_FLOAT);
+    float_tensor.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_param("N");
+
+    TypeProto float_one;
+    float_one.mutable_tensor_type()->set_elem_type(TensorProto_DataType_FLOAT);
+    float_one.mutable_tensor_type()->mutable_shape()->add_dim()->set_dim_value(1);
+
+    auto& iter_num_in = graph.GetOrCreateNodeArg("iter_num_in", &int64_scalar);
+    auto& cond_in = graph.GetOrCreateNodeArg("cond_in", &bool_scalar);
+    auto& loop_var_0_in = graph.GetOrCreateNodeArg("loop_var_0_in", &float_tensor);
+    auto& one = graph.GetOrCreateNodeArg("one", &float_one);
+
+    auto& cond_out = graph.GetOrCreateNodeArg("cond_out", &bool_scalar);
+    auto& loop_var_0_out = graph.GetOrCreateNodeArg("loop_var_0_out", &float_tensor);
+
+    TensorProto one_proto;
+    one_proto.set_name("one");
+    one_proto.set_data_type(TensorProto_DataType_FLOAT);
+    one_proto.add_dims(1);
+    one_proto.add_float_data(1.f);
+    graph.AddInitializedTensor(one_proto);
+
+    graph.AddNode("cond", "Identity", "Forward cond", {&cond_in}, {&cond_out});
+    auto& concat = graph.AddNode("concat", "Concat", "Append one to loop_var_0", {&loop_var_0_in, &one},
+                                 {&loop_var_0_out});
+    concat.AddAttribute("axis", int64_t{0});
+
+    graph.SetInputs({&iter_num_in, &cond_in, &loop_var_0_in});
+    graph.SetOutputs({&cond_out, &loop_var_0_out});
+
+    auto status = graph.Resolve();
+    EXPECT_EQ(status, Status::OK());
+
+    return graph.ToGraphProto();
+  };
+
+  OpTester test("Loop", 13);
+  auto body = create_subgraph();
+  test.AddAttribute<GraphProto>("body", body);
+  test.AddInput<int64_t>("M", {1}, {3});
+  test.AddInput<bool>("cond", {}, {true});
+  test.AddInput<float>("loop_var_0_orig", {1}, {0.f});
+
+  test.AddOutput<float>("loop_var_0_final", {4}, {0.f, 1.f, 1.f, 1.f});
+
+  // Disable TensorRT on unsupported data type BOOL
+  test.Run(OpTester::ExpectResult::kExpectSuccess, "", {kTensorrtExecutionProvider});
+}
+
 #ifdef USE_CUDA
 // test that when part of the subgraph run on CUDA it executes successfully
 TEST(Loop, MixedExecutionProviders) {
@@ -1,8 +1,13 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <cmath>
+#include <limits>
+
 #include "gtest/gtest.h"
 #include "test/providers/provider_test_utils.h"
+#include "test/util/include/scoped_env_vars.h"
+#include "core/providers/cpu/ml/tree_ensemble_common.h"
 
 namespace onnxruntime {
 namespace test {
@@ -676,5 +681,185 @@ TEST(MLOpTest, TreeRegressorSingleTargetSum_as_tensor_precision) {
   GenTreeAndRunTest1_as_tensor_precision(3);
 }
 
+void GenTreeAndRunTestChains(int64_t n_obs, int n_trees, bool missing_value_tracks) {
+  // Each tree is a chain of decision nodes whose true branches end in leaves. The hitrates favour the
+  // deeper branch in one tree out of two. With missing_value_tracks, missing values follow the true branch
+  // on even nodes, otherwise the small trees of only BRANCH_LEQ nodes are evaluated with the QuickScorer.
+  OpTester test("TreeEnsembleRegressor", 3, onnxruntime::kMLDomain);
+  const int64_t n_features = 3;
+
+  std::vector<int64_t> lefts, rights, treeids, nodeids, featureids, missing_tracks;
+  std::vector<float> thresholds, hitrates;
+  std::vector<std::string> modes;
+  std::vector<int64_t> target_treeids, target_nodeids, target_classids;
+  std::vector<float> target_weights;
+  for (int t = 0; t < n_trees; ++t) {
+    const int64_t depth = 2 + t % 5;
+    for (int64_t k = 0; k <= 2 * depth; ++k) {
+      const bool is_leaf = k >= depth;
+      treeids.push_back(t);
+      nodeids.push_back(k);
+      lefts.push_back(is_leaf ? 0 : depth + k);
+      rights.push_back(is_leaf ? 0 : (k + 1 < depth ? k + 1 : 2 * depth));
+      featureids.push_back(is_leaf ? 0 : (t + k) % n_features);
+      thresholds.push_back(is_leaf ? 0.f : 0.1f * static_cast<float>(k - depth / 2) + 0.01f * static_cast<float>(t % 3));
+      modes.push_back(is_leaf ? "LEAF" : "BRANCH_LEQ");
+      missing_tracks.push_back(!is_leaf && missing_value_tracks && k % 2 == 0 ? 1 : 0);
+      hitrates.push_back((t % 2 == 0) == (is_leaf && k != 2 * depth) ? 0.9f : 0.1f);
+      if (is_leaf) {
+        for (int64_t c = 0; c < 2; ++c) {
+          target_treeids.push_back(t);
+          target_nodeids.push_back(k);
+          target_classids.push_back(c);
+          target_weights.push_back(c == 0 ? 0.5f * static_cast<float>(t + 1) + 0.25f * static_cast<float>(k)
+                                          : -0.125f * static_cast<float>(k));
+        }
+      }
+    }
+  }
+
+  std::vector<float> X(n_obs * n_features);
+  for (size_t i = 0; i < X.size(); ++i) {
+    X[i] = i % 13 == 5 ? std::numeric_limits<float>::quiet_NaN()
+                       : static_cast<float>((i * 7) % 11) / 10.f - 0.5f;
+  }
+
+  std::vector<float> Y(n_obs * 2, 0.f);
+  for (int64_t i = 0; i < n_obs; ++i) {
+    size_t first = 0;
+    for (int t = 0; t < n_trees; ++t) {
+      const int64_t depth = 2 + t % 5;
+      int64_t k = 0;
+      while (k < depth) {
+        float val = X[i * n_features + featureids[first + k]];
+        bool cond = val <= thresholds[first + k] || (missing_tracks[first + k] == 1 && std::isnan(val));
+        k = cond ? lefts[first + k] : rights[first + k];
+      }
+      Y[i * 2] += 0.5f * static_cast<float>(t + 1) + 0.25f * static_cast<float>(k);
+      Y[i * 2 + 1] += -0.125f * static_cast<float>(k);
+      first += 2 * depth + 1;
+    }
+  }
+
+  test.AddAttribute("nodes_truenodeids", lefts);
+  test.AddAttribute("nodes_falsenodeids", rights);
+  test.AddAttribute("nodes_treeids", treeids);
+  test.AddAttribute("nodes_nodeids", nodeids);
+  test.AddAttribute("nodes_featureids", featureids);
+  test.AddAttribute("nodes_values", thresholds);
+  test.AddAttribute("nodes_hitrates", hitrates);
+  test.AddAttribute("nodes_missing_value_tracks_true", missing_tracks);
+  test.AddAttribute("nodes_modes", modes);
+  test.AddAttribute("target_treeids", target_treeids);
+  test.AddAttribute("target_nodeids", target_nodeids);
+  test.AddAttribute("target_ids", target_classids);
+  test.AddAttribute("target_weights", target_weights);
+  test.AddAttribute("n_targets", (int64_t)2);
+
+  test.AddInput<float>("X", {n_obs, n_features}, X);
+  test.AddOutput<float>("Y", {n_obs, 2}, Y);
+  test.Run();
+}
+
+TEST(MLOpTest, TreeRegressorChainsBatch) {
+  // row counts below, between and above the number of traversals walked together
+  for (bool missing_value_tracks : {true, false}) {
+    GenTreeAndRunTestChains(1, 11, missing_value_tracks);
+    GenTreeAndRunTestChains(13, 11, missing_value_tracks);
+    GenTreeAndRunTestChains(67, 11, missing_value_tracks);
+    GenTreeAndRunTestChains(1, 100, missing_value_tracks);
+    GenTreeAndRunTestChains(67, 100, missing_value_tracks);
+  }
+}
+
+void GenTreeAndRunTestBalanced(int64_t n_obs, const std::vector<int64_t>& depths) {
+  // Each tree is a complete binary tree whose nodes are numbered level by level, node k has the children
+  // 2k + 1 (true) and 2k + 2 (false). A tree of depth 6 has 64 leaves, the most a leaf mask holds.
+  OpTester test("TreeEnsembleRegressor", 3, onnxruntime::kMLDomain);
+  const int64_t n_features = 5;
+
+  std::vector<int64_t> lefts, rights, treeids, nodeids, featureids;
+  std::vector<float> thresholds;
+  std::vector<std::string> modes;
+  std::vector<int64_t> target_treeids, target_nodeids, target_classids;
+  std::vector<float> target_weights;
+  for (size_t t = 0; t < depths.size(); ++t) {
+    const int64_t n_decisions = (int64_t(1) << depths[t]) - 1;
+    for (int64_t k = 0; k < 2 * n_decisions + 1; ++k) {
+      const bool is_leaf = k >= n_decisions;
+      treeids.push_back(static_cast<int64_t>(t));
+      nodeids.push_back(k);
+      lefts.push_back(is_leaf ? 0 : 2 * k + 1);
+      rights.push_back(is_leaf ? 0 : 2 * k + 2);
+      featureids.push_back(is_leaf ? 0 : (static_cast<int64_t>(t) + k) % n_features);
+      thresholds.push_back(is_leaf ? 0.f : static_cast<float>((k * 37 + static_cast<int64_t>(t) * 11) % 19) / 20.f - 0.45f);
+      modes.push_back(is_leaf ? "LEAF" : "BRANCH_LEQ");
+      if (is_leaf) {
+        target_treeids.push_back(static_cast<int64_t>(t));
+        target_nodeids.push_back(k);
+        target_classids.push_back(0);
+        target_weights.push_back(static_cast<float>(k - n_decisions + 1000 * static_cast<int64_t>(t)));
+      }
+    }
+  }
+
+  // The first row fails every condition and exits on the last leaf, the second one on the first leaf.
+  std::vector<float> X(n_obs * n_features);
+  for (size_t i = 0; i < X.size(); ++i) {
+    const size_t row = i / n_features;
+    X[i] = row == 0 ? 1.f : (row == 1 ? -1.f : static_cast<float>((i * 7919) % 101) / 100.f - 0.5f);
+  }
+
+  // expected values from walking the trees node by node
+  std::vector<float> Y(n_obs, 0.f);
+  for (int64_t i = 0; i < n_obs; ++i) {
+    size_t first = 0;
+    for (size_t t = 0; t < depths.size(); ++t) {
+      const int64_t n_decisions = (int64_t(1) << depths[t]) - 1;
+      int64_t k = 0;
+      while (k < n_decisions) {
+        k = X[i * n_features + featureids[first + k]] <= thresholds[first + k] ? lefts[first + k] : rights[first + k];
+      }
+      Y[i] += static_cast<float>(k - n_decisions + 1000 * static_cast<int64_t>(t));
+      first += 2 * n_decisions + 1;
+    }
+  }
+
+  test.AddAttribute("nodes_truenodeids", lefts);
+  test.AddAttribute("nodes_falsenodeids", rights);
+  test.AddAttribute("nodes_treeids", treeids);
+  test.AddAttribute("nodes_nodeids", nodeids);
+  test.AddAttribute("nodes_featureids", featureids);
+  test.AddAttribute("nodes_values", thresholds);
+  test.AddAttribute("nodes_modes", modes);
+  test.AddAttribute("target_treeids", target_treeids);
+  test.AddAttribute("target_nodeids", target_nodeids);
+  test.AddAttribute("target_ids", target_classids);
+  test.AddAttribute("target_weights", target_weights);
+  test.AddAttribute("n_targets", (int64_t)1);
+
+  test.AddInput<float>("X", {n_obs, n_features}, X);
+  test.AddOutput<float>("Y", {n_obs, 1}, Y);
+  test.Run();
+}
+
+TEST(MLOpTest, TreeRegressorBalancedBatch) {
+  // Balanced trees of 64 leaves are walked node by node by default.
+  GenTreeAndRunTestBalanced(67, {6, 6, 6});
+  GenTreeAndRunTestBalanced(67, {3, 5, 6});
+
+  // Lifting the limit on the decision nodes per depth evaluates trees of up to 64 leaves with the QuickScorer,
+  // deeper trees still fall back to the node walk.
+  ScopedEnvironmentVariables scoped_env_vars{
+      EnvVarMap{
+          {onnxruntime::ml::detail::tree_ensemble::kQuickScorerMaxNodesPerDepth, "64"},
+      }};
+  GenTreeAndRunTestBalanced(1, {6});
+  GenTreeAndRunTestBalanced(67, {6, 6, 6});
+  GenTreeAndRunTestBalanced(67, {3, 5, 6});
+  GenTreeAndRunTestBalanced(67, {6, 7});
+  GenTreeAndRunTestBalanced(67, {9});
+}
+
 }  // namespace test
 }  // namespace onnxruntime
@@ -4512,5 +4512,58 @@ TEST(ReductionOpTest, ReduceSum_RKRK_keepdims) {
   test.Run();
 }
 
+TEST(ReductionOpTest, ReduceL2_KRK) {
+  OpTester test("ReduceL2");
+  test.AddAttribute("axes", std::vector<int64_t>{1});
+  test.AddAttribute("keepdims", (int64_t)0);
+  test.AddInput<float>("data", {3, 2, 2},
+                       {1.0f, 2.0f,
+                        3.0f, 4.0f,
+
+                        5.0f, 6.0f,
+                        7.0f, 8.0f,
+
+                        9.0f, 10.0f,
+                        11.0f, 12.0f});
+  test.AddOutput<float>("reduced", {3, 2}, {3.16227766f, 4.47213595f, 8.60232527f, 10.0f, 14.2126704f, 15.62049935f});
+  test.Run();
+}
+
+TEST(ReductionOpTest, ReduceLogSumExp_KR) {
+  OpTester test("ReduceLogSumExp");
+  test.AddAttribute("axes", std::vector<int64_t>{1});
+  test.AddAttribute("keepdims", (int64_t)0);
+  test.AddInput<float>("data", {2, 3},
+                       {1.0f, 2.0f, 3.0f,
+                        4.0f, 5.0f, 6.0f});
+  test.AddOutput<float>("reduced", {2}, {3.407606f, 6.407606f});
+  test.Run();
+}
+
+TEST(ReductionOpTest, ReduceLogSumExp_RK) {
+  OpTester test("ReduceLogSumExp");
+  test.AddAttribute("axes", std::vector<int64_t>{0});
+  test.AddAttribute("keepdims", (int64_t)1);
+  test.AddInput<float>("data", {2, 8},
+                       {0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+                        8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f});
+  test.AddOutput<float>("reduced", {1, 8},
+                        {8.000335f, 9.000335f, 10.000335f, 11.000335f,
+                         12.000335f, 13.000335f, 14.000335f, 15.000335f});
+  test.Run();
+}
+
+TEST(ReductionOpTest, ReduceMean_RKR_dim_one) {
+  // The kept dimension is equal to 1, the reduction is done on all values.
+  OpTester test("ReduceMean");
+  test.AddAttribute("axes", std::vector<int64_t>{0, 2});
+  test.AddAttribute("keepdims", (int64_t)1);
+  test.AddInput<float>("data", {2, 1, 3},
+                       {1.0f, 2.0f, 3.0f,
+                        4.0f, 5.0f, 6.0f});
+  test.AddOutput<float>("reduced", {1, 1, 1}, {3.5f});
+  test.Run();
+}
+
 }  // namespace test
 }  // namespace onnxruntime
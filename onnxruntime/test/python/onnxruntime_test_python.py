@@ -13,7 +13,7 @@ import numpy as np
 from helper import get_name
 
 import onnxruntime as onnxrt
-from onnxruntime.capi.onnxruntime_pybind11_state import Fail
+from onnxruntime.capi.onnxruntime_pybind11_state import Fail, InvalidArgument
 
 # handle change from python 3.8 and on where loading a dll from the current directory needs to be explicitly allowed.
 if platform.system() == "Windows" and sys.version_info.major >= 3 and sys.version_info.minor >= 8:
@@ -368,6 +368,34 @@ class TestInferenceSession(unittest.TestCase):
         output_expected = np.array([[1.0, 4.0], [9.0, 16.0], [25.0, 36.0]], dtype=np.float32)
         np.testing.assert_allclose(output_expected, res[0], rtol=1e-05, atol=1e-08)
 
+    def testRunPrepared(self):
+        sess = onnxrt.InferenceSession(get_name("mul_1.onnx"), providers=["CPUExecutionProvider"])
+        x = np.array([[1.0, 2.0], [3.0, 4.0], [5.0, 6.0]], dtype=np.float32)
+        output_expected = np.array([[1.0, 4.0], [9.0, 16.0], [25.0, 36.0]], dtype=np.float32)
+
+        prepared = sess.prepare_run(["X"], ["Y"])
+        self.assertEqual(prepared.input_names, ["X"])
+        self.assertEqual(prepared.output_names, ["Y"])
+        for _ in range(2):
+            res = sess.run_prepared(prepared, [x])
+            np.testing.assert_allclose(output_expected, res[0], rtol=1e-05, atol=1e-08)
+
+        # all the outputs of the model by default
+        self.assertEqual(sess.prepare_run(["X"]).output_names, ["Y"])
+
+        with self.assertRaises(RuntimeError):
+            sess.run_prepared(prepared, [x, x])
+        with self.assertRaises(InvalidArgument):
+            sess.prepare_run(["Z"], ["Y"])
+
+        # set_providers creates a new session, which doesn't accept the names prepared by the previous one
+        sess.set_providers(["CPUExecutionProvider"])
+        with self.assertRaises(InvalidArgument) as context:
+            sess.run_prepared(prepared, [x])
+        self.assertIn("prepared by another session", str(context.exception))
+        res = sess.run_prepared(sess.prepare_run(["X"], ["Y"]), [x])
+        np.testing.assert_allclose(output_expected, res[0], rtol=1e-05, atol=1e-08)
+
     def testRunModelFromBytes(self):
         with open(get_name("mul_1.onnx"), "rb") as f:
             content = f.read()
@@ -251,6 +251,121 @@ TEST(CApiTest, dim_param) {
   ASSERT_EQ(strcmp(dim_param, ""), 0);
 }
 
+TEST(CApiTest, PrepareRun) {
+  Ort::Session session(*ort_env, MODEL_URI, Ort::SessionOptions{});
+  const char* const input_names[] = {"X"};
+  const char* const output_names[] = {"Y"};
+  Ort::PreparedRun prepared_run = session.PrepareRun(input_names, 1, output_names, 1);
+
+  auto memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+  std::vector<float> x = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+  std::vector<int64_t> dims = {3, 2};
+  Ort::Value input = Ort::Value::CreateTensor<float>(memory_info, x.data(), x.size(), dims.data(), dims.size());
+  const std::vector<float> expected_y = {1.0f, 4.0f, 9.0f, 16.0f, 25.0f, 36.0f};
+
+  // outputs allocated by the run
+  for (int i = 0; i < 2; ++i) {
+    auto outputs = session.Run(Ort::RunOptions{}, prepared_run, &input, 1, 1);
+    ASSERT_EQ(outputs.size(), 1u);
+    ASSERT_EQ(outputs[0].GetTensorTypeAndShapeInfo().GetShape(), dims);
+    const float* y = outputs[0].GetTensorData<float>();
+    ASSERT_EQ(std::vector<float>(y, y + expected_y.size()), expected_y);
+  }
+
+  // outputs given by the caller
+  std::vector<float> y(expected_y.size());
+  Ort::Value output = Ort::Value::CreateTensor<float>(memory_info, y.data(), y.size(), dims.data(), dims.size());
+  session.Run(Ort::RunOptions{}, prepared_run, &input, 1, &output, 1);
+  ASSERT_EQ(y, expected_y);
+
+  const auto& api = Ort::GetApi();
+  const char* const invalid_names[] = {"Z"};
+  OrtPreparedRun* invalid_run = nullptr;
+  OrtStatus* status = api.PrepareRun(session, invalid_names, 1, output_names, 1, &invalid_run);
+  ASSERT_NE(status, nullptr);
+  EXPECT_EQ(api.GetErrorCode(status), ORT_INVALID_ARGUMENT);
+  api.ReleaseStatus(status);
+
+  // the names prepared by one session are not accepted by another one
+  Ort::Session other_session(*ort_env, MODEL_URI, Ort::SessionOptions{});
+  try {
+    other_session.Run(Ort::RunOptions{}, prepared_run, &input, 1, 1);
+    FAIL() << "Run with the names prepared by another session should have failed";
+  } catch (const Ort::Exception& e) {
+    EXPECT_EQ(e.GetOrtErrorCode(), ORT_INVALID_ARGUMENT);
+    EXPECT_NE(std::string(e.what()).find("prepared by another session"), std::string::npos) << e.what();
+  }
+}
+
+namespace {
+struct RunAsyncResult {
+  std::promise<void> done;
+  OrtValue** outputs = nullptr;
+  size_t num_outputs = 0;
+  OrtErrorCode error_code = ORT_OK;
+};
+
+void ORT_API_CALL RunAsyncCallback(void* user_data, OrtValue** outputs, size_t num_outputs, OrtStatus* status) {
+  auto* result = static_cast<RunAsyncResult*>(user_data);
+  result->outputs = outputs;
+  result->num_outputs = num_outputs;
+  if (status != nullptr) {
+    // the status is owned by the callback
+    result->error_code = Ort::GetApi().GetErrorCode(status);
+    Ort::GetApi().ReleaseStatus(status);
+  }
+  result->done.set_value();
+}
+}  // namespace
+
+TEST(CApiTest, RunAsync) {
+  Ort::Session session(*ort_env, MODEL_URI, Ort::SessionOptions{});
+  const char* const input_names[] = {"X"};
+  const char* const output_names[] = {"Y"};
+
+  auto memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
+  std::vector<float> x = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+  std::vector<int64_t> dims = {3, 2};
+  Ort::Value input = Ort::Value::CreateTensor<float>(memory_info, x.data(), x.size(), dims.data(), dims.size());
+  const OrtValue* inputs[] = {input};
+
+  Ort::RunOptions run_options;
+  RunAsyncResult result;
+  OrtValue* outputs[] = {nullptr};
+  ASSERT_EQ(Ort::GetApi().RunAsync(session, run_options, input_names, inputs, 1, output_names, 1, outputs,
+                                   RunAsyncCallback, &result),
+            nullptr);
+  result.done.get_future().wait();
+  EXPECT_EQ(result.error_code, ORT_OK);
+  ASSERT_EQ(result.outputs, outputs);
+  ASSERT_EQ(result.num_outputs, 1u);
+  ASSERT_NE(outputs[0], nullptr);
+  // the outputs created by the run are owned by the caller
+  Ort::Value y{outputs[0]};
+  ASSERT_EQ(y.GetTensorTypeAndShapeInfo().GetShape(), dims);
+  const float* y_data = y.GetTensorData<float>();
+  EXPECT_EQ(std::vector<float>(y_data, y_data + x.size()),
+            (std::vector<float>{1.0f, 4.0f, 9.0f, 16.0f, 25.0f, 36.0f}));
+
+  // the error of a cancelled run is passed to the callback, and no output is created
+  Ort::RunOptions terminated_run_options;
+  terminated_run_options.SetTerminate();
+  RunAsyncResult cancelled;
+  Ort::Value cancelled_output{nullptr};
+  session.RunAsync(terminated_run_options, input_names, &input, 1, output_names, &cancelled_output, 1,
+                   RunAsyncCallback, &cancelled);
+  cancelled.done.get_future().wait();
+  EXPECT_NE(cancelled.error_code, ORT_OK);
+  EXPECT_EQ(static_cast<OrtValue*>(cancelled_output), nullptr);
+
+  // errors found before the run is queued are returned right away, without invoking a callback
+  OrtStatus* status = Ort::GetApi().RunAsync(session, run_options, input_names, inputs, 1, output_names, 1,
+                                             outputs, nullptr, nullptr);
+  ASSERT_NE(status, nullptr);
+  EXPECT_EQ(Ort::GetApi().GetErrorCode(status), ORT_INVALID_ARGUMENT);
+  Ort::GetApi().ReleaseStatus(status);
+}
+
 INSTANTIATE_TEST_SUITE_P(CApiTestWithProviders,
                          CApiTestWithProvider,
                          ::testing::Values(0, 1, 2, 3, 4));